@@ -0,0 +1,368 @@
+// arrow_ipc_writer.cpp
+#include "arrow_ipc_writer.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+namespace {
+
+// Minimal flatbuffer builder (same wire layout as the flatbuffers library).
+// The buffer grows towards the front; an object is referred to by its
+// distance from the end of the buffer, which does not change as more is
+// prepended.
+class FlatBufferBuilder {
+public:
+    using Offset = std::uint32_t;
+
+    std::uint32_t size() const { return static_cast<std::uint32_t>(buf_.size() - head_); }
+
+    void align(std::size_t alignment, std::size_t additional = 0)
+    {
+        max_align_ = std::max(max_align_, alignment);
+        std::size_t padding = (alignment - (size() + additional) % alignment) % alignment;
+        prepend_zeros(padding);
+    }
+
+    template <typename T>
+    void push(T value)
+    {
+        align(sizeof(T));
+        prepend(&value, sizeof(T));
+    }
+
+    Offset create_string(const std::string& s)
+    {
+        align(4, s.size() + 1);
+        prepend_zeros(1);
+        prepend(s.data(), s.size());
+        push<std::uint32_t>(static_cast<std::uint32_t>(s.size()));
+        return size();
+    }
+
+    Offset create_offset_vector(const std::vector<Offset>& offsets)
+    {
+        align(4, offsets.size() * 4);
+        for (auto it = offsets.rbegin(); it != offsets.rend(); ++it)
+            push_offset(*it);
+        push<std::uint32_t>(static_cast<std::uint32_t>(offsets.size()));
+        return size();
+    }
+
+    // Structs are passed as raw little-endian bytes of struct_size each.
+    Offset create_struct_vector(const void* data, std::size_t count, std::size_t struct_size, std::size_t struct_align)
+    {
+        align(4, count * struct_size);
+        align(struct_align, count * struct_size);
+        if (count > 0)
+            prepend(data, count * struct_size);
+        push<std::uint32_t>(static_cast<std::uint32_t>(count));
+        return size();
+    }
+
+    void start_table()
+    {
+        fields_.clear();
+        table_start_ = size();
+    }
+
+    template <typename T>
+    void add_scalar(std::uint16_t id, T value)
+    {
+        push(value);
+        fields_.emplace_back(id, size());
+    }
+
+    void add_offset(std::uint16_t id, Offset target)
+    {
+        push_offset(target);
+        fields_.emplace_back(id, size());
+    }
+
+    Offset end_table()
+    {
+        push<std::int32_t>(0); // soffset to the vtable, patched below
+        const Offset table = size();
+        std::uint16_t field_count = 0;
+        for (const auto& field : fields_)
+            field_count = std::max<std::uint16_t>(field_count, field.first + 1);
+        std::vector<std::uint16_t> vtable(2 + field_count, 0);
+        vtable[0] = static_cast<std::uint16_t>(vtable.size() * 2);
+        vtable[1] = static_cast<std::uint16_t>(table - table_start_);
+        for (const auto& field : fields_)
+            vtable[2 + field.first] = static_cast<std::uint16_t>(table - field.second);
+        for (auto it = vtable.rbegin(); it != vtable.rend(); ++it)
+            push<std::uint16_t>(*it);
+        const std::int32_t to_vtable = static_cast<std::int32_t>(size()) - static_cast<std::int32_t>(table);
+        std::memcpy(buf_.data() + buf_.size() - table, &to_vtable, sizeof(to_vtable));
+        return table;
+    }
+
+    std::vector<std::uint8_t> finish(Offset root)
+    {
+        align(max_align_, 4);
+        push_offset(root);
+        return std::vector<std::uint8_t>(buf_.begin() + static_cast<std::ptrdiff_t>(head_), buf_.end());
+    }
+
+private:
+    void push_offset(Offset target)
+    {
+        align(4);
+        push<std::uint32_t>(size() + 4 - target);
+    }
+
+    void reserve(std::size_t bytes)
+    {
+        if (head_ >= bytes)
+            return;
+        std::size_t used = size();
+        std::size_t capacity = std::max<std::size_t>(buf_.size() * 2, used + bytes + 256);
+        std::vector<std::uint8_t> grown(capacity);
+        std::memcpy(grown.data() + capacity - used, buf_.data() + head_, used);
+        buf_.swap(grown);
+        head_ = capacity - used;
+    }
+
+    void prepend(const void* data, std::size_t bytes)
+    {
+        reserve(bytes);
+        head_ -= bytes;
+        std::memcpy(buf_.data() + head_, data, bytes);
+    }
+
+    void prepend_zeros(std::size_t bytes)
+    {
+        reserve(bytes);
+        head_ -= bytes;
+        std::memset(buf_.data() + head_, 0, bytes);
+    }
+
+    std::vector<std::uint8_t> buf_;
+    std::size_t head_ = 0;
+    std::size_t max_align_ = 1;
+    std::uint32_t table_start_ = 0;
+    std::vector<std::pair<std::uint16_t, std::uint32_t>> fields_;
+};
+
+// Arrow format.fbs constants.
+constexpr std::int16_t kMetadataV5 = 4;
+constexpr std::uint8_t kHeaderSchema = 1;
+constexpr std::uint8_t kHeaderRecordBatch = 3;
+constexpr std::uint8_t kTypeInt = 2;
+constexpr std::uint8_t kTypeFloatingPoint = 3;
+constexpr std::uint8_t kTypeFixedSizeList = 16;
+constexpr std::int16_t kPrecisionSingle = 1;
+constexpr std::int16_t kPrecisionDouble = 2;
+constexpr std::uint32_t kContinuation = 0xFFFFFFFF;
+constexpr char kFileMagic[8] = { 'A', 'R', 'R', 'O', 'W', '1', 0, 0 };
+
+std::size_t padded8(std::size_t bytes)
+{
+    return (bytes + 7) / 8 * 8;
+}
+
+FlatBufferBuilder::Offset build_type(FlatBufferBuilder& fb, ColumnType type, std::uint8_t* type_id)
+{
+    fb.start_table();
+    if (type == ColumnType::Int64) {
+        fb.add_scalar<std::int32_t>(0, 64); // bitWidth
+        fb.add_scalar<std::uint8_t>(1, 1); // is_signed
+        *type_id = kTypeInt;
+    } else {
+        fb.add_scalar<std::int16_t>(0, type == ColumnType::Float32 ? kPrecisionSingle : kPrecisionDouble);
+        *type_id = kTypeFloatingPoint;
+    }
+    return fb.end_table();
+}
+
+FlatBufferBuilder::Offset build_field(FlatBufferBuilder& fb, const ColumnSpec& column)
+{
+    FlatBufferBuilder::Offset name = fb.create_string(column.name);
+    std::uint8_t type_id = 0;
+    FlatBufferBuilder::Offset type;
+    FlatBufferBuilder::Offset children;
+    if (column.width > 1) {
+        FlatBufferBuilder::Offset item = build_field(fb, ColumnSpec { "item", column.type, 1 });
+        children = fb.create_offset_vector({ item });
+        fb.start_table();
+        fb.add_scalar<std::int32_t>(0, static_cast<std::int32_t>(column.width)); // listSize
+        type = fb.end_table();
+        type_id = kTypeFixedSizeList;
+    } else {
+        children = fb.create_offset_vector({});
+        type = build_type(fb, column.type, &type_id);
+    }
+    fb.start_table();
+    fb.add_offset(0, name);
+    fb.add_offset(3, type);
+    fb.add_offset(5, children);
+    fb.add_scalar<std::uint8_t>(1, 0); // nullable = false
+    fb.add_scalar<std::uint8_t>(2, type_id); // type_type
+    return fb.end_table();
+}
+
+FlatBufferBuilder::Offset build_schema(FlatBufferBuilder& fb, const std::vector<ColumnSpec>& schema)
+{
+    std::vector<FlatBufferBuilder::Offset> fields;
+    for (const auto& column : schema)
+        fields.push_back(build_field(fb, column));
+    FlatBufferBuilder::Offset field_vector = fb.create_offset_vector(fields);
+    fb.start_table();
+    fb.add_offset(1, field_vector);
+    fb.add_scalar<std::int16_t>(0, 0); // endianness = Little
+    return fb.end_table();
+}
+
+std::vector<std::uint8_t> build_message(FlatBufferBuilder& fb, std::uint8_t header_type, FlatBufferBuilder::Offset header, std::int64_t body_length)
+{
+    fb.start_table();
+    fb.add_scalar<std::int64_t>(3, body_length);
+    fb.add_offset(2, header);
+    fb.add_scalar<std::int16_t>(0, kMetadataV5);
+    fb.add_scalar<std::uint8_t>(1, header_type);
+    return fb.finish(fb.end_table());
+}
+
+} // namespace
+
+ArrowIpcWriter::~ArrowIpcWriter()
+{
+    close();
+}
+
+bool ArrowIpcWriter::write_bytes(const void* data, std::size_t size)
+{
+    if (size > 0 && std::fwrite(data, 1, size, file_) != size) {
+        error_ = "write failed";
+        return false;
+    }
+    position_ += static_cast<std::int64_t>(size);
+    return true;
+}
+
+bool ArrowIpcWriter::write_padding(std::size_t size)
+{
+    static const char zeros[8] = {};
+    return write_bytes(zeros, size);
+}
+
+bool ArrowIpcWriter::write_message(const std::vector<std::uint8_t>& metadata, std::int32_t* metadata_length)
+{
+    // Continuation marker, length, flatbuffer; the body that follows starts 8-byte aligned.
+    std::size_t padded = padded8(metadata.size() + 8) - 8;
+    std::int32_t length = static_cast<std::int32_t>(padded);
+    if (metadata_length)
+        *metadata_length = length + 8;
+    return write_bytes(&kContinuation, 4) && write_bytes(&length, 4)
+        && write_bytes(metadata.data(), metadata.size()) && write_padding(padded - metadata.size());
+}
+
+bool ArrowIpcWriter::open(const std::string& path, const std::vector<ColumnSpec>& schema, ArrowIpcFormat format)
+{
+    close();
+    file_ = std::fopen(path.c_str(), "wb");
+    if (!file_) {
+        error_ = "cannot create '" + path + "': " + std::strerror(errno);
+        return false;
+    }
+    format_ = format;
+    schema_ = schema;
+    batches_.clear();
+    position_ = 0;
+
+    if (format_ == ArrowIpcFormat::File && !write_bytes(kFileMagic, sizeof(kFileMagic)))
+        return false;
+    FlatBufferBuilder fb;
+    FlatBufferBuilder::Offset schema_table = build_schema(fb, schema_);
+    return write_message(build_message(fb, kHeaderSchema, schema_table, 0), nullptr);
+}
+
+bool ArrowIpcWriter::write_batch(const std::vector<const void*>& columns, std::size_t row_count)
+{
+    if (!file_)
+        return false;
+
+    struct FieldNode {
+        std::int64_t length;
+        std::int64_t null_count;
+    };
+    struct BufferRef {
+        std::int64_t offset;
+        std::int64_t length;
+    };
+    std::vector<FieldNode> nodes;
+    std::vector<BufferRef> buffers;
+    std::int64_t body_length = 0;
+    auto add_buffer = [&](std::size_t bytes) {
+        buffers.push_back({ body_length, static_cast<std::int64_t>(bytes) });
+        body_length += static_cast<std::int64_t>(padded8(bytes));
+    };
+    for (const auto& column : schema_) {
+        std::size_t values = row_count * column.width;
+        if (column.width > 1) {
+            nodes.push_back({ static_cast<std::int64_t>(row_count), 0 });
+            add_buffer(0); // List validity (all valid)
+        }
+        nodes.push_back({ static_cast<std::int64_t>(values), 0 });
+        add_buffer(0); // Validity (all valid)
+        add_buffer(values * column_type_size(column.type));
+    }
+
+    FlatBufferBuilder fb;
+    FlatBufferBuilder::Offset buffer_vector = fb.create_struct_vector(buffers.data(), buffers.size(), sizeof(BufferRef), 8);
+    FlatBufferBuilder::Offset node_vector = fb.create_struct_vector(nodes.data(), nodes.size(), sizeof(FieldNode), 8);
+    fb.start_table();
+    fb.add_scalar<std::int64_t>(0, static_cast<std::int64_t>(row_count));
+    fb.add_offset(1, node_vector);
+    fb.add_offset(2, buffer_vector);
+    FlatBufferBuilder::Offset batch = fb.end_table();
+
+    Block block { position_, 0, body_length };
+    if (!write_message(build_message(fb, kHeaderRecordBatch, batch, body_length), &block.metadata_length))
+        return false;
+    for (std::size_t i = 0; i < schema_.size(); ++i) {
+        std::size_t bytes = row_count * schema_[i].width * column_type_size(schema_[i].type);
+        if (!write_bytes(columns[i], bytes) || !write_padding(padded8(bytes) - bytes))
+            return false;
+    }
+    batches_.push_back(block);
+    return true;
+}
+
+bool ArrowIpcWriter::close()
+{
+    if (!file_)
+        return true;
+    bool ok = write_bytes(&kContinuation, 4) && write_padding(4); // End of stream
+
+    if (ok && format_ == ArrowIpcFormat::File) {
+        // Footer: schema again plus the location of every record batch.
+        struct BlockStruct {
+            std::int64_t offset;
+            std::int32_t metadata_length;
+            std::int32_t padding;
+            std::int64_t body_length;
+        };
+        std::vector<BlockStruct> blocks;
+        for (const auto& block : batches_)
+            blocks.push_back({ block.offset, block.metadata_length, 0, block.body_length });
+        FlatBufferBuilder fb;
+        FlatBufferBuilder::Offset schema_table = build_schema(fb, schema_);
+        FlatBufferBuilder::Offset batch_vector = fb.create_struct_vector(blocks.data(), blocks.size(), sizeof(BlockStruct), 8);
+        FlatBufferBuilder::Offset dictionary_vector = fb.create_struct_vector(nullptr, 0, sizeof(BlockStruct), 8);
+        fb.start_table();
+        fb.add_offset(1, schema_table);
+        fb.add_offset(2, dictionary_vector);
+        fb.add_offset(3, batch_vector);
+        fb.add_scalar<std::int16_t>(0, kMetadataV5);
+        std::vector<std::uint8_t> footer = fb.finish(fb.end_table());
+        std::int32_t footer_length = static_cast<std::int32_t>(footer.size());
+        ok = write_bytes(footer.data(), footer.size()) && write_bytes(&footer_length, 4) && write_bytes(kFileMagic, 6);
+    }
+    if (std::fclose(file_) != 0 && ok) {
+        error_ = "write failed";
+        ok = false;
+    }
+    file_ = nullptr;
+    return ok;
+}
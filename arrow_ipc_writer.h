@@ -0,0 +1,66 @@
+// arrow_ipc_writer.h
+// Self-contained writer for the Apache Arrow IPC format (columnar format
+// version 1.0, metadata V5), so results open in pyarrow/pandas/polars
+// without parsing:
+//   File   - "Feather v2" / .arrow; memory-mappable, e.g.
+//            pyarrow.ipc.open_file / polars.read_ipc(memory_map=True)
+//   Stream - .arrows; pyarrow.ipc.open_stream / polars.read_ipc_stream
+// The flatbuffer metadata is built by hand; there is no Arrow dependency.
+//
+// Column mapping: Int64 -> int64, Float64 -> double, Float32 -> float; a
+// column of width N > 1 becomes fixed_size_list<N> of its element type.
+// All columns are non-nullable.
+#ifndef ARROW_IPC_WRITER_H
+#define ARROW_IPC_WRITER_H
+
+#include "columnar_recorder.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+enum class ArrowIpcFormat {
+    File,
+    Stream,
+};
+
+class ArrowIpcWriter {
+public:
+    ArrowIpcWriter() = default;
+    ~ArrowIpcWriter();
+    ArrowIpcWriter(const ArrowIpcWriter&) = delete;
+    ArrowIpcWriter& operator=(const ArrowIpcWriter&) = delete;
+
+    // Writes the schema message. Returns false and fills error() on failure.
+    bool open(const std::string& path, const std::vector<ColumnSpec>& schema, ArrowIpcFormat format = ArrowIpcFormat::File);
+    // One record batch; columns[i] points to row_count * width values of column i.
+    bool write_batch(const std::vector<const void*>& columns, std::size_t row_count);
+    // Writes the end-of-stream marker (and the footer for the file format).
+    bool close();
+
+    bool is_open() const { return file_ != nullptr; }
+    const std::string& error() const { return error_; }
+    std::size_t batches_written() const { return batches_.size(); }
+
+private:
+    struct Block {
+        std::int64_t offset;
+        std::int32_t metadata_length;
+        std::int64_t body_length;
+    };
+
+    bool write_bytes(const void* data, std::size_t size);
+    bool write_padding(std::size_t size);
+    // Writes an encapsulated message; returns the metadata length including its prefix.
+    bool write_message(const std::vector<std::uint8_t>& metadata, std::int32_t* metadata_length);
+
+    std::FILE* file_ = nullptr;
+    ArrowIpcFormat format_ = ArrowIpcFormat::File;
+    std::vector<ColumnSpec> schema_;
+    std::vector<Block> batches_;
+    std::int64_t position_ = 0;
+    std::string error_;
+};
+
+#endif // ARROW_IPC_WRITER_H
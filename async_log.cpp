@@ -0,0 +1,273 @@
+// async_log.cpp
+#include "async_log.h"
+#include <algorithm>
+
+namespace async_log_detail {
+
+Ring::Ring(std::size_t capacity_bytes, std::thread::id owner)
+    : owner_(owner)
+{
+    std::size_t capacity = 4096;
+    while (capacity < capacity_bytes)
+        capacity <<= 1;
+    buffer_ = std::make_unique<unsigned char[]>(capacity);
+    mask_ = capacity - 1;
+}
+
+void* Ring::reserve(std::size_t bytes)
+{
+    const std::uint64_t head = head_.load(std::memory_order_relaxed);
+    const std::size_t position = head & mask_;
+    const std::size_t contiguous = capacity() - position;
+    // A record never wraps: the rest of the ring becomes filler first.
+    const std::size_t needed = bytes <= contiguous ? bytes : contiguous + bytes;
+    if (head + needed - cached_tail_ > capacity()) {
+        cached_tail_ = tail_.load(std::memory_order_acquire);
+        if (head + needed - cached_tail_ > capacity())
+            return nullptr;
+    }
+    unsigned char* slot = buffer_.get() + position;
+    if (bytes > contiguous) {
+        auto* filler = reinterpret_cast<RecordHeader*>(slot);
+        filler->size = static_cast<std::uint32_t>(contiguous);
+        filler->format = nullptr;
+        head_.store(head + contiguous, std::memory_order_release);
+        slot = buffer_.get();
+    }
+    reinterpret_cast<RecordHeader*>(slot)->size = static_cast<std::uint32_t>(bytes);
+    return slot;
+}
+
+void Ring::commit(std::size_t bytes)
+{
+    head_.store(head_.load(std::memory_order_relaxed) + bytes, std::memory_order_release);
+    enqueued.fetch_add(1, std::memory_order_relaxed);
+}
+
+namespace {
+
+class Backend {
+public:
+    void start(const AsyncLogSettings& settings)
+    {
+        stop();
+        settings_ = settings;
+        stopping_ = false;
+        generation_.fetch_add(1, std::memory_order_relaxed);
+        active_.store(true, std::memory_order_seq_cst);
+        thread_ = std::thread([this] { run(); });
+    }
+
+    void stop()
+    {
+        if (!active_.load(std::memory_order_acquire))
+            return;
+        // New log calls now go straight to the sinks; calls that already hold
+        // a ring finish their record before the backend's final drain.
+        active_.store(false, std::memory_order_seq_cst);
+        std::vector<std::shared_ptr<Ring>> rings;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            rings = rings_;
+        }
+        for (const auto& ring : rings) {
+            while (ring->writing.load(std::memory_order_seq_cst)) {
+                wake_.notify_one();
+                std::this_thread::yield();
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        wake_.notify_one();
+        thread_.join();
+    }
+
+    bool active() const { return active_.load(std::memory_order_seq_cst); }
+    std::uint64_t generation() const { return generation_.load(std::memory_order_relaxed); }
+    LogOverflowPolicy overflow() const { return settings_.overflow; }
+
+    std::shared_ptr<Ring> register_ring()
+    {
+        auto ring = std::make_shared<Ring>(settings_.ring_bytes, std::this_thread::get_id());
+        std::lock_guard<std::mutex> lock(mutex_);
+        rings_.push_back(ring);
+        rings_changed_ = true;
+        return ring;
+    }
+
+    void wake() { wake_.notify_one(); }
+
+    AsyncLogStats stats()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        AsyncLogStats total = retired_;
+        for (const auto& ring : rings_)
+            add_ring_stats(total, *ring);
+        return total;
+    }
+
+private:
+    static void add_ring_stats(AsyncLogStats& total, const Ring& ring)
+    {
+        total.enqueued += ring.enqueued.load(std::memory_order_relaxed);
+        total.dropped += ring.dropped.load(std::memory_order_relaxed);
+        total.blocked += ring.blocked.load(std::memory_order_relaxed);
+        total.oversized += ring.oversized.load(std::memory_order_relaxed);
+    }
+
+    static void emit(RecordHeader& header, unsigned char* args, fmt::memory_buffer& buffer)
+    {
+        buffer.clear();
+        header.format(args, fmt::string_view(header.format_data, header.format_size), buffer);
+        header.target->log(header.time, spdlog::source_loc {}, static_cast<spdlog::level::level_enum>(header.level),
+            spdlog::string_view_t(buffer.data(), buffer.size()));
+        header.destroy(args);
+    }
+
+    void run()
+    {
+        std::vector<std::shared_ptr<Ring>> rings;
+        fmt::memory_buffer buffer;
+        std::uint64_t reported_dropped = stats().dropped; // Earlier runs reported their own
+        while (true) {
+            bool stopping;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                stopping = stopping_;
+                if (rings_changed_) {
+                    rings = rings_;
+                    rings_changed_ = false;
+                }
+            }
+
+            std::size_t handled = 0;
+            std::uint64_t dropped = 0;
+            for (const auto& ring : rings) {
+                handled += ring->drain([&](RecordHeader& header, unsigned char* args) { emit(header, args, buffer); });
+                dropped += ring->dropped.load(std::memory_order_relaxed);
+            }
+            dropped += retired_.dropped;
+            if (dropped > reported_dropped) {
+                spdlog::default_logger_raw()->warn("[AsyncLog] {} log records dropped (ring full).", dropped - reported_dropped);
+                reported_dropped = dropped;
+            }
+            retire_abandoned_rings(rings);
+
+            if (handled > 0)
+                continue;
+            if (stopping)
+                return;
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait_for(lock, settings_.idle_poll, [this] { return stopping_ || rings_changed_; });
+        }
+    }
+
+    void retire_abandoned_rings(std::vector<std::shared_ptr<Ring>>& rings)
+    {
+        bool any = std::any_of(rings.begin(), rings.end(), [](const auto& ring) {
+            return ring->abandoned.load(std::memory_order_acquire) && ring->empty();
+        });
+        if (!any)
+            return;
+        std::lock_guard<std::mutex> lock(mutex_);
+        // partition, not remove_if: the retired rings are still read below.
+        auto retired = std::stable_partition(rings_.begin(), rings_.end(), [](const auto& ring) {
+            return !(ring->abandoned.load(std::memory_order_acquire) && ring->empty());
+        });
+        for (auto it = retired; it != rings_.end(); ++it)
+            add_ring_stats(retired_, **it);
+        rings_.erase(retired, rings_.end());
+        rings = rings_;
+        rings_changed_ = false;
+    }
+
+    AsyncLogSettings settings_;
+    std::atomic<bool> active_ { false };
+    std::atomic<std::uint64_t> generation_ { 0 };
+    std::thread thread_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::vector<std::shared_ptr<Ring>> rings_;
+    bool rings_changed_ = false;
+    bool stopping_ = false;
+    AsyncLogStats retired_;
+};
+
+Backend& backend()
+{
+    static Backend instance;
+    return instance;
+}
+
+struct ProducerSlot {
+    std::shared_ptr<Ring> ring;
+    std::uint64_t generation = 0;
+    ~ProducerSlot()
+    {
+        if (ring)
+            ring->abandoned.store(true, std::memory_order_release);
+    }
+};
+
+} // namespace
+
+Ring* producer_ring()
+{
+    Backend& b = backend();
+    thread_local ProducerSlot slot;
+    if (!b.active()) {
+        // While stop() drains, this thread's earlier records leave its ring
+        // before it logs synchronously.
+        if (slot.ring)
+            while (!slot.ring->empty())
+                std::this_thread::yield();
+        return nullptr;
+    }
+    if (!slot.ring || slot.generation != b.generation()) {
+        if (slot.ring)
+            slot.ring->abandoned.store(true, std::memory_order_release);
+        slot.ring = b.register_ring();
+        slot.generation = b.generation();
+    }
+    // Pairs with stop(): either it sees this ring writing and waits, or this
+    // call sees the backend stopping and logs synchronously.
+    slot.ring->writing.store(true, std::memory_order_seq_cst);
+    if (!b.active()) {
+        slot.ring->writing.store(false, std::memory_order_release);
+        while (!slot.ring->empty())
+            std::this_thread::yield();
+        return nullptr;
+    }
+    return slot.ring.get();
+}
+
+LogOverflowPolicy overflow_policy()
+{
+    return backend().overflow();
+}
+
+void wait_for_room(Ring& /*ring*/)
+{
+    backend().wake();
+    std::this_thread::yield();
+}
+
+} // namespace async_log_detail
+
+void start_async_logging(const AsyncLogSettings& settings)
+{
+    if (settings.enabled)
+        async_log_detail::backend().start(settings);
+}
+
+void stop_async_logging()
+{
+    async_log_detail::backend().stop();
+}
+
+AsyncLogStats async_log_stats()
+{
+    return async_log_detail::backend().stats();
+}
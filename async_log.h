@@ -0,0 +1,250 @@
+// async_log.h
+// Asynchronous front end for the spdlog loggers. A log call on the
+// simulation thread only checks the level and copies its raw arguments into
+// that thread's single-producer/single-consumer ring; a background thread
+// formats the records and hands them to the spdlog sinks with the original
+// timestamp. Per thread, records keep their order.
+//
+// Format strings must be literals (only their address is stored). Character
+// pointers and string views are copied into std::string, since they usually
+// point at temporaries (a null character pointer is logged as "(null)");
+// everything else is copied as-is.
+#ifndef ASYNC_LOG_H
+#define ASYNC_LOG_H
+
+#include "spdlog/spdlog.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+enum class LogOverflowPolicy {
+    Block, // Wait for the backend to make room (nothing is lost)
+    Drop, // Discard the new record and count it
+};
+
+struct AsyncLogSettings {
+    bool enabled = true;
+    std::size_t ring_bytes = std::size_t(1) << 20; // Per producing thread, rounded up to a power of two
+    LogOverflowPolicy overflow = LogOverflowPolicy::Block;
+    std::chrono::milliseconds idle_poll { 2 }; // Backend sleep when every ring is empty
+};
+
+struct AsyncLogStats {
+    std::uint64_t enqueued = 0;
+    std::uint64_t dropped = 0;
+    std::uint64_t blocked = 0; // Records that had to wait for room
+    std::uint64_t oversized = 0; // Records too large for a ring, logged synchronously
+};
+
+namespace async_log_detail {
+
+// Fixed part of every record in a ring. size covers the header, the argument
+// tuple and alignment padding; a record with no format function is filler
+// before the ring wraps.
+struct RecordHeader {
+    std::uint32_t size;
+    std::uint32_t level;
+    void (*format)(const void* args, fmt::string_view format_string, fmt::memory_buffer& out);
+    void (*destroy)(void* args);
+    spdlog::logger* target;
+    const char* format_data;
+    std::size_t format_size;
+    spdlog::log_clock::time_point time;
+};
+
+constexpr std::size_t kRecordAlign = 16;
+
+constexpr std::size_t align_up(std::size_t bytes)
+{
+    return (bytes + kRecordAlign - 1) / kRecordAlign * kRecordAlign;
+}
+
+constexpr std::size_t kHeaderBytes = align_up(sizeof(RecordHeader));
+
+class Ring {
+public:
+    Ring(std::size_t capacity_bytes, std::thread::id owner);
+
+    // Producer side. reserve() returns null when the record does not fit now.
+    void* reserve(std::size_t bytes);
+    void commit(std::size_t bytes);
+
+    // Consumer side. Returns the number of records handled.
+    template <typename Fn>
+    std::size_t drain(Fn&& handle)
+    {
+        std::size_t handled = 0;
+        std::uint64_t tail = tail_.load(std::memory_order_relaxed);
+        const std::uint64_t head = head_.load(std::memory_order_acquire);
+        while (tail != head) {
+            auto* header = reinterpret_cast<RecordHeader*>(buffer_.get() + (tail & mask_));
+            if (header->format) {
+                handle(*header, reinterpret_cast<unsigned char*>(header) + kHeaderBytes);
+                ++handled;
+            }
+            tail += header->size;
+            tail_.store(tail, std::memory_order_release);
+        }
+        return handled;
+    }
+
+    std::size_t capacity() const { return mask_ + 1; }
+    std::thread::id owner() const { return owner_; }
+    bool empty() const { return tail_.load(std::memory_order_acquire) == head_.load(std::memory_order_acquire); }
+
+    std::atomic<std::uint64_t> enqueued { 0 };
+    std::atomic<std::uint64_t> dropped { 0 };
+    std::atomic<std::uint64_t> blocked { 0 };
+    std::atomic<std::uint64_t> oversized { 0 };
+    std::atomic<bool> abandoned { false }; // Producer thread has exited
+    std::atomic<bool> writing { false }; // Producer is inside a log call (see producer_ring)
+
+private:
+    std::unique_ptr<unsigned char[]> buffer_;
+    std::size_t mask_;
+    std::thread::id owner_;
+    alignas(64) std::atomic<std::uint64_t> head_ { 0 };
+    std::uint64_t cached_tail_ = 0; // Producer's view of tail_
+    alignas(64) std::atomic<std::uint64_t> tail_ { 0 };
+};
+
+// Returns the calling thread's ring marked as writing, or null if the
+// backend is not running. The caller clears Ring::writing when the record is
+// committed or abandoned; stop_async_logging waits for that before the final
+// drain, so no record is left behind in a ring.
+Ring* producer_ring();
+LogOverflowPolicy overflow_policy();
+void wait_for_room(Ring& ring);
+
+template <typename T>
+using captured_t = std::conditional_t<
+    std::is_same_v<std::decay_t<T>, const char*> || std::is_same_v<std::decay_t<T>, char*>
+        || std::is_same_v<std::decay_t<T>, std::string_view>,
+    std::string,
+    std::decay_t<T>>;
+
+template <typename T>
+decltype(auto) capture(T&& value)
+{
+    if constexpr (std::is_same_v<std::decay_t<T>, const char*> || std::is_same_v<std::decay_t<T>, char*>) {
+        const char* text = value;
+        return text ? std::string(text) : std::string("(null)");
+    } else {
+        return std::forward<T>(value);
+    }
+}
+
+template <typename Tuple>
+void format_tuple(const void* args, fmt::string_view format_string, fmt::memory_buffer& out)
+{
+    std::apply([&](const auto&... values) { fmt::vformat_to(std::back_inserter(out), format_string, fmt::make_format_args(values...)); },
+        *static_cast<const Tuple*>(args));
+}
+
+template <typename Tuple>
+void destroy_tuple(void* args)
+{
+    static_cast<Tuple*>(args)->~Tuple();
+}
+
+} // namespace async_log_detail
+
+// Starts the backend thread; log calls made before this (or after
+// stop_async_logging) go straight to the sinks.
+void start_async_logging(const AsyncLogSettings& settings);
+// Drains every ring, then stops the backend thread.
+void stop_async_logging();
+AsyncLogStats async_log_stats();
+
+// Drop-in for the spdlog::logger calls used by the simulation.
+class AsyncLogger {
+public:
+    explicit AsyncLogger(std::shared_ptr<spdlog::logger> target)
+        : target_(std::move(target))
+    {
+    }
+
+    spdlog::logger& target() const { return *target_; }
+    bool should_log(spdlog::level::level_enum level) const { return target_->should_log(level); }
+    void set_level(spdlog::level::level_enum level) { target_->set_level(level); }
+
+    template <typename... Args>
+    void log(spdlog::level::level_enum level, fmt::format_string<Args...> format_string, Args&&... args)
+    {
+        if (!target_->should_log(level))
+            return;
+        using Tuple = std::tuple<async_log_detail::captured_t<Args>...>;
+        constexpr std::size_t bytes = async_log_detail::kHeaderBytes + async_log_detail::align_up(sizeof(Tuple));
+        static_assert(alignof(Tuple) <= async_log_detail::kRecordAlign, "Log argument alignment exceeds record alignment");
+
+        async_log_detail::Ring* ring = async_log_detail::producer_ring();
+        if (!ring || bytes > ring->capacity() / 2) {
+            if (ring) {
+                // Earlier records of this thread reach the sinks first.
+                ring->oversized.fetch_add(1, std::memory_order_relaxed);
+                while (!ring->empty())
+                    async_log_detail::wait_for_room(*ring);
+                ring->writing.store(false, std::memory_order_release);
+            }
+            Tuple captured(async_log_detail::capture(std::forward<Args>(args))...);
+            fmt::memory_buffer buffer;
+            async_log_detail::format_tuple<Tuple>(&captured, format_string, buffer);
+            target_->log(level, spdlog::string_view_t(buffer.data(), buffer.size()));
+            return;
+        }
+        void* slot = ring->reserve(bytes);
+        if (!slot) {
+            if (async_log_detail::overflow_policy() == LogOverflowPolicy::Drop) {
+                ring->dropped.fetch_add(1, std::memory_order_relaxed);
+                ring->writing.store(false, std::memory_order_release);
+                return;
+            }
+            ring->blocked.fetch_add(1, std::memory_order_relaxed);
+            while (!(slot = ring->reserve(bytes)))
+                async_log_detail::wait_for_room(*ring);
+        }
+        auto* header = static_cast<async_log_detail::RecordHeader*>(slot);
+        fmt::string_view format_view = format_string;
+        header->level = static_cast<std::uint32_t>(level);
+        header->format = &async_log_detail::format_tuple<Tuple>;
+        header->destroy = &async_log_detail::destroy_tuple<Tuple>;
+        header->target = target_.get();
+        header->format_data = format_view.data();
+        header->format_size = format_view.size();
+        header->time = spdlog::log_clock::now();
+        new (static_cast<unsigned char*>(slot) + async_log_detail::kHeaderBytes) Tuple(async_log_detail::capture(std::forward<Args>(args))...);
+        ring->commit(bytes);
+        ring->writing.store(false, std::memory_order_release);
+    }
+
+    template <typename... Args>
+    void trace(fmt::format_string<Args...> format_string, Args&&... args) { log(spdlog::level::trace, format_string, std::forward<Args>(args)...); }
+    template <typename... Args>
+    void debug(fmt::format_string<Args...> format_string, Args&&... args) { log(spdlog::level::debug, format_string, std::forward<Args>(args)...); }
+    template <typename... Args>
+    void info(fmt::format_string<Args...> format_string, Args&&... args) { log(spdlog::level::info, format_string, std::forward<Args>(args)...); }
+    template <typename... Args>
+    void warn(fmt::format_string<Args...> format_string, Args&&... args) { log(spdlog::level::warn, format_string, std::forward<Args>(args)...); }
+    template <typename... Args>
+    void error(fmt::format_string<Args...> format_string, Args&&... args) { log(spdlog::level::err, format_string, std::forward<Args>(args)...); }
+    template <typename... Args>
+    void critical(fmt::format_string<Args...> format_string, Args&&... args) { log(spdlog::level::critical, format_string, std::forward<Args>(args)...); }
+
+private:
+    std::shared_ptr<spdlog::logger> target_;
+};
+
+#endif // ASYNC_LOG_H
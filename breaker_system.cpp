@@ -0,0 +1,200 @@
+// breaker_system.cpp
+#include "breaker_system.h"
+#include "logging_utils.h"
+#include "simulation_events_and_data.h"
+#include <utility>
+
+namespace {
+// Timer tag: breaker index, timer kind, and the low bits of the generation.
+constexpr int kTimerShift = 32;
+constexpr int kGenerationShift = 35;
+constexpr std::uint64_t kGenerationMask = (std::uint64_t { 1 } << (64 - kGenerationShift)) - 1;
+}
+
+BreakerSystem::BreakerSystem(cps_coro::Scheduler& sch)
+    : scheduler_(sch)
+{
+}
+
+std::size_t BreakerSystem::add(Entity entity, const BreakerSettings& settings, std::string name)
+{
+    const auto index = static_cast<std::uint32_t>(entities_.size());
+    entities_.push_back(entity);
+    settings_.push_back(settings);
+    if (settings_.back().reclose_shots > settings.dead_time_ms.size())
+        settings_.back().reclose_shots = static_cast<std::uint8_t>(settings.dead_time_ms.size());
+    breakers_.emplace_back();
+    index_of_[entity] = index;
+    if (name.empty())
+        return index;
+    names_[index] = std::move(name);
+    if (listening_)
+        HECS_LOG_INFO(LogSubsystem::Protection, "[{}ms] [BreakerAgent_PROT-{}-#{}] Active, awaiting ENTITY_TRIP_EVENT_PROT.",
+            scheduler_.now().time_since_epoch().count(), names_[index], entity);
+    return index;
+}
+
+void BreakerSystem::set_backups(Entity entity, std::vector<Entity> backups)
+{
+    auto it = index_of_.find(entity);
+    if (it != index_of_.end())
+        backups_[it->second] = std::move(backups);
+}
+
+void BreakerSystem::set_stuck(Entity entity, bool stuck)
+{
+    auto it = index_of_.find(entity);
+    if (it != index_of_.end())
+        breakers_[it->second].stuck = stuck;
+}
+
+const std::string* BreakerSystem::name(std::uint32_t index) const
+{
+    auto it = names_.find(index);
+    return it == names_.end() ? nullptr : &it->second;
+}
+
+BreakerSystem::State BreakerSystem::state(Entity entity) const
+{
+    auto it = index_of_.find(entity);
+    return it == index_of_.end() ? State::Closed : breakers_[it->second].state;
+}
+
+void BreakerSystem::start()
+{
+    if (listening_)
+        return;
+    listening_ = true;
+    for (std::uint32_t i = 0; i < entities_.size(); ++i)
+        if (const std::string* named = name(i))
+            HECS_LOG_INFO(LogSubsystem::Protection, "[{}ms] [BreakerAgent_PROT-{}-#{}] Active, awaiting ENTITY_TRIP_EVENT_PROT.",
+                scheduler_.now().time_since_epoch().count(), *named, entities_[i]);
+    listen();
+}
+
+void BreakerSystem::listen()
+{
+    // Event handlers are one-shot: re-register after each trip command.
+    scheduler_.register_event_handler(ENTITY_TRIP_EVENT_PROT, [this](const void* data) {
+        if (data)
+            trip(*static_cast<const Entity*>(data));
+        listen();
+    });
+}
+
+bool BreakerSystem::trip(Entity entity)
+{
+    auto it = index_of_.find(entity);
+    if (it == index_of_.end())
+        return false;
+    trip_index(it->second);
+    return true;
+}
+
+void BreakerSystem::trip_index(std::uint32_t index)
+{
+    Breaker& breaker = breakers_[index];
+    const State state = breaker.state;
+    // Opening ignores trips until its operating time has passed; lockout and
+    // dead time belong to the reclosing sequence.
+    if ((state == State::Opening && !breaker.failed_to_open) || state == State::DeadTime || state == State::Lockout)
+        return;
+    breaker.failed_to_open = false;
+    ++stats_.trips;
+    if (const std::string* named = name(index))
+        HECS_LOG_INFO(LogSubsystem::Protection, "[{}ms] [BreakerAgent_PROT-{}-#{}] Received TRIP for self.",
+            scheduler_.now().time_since_epoch().count(), *named, entities_[index]);
+    set_state(index, State::Opening);
+    start_timer(index, Timer::ContactsOpen, settings_[index].operate_ms);
+    if (settings_[index].failure_ms > 0)
+        start_timer(index, Timer::Failure, settings_[index].failure_ms);
+}
+
+void BreakerSystem::set_state(std::uint32_t index, State state)
+{
+    breakers_[index].state = state;
+    ++breakers_[index].generation;
+}
+
+void BreakerSystem::start_timer(std::uint32_t index, Timer timer, int delay_ms)
+{
+    const std::uint64_t tag = index | (static_cast<std::uint64_t>(timer) << kTimerShift)
+        | ((breakers_[index].generation & kGenerationMask) << kGenerationShift);
+    scheduler_.call_after(cps_coro::Scheduler::duration(delay_ms), &BreakerSystem::on_timer, this, tag);
+}
+
+void BreakerSystem::on_timer(void* context, std::uint64_t tag)
+{
+    auto* system = static_cast<BreakerSystem*>(context);
+    const auto index = static_cast<std::uint32_t>(tag);
+    if ((system->breakers_[index].generation & kGenerationMask) != tag >> kGenerationShift)
+        return; // The breaker changed state since the timer started
+    system->expire(index, static_cast<Timer>((tag >> kTimerShift) & 0x7));
+}
+
+void BreakerSystem::expire(std::uint32_t index, Timer timer)
+{
+    Breaker& breaker = breakers_[index];
+    const BreakerSettings& settings = settings_[index];
+    const auto now_ms = scheduler_.now().time_since_epoch().count();
+    switch (timer) {
+    case Timer::ContactsOpen:
+        if (breaker.stuck) {
+            breaker.failed_to_open = true; // Stays opening; 50BF, if set, acts
+            return;
+        }
+        set_state(index, State::Open);
+        ++stats_.openings;
+        if (const std::string* named = name(index))
+            HECS_LOG_INFO(LogSubsystem::Protection, "[{}ms] [BreakerAgent_PROT-{}-#{}] Breaker OPENED.", now_ms, *named, entities_[index]);
+        after_opening(index);
+        scheduler_.trigger_event(BREAKER_OPENED_EVENT, entities_[index]);
+        break;
+    case Timer::Failure: {
+        ++stats_.failures;
+        auto it = backups_.find(index);
+        const std::size_t backup_count = it == backups_.end() ? 0 : it->second.size();
+        if (const std::string* named = name(index))
+            HECS_LOG_INFO(LogSubsystem::Protection, "[{}ms] [BreakerAgent_PROT-{}-#{}] BREAKER FAILURE: not open {} ms after TRIP, tripping {} backup breakers.",
+                now_ms, *named, entities_[index], settings.failure_ms, backup_count);
+        for (std::size_t b = 0; b < backup_count; ++b)
+            trip(it->second[b]);
+        break;
+    }
+    case Timer::Reclose:
+        set_state(index, State::Closing);
+        start_timer(index, Timer::ContactsClosed, settings.close_ms);
+        break;
+    case Timer::ContactsClosed:
+        set_state(index, State::Closed);
+        ++stats_.reclosures;
+        if (const std::string* named = name(index))
+            HECS_LOG_INFO(LogSubsystem::Protection, "[{}ms] [BreakerAgent_PROT-{}-#{}] Breaker RECLOSED (shot {} of {}).",
+                now_ms, *named, entities_[index], breaker.shot, settings.reclose_shots);
+        start_timer(index, Timer::Reclaim, settings.reclaim_ms);
+        scheduler_.trigger_event(BREAKER_CLOSED_EVENT, entities_[index]);
+        break;
+    case Timer::Reclaim:
+        breaker.shot = 0;
+        break;
+    }
+}
+
+void BreakerSystem::after_opening(std::uint32_t index)
+{
+    Breaker& breaker = breakers_[index];
+    const BreakerSettings& settings = settings_[index];
+    if (settings.reclose_shots == 0)
+        return;
+    if (breaker.shot < settings.reclose_shots) {
+        set_state(index, State::DeadTime);
+        start_timer(index, Timer::Reclose, settings.dead_time_ms[breaker.shot]);
+        ++breaker.shot;
+        return;
+    }
+    set_state(index, State::Lockout);
+    ++stats_.lockouts;
+    if (const std::string* named = name(index))
+        HECS_LOG_INFO(LogSubsystem::Protection, "[{}ms] [BreakerAgent_PROT-{}-#{}] LOCKOUT after {} reclose shots.",
+            scheduler_.now().time_since_epoch().count(), *named, entities_[index], settings.reclose_shots);
+}
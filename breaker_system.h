@@ -0,0 +1,123 @@
+// breaker_system.h
+// Circuit breakers, auto-reclosing and breaker-failure protection (50BF) as
+// small state machines, stepped by one system over flat arrays.
+//
+// Each breaker is a few bytes of state plus its settings, indexed by
+// position; there is no coroutine per breaker. The system listens for
+// ENTITY_TRIP_EVENT_PROT once for all breakers, and every timer (operating
+// time, dead time, reclaim time, 50BF) is a scheduler timer callback whose
+// tag carries the breaker index, the timer kind and the breaker's state
+// generation. A state change bumps the generation, so a timer that no longer
+// applies is recognised as stale when it expires instead of being cancelled.
+//
+// Without reclosing and 50BF a breaker behaves like the former per-breaker
+// agent: a trip command opens it after the operating time and raises
+// BREAKER_OPENED_EVENT. Trips while it is opening are ignored; a trip while
+// it is open opens it again and raises BREAKER_OPENED_EVENT again.
+//   - Auto-reclose: after a trip, the breaker closes again after the dead
+//     time of the next shot and raises BREAKER_CLOSED_EVENT. A trip within
+//     the reclaim time counts as the next shot; when the shots are used up
+//     the breaker locks out open. After the reclaim time the count resets.
+//   - 50BF: when a breaker has not opened `failure_ms` after a trip command
+//     (e.g. stuck, see set_stuck), its backup breakers are tripped.
+// A stuck breaker stays Opening past its operating time; clearing the fault
+// is left to 50BF. It is not held there: the next trip command retries the
+// opening (after set_stuck(false), it opens).
+#ifndef BREAKER_SYSTEM_H
+#define BREAKER_SYSTEM_H
+
+#include "cps_coro_lib.h"
+#include "ecs_core.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct BreakerSettings {
+    std::uint16_t operate_ms = 100; // Trip command to contacts open
+    std::uint16_t close_ms = 100; // Close command to contacts closed
+    std::uint16_t failure_ms = 0; // 50BF time from the trip command; 0 for none
+    std::uint16_t reclaim_ms = 10000;
+    std::uint8_t reclose_shots = 0; // Up to dead_time_ms.size()
+    std::array<std::uint16_t, 3> dead_time_ms { 500, 5000, 15000 };
+};
+
+struct BreakerStats {
+    std::size_t trips = 0; // Trip commands accepted
+    std::size_t openings = 0;
+    std::size_t reclosures = 0;
+    std::size_t lockouts = 0;
+    std::size_t failures = 0; // 50BF operations
+};
+
+class BreakerSystem {
+public:
+    enum class State : std::uint8_t {
+        Closed,
+        Opening,
+        Open,
+        DeadTime, // Open, waiting to reclose
+        Closing,
+        Lockout
+    };
+
+    explicit BreakerSystem(cps_coro::Scheduler& sch);
+
+    // Adds the breaker operated by trips of `entity` and returns its index.
+    // Named breakers log their operations; unnamed ones only count them.
+    std::size_t add(Entity entity, const BreakerSettings& settings = {}, std::string name = {});
+    // Breakers tripped by 50BF when `entity`'s breaker fails to open.
+    void set_backups(Entity entity, std::vector<Entity> backups);
+    // A stuck breaker accepts trip commands but does not open.
+    void set_stuck(Entity entity, bool stuck);
+    // Starts listening for ENTITY_TRIP_EVENT_PROT.
+    void start();
+    // Trip command, as ENTITY_TRIP_EVENT_PROT does; false for an unknown
+    // entity.
+    bool trip(Entity entity);
+
+    std::size_t size() const { return entities_.size(); }
+    // Bytes of settings and state per breaker, excluding the entity lookup.
+    static constexpr std::size_t bytes_per_breaker() { return sizeof(BreakerSettings) + sizeof(Breaker) + sizeof(Entity); }
+    State state(Entity entity) const;
+    const BreakerStats& stats() const { return stats_; }
+
+private:
+    enum class Timer : std::uint8_t {
+        ContactsOpen,
+        Failure,
+        Reclose,
+        ContactsClosed,
+        Reclaim
+    };
+    struct Breaker {
+        State state = State::Closed;
+        std::uint8_t shot = 0; // Reclose shots used since the last reclaim
+        bool stuck = false;
+        bool failed_to_open = false; // Operating time passed while stuck
+        std::uint32_t generation = 0; // Bumped on every state change
+    };
+
+    void listen();
+    void trip_index(std::uint32_t index);
+    void set_state(std::uint32_t index, State state);
+    void start_timer(std::uint32_t index, Timer timer, int delay_ms);
+    static void on_timer(void* context, std::uint64_t tag);
+    void expire(std::uint32_t index, Timer timer);
+    void after_opening(std::uint32_t index);
+    const std::string* name(std::uint32_t index) const;
+
+    cps_coro::Scheduler& scheduler_;
+    std::vector<Entity> entities_;
+    std::vector<BreakerSettings> settings_;
+    std::vector<Breaker> breakers_;
+    std::unordered_map<std::uint32_t, std::string> names_; // Named breakers only
+    std::unordered_map<Entity, std::uint32_t> index_of_;
+    std::unordered_map<std::uint32_t, std::vector<Entity>> backups_;
+    bool listening_ = false;
+    BreakerStats stats_;
+};
+
+#endif // BREAKER_SYSTEM_H
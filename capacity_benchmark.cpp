@@ -0,0 +1,793 @@
+// capacity_benchmark.cpp
+// Capacity checks of the simulation subsystems on workloads far larger than
+// the demo scenario in main.cpp, each on its own registry and scheduler.
+//
+// Usage: hecs_capacity_benchmark [check ...]   (default: every check)
+//
+// Checks:
+//   multirate
+//           one simulated hour of the frequency control layers over 2000 EV
+//           piles in 200 stations and 500 ESS units, with the multi-rate
+//           periods and with every layer at the 20 ms primary rate
+//   sweep   fault sweep of the demo relays: 108k faults along Line1 and
+//           inside Transformer1, every fault type and pre-fault voltage
+//   feeder  radial power flow of one random 10k-bus feeder: a cold solve,
+//           then a warm solve after a 1 % load change (step budget 20 ms)
+//   phasor  full-cycle DFT phasor estimation of 4096 channels sampled at
+//           12.8 kHz (256 per cycle), one second of samples
+//   comtrade
+//           replay rate of a recorded demo Line1 fault through the demo
+//           relays, 200 times from the memory-mapped FLOAT32 record
+//   reach   relay reach index of a 2500-bus meshed 110 kV grid with an
+//           overcurrent and a distance relay on every branch: relays within
+//           reach per bus fault, and re-indexing when a branch opens
+//   coordination
+//           coordination check of the same grid's relays: every
+//           primary/backup pair over faults along each branch
+//   flisr   feeder automation storm on 8 substations of 12 feeders: 300
+//           simultaneous faults at 20 s, 50 more at 40 s
+//   breakers
+//           storm on 50,000 feeder breakers with two-shot reclosing and
+//           50BF: every feeder tripped at 55 s, a quarter of them again
+//           after each reclosure
+//   ami     AMI telemetry of 50,000 meters over the communication network
+//           for 60 s, with 10,000 last gasp alarms at once at 30 s
+//   injection
+//           22.5k event bus injection rules over a storm on 50,000 feeder
+//           breakers and the last gasp alarms of a 50,000-meter AMI network
+#include "breaker_system.h"
+#include "comm_network.h"
+#include "comtrade.h"
+#include "coordination_check.h"
+#include "ecs_core.h"
+#include "event_injection.h"
+#include "fault_sweep.h"
+#include "flisr.h"
+#include "frequency_system.h"
+#include "multi_rate.h"
+#include "network_model.h"
+#include "protection_system.h"
+#include "radial_power_flow.h"
+#include "relay_reach_index.h"
+#include "sampled_values.h"
+#include "simulation_events_and_data.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <complex>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <numbers>
+#include <random>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Required by hecs_core; the checks run their own schedulers, and point
+// this at theirs where a subsystem reads it.
+cps_coro::Scheduler* g_scheduler = nullptr;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using Milliseconds = std::chrono::duration<double, std::milli>;
+
+struct MultiRateRun {
+    double elapsed_ms = 0.0;
+    std::vector<double> vpp_total_kW; // Per primary step
+    std::vector<std::uint64_t> layer_steps;
+};
+
+MultiRateRun run_frequency_layers(bool single_rate)
+{
+    cps_coro::Scheduler scheduler;
+    g_scheduler = &scheduler;
+    Registry registry;
+    std::vector<Entity> stations;
+    for (int s = 0; s < 200; ++s) {
+        std::vector<Entity> piles;
+        for (int p = 0; p < 10; ++p) {
+            Entity pile = registry.create();
+            registry.emplace<FrequencyControlConfigComponent>(pile, FrequencyControlConfigComponent::DeviceType::EV_PILE, -5.0, 4.0, 0.03, 5.0, -5.0, 0.1, 0.95);
+            registry.emplace<PhysicalStateComponent>(pile, -5.0, 0.15 + 0.0004 * (10 * s + p));
+            piles.push_back(pile);
+        }
+        stations.push_back(registry.create());
+        registry.emplace<VppStationComponent>(stations.back(), piles);
+    }
+    std::vector<Entity> ess_units;
+    for (int e = 0; e < 500; ++e) {
+        ess_units.push_back(registry.create());
+        registry.emplace<FrequencyControlConfigComponent>(ess_units.back(), FrequencyControlConfigComponent::DeviceType::ESS_UNIT, 0.0, 100.0, 0.03, 1000.0, -1000.0, 0.05, 0.95);
+        registry.emplace<PhysicalStateComponent>(ess_units.back(), 0.0, 0.3 + 0.001 * e);
+    }
+    Entity ev_vpp = registry.create();
+    registry.emplace<VppAggregateComponent>(ev_vpp, stations);
+    Entity ess_vpp = registry.create();
+    registry.emplace<VppDeviceAggregateComponent>(ess_vpp, ess_units);
+    const std::vector<Entity> vpps = { ev_vpp, ess_vpp };
+    auto ev_task = vppHierarchicalResponseTask(registry, "EV", ev_vpp, 20.0);
+    ev_task.detach();
+    auto ess_task = vppFrequencyResponseTask(registry, "ESS", ess_vpp, 20.0);
+    ess_task.detach();
+
+    MultiRateCoordinator layers;
+    if (single_rate)
+        layers.force_single_rate(std::chrono::milliseconds(20));
+    FrequencyControlLayers control;
+    add_frequency_control_layers(layers, control, registry, vpps, std::chrono::milliseconds(20), nullptr);
+    MultiRateRun run;
+    layers.add_layer("probe", std::chrono::milliseconds(20), [&](double, double) {
+        run.vpp_total_kW.push_back(vpp_total_power_kW(registry, ev_vpp) + vpp_total_power_kW(registry, ess_vpp));
+    });
+    auto layers_task = layers.run();
+    layers_task.detach();
+    auto start = Clock::now();
+    scheduler.run_until(cps_coro::Scheduler::time_point { std::chrono::milliseconds(3600 * 1000 + 10) });
+    run.elapsed_ms = Milliseconds(Clock::now() - start).count();
+    for (std::size_t i = 0; i < layers.layer_count(); ++i)
+        run.layer_steps.push_back(layers.layer_steps(i));
+    g_scheduler = nullptr;
+    return run;
+}
+
+void run_multirate()
+{
+    MultiRateRun multi = run_frequency_layers(false);
+    MultiRateRun single = run_frequency_layers(true);
+    double max_diff_kW = 0.0;
+    for (std::size_t k = 0; k < std::min(multi.vpp_total_kW.size(), single.vpp_total_kW.size()); ++k)
+        max_diff_kW = std::max(max_diff_kW, std::abs(multi.vpp_total_kW[k] - single.vpp_total_kW[k]));
+    auto slow_steps = [](const MultiRateRun& run) {
+        std::uint64_t steps = 0;
+        for (std::size_t i = 1; i + 1 < run.layer_steps.size(); ++i)
+            steps += run.layer_steps[i];
+        return steps;
+    };
+    std::printf("multirate: 1 h, 2500 devices: multi-rate %.0f ms (%llu slow layer steps), single-rate %.0f ms (%llu), speedup %.2fx; VPP totals differ by at most %.2g kW\n",
+        multi.elapsed_ms, static_cast<unsigned long long>(slow_steps(multi)), single.elapsed_ms,
+        static_cast<unsigned long long>(slow_steps(single)), single.elapsed_ms / multi.elapsed_ms, max_diff_kW);
+}
+
+// The relays of the demo scenario (main.cpp) on Line1 and Transformer1.
+void add_demo_relays(ProtectionRelayPools& relays, Entity line1, Entity transformer1)
+{
+    relays.emplace<OverCurrentProtection>(line1, 5.0, 200, "OC-L1P-Fast");
+    relays.emplace<DistanceProtection>(line1, 5.0, 0, 15.0, 300, 25.0, 700);
+    relays.emplace<OverCurrentProtection>(line1, 1.0, OvercurrentCurve::IecVeryInverse, 0.5, "OC-L1P-IDMT");
+    relays.emplace<OverCurrentProtection>(transformer1, 2.5, 300, "OC-T1P-Main");
+}
+
+void run_sweep()
+{
+    Registry registry;
+    ProtectionRelayPools relays;
+    Entity line1 = registry.create();
+    Entity transformer1 = registry.create();
+    add_demo_relays(relays, line1, transformer1);
+
+    FaultSweepEngine engine(relays);
+    FaultSweepGrid grid;
+    grid.locations_per_element = 2000;
+    grid.prefault_voltage_pu = { 0.90, 0.925, 0.95, 0.975, 1.0, 1.025, 1.05, 1.075, 1.10 };
+    grid.ground_fault_resistance_Ohm = 2.0;
+    const std::vector<FaultSweepElement> elements = {
+        { line1, 60.0, 0.4, 2.0, 220.0 },
+        { transformer1, 1.0, 40.0, 2.0, 220.0 },
+    };
+    const int coordination_interval_ms = 200;
+
+    auto start = Clock::now();
+    FaultCaseTable cases = build_fault_cases(elements, grid);
+    FaultSweepResults results = engine.run(cases);
+    FaultSweepSummary summary = engine.summarize(cases, results, coordination_interval_ms);
+    Milliseconds elapsed = Clock::now() - start;
+    std::printf("sweep: %zu cases x %zu relays in %.1f ms: %zu not cleared, %zu non-selective, %zu below the %d ms interval\n",
+        summary.cases, engine.relay_count(), elapsed.count(), summary.not_cleared, summary.non_selective,
+        summary.below_interval, coordination_interval_ms);
+    if (summary.min_grading_margin_ms != kNoTripDelayMs) {
+        std::size_t worst = summary.min_grading_case;
+        std::printf("sweep: smallest grading margin %d ms (%s fault on #%llu at %.2f km, %.3f pu): %s at %d ms, backup %s at %d ms\n",
+            summary.min_grading_margin_ms, fault_type_name(cases.fault_type[worst]),
+            static_cast<unsigned long long>(cases.faulty_entity_id[worst]), cases.distance_km[worst], cases.prefault_voltage_pu[worst],
+            engine.relay_name(results.first_relay[worst]), results.first_trip_ms[worst],
+            engine.relay_name(results.backup_relay[worst]), results.backup_trip_ms[worst]);
+    }
+}
+
+void run_feeder()
+{
+    Registry feeder;
+    std::mt19937 layout_rng(7);
+    std::vector<Entity> buses;
+    for (int k = 0; k < 10000; ++k) {
+        buses.push_back(feeder.create());
+        feeder.emplace<BusComponent>(buses.back(), 10.0);
+        if (k == 0)
+            continue;
+        Entity upstream = buses[layout_rng() % k];
+        feeder.emplace<BranchComponent>(feeder.create(), upstream, buses.back(), std::complex<double>(0.27, 0.35) * 0.05, 0.05);
+        feeder.emplace<LoadComponent>(feeder.create(), buses.back(), 1.5, 0.5);
+    }
+    feeder.emplace<SourceComponent>(feeder.create(), buses.front(), 10.5, std::complex<double>(0.05, 0.5));
+    RadialPowerFlow power_flow(feeder, 1);
+    power_flow.build();
+    auto cold_start = Clock::now();
+    PowerFlowStats cold = power_flow.solve();
+    Milliseconds cold_time = Clock::now() - cold_start;
+    for (std::size_t k = 1; k < buses.size(); ++k)
+        power_flow.set_load(buses[k], 1.515, 0.505);
+    auto warm_start = Clock::now();
+    PowerFlowStats warm = power_flow.solve();
+    Milliseconds warm_time = Clock::now() - warm_start;
+    std::printf("feeder: %zu buses, cold %d iterations in %.2f ms, warm %d iterations in %.2f ms (step budget 20 ms)\n",
+        cold.buses, cold.max_iterations, cold_time.count(), warm.max_iterations, warm_time.count());
+}
+
+void run_phasor()
+{
+    const std::size_t channels = 4096;
+    const std::size_t per_cycle = 256;
+    std::vector<float> cycle_block(per_cycle * channels);
+    for (std::size_t n = 0; n < per_cycle; ++n) {
+        for (std::size_t ch = 0; ch < channels; ++ch)
+            cycle_block[n * channels + ch] = static_cast<float>((1.0 + ch % 7) * std::sin(2.0 * std::numbers::pi * n / per_cycle + 0.001 * ch));
+    }
+    PhasorEstimator estimator(channels, per_cycle);
+    auto start = Clock::now();
+    for (int cycle = 0; cycle < 50; ++cycle)
+        estimator.push(cycle_block);
+    Milliseconds elapsed = Clock::now() - start;
+    std::printf("phasor: %zu channels x 12.8 kHz, 1 s of samples in %.1f ms (%.1fx real time); channel 6 reads %.4f (RMS, expected %.4f)\n",
+        channels, elapsed.count(), 1000.0 / elapsed.count(), std::abs(estimator.phasor(6)), 7.0 / std::sqrt(2.0));
+}
+
+void run_comtrade()
+{
+    // The demo network: grid infeed, Transformer1 and the 60 km Line1.
+    Registry registry;
+    cps_coro::Scheduler scheduler;
+    ProtectionSystem protection(registry, scheduler);
+    Entity line1 = registry.create();
+    Entity transformer1 = registry.create();
+    add_demo_relays(protection.relays(), line1, transformer1);
+    Entity hv_bus = registry.create();
+    Entity mv_bus = registry.create();
+    Entity feeder_end_bus = registry.create();
+    for (Entity bus : { hv_bus, mv_bus, feeder_end_bus })
+        registry.emplace<BusComponent>(bus, 220.0);
+    registry.emplace<SourceComponent>(registry.create(), hv_bus, 220.0, std::complex<double>(0.2, 2.0));
+    registry.emplace<BranchComponent>(transformer1, hv_bus, mv_bus, std::complex<double>(0.1, 4.0));
+    registry.emplace<BranchComponent>(line1, mv_bus, feeder_end_bus, std::complex<double>(0.05, 0.4) * 60.0, 60.0);
+    NetworkModel network(registry);
+    if (!network.build()) {
+        std::printf("comtrade: demo network is singular\n");
+        return;
+    }
+    protection.set_network(&network);
+    const double rate_Hz = 4000.0;
+    protection.set_sampled_values(rate_Hz);
+
+    // Records the fault 10 km out; the relays' digital channels are left at
+    // zero, as only the size of the .dat matters here.
+    FaultInfo fault;
+    fault.faulty_entity_id = line1;
+    fault.distance_km = 10.0;
+    NetworkWaveformSource waveforms(network, network.fault_on_branch(line1, 10.0), { line1, transformer1 }, rate_Hz, 50.0, 1, 10);
+    ComtradeConfig config;
+    config.device = "Line1";
+    config.sample_rate_Hz = rate_Hz;
+    config.trigger_time_s = static_cast<double>(waveforms.inception_frame()) / rate_Hz;
+    for (std::size_t ch = 0; ch < waveforms.channel_count(); ++ch) {
+        const std::string name = waveforms.channel_name(ch);
+        config.analog.push_back({ name, name.substr(name.size() - 1), name.substr(0, name.find('_')), waveforms.channel_unit(ch) });
+    }
+    for (std::size_t r = 0; r < protection.relays().size(); ++r) {
+        config.digital.push_back({ std::string(protection.relays().name(r)) + " PICKUP" });
+        config.digital.push_back({ std::string(protection.relays().name(r)) + " TRIP" });
+    }
+    const std::string stem = (std::filesystem::temp_directory_path() / "hecs_capacity_benchmark_line1").string();
+    ComtradeWriter writer;
+    std::vector<float> frame(waveforms.channel_count());
+    bool written = writer.open(stem, config);
+    while (written && waveforms.read(frame) == 1)
+        written = writer.write(frame);
+    written = writer.close() && written;
+    ComtradeRecord record;
+    if (!written || !record.open(stem + ".cfg")) {
+        std::printf("comtrade: %s\n", (written ? record.error() : writer.error()).c_str());
+        return;
+    }
+
+    std::vector<ProtectionSystem::SampledRelayChannels> channels(waveforms.relays().size());
+    for (std::size_t r = 0; r < channels.size(); ++r) {
+        channels[r].entity = waveforms.relays()[r];
+        for (std::size_t k = 0; k < NetworkWaveformSource::kChannelsPerRelay; ++k)
+            channels[r].channel[k] = static_cast<std::size_t>(record.analog_index(waveforms.channel_name(r * NetworkWaveformSource::kChannelsPerRelay + k)));
+    }
+    const int replays = 200;
+    auto start = Clock::now();
+    for (int i = 0; i < replays; ++i) {
+        record.rewind();
+        protection.evaluate_sampled(record, channels, record.trigger_frame(), fault);
+    }
+    Milliseconds elapsed = Clock::now() - start;
+    const double record_MB = static_cast<double>(record.frame_count()) * (8 + 4 * record.channel_count() + 2 * ((record.digital_count() + 15) / 16)) / 1e6;
+    std::printf("comtrade: %d replays of %zu frames x %zu analog channels in %.1f ms (%.0f records/s, %.1f MB/s of .dat)\n",
+        replays, record.frame_count(), record.channel_count(), elapsed.count(), replays * 1000.0 / elapsed.count(),
+        replays * record_MB * 1000.0 / elapsed.count());
+    std::error_code ignored;
+    std::filesystem::remove(stem + ".cfg", ignored);
+    std::filesystem::remove(stem + ".dat", ignored);
+}
+
+// 50 x 50 buses of a meshed 110 kV grid: every third row and column fully
+// connected, the other grid edges each with probability 1/2, and a source
+// every 8 buses both ways.
+struct MeshedGrid {
+    Registry registry;
+    std::vector<Entity> buses;
+    std::vector<Entity> lines;
+    ProtectionRelayPools relays;
+};
+
+void build_meshed_grid(MeshedGrid& grid)
+{
+    std::mt19937 rng(11);
+    std::uniform_real_distribution<double> length_km(5.0, 40.0);
+    const int side = 50;
+    grid.buses.resize(side * side);
+    for (Entity& bus : grid.buses) {
+        bus = grid.registry.create();
+        grid.registry.emplace<BusComponent>(bus, 110.0);
+    }
+    auto add_line = [&](int a, int b) {
+        const double km = length_km(rng);
+        const std::complex<double> z = std::complex<double>(0.05, 0.4) * km;
+        Entity line = grid.registry.create();
+        grid.registry.emplace<BranchComponent>(line, grid.buses[a], grid.buses[b], z, km);
+        grid.relays.emplace<OverCurrentProtection>(line, 1.5 + rng() % 40 * 0.1, 300);
+        grid.relays.emplace<DistanceProtection>(line, 0.8 * std::abs(z), 0, 1.2 * std::abs(z), 300, 2.0 * std::abs(z), 600);
+        grid.lines.push_back(line);
+    };
+    for (int y = 0; y < side; ++y) {
+        for (int x = 0; x < side; ++x) {
+            if (x + 1 < side && (y % 3 == 0 || rng() % 2 == 0))
+                add_line(y * side + x, y * side + x + 1);
+            if (y + 1 < side && (x % 3 == 0 || rng() % 2 == 0))
+                add_line(y * side + x, (y + 1) * side + x);
+        }
+    }
+    for (int y = 2; y < side; y += 8)
+        for (int x = 2; x < side; x += 8)
+            grid.registry.emplace<SourceComponent>(grid.registry.create(), grid.buses[y * side + x], 110.0, std::complex<double>(0.5, 5.0));
+}
+
+void run_reach()
+{
+    MeshedGrid grid;
+    build_meshed_grid(grid);
+    NetworkModel network(grid.registry);
+    if (!network.build()) {
+        std::printf("reach: grid admittance matrix is singular\n");
+        return;
+    }
+    const double phase_kV = 110.0 / std::sqrt(3.0);
+    std::vector<RelayReach> reaches(grid.relays.size());
+    for (std::size_t r = 0; r < reaches.size(); ++r) {
+        reaches[r].entity = grid.relays.entity(r);
+        grid.relays.visit(r, [&](const auto& relay, Entity) { reaches[r].reach_Ohm = relay.reach_Ohm(phase_kV); });
+    }
+    RelayReachIndex index(network);
+    auto index_start = Clock::now();
+    index.build(reaches);
+    Milliseconds index_time = Clock::now() - index_start;
+    std::vector<std::size_t> candidates;
+    std::size_t candidate_total = 0;
+    for (Entity bus : grid.buses) {
+        index.candidates(bus, candidates);
+        candidate_total += candidates.size();
+    }
+    const Entity switched = grid.lines[grid.lines.size() / 2];
+    auto switch_start = Clock::now();
+    network.set_branch_closed(switched, false);
+    index.branch_switched(switched);
+    Milliseconds switch_time = Clock::now() - switch_start;
+    std::printf("reach: %zu relays on %zu buses indexed in %.1f ms; %.1f relays within reach per bus fault; branch opening re-indexed %zu relays in %.2f ms (with the network update)\n",
+        reaches.size(), network.bus_count(), index_time.count(), static_cast<double>(candidate_total) / grid.buses.size(),
+        index.last_updated_relays(), switch_time.count());
+}
+
+void run_coordination()
+{
+    MeshedGrid grid;
+    build_meshed_grid(grid);
+    NetworkModel network(grid.registry);
+    if (!network.build()) {
+        std::printf("coordination: grid admittance matrix is singular\n");
+        return;
+    }
+    CoordinationChecker coordination(grid.relays, network);
+    auto start = Clock::now();
+    CoordinationReport report = coordination.check();
+    Milliseconds elapsed = Clock::now() - start;
+    std::printf("coordination: %zu pairs on %zu branches, %zu fault cases (%zu network solves), %zu graded pair cases in %.1f ms: %zu not cleared, %zu backup first, %zu below the %d ms interval\n",
+        report.pairs, report.branches, report.cases, report.network_faults, report.pair_cases, elapsed.count(),
+        report.count(CoordinationViolation::Kind::NotCleared), report.count(CoordinationViolation::Kind::BackupFirst),
+        report.count(CoordinationViolation::Kind::BelowInterval), coordination.coordination_interval_ms);
+    std::size_t shown = 0;
+    for (const CoordinationViolation& v : report.violations) {
+        if (v.kind == CoordinationViolation::Kind::NotCleared)
+            continue;
+        if (shown++ == 3)
+            break;
+        std::printf("coordination: %s on #%llu backed up by %s on #%llu: margin %d ms in %u cases, worst %s fault at %.0f %% of branch #%llu, %.2f pu\n",
+            grid.relays.name(v.primary), static_cast<unsigned long long>(grid.relays.entity(v.primary)),
+            grid.relays.name(v.backup), static_cast<unsigned long long>(grid.relays.entity(v.backup)),
+            v.margin_ms, static_cast<unsigned>(v.cases), fault_type_name(v.fault_type), v.location * 100.0, static_cast<unsigned long long>(v.branch), v.prefault_voltage_pu);
+    }
+}
+
+// 8 substations of 12 radial 10 kV feeders, each a DTU-controlled breaker
+// and 8 sections split by FTU sectionalizers, with normally-open FTU ties
+// from every feeder end to the middle of the next feeder and to the end of
+// the same feeder at the next substation. `lines` gets the line segments.
+void build_storm_grid(Registry& grid, std::vector<Entity>& lines)
+{
+    std::mt19937 layout_rng(23);
+    std::uniform_real_distribution<double> segment_km(0.5, 1.5);
+    std::uniform_real_distribution<double> section_kW(100.0, 400.0);
+    const int substations = 8, feeders = 12, sections = 8, buses_per_section = 3;
+    auto new_bus = [&]() {
+        Entity bus = grid.create();
+        grid.emplace<BusComponent>(bus, 10.0);
+        return bus;
+    };
+    auto new_switch = [&](Entity from, Entity to, FeederSwitchComponent::Kind kind, double limit_kW = 0.0) {
+        Entity sw = grid.create();
+        grid.emplace<BranchComponent>(sw, from, to, std::complex<double>(0.0, 0.001));
+        grid.emplace<FeederSwitchComponent>(sw, kind, 0.4, limit_kW);
+        if (kind != FeederSwitchComponent::Kind::Breaker)
+            grid.emplace<TerminalUnitComponent>(grid.create(), TerminalUnitComponent::Kind::FTU, std::vector<Entity> { sw }, 400);
+        return sw;
+    };
+    std::vector<std::vector<Entity>> feeder_buses(substations * feeders);
+    for (int s = 0; s < substations; ++s) {
+        Entity station = new_bus();
+        grid.emplace<SourceComponent>(grid.create(), station, 10.5, std::complex<double>(0.1, 0.5));
+        std::vector<Entity> breakers;
+        for (int f = 0; f < feeders; ++f) {
+            auto& buses = feeder_buses[s * feeders + f];
+            for (int k = 0; k < sections; ++k) {
+                for (int b = 0; b < buses_per_section; ++b) {
+                    buses.push_back(new_bus());
+                    if (b == 0) {
+                        Entity upstream = k == 0 ? station : buses[buses.size() - 2];
+                        auto kind = k == 0 ? FeederSwitchComponent::Kind::Breaker : FeederSwitchComponent::Kind::Sectionalizer;
+                        Entity sw = new_switch(upstream, buses.back(), kind);
+                        if (k == 0)
+                            breakers.push_back(sw);
+                        continue;
+                    }
+                    const double km = segment_km(layout_rng);
+                    lines.push_back(grid.create());
+                    grid.emplace<BranchComponent>(lines.back(), buses[buses.size() - 2], buses.back(), std::complex<double>(0.27, 0.35) * km, km);
+                }
+                grid.emplace<LoadComponent>(grid.create(), buses.back(), section_kW(layout_rng), 0.0);
+            }
+        }
+        grid.emplace<TerminalUnitComponent>(grid.create(), TerminalUnitComponent::Kind::DTU, breakers, 200);
+    }
+    for (int s = 0; s < substations; ++s) {
+        for (int f = 0; f < feeders; ++f) {
+            const auto& buses = feeder_buses[s * feeders + f];
+            const auto& next_feeder = feeder_buses[s * feeders + (f + 1) % feeders];
+            const auto& next_station = feeder_buses[((s + 1) % substations) * feeders + f];
+            grid.get<BranchComponent>(new_switch(buses.back(), next_feeder[next_feeder.size() / 2], FeederSwitchComponent::Kind::Tie, 900.0))->closed = false;
+            grid.get<BranchComponent>(new_switch(buses.back(), next_station.back(), FeederSwitchComponent::Kind::Tie, 1200.0))->closed = false;
+        }
+    }
+}
+
+// A burst of simultaneous faults on random line segments, then a second,
+// smaller wave while the first is still being restored around.
+cps_coro::Task flisr_storm(FlisrEngine& flisr, const std::vector<Entity>& lines)
+{
+    std::mt19937 rng(29);
+    std::uniform_real_distribution<double> position(0.05, 0.95);
+    const std::pair<int, std::size_t> waves[] = { { 20000, 300 }, { 40000, 50 } };
+    int at_ms = 0;
+    for (const auto& [wave_ms, faults] : waves) {
+        co_await cps_coro::delay(cps_coro::Scheduler::duration(wave_ms - at_ms));
+        at_ms = wave_ms;
+        for (std::size_t k = 0; k < faults; ++k) {
+            FaultInfo fault;
+            fault.voltage_kV = 10.0;
+            fault.faulty_entity_id = lines[rng() % lines.size()];
+            fault.distance_km = position(rng);
+            flisr.apply_fault(fault);
+        }
+    }
+}
+
+void run_flisr()
+{
+    Registry grid;
+    std::vector<Entity> lines;
+    build_storm_grid(grid, lines);
+    cps_coro::Scheduler scheduler;
+    NetworkModel network(grid);
+    FlisrEngine flisr(grid, network, scheduler);
+    if (!network.build() || !flisr.build()) {
+        std::printf("flisr: storm grid could not be built\n");
+        return;
+    }
+    auto master = flisr.run();
+    master.detach();
+    auto storm = flisr_storm(flisr, lines);
+    storm.detach();
+    auto start = Clock::now();
+    scheduler.run_until(cps_coro::Scheduler::time_point { std::chrono::milliseconds(50000) });
+    Milliseconds elapsed = Clock::now() - start;
+    const FlisrStats& stats = flisr.stats();
+    std::printf("flisr: %zu buses, %zu sections, %zu switches, %zu terminal units; 50 s simulated in %.1f ms\n",
+        network.bus_count(), flisr.section_count(), flisr.switch_count(), flisr.unit_count(), elapsed.count());
+    std::printf("flisr: %zu batches: %zu faults located, %zu breaker trips, %zu switches opened and %zu closed, %zu sections (%.0f kW) restored; %zu of %zu sections live, %zu isolated, %.0f kW unserved; group searches %zu, reused %zu\n",
+        stats.batches, stats.faults_located, stats.breaker_trips, stats.switches_opened, stats.switches_closed,
+        stats.sections_restored, stats.restored_kW, flisr.live_section_count(), flisr.section_count(),
+        flisr.faulted_section_count(), flisr.unserved_kW(), stats.group_searches, stats.group_cache_hits);
+}
+
+// 50,000 distribution feeder breakers in groups of ten behind an incomer
+// that 50BF trips, with two-shot auto-reclosing; one feeder in a hundred is
+// stuck. Returns the feeder breakers.
+std::vector<Entity> add_storm_breakers(BreakerSystem& breakers, Registry& registry)
+{
+    BreakerSettings incomer;
+    incomer.operate_ms = 60;
+    BreakerSettings feeder;
+    feeder.reclose_shots = 2;
+    feeder.failure_ms = 250;
+    std::vector<Entity> feeders;
+    std::vector<Entity> group_backups;
+    for (int k = 0; k < 50000; ++k) {
+        Entity breaker = registry.create();
+        if (k % 10 == 0) {
+            breakers.add(breaker, incomer);
+            group_backups.assign(1, breaker);
+            continue;
+        }
+        breakers.add(breaker, feeder);
+        breakers.set_backups(breaker, group_backups);
+        if (k % 100 == 1)
+            breakers.set_stuck(breaker, true);
+        feeders.push_back(breaker);
+    }
+    return feeders;
+}
+
+// Trips every feeder breaker at 55 s through the event bus, as relays do.
+// Every fourth fault is permanent and trips again after each reclosure, so
+// those feeders lock out after their two shots.
+cps_coro::Task breaker_storm(cps_coro::Scheduler& scheduler, const std::vector<Entity>& feeders)
+{
+    const int retrip_ms[] = { 55000, 56000, 62000 };
+    int at_ms = 0;
+    for (int wave = 0; wave < 3; ++wave) {
+        co_await cps_coro::delay(cps_coro::Scheduler::duration(retrip_ms[wave] - at_ms));
+        at_ms = retrip_ms[wave];
+        for (std::size_t k = 0; k < feeders.size(); ++k)
+            if (wave == 0 || k % 4 == 0)
+                scheduler.trigger_event(ENTITY_TRIP_EVENT_PROT, feeders[k]);
+    }
+}
+
+void run_breakers()
+{
+    Registry registry;
+    cps_coro::Scheduler scheduler;
+    BreakerSystem breakers(scheduler);
+    const std::vector<Entity> feeders = add_storm_breakers(breakers, registry);
+    breakers.start();
+    auto storm = breaker_storm(scheduler, feeders);
+    storm.detach();
+    auto start = Clock::now();
+    scheduler.run_until(cps_coro::Scheduler::time_point { std::chrono::milliseconds(63000) });
+    Milliseconds elapsed = Clock::now() - start;
+    const BreakerStats& stats = breakers.stats();
+    std::printf("breakers: %zu breakers (%zu bytes each), 63 s simulated in %.1f ms: %zu trips, %zu openings, %zu reclosures, %zu lockouts, %zu breaker failures\n",
+        breakers.size(), BreakerSystem::bytes_per_breaker(), elapsed.count(), stats.trips, stats.openings, stats.reclosures,
+        stats.lockouts, stats.failures);
+}
+
+// Head end, 10 WAN routers, 500 data concentrators on cellular backhaul and
+// 50,000 meters on a narrowband field network.
+struct AmiNetwork {
+    std::uint32_t head_end = 0;
+    std::vector<std::uint32_t> meters;
+};
+
+AmiNetwork build_ami_network(CommNetwork& comm)
+{
+    AmiNetwork ami;
+    ami.head_end = comm.add_node();
+    CommLinkSettings wan { 3.0, 100e6, 1.0, 0.0, 1 << 20 };
+    CommLinkSettings backhaul { 40.0, 2e6, 20.0, 0.001, 4096 };
+    CommLinkSettings field { 20.0, 100e3, 10.0, 0.01, 2048 };
+    std::vector<std::uint32_t> routers, concentrators;
+    for (int r = 0; r < 10; ++r) {
+        routers.push_back(comm.add_node());
+        comm.connect(ami.head_end, routers.back(), wan);
+    }
+    for (int c = 0; c < 500; ++c) {
+        concentrators.push_back(comm.add_node());
+        comm.connect(routers[c % routers.size()], concentrators.back(), backhaul);
+    }
+    for (int m = 0; m < 50000; ++m) {
+        ami.meters.push_back(comm.add_node());
+        comm.connect(concentrators[m / 100], ami.meters.back(), field);
+    }
+    return ami;
+}
+
+// Every meter reports a 96-byte reading every 3 s, spread evenly over the
+// milliseconds, for 60 s; at 30 s an outage in 100 neighbourhoods makes
+// 10,000 meters send their last gasp alarm to the head end at once.
+cps_coro::Task ami_telemetry(CommNetwork& comm, const AmiNetwork& ami)
+{
+    const std::size_t period_ms = 3000;
+    for (std::size_t tick = 0; tick < 60000; ++tick) {
+        if (tick == 30000) {
+            for (std::size_t m = 0; m < ami.meters.size() && m < 10000; ++m)
+                comm.send(ami.meters[m], ami.head_end, AMI_OUTAGE_EVENT, ami.meters[m]);
+        }
+        for (std::size_t m = tick % period_ms; m < ami.meters.size(); m += period_ms)
+            comm.send(ami.meters[m], ami.head_end, 96);
+        co_await cps_coro::delay(cps_coro::Scheduler::duration(1));
+    }
+}
+
+struct AlarmCount {
+    std::size_t alarms = 0;
+    std::size_t unknown = 0; // From meters not on the network
+};
+
+cps_coro::Task ami_head_end(AlarmCount& count, std::uint32_t node_count)
+{
+    while (true) {
+        std::uint32_t meter = co_await cps_coro::wait_for_event<std::uint32_t>(AMI_OUTAGE_EVENT);
+        ++count.alarms;
+        if (meter >= node_count)
+            ++count.unknown;
+    }
+}
+
+void run_ami()
+{
+    cps_coro::Scheduler scheduler;
+    CommNetwork comm(scheduler, 74);
+    const AmiNetwork ami = build_ami_network(comm);
+    AlarmCount alarms;
+    auto head_end = ami_head_end(alarms, static_cast<std::uint32_t>(comm.node_count()));
+    head_end.detach();
+    auto telemetry = ami_telemetry(comm, ami);
+    telemetry.detach();
+    auto start = Clock::now();
+    scheduler.run_until(cps_coro::Scheduler::time_point { std::chrono::milliseconds(61000) });
+    Milliseconds elapsed = Clock::now() - start;
+
+    const CommStats& stats = comm.stats();
+    std::printf("ami: %zu nodes, %zu links, 61 s simulated in %.1f ms: %zu sent, %zu delivered, %zu lost, %zu dropped by full queues, %zu link transmissions\n",
+        comm.node_count(), comm.link_count(), elapsed.count(), stats.sent, stats.delivered, stats.lost, stats.dropped, stats.transmissions);
+    std::printf("ami: latency mean %.1f ms, max %.1f ms; %zu pooled packets, %zu in flight; %zu last gasp alarms at the head end\n",
+        stats.delivered > 0 ? stats.latency_sum_ms / stats.delivered : 0.0, stats.max_latency_ms, comm.packet_pool_size(),
+        comm.in_flight(), alarms.alarms);
+}
+
+// During the breaker storm the trip commands to one feeder in twenty are
+// lost and those to every other odd feeder arrive 150 ms late (one keyed
+// rule per feeder); the first AMI alarms are replayed 2 s later and a burst
+// of them carries spoofed meter ids.
+void run_injection()
+{
+    Registry registry;
+    cps_coro::Scheduler scheduler;
+    BreakerSystem breakers(scheduler);
+    const std::vector<Entity> feeders = add_storm_breakers(breakers, registry);
+    breakers.start();
+    CommNetwork comm(scheduler, 74);
+    const AmiNetwork ami = build_ami_network(comm);
+
+    EventInjector injector(scheduler);
+    std::istringstream scenario(
+        "key event=101 field=0:u64 # ENTITY_TRIP_EVENT_PROT: the breaker\n"
+        "key event=120 field=0:u32 # AMI_OUTAGE_EVENT: the meter\n"
+        "replay event=120 from=30000 until=30075 count=1 every=2000\n"
+        "falsify event=120 from=30080 until=30082 field=0:u32 bias=1000000\n");
+    if (!injector.load(scenario)) {
+        std::printf("injection: %s\n", injector.error().c_str());
+        return;
+    }
+    for (std::size_t k = 1; k < feeders.size(); k += 2) {
+        InjectionRule rule;
+        rule.event = ENTITY_TRIP_EVENT_PROT;
+        rule.key = feeders[k];
+        rule.from_ms = 55000;
+        rule.until_ms = 55001;
+        if (k % 20 == 3) {
+            rule.action = InjectionRule::Action::Drop;
+        } else {
+            rule.action = InjectionRule::Action::Delay;
+            rule.delay_ms = 150;
+        }
+        injector.add(rule);
+    }
+    injector.install();
+
+    AlarmCount alarms;
+    auto head_end = ami_head_end(alarms, static_cast<std::uint32_t>(comm.node_count()));
+    head_end.detach();
+    auto telemetry = ami_telemetry(comm, ami);
+    telemetry.detach();
+    auto storm = breaker_storm(scheduler, feeders);
+    storm.detach();
+    auto start = Clock::now();
+    scheduler.run_until(cps_coro::Scheduler::time_point { std::chrono::milliseconds(64000) });
+    Milliseconds elapsed = Clock::now() - start;
+
+    const InjectionStats& stats = injector.stats();
+    const BreakerStats& breaker_stats = breakers.stats();
+    std::printf("injection: %zu rules, 64 s simulated in %.1f ms: %zu events in rule windows, %zu dropped, %zu delayed, %zu replayed, %zu falsified, %zu copies delivered\n",
+        injector.rule_count(), elapsed.count(), stats.examined, stats.dropped, stats.delayed, stats.replayed, stats.falsified, stats.copies);
+    std::printf("injection: %zu breaker trips, %zu lockouts; %zu last gasp alarms at the head end, %zu from unknown meters\n",
+        breaker_stats.trips, breaker_stats.lockouts, alarms.alarms, alarms.unknown);
+}
+
+struct Check {
+    const char* name;
+    void (*run)();
+};
+
+const Check kChecks[] = {
+    { "multirate", run_multirate },
+    { "sweep", run_sweep },
+    { "feeder", run_feeder },
+    { "phasor", run_phasor },
+    { "comtrade", run_comtrade },
+    { "reach", run_reach },
+    { "coordination", run_coordination },
+    { "flisr", run_flisr },
+    { "breakers", run_breakers },
+    { "ami", run_ami },
+    { "injection", run_injection },
+};
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    std::vector<const Check*> selected;
+    for (int i = 1; i < argc; ++i) {
+        const Check* found = nullptr;
+        for (const Check& check : kChecks)
+            if (std::strcmp(argv[i], check.name) == 0)
+                found = &check;
+        if (!found) {
+            std::fprintf(stderr, "Usage: hecs_capacity_benchmark [check ...]\nChecks:");
+            for (const Check& check : kChecks)
+                std::fprintf(stderr, " %s", check.name);
+            std::fprintf(stderr, "\n");
+            return 1;
+        }
+        selected.push_back(found);
+    }
+    if (selected.empty())
+        for (const Check& check : kChecks)
+            selected.push_back(&check);
+    for (const Check* check : selected)
+        check->run();
+    return 0;
+}
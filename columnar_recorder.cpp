@@ -0,0 +1,346 @@
+// columnar_recorder.cpp
+#include "columnar_recorder.h"
+#include "arrow_ipc_writer.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+namespace {
+
+constexpr char kColumnarMagic[8] = { 'H', 'E', 'C', 'S', 'C', 'O', 'L', '1' };
+constexpr std::uint32_t kColumnarVersion = 1;
+constexpr std::uint32_t kChunkMarker = 0x4B4E4843; // "CHNK"
+
+std::size_t padded(std::size_t bytes)
+{
+    return (bytes + 7) / 8 * 8;
+}
+
+} // namespace
+
+std::size_t column_type_size(ColumnType type)
+{
+    switch (type) {
+    case ColumnType::Int64:
+    case ColumnType::Float64:
+        return 8;
+    case ColumnType::Float32:
+        return 4;
+    }
+    return 0;
+}
+
+const char* columnar_file_extension(ColumnarFileFormat format)
+{
+    switch (format) {
+    case ColumnarFileFormat::Native:
+        return ".hcol";
+    case ColumnarFileFormat::ArrowIpcFile:
+        return ".arrow";
+    case ColumnarFileFormat::ArrowIpcStream:
+        return ".arrows";
+    }
+    return "";
+}
+
+ColumnarRecorder::ColumnarRecorder(std::vector<ColumnSpec> schema, std::size_t chunk_bytes, std::size_t max_pending_chunks)
+    : schema_(std::move(schema))
+    , max_pending_chunks_(std::max<std::size_t>(1, max_pending_chunks))
+{
+    std::size_t row_bytes = 0;
+    for (const auto& column : schema_)
+        row_bytes += column_type_size(column.type) * column.width;
+    rows_per_chunk_ = std::max<std::size_t>(1, row_bytes > 0 ? chunk_bytes / row_bytes : 1);
+    current_ = acquire_chunk();
+}
+
+ColumnarRecorder::~ColumnarRecorder()
+{
+    close();
+}
+
+std::size_t ColumnarRecorder::column_index(std::string_view name) const
+{
+    for (std::size_t i = 0; i < schema_.size(); ++i) {
+        if (schema_[i].name == name)
+            return i;
+    }
+    return schema_.size();
+}
+
+bool ColumnarRecorder::open(const std::string& path, ColumnarFileFormat format)
+{
+    close();
+    if (format != ColumnarFileFormat::Native) {
+        arrow_ = std::make_unique<ArrowIpcWriter>();
+        if (!arrow_->open(path, schema_, format == ColumnarFileFormat::ArrowIpcFile ? ArrowIpcFormat::File : ArrowIpcFormat::Stream)) {
+            error_ = arrow_->error();
+            arrow_.reset();
+            return false;
+        }
+        start_writer();
+        return true;
+    }
+
+    file_ = std::fopen(path.c_str(), "wb");
+    if (!file_) {
+        error_ = "cannot create '" + path + "': " + std::strerror(errno);
+        return false;
+    }
+
+    ColumnarFileHeader header {};
+    std::memcpy(header.magic, kColumnarMagic, sizeof(kColumnarMagic));
+    header.version = kColumnarVersion;
+    header.column_count = static_cast<std::uint32_t>(schema_.size());
+    std::fwrite(&header, sizeof(header), 1, file_);
+    const char zeros[8] = {};
+    for (const auto& column : schema_) {
+        ColumnarColumnHeader column_header {};
+        column_header.type = column.type;
+        column_header.width = column.width;
+        column_header.name_length = static_cast<std::uint32_t>(column.name.size());
+        std::fwrite(&column_header, sizeof(column_header), 1, file_);
+        std::fwrite(column.name.data(), 1, column.name.size(), file_);
+        std::fwrite(zeros, 1, padded(column.name.size()) - column.name.size(), file_);
+    }
+    if (std::ferror(file_)) {
+        error_ = "cannot write '" + path + "'";
+        std::fclose(file_);
+        file_ = nullptr;
+        return false;
+    }
+
+    start_writer();
+    return true;
+}
+
+void ColumnarRecorder::start_writer()
+{
+    stopping_ = false;
+    write_failed_ = false;
+    rows_committed_ = 0;
+    current_->row_count = 0;
+    writer_ = std::thread([this] { writer_loop(); });
+}
+
+void ColumnarRecorder::close()
+{
+    if (!is_open())
+        return;
+    if (current_->row_count > 0)
+        submit_current();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    work_ready_.notify_one();
+    writer_.join();
+    if (arrow_) {
+        if (!arrow_->close() || write_failed_)
+            error_ = "write error while recording results";
+        arrow_.reset();
+    } else {
+        if (std::fclose(file_) != 0 || write_failed_)
+            error_ = "write error while recording results";
+        file_ = nullptr;
+    }
+}
+
+void ColumnarRecorder::set(std::size_t column, double value)
+{
+    std::byte* slot = current_->columns[column].data() + current_->row_count * column_type_size(schema_[column].type);
+    switch (schema_[column].type) {
+    case ColumnType::Int64: {
+        auto v = static_cast<std::int64_t>(value);
+        std::memcpy(slot, &v, sizeof(v));
+        break;
+    }
+    case ColumnType::Float64:
+        std::memcpy(slot, &value, sizeof(value));
+        break;
+    case ColumnType::Float32: {
+        auto v = static_cast<float>(value);
+        std::memcpy(slot, &v, sizeof(v));
+        break;
+    }
+    }
+}
+
+void ColumnarRecorder::set_int(std::size_t column, std::int64_t value)
+{
+    if (schema_[column].type != ColumnType::Int64) {
+        set(column, static_cast<double>(value));
+        return;
+    }
+    std::memcpy(current_->columns[column].data() + current_->row_count * sizeof(value), &value, sizeof(value));
+}
+
+void ColumnarRecorder::commit_row()
+{
+    ++current_->row_count;
+    ++rows_committed_;
+    if (current_->row_count == rows_per_chunk_)
+        submit_current();
+}
+
+std::unique_ptr<ColumnarRecorder::Chunk> ColumnarRecorder::acquire_chunk()
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        // The chunk being filled is not counted against the pending limit.
+        chunk_freed_.wait(lock, [this] { return !free_.empty() || pending_.size() < max_pending_chunks_; });
+        if (!free_.empty()) {
+            auto chunk = std::move(free_.back());
+            free_.pop_back();
+            chunk->row_count = 0;
+            return chunk;
+        }
+    }
+    auto chunk = std::make_unique<Chunk>();
+    chunk->columns.resize(schema_.size());
+    for (std::size_t i = 0; i < schema_.size(); ++i)
+        chunk->columns[i].resize(rows_per_chunk_ * schema_[i].width * column_type_size(schema_[i].type));
+    return chunk;
+}
+
+void ColumnarRecorder::submit_current()
+{
+    if (!is_open()) {
+        // Not recording: the rows are discarded.
+        current_->row_count = 0;
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_.push_back(std::move(current_));
+    }
+    work_ready_.notify_one();
+    current_ = acquire_chunk();
+}
+
+void ColumnarRecorder::writer_loop()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        work_ready_.wait(lock, [this] { return stopping_ || !pending_.empty(); });
+        if (pending_.empty())
+            return;
+        auto chunk = std::move(pending_.front());
+        pending_.pop_front();
+        lock.unlock();
+        write_chunk(*chunk);
+        lock.lock();
+        free_.push_back(std::move(chunk));
+        chunk_freed_.notify_one();
+    }
+}
+
+void ColumnarRecorder::write_chunk(const Chunk& chunk)
+{
+    if (write_failed_)
+        return;
+    if (arrow_) {
+        std::vector<const void*> columns;
+        for (const auto& column : chunk.columns)
+            columns.push_back(column.data());
+        if (!arrow_->write_batch(columns, chunk.row_count))
+            write_failed_ = true;
+        return;
+    }
+    ColumnarChunkHeader header { kChunkMarker, static_cast<std::uint32_t>(chunk.row_count) };
+    std::fwrite(&header, sizeof(header), 1, file_);
+    const char zeros[8] = {};
+    for (std::size_t i = 0; i < schema_.size(); ++i) {
+        std::size_t bytes = chunk.row_count * schema_[i].width * column_type_size(schema_[i].type);
+        std::fwrite(chunk.columns[i].data(), 1, bytes, file_);
+        std::fwrite(zeros, 1, padded(bytes) - bytes, file_);
+    }
+    if (std::ferror(file_))
+        write_failed_ = true;
+}
+
+bool ColumnarReader::open(const std::string& path)
+{
+    schema_.clear();
+    chunks_.clear();
+    row_count_ = 0;
+    if (!file_.open(path, MappedFile::AccessHint::Sequential)) {
+        error_ = file_.error();
+        return false;
+    }
+
+    const unsigned char* data = file_.data();
+    std::size_t size = file_.size();
+    ColumnarFileHeader header;
+    if (size < sizeof(header)) {
+        error_ = "'" + path + "' is too small for a columnar header";
+        return false;
+    }
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, kColumnarMagic, sizeof(kColumnarMagic)) != 0 || header.version != kColumnarVersion) {
+        error_ = "'" + path + "' is not a version 1 HECS columnar file";
+        return false;
+    }
+
+    std::size_t offset = sizeof(header);
+    for (std::uint32_t i = 0; i < header.column_count; ++i) {
+        ColumnarColumnHeader column_header;
+        if (offset + sizeof(column_header) > size) {
+            error_ = "'" + path + "' has a truncated schema";
+            return false;
+        }
+        std::memcpy(&column_header, data + offset, sizeof(column_header));
+        offset += sizeof(column_header);
+        if (offset + column_header.name_length > size || column_type_size(column_header.type) == 0) {
+            error_ = "'" + path + "' has a corrupt schema";
+            return false;
+        }
+        schema_.push_back(ColumnSpec {
+            std::string(reinterpret_cast<const char*>(data + offset), column_header.name_length),
+            column_header.type,
+            column_header.width });
+        offset += padded(column_header.name_length);
+    }
+
+    while (offset + sizeof(ColumnarChunkHeader) <= size) {
+        ColumnarChunkHeader chunk_header;
+        std::memcpy(&chunk_header, data + offset, sizeof(chunk_header));
+        if (chunk_header.marker != kChunkMarker)
+            break;
+        ChunkIndex chunk { chunk_header.row_count, {} };
+        std::size_t next = offset + sizeof(chunk_header);
+        for (const auto& column : schema_) {
+            chunk.column_offsets.push_back(next);
+            next += padded(chunk.row_count * column.width * column_type_size(column.type));
+        }
+        if (next > size)
+            break;
+        row_count_ += chunk.row_count;
+        chunks_.push_back(std::move(chunk));
+        offset = next;
+    }
+    return true;
+}
+
+std::size_t ColumnarReader::column_index(std::string_view name) const
+{
+    for (std::size_t i = 0; i < schema_.size(); ++i) {
+        if (schema_[i].name == name)
+            return i;
+    }
+    return schema_.size();
+}
+
+double ColumnarReader::value(std::size_t chunk, std::size_t column, std::size_t row, std::size_t k) const
+{
+    std::size_t index = row * schema_[column].width + k;
+    switch (schema_[column].type) {
+    case ColumnType::Int64:
+        return static_cast<double>(column_values<std::int64_t>(chunk, column)[index]);
+    case ColumnType::Float64:
+        return column_values<double>(chunk, column)[index];
+    case ColumnType::Float32:
+        return column_values<float>(chunk, column)[index];
+    }
+    return 0.0;
+}
@@ -0,0 +1,187 @@
+// columnar_recorder.h
+// Binary columnar result files. The schema is declared up front; rows are
+// appended into fixed-size chunks that hold each column contiguously, and
+// full chunks are written by a background thread so the simulation thread
+// only copies values into memory.
+//
+// File layout (little-endian, every block padded to 8 bytes):
+//   ColumnarFileHeader
+//   column_count x { ColumnarColumnHeader, name bytes }
+//   chunks: ColumnarChunkHeader, then per column row_count * width values
+// A column of width N stores N values per row (e.g. one per device).
+#ifndef COLUMNAR_RECORDER_H
+#define COLUMNAR_RECORDER_H
+
+#include "mapped_file.h"
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+enum class ColumnType : std::uint8_t {
+    Int64 = 1,
+    Float64 = 2,
+    Float32 = 3,
+};
+
+std::size_t column_type_size(ColumnType type);
+
+struct ColumnSpec {
+    std::string name;
+    ColumnType type = ColumnType::Float64;
+    std::uint32_t width = 1;
+};
+
+struct ColumnarFileHeader {
+    char magic[8]; // "HECSCOL1"
+    std::uint32_t version;
+    std::uint32_t column_count;
+};
+
+struct ColumnarColumnHeader {
+    ColumnType type;
+    std::uint8_t reserved[3];
+    std::uint32_t width;
+    std::uint32_t name_length;
+    std::uint32_t reserved2;
+};
+
+struct ColumnarChunkHeader {
+    std::uint32_t marker; // "CHNK"
+    std::uint32_t row_count;
+};
+
+static_assert(sizeof(ColumnarFileHeader) == 16 && sizeof(ColumnarColumnHeader) == 16 && sizeof(ColumnarChunkHeader) == 8,
+    "Columnar headers are an on-disk layout");
+
+class ArrowIpcWriter;
+
+// Native is the layout described above; the Arrow formats write each chunk
+// as a record batch (see arrow_ipc_writer.h).
+enum class ColumnarFileFormat {
+    Native,
+    ArrowIpcFile,
+    ArrowIpcStream,
+};
+
+// Conventional extension for a format: ".hcol", ".arrow" or ".arrows".
+const char* columnar_file_extension(ColumnarFileFormat format);
+
+class ColumnarRecorder {
+public:
+    // Chunks hold as many rows as fit into chunk_bytes (at least one). At most
+    // max_pending_chunks wait for the writer; beyond that commit_row() blocks
+    // rather than dropping data.
+    explicit ColumnarRecorder(std::vector<ColumnSpec> schema,
+        std::size_t chunk_bytes = std::size_t(4) << 20,
+        std::size_t max_pending_chunks = 8);
+    ~ColumnarRecorder();
+    ColumnarRecorder(const ColumnarRecorder&) = delete;
+    ColumnarRecorder& operator=(const ColumnarRecorder&) = delete;
+
+    // Returns false and fills error() on failure.
+    bool open(const std::string& path, ColumnarFileFormat format = ColumnarFileFormat::Native);
+    // Writes the partial chunk and stops the writer thread.
+    void close();
+    bool is_open() const { return file_ != nullptr || arrow_ != nullptr; }
+    const std::string& error() const { return error_; }
+
+    const std::vector<ColumnSpec>& schema() const { return schema_; }
+    // Index of the named column, or schema().size() if there is none.
+    std::size_t column_index(std::string_view name) const;
+    std::size_t rows_per_chunk() const { return rows_per_chunk_; }
+    std::uint64_t rows_committed() const { return rows_committed_; }
+
+    // Fills a width-1 column of the current row, converting to its type.
+    void set(std::size_t column, double value);
+    void set_int(std::size_t column, std::int64_t value);
+    // Width values of the current row, written in place. T must match the
+    // column type.
+    template <typename T>
+    std::span<T> row_values(std::size_t column)
+    {
+        static_assert(std::is_arithmetic_v<T>);
+        std::size_t width = schema_[column].width;
+        auto* base = reinterpret_cast<T*>(current_->columns[column].data());
+        return { base + current_->row_count * width, width };
+    }
+    // Every column must have been filled for the row before it is committed.
+    void commit_row();
+
+private:
+    struct Chunk {
+        std::vector<std::vector<std::byte>> columns;
+        std::size_t row_count = 0;
+    };
+
+    void start_writer();
+    std::unique_ptr<Chunk> acquire_chunk();
+    void submit_current();
+    void writer_loop();
+    void write_chunk(const Chunk& chunk);
+
+    std::vector<ColumnSpec> schema_;
+    std::size_t rows_per_chunk_ = 1;
+    std::size_t max_pending_chunks_;
+    std::unique_ptr<Chunk> current_;
+    std::uint64_t rows_committed_ = 0;
+    std::FILE* file_ = nullptr;
+    std::unique_ptr<ArrowIpcWriter> arrow_; // Set for the Arrow formats instead of file_
+    std::string error_;
+
+    std::mutex mutex_;
+    std::condition_variable work_ready_;
+    std::condition_variable chunk_freed_;
+    std::deque<std::unique_ptr<Chunk>> pending_;
+    std::vector<std::unique_ptr<Chunk>> free_;
+    bool stopping_ = false;
+    bool write_failed_ = false;
+    std::thread writer_;
+};
+
+// Reads a columnar file through a read-only mapping. Column values of a
+// chunk are returned as spans into the mapping. A trailing chunk cut short
+// (e.g. by a crash) is ignored.
+class ColumnarReader {
+public:
+    bool open(const std::string& path);
+    const std::string& error() const { return error_; }
+
+    const std::vector<ColumnSpec>& schema() const { return schema_; }
+    std::size_t column_index(std::string_view name) const;
+    std::size_t chunk_count() const { return chunks_.size(); }
+    std::size_t chunk_rows(std::size_t chunk) const { return chunks_[chunk].row_count; }
+    std::uint64_t row_count() const { return row_count_; }
+
+    template <typename T>
+    std::span<const T> column_values(std::size_t chunk, std::size_t column) const
+    {
+        auto* first = reinterpret_cast<const T*>(file_.data() + chunks_[chunk].column_offsets[column]);
+        return { first, chunks_[chunk].row_count * schema_[column].width };
+    }
+    // Value k of a row in any column type, widened to double.
+    double value(std::size_t chunk, std::size_t column, std::size_t row, std::size_t k = 0) const;
+
+private:
+    struct ChunkIndex {
+        std::size_t row_count = 0;
+        std::vector<std::size_t> column_offsets;
+    };
+
+    MappedFile file_;
+    std::vector<ColumnSpec> schema_;
+    std::vector<ChunkIndex> chunks_;
+    std::uint64_t row_count_ = 0;
+    std::string error_;
+};
+
+#endif // COLUMNAR_RECORDER_H
@@ -0,0 +1,168 @@
+// columnar_to_csv.cpp
+// Converts a columnar result file (see columnar_recorder.h) to CSV.
+//
+// Usage: hecs_columnar_to_csv <input> [output.csv] [--columns a,b,...] [--delimiter tab|comma] [--info]
+// Wide columns expand to name[0], name[1], ...; --info prints the schema only.
+#include "columnar_recorder.h"
+#include <charconv>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+void print_usage()
+{
+    std::cerr << "Usage: hecs_columnar_to_csv <input> [output.csv] [--columns a,b,...] [--delimiter tab|comma] [--info]\n";
+}
+
+const char* type_name(ColumnType type)
+{
+    switch (type) {
+    case ColumnType::Int64:
+        return "int64";
+    case ColumnType::Float64:
+        return "float64";
+    case ColumnType::Float32:
+        return "float32";
+    }
+    return "?";
+}
+
+// Shortest representation that round-trips the stored value.
+void append_value(std::string& out, const ColumnarReader& reader, std::size_t chunk, std::size_t column, std::size_t row, std::size_t k)
+{
+    char buffer[32];
+    std::to_chars_result result {};
+    std::size_t index = row * reader.schema()[column].width + k;
+    switch (reader.schema()[column].type) {
+    case ColumnType::Int64:
+        result = std::to_chars(buffer, buffer + sizeof(buffer), reader.column_values<std::int64_t>(chunk, column)[index]);
+        break;
+    case ColumnType::Float64:
+        result = std::to_chars(buffer, buffer + sizeof(buffer), reader.column_values<double>(chunk, column)[index]);
+        break;
+    case ColumnType::Float32:
+        result = std::to_chars(buffer, buffer + sizeof(buffer), reader.column_values<float>(chunk, column)[index]);
+        break;
+    }
+    out.append(buffer, result.ptr);
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    std::string input_path;
+    std::string output_path;
+    std::string column_list;
+    char delimiter = ',';
+    bool info_only = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--columns" && i + 1 < argc) {
+            column_list = argv[++i];
+        } else if (arg == "--delimiter" && i + 1 < argc) {
+            std::string d = argv[++i];
+            delimiter = (d == "tab" || d == "\\t") ? '\t' : (d == "comma" ? ',' : d.front());
+        } else if (arg == "--info") {
+            info_only = true;
+        } else if (!arg.empty() && arg[0] == '-') {
+            print_usage();
+            return 2;
+        } else if (input_path.empty()) {
+            input_path = arg;
+        } else if (output_path.empty()) {
+            output_path = arg;
+        } else {
+            print_usage();
+            return 2;
+        }
+    }
+    if (input_path.empty()) {
+        print_usage();
+        return 2;
+    }
+
+    ColumnarReader reader;
+    if (!reader.open(input_path)) {
+        std::cerr << "Error: " << reader.error() << "\n";
+        return 1;
+    }
+
+    if (info_only) {
+        for (const auto& column : reader.schema())
+            std::cout << column.name << "\t" << type_name(column.type) << "\t" << column.width << "\n";
+        std::cout << reader.row_count() << " rows in " << reader.chunk_count() << " chunks\n";
+        return 0;
+    }
+
+    std::vector<std::size_t> columns;
+    if (column_list.empty()) {
+        for (std::size_t i = 0; i < reader.schema().size(); ++i)
+            columns.push_back(i);
+    } else {
+        std::size_t begin = 0;
+        while (begin <= column_list.size()) {
+            std::size_t end = column_list.find(',', begin);
+            if (end == std::string::npos)
+                end = column_list.size();
+            std::string name = column_list.substr(begin, end - begin);
+            std::size_t index = reader.column_index(name);
+            if (index == reader.schema().size()) {
+                std::cerr << "Error: no column '" << name << "' in " << input_path << "\n";
+                return 1;
+            }
+            columns.push_back(index);
+            begin = end + 1;
+        }
+    }
+
+    std::FILE* out = output_path.empty() ? stdout : std::fopen(output_path.c_str(), "w");
+    if (!out) {
+        std::cerr << "Error: cannot create '" << output_path << "'\n";
+        return 1;
+    }
+
+    std::string line;
+    for (std::size_t c = 0; c < columns.size(); ++c) {
+        const auto& column = reader.schema()[columns[c]];
+        for (std::uint32_t k = 0; k < column.width; ++k) {
+            if (c > 0 || k > 0)
+                line += delimiter;
+            line += column.name;
+            if (column.width > 1) {
+                line += '[';
+                line += std::to_string(k);
+                line += ']';
+            }
+        }
+    }
+    line += '\n';
+    std::fwrite(line.data(), 1, line.size(), out);
+
+    for (std::size_t chunk = 0; chunk < reader.chunk_count(); ++chunk) {
+        for (std::size_t row = 0; row < reader.chunk_rows(chunk); ++row) {
+            line.clear();
+            for (std::size_t c = 0; c < columns.size(); ++c) {
+                for (std::uint32_t k = 0; k < reader.schema()[columns[c]].width; ++k) {
+                    if (c > 0 || k > 0)
+                        line += delimiter;
+                    append_value(line, reader, chunk, columns[c], row, k);
+                }
+            }
+            line += '\n';
+            std::fwrite(line.data(), 1, line.size(), out);
+        }
+    }
+
+    bool ok = !std::ferror(out);
+    if (out != stdout)
+        ok = std::fclose(out) == 0 && ok;
+    if (!ok) {
+        std::cerr << "Error: write failed\n";
+        return 1;
+    }
+    return 0;
+}
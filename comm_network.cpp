@@ -0,0 +1,227 @@
+// comm_network.cpp
+#include "comm_network.h"
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+CommNetwork::CommNetwork(cps_coro::Scheduler& sch, std::uint64_t seed)
+    : scheduler_(sch)
+    , rng_(seed)
+{
+}
+
+std::uint32_t CommNetwork::add_node()
+{
+    node_links_.emplace_back();
+    node_in_links_.emplace_back();
+    next_link_.clear();
+    return static_cast<std::uint32_t>(node_links_.size() - 1);
+}
+
+void CommNetwork::connect(std::uint32_t a, std::uint32_t b, const CommLinkSettings& settings)
+{
+    for (auto [from, to] : { std::pair { a, b }, std::pair { b, a } }) {
+        Link link;
+        link.from = from;
+        link.to = to;
+        link.latency_us = std::llround(settings.latency_ms * 1000.0);
+        link.jitter_us = std::llround(settings.jitter_ms * 1000.0);
+        link.us_per_byte = 8e6 / settings.bandwidth_bps;
+        link.bytes_per_us = settings.bandwidth_bps / 8e6;
+        link.loss = settings.loss;
+        link.queue_bytes = static_cast<double>(settings.queue_bytes);
+        std::size_t buckets = 1;
+        while (buckets < kMaxBuckets && static_cast<double>(buckets) < settings.latency_ms + settings.jitter_ms + 2.0)
+            buckets *= 2;
+        link.bucket_mask = buckets - 1;
+        const auto index = static_cast<std::uint32_t>(links_.size());
+        links_.push_back(std::move(link));
+        node_links_[from].push_back(index);
+        node_in_links_[to].push_back(index);
+    }
+    next_link_.clear();
+}
+
+std::uint32_t CommNetwork::allocate()
+{
+    if (free_ == kNone) {
+        packets_.emplace_back();
+        return static_cast<std::uint32_t>(packets_.size() - 1);
+    }
+    const std::uint32_t packet = free_;
+    free_ = packets_[packet].next;
+    return packet;
+}
+
+void CommNetwork::release(std::uint32_t packet)
+{
+    packets_[packet].next = free_;
+    free_ = packet;
+    --in_flight_;
+}
+
+const std::vector<std::uint32_t>& CommNetwork::routes_to(std::uint32_t dst)
+{
+    auto [it, inserted] = next_link_.try_emplace(dst);
+    std::vector<std::uint32_t>& next = it->second;
+    if (!inserted)
+        return next;
+    // Breadth-first from the destination over the links into each node.
+    next.assign(node_links_.size(), kNone);
+    std::vector<std::uint32_t> queue { dst };
+    std::vector<char> reached(node_links_.size(), 0);
+    reached[dst] = 1;
+    for (std::size_t head = 0; head < queue.size(); ++head) {
+        for (std::uint32_t link : node_in_links_[queue[head]]) {
+            const std::uint32_t from = links_[link].from;
+            if (!reached[from]) {
+                reached[from] = 1;
+                next[from] = link;
+                queue.push_back(from);
+            }
+        }
+    }
+    return next;
+}
+
+bool CommNetwork::send(std::uint32_t src, std::uint32_t dst, std::uint32_t size_bytes)
+{
+    const std::uint32_t index = allocate();
+    packets_[index].event = 0;
+    packets_[index].deliver = nullptr;
+    return launch(index, src, dst, size_bytes);
+}
+
+bool CommNetwork::launch(std::uint32_t packet, std::uint32_t src, std::uint32_t dst, std::uint32_t size_bytes)
+{
+    Packet& p = packets_[packet];
+    p.dst = dst;
+    p.size_bytes = size_bytes;
+    p.sent_us = scheduler_.now().time_since_epoch().count() * 1000;
+    p.arrival_us = p.sent_us;
+    ++stats_.sent;
+    ++in_flight_;
+    if (src >= node_links_.size() || dst >= node_links_.size() || (src != dst && routes_to(dst)[src] == kNone)) {
+        ++stats_.unroutable;
+        release(packet);
+        return false;
+    }
+    arrive(packet, src);
+    return true;
+}
+
+void CommNetwork::arrive(std::uint32_t packet, std::uint32_t node)
+{
+    Packet& p = packets_[packet];
+    if (node != p.dst) {
+        transmit(packet, routes_to(p.dst)[node], p.arrival_us);
+        return;
+    }
+    const double latency_ms = static_cast<double>(p.arrival_us - p.sent_us) / 1000.0;
+    ++stats_.delivered;
+    stats_.latency_sum_ms += latency_ms;
+    stats_.max_latency_ms = std::max(stats_.max_latency_ms, latency_ms);
+    // The receiver may send from its handler, which can grow the pool.
+    const Deliver deliver = p.deliver;
+    const cps_coro::EventId event = p.event;
+    alignas(8) unsigned char payload[kMaxPayloadBytes];
+    std::memcpy(payload, p.payload, kMaxPayloadBytes);
+    release(packet);
+    if (deliver)
+        deliver(scheduler_, event, payload);
+}
+
+void CommNetwork::transmit(std::uint32_t packet, std::uint32_t link, std::int64_t now_us)
+{
+    Link& l = links_[link];
+    Packet& p = packets_[packet];
+    // Output queue: first in first out behind the packets already waiting.
+    const std::int64_t start_us = std::max(now_us, l.busy_until_us);
+    if (static_cast<double>(start_us - now_us) * l.bytes_per_us > l.queue_bytes) {
+        ++stats_.dropped;
+        release(packet);
+        return;
+    }
+    l.busy_until_us = start_us + std::llround(p.size_bytes * l.us_per_byte);
+    ++stats_.transmissions;
+    if (l.loss > 0.0 && unit_(rng_) < l.loss) {
+        ++stats_.lost;
+        release(packet);
+        return;
+    }
+    p.arrival_us = l.busy_until_us + l.latency_us + (l.jitter_us > 0 ? std::llround(unit_(rng_) * l.jitter_us) : 0);
+    const std::int64_t due_ms = (p.arrival_us + 999) / 1000;
+    if (l.calendar.empty())
+        l.calendar.assign(l.bucket_mask + 1, kNone);
+    std::uint32_t& head = l.calendar[static_cast<std::size_t>(due_ms) & l.bucket_mask];
+    p.next = head;
+    head = packet;
+    ++l.in_flight;
+    arm(link, due_ms);
+}
+
+void CommNetwork::arm(std::uint32_t link, std::int64_t due_ms)
+{
+    Link& l = links_[link];
+    if (l.armed_ms >= 0 && l.armed_ms <= due_ms)
+        return;
+    l.armed_ms = due_ms;
+    const std::int64_t now_ms = scheduler_.now().time_since_epoch().count();
+    const std::uint64_t tag = link | (static_cast<std::uint64_t>(due_ms) << 32);
+    scheduler_.call_after(cps_coro::Scheduler::duration(std::max<std::int64_t>(0, due_ms - now_ms)), &CommNetwork::on_timer, this, tag);
+}
+
+void CommNetwork::on_timer(void* context, std::uint64_t tag)
+{
+    static_cast<CommNetwork*>(context)->expire(static_cast<std::uint32_t>(tag), static_cast<std::int64_t>(tag >> 32));
+}
+
+void CommNetwork::expire(std::uint32_t link, std::int64_t due_ms)
+{
+    {
+        Link& l = links_[link];
+        if (l.armed_ms != due_ms)
+            return; // Re-armed earlier since
+        l.armed_ms = -1;
+        // Take this millisecond's packets out of the bucket; later laps of
+        // the ring stay.
+        std::uint32_t* link_to = &l.calendar[static_cast<std::size_t>(due_ms) & l.bucket_mask];
+        due_.clear();
+        while (*link_to != kNone) {
+            const std::uint32_t p = *link_to;
+            if ((packets_[p].arrival_us + 999) / 1000 == due_ms) {
+                due_.push_back(p);
+                *link_to = packets_[p].next;
+            } else {
+                link_to = &packets_[p].next;
+            }
+        }
+        l.in_flight -= due_.size();
+        // Buckets are pushed at the head: restore the order of enqueueing,
+        // then order by arrival within the millisecond.
+        std::reverse(due_.begin(), due_.end());
+        std::stable_sort(due_.begin(), due_.end(), [this](std::uint32_t a, std::uint32_t b) { return packets_[a].arrival_us < packets_[b].arrival_us; });
+    }
+    // Delivery can raise events whose handlers send again, on any link, so
+    // links_ is indexed afresh after it.
+    for (std::uint32_t p : due_)
+        arrive(p, links_[link].to);
+
+    Link& l = links_[link];
+    if (l.in_flight == 0)
+        return;
+    // Next due bucket within one lap, else the earliest packet anywhere.
+    for (std::int64_t t = due_ms; t <= due_ms + static_cast<std::int64_t>(l.bucket_mask); ++t) {
+        for (std::uint32_t p = l.calendar[static_cast<std::size_t>(t) & l.bucket_mask]; p != kNone; p = packets_[p].next) {
+            if ((packets_[p].arrival_us + 999) / 1000 == t) {
+                arm(link, t);
+                return;
+            }
+        }
+    }
+    std::int64_t earliest_us = -1;
+    for (std::uint32_t head : l.calendar)
+        for (std::uint32_t p = head; p != kNone; p = packets_[p].next)
+            earliest_us = earliest_us < 0 ? packets_[p].arrival_us : std::min(earliest_us, packets_[p].arrival_us);
+    arm(link, (earliest_us + 999) / 1000);
+}
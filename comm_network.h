@@ -0,0 +1,154 @@
+// comm_network.h
+// Packet-level communication network for the cyber side of the simulation:
+// messages between nodes (IEDs, meters, concentrators, routers, control
+// centres) cross links with latency, bandwidth, jitter and loss, as discrete
+// events on the simulation scheduler. A message that reaches its destination
+// is raised there as an ordinary scheduler event, so a receiver waits for it
+// exactly as for a direct trigger_event.
+//
+// Each directed link has an output queue in front of it, served first in
+// first out at the link's bandwidth: a packet's transmission end follows
+// from the queue's busy horizon when it is enqueued, and a full queue drops
+// it (tail drop). Packets then propagate for the latency plus uniform jitter
+// and wait in the link's calendar queue: a ring of 1 ms buckets indexed by
+// arrival time, sized to cover the link's latency and jitter and allocated
+// on the link's first packet, with one scheduler timer callback per link
+// armed for the earliest bucket due. Packets due in the same millisecond are
+// handled in arrival order. Timers are not cancelled; one that no longer
+// matches the link's armed time is ignored when it expires.
+//
+// Packets come from a pool and are linked through their own index fields,
+// so steady traffic allocates nothing. Routes are the fewest-hop paths, one
+// next-hop table per destination built on first use; this suits telemetry
+// towards a few head ends and commands from them.
+#ifndef COMM_NETWORK_H
+#define COMM_NETWORK_H
+
+#include "cps_coro_lib.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+struct CommLinkSettings {
+    double latency_ms = 1.0;
+    double bandwidth_bps = 1e6;
+    double jitter_ms = 0.0; // Uniform extra delay per packet
+    double loss = 0.0; // Probability a packet is lost on the link
+    std::size_t queue_bytes = 64 * 1024; // Output queue before tail drop
+};
+
+struct CommStats {
+    std::size_t sent = 0;
+    std::size_t delivered = 0;
+    std::size_t lost = 0; // On a lossy link
+    std::size_t dropped = 0; // By a full output queue
+    std::size_t unroutable = 0;
+    std::size_t transmissions = 0; // Link hops
+    double latency_sum_ms = 0.0; // Of delivered packets, end to end
+    double max_latency_ms = 0.0;
+};
+
+class CommNetwork {
+public:
+    static constexpr std::size_t kHeaderBytes = 32; // Added to every payload
+    static constexpr std::size_t kMaxPayloadBytes = 48;
+
+    explicit CommNetwork(cps_coro::Scheduler& sch, std::uint64_t seed = 1);
+
+    // Nodes are endpoints and routers alike; any node forwards.
+    std::uint32_t add_node();
+    // A duplex link as two directed links with the same settings.
+    void connect(std::uint32_t a, std::uint32_t b, const CommLinkSettings& settings);
+
+    // Sends `data` from src to dst; on arrival the scheduler raises `event`
+    // with it. `size_bytes` defaults to the payload plus the header. False
+    // when dst cannot be reached (the packet is counted as unroutable).
+    template <typename T>
+    bool send(std::uint32_t src, std::uint32_t dst, cps_coro::EventId event, const T& data, std::uint32_t size_bytes = 0)
+    {
+        static_assert(std::is_trivially_copyable_v<T> && sizeof(T) <= kMaxPayloadBytes, "Payload must be a small trivially copyable type");
+        const std::uint32_t index = allocate();
+        Packet& packet = packets_[index];
+        packet.event = event;
+        packet.deliver = &deliver_as<T>;
+        std::memcpy(packet.payload, &data, sizeof(T));
+        return launch(index, src, dst, size_bytes > 0 ? size_bytes : static_cast<std::uint32_t>(sizeof(T) + kHeaderBytes));
+    }
+    // A packet that is only counted on arrival (bulk telemetry).
+    bool send(std::uint32_t src, std::uint32_t dst, std::uint32_t size_bytes);
+
+    std::size_t node_count() const { return node_links_.size(); }
+    std::size_t link_count() const { return links_.size(); }
+    std::size_t packet_pool_size() const { return packets_.size(); }
+    std::size_t in_flight() const { return in_flight_; }
+    const CommStats& stats() const { return stats_; }
+
+private:
+    static constexpr std::uint32_t kNone = 0xFFFFFFFFu;
+    static constexpr std::size_t kMaxBuckets = 256; // Calendar ring, 1 ms per bucket
+
+    using Deliver = void (*)(cps_coro::Scheduler&, cps_coro::EventId, const void*);
+
+    template <typename T>
+    static void deliver_as(cps_coro::Scheduler& scheduler, cps_coro::EventId event, const void* payload)
+    {
+        T data;
+        std::memcpy(&data, payload, sizeof(T));
+        scheduler.trigger_event(event, data);
+    }
+
+    struct Packet {
+        std::uint32_t next = kNone; // Free list or calendar bucket
+        std::uint32_t dst = 0;
+        std::uint32_t size_bytes = 0;
+        std::int64_t sent_us = 0;
+        std::int64_t arrival_us = 0; // At the far end of the current link
+        cps_coro::EventId event = 0;
+        Deliver deliver = nullptr;
+        alignas(8) unsigned char payload[kMaxPayloadBytes];
+    };
+    struct Link {
+        std::uint32_t from, to;
+        std::int64_t latency_us;
+        std::int64_t jitter_us;
+        double us_per_byte;
+        double bytes_per_us;
+        double loss;
+        double queue_bytes;
+        std::int64_t busy_until_us = 0; // Output queue drains by then
+        std::int64_t armed_ms = -1; // Timer due time; -1 when idle
+        std::size_t in_flight = 0;
+        std::size_t bucket_mask; // Ring size - 1
+        std::vector<std::uint32_t> calendar; // Bucket list heads; empty until used
+    };
+
+    std::uint32_t allocate();
+    void release(std::uint32_t packet);
+    bool launch(std::uint32_t packet, std::uint32_t src, std::uint32_t dst, std::uint32_t size_bytes);
+    const std::vector<std::uint32_t>& routes_to(std::uint32_t dst);
+    // The packet is at `node` at time packet.arrival_us: deliver or forward.
+    void arrive(std::uint32_t packet, std::uint32_t node);
+    void transmit(std::uint32_t packet, std::uint32_t link, std::int64_t now_us);
+    void arm(std::uint32_t link, std::int64_t due_ms);
+    static void on_timer(void* context, std::uint64_t tag);
+    void expire(std::uint32_t link, std::int64_t due_ms);
+
+    cps_coro::Scheduler& scheduler_;
+    std::mt19937_64 rng_;
+    std::uniform_real_distribution<double> unit_ { 0.0, 1.0 };
+    std::vector<std::vector<std::uint32_t>> node_links_; // Outgoing link indices
+    std::vector<std::vector<std::uint32_t>> node_in_links_; // Incoming
+    std::vector<Link> links_;
+    std::vector<Packet> packets_;
+    std::uint32_t free_ = kNone;
+    std::size_t in_flight_ = 0;
+    std::vector<std::uint32_t> due_; // Scratch for a timer's packets
+    std::unordered_map<std::uint32_t, std::vector<std::uint32_t>> next_link_; // By destination, then node; kNone if unreachable
+    CommStats stats_;
+};
+
+#endif // COMM_NETWORK_H
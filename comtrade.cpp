@@ -0,0 +1,589 @@
+// comtrade.cpp
+#include "comtrade.h"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <sstream>
+
+namespace {
+
+constexpr std::size_t kPrefetchBytes = std::size_t(8) << 20;
+constexpr std::size_t kReleaseBytes = std::size_t(64) << 20;
+constexpr double kSecondsPerDay = 86400.0;
+
+std::string_view trim(std::string_view s)
+{
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t'))
+        s.remove_prefix(1);
+    while (!s.empty() && (s.back() == ' ' || s.back() == '\t' || s.back() == '\r'))
+        s.remove_suffix(1);
+    return s;
+}
+
+std::vector<std::string_view> split_fields(std::string_view line)
+{
+    std::vector<std::string_view> fields;
+    std::size_t start = 0;
+    while (true) {
+        const std::size_t comma = line.find(',', start);
+        fields.push_back(trim(line.substr(start, comma == std::string_view::npos ? std::string_view::npos : comma - start)));
+        if (comma == std::string_view::npos)
+            return fields;
+        start = comma + 1;
+    }
+}
+
+bool parse_number(std::string_view field, double& value)
+{
+    if (field.empty())
+        return false;
+    if (field.front() == '+')
+        field.remove_prefix(1);
+    const auto [end, ec] = std::from_chars(field.data(), field.data() + field.size(), value);
+    return ec == std::errc() && end == field.data() + field.size();
+}
+
+bool parse_count(std::string_view field, std::size_t& value)
+{
+    // Channel counts carry a type suffix ("12A", "4D").
+    while (!field.empty() && (field.back() < '0' || field.back() > '9'))
+        field.remove_suffix(1);
+    const auto [end, ec] = std::from_chars(field.data(), field.data() + field.size(), value);
+    return ec == std::errc() && end == field.data() + field.size();
+}
+
+// "hh:mm:ss.ssssss" to seconds since midnight.
+bool parse_time_of_day(std::string_view field, double& seconds)
+{
+    const std::size_t first = field.find(':');
+    const std::size_t second = first == std::string_view::npos ? first : field.find(':', first + 1);
+    double h = 0.0, m = 0.0, s = 0.0;
+    if (second == std::string_view::npos || !parse_number(field.substr(0, first), h)
+        || !parse_number(field.substr(first + 1, second - first - 1), m) || !parse_number(field.substr(second + 1), s))
+        return false;
+    seconds = h * 3600.0 + m * 60.0 + s;
+    return true;
+}
+
+bool equals_ignoring_case(std::string_view a, std::string_view b)
+{
+    return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) {
+        return (x >= 'a' && x <= 'z' ? x - 32 : x) == (y >= 'a' && y <= 'z' ? y - 32 : y);
+    });
+}
+
+std::string format_time_of_day(double seconds)
+{
+    seconds = std::clamp(seconds, 0.0, kSecondsPerDay - 1e-6);
+    const auto micros = static_cast<long long>(std::llround(seconds * 1e6));
+    char text[32];
+    std::snprintf(text, sizeof(text), "%02lld:%02lld:%02lld.%06lld", micros / 3600000000LL, micros / 60000000LL % 60,
+        micros / 1000000LL % 60, micros % 1000000LL);
+    return text;
+}
+
+const char* format_name(ComtradeFormat format)
+{
+    switch (format) {
+    case ComtradeFormat::Ascii:
+        return "ASCII";
+    case ComtradeFormat::Binary:
+        return "BINARY";
+    case ComtradeFormat::Binary32:
+        return "BINARY32";
+    case ComtradeFormat::Float32:
+        return "FLOAT32";
+    }
+    return "FLOAT32";
+}
+
+std::size_t analog_bytes(ComtradeFormat format)
+{
+    return format == ComtradeFormat::Binary ? 2 : 4;
+}
+
+std::size_t digital_words(std::size_t digital_count)
+{
+    return (digital_count + 15) / 16;
+}
+
+template <typename T>
+T load_le(const unsigned char* p)
+{
+    // The .dat is little-endian, as are the targets this builds for.
+    T value;
+    std::memcpy(&value, p, sizeof(T));
+    return value;
+}
+
+} // namespace
+
+bool parse_comtrade_config(std::string_view text, ComtradeConfig& config, std::string& error)
+{
+    std::vector<std::string_view> lines;
+    for (std::size_t start = 0; start < text.size();) {
+        std::size_t end = text.find('\n', start);
+        if (end == std::string_view::npos)
+            end = text.size();
+        lines.push_back(trim(text.substr(start, end - start)));
+        start = end + 1;
+    }
+    std::size_t line = 0;
+    auto next = [&]() -> std::vector<std::string_view> {
+        if (line >= lines.size())
+            return {};
+        return split_fields(lines[line++]);
+    };
+    auto fail = [&](const char* what) {
+        error = std::string(what) + " (line " + std::to_string(line) + ")";
+        return false;
+    };
+
+    config = ComtradeConfig {};
+    auto fields = next();
+    if (fields.size() < 2)
+        return fail("missing station line");
+    config.station = fields[0];
+    config.device = fields[1];
+    config.revision_year = 1991;
+    if (fields.size() > 2 && !fields[2].empty()) {
+        double year = 0.0;
+        if (!parse_number(fields[2], year))
+            return fail("bad revision year");
+        config.revision_year = static_cast<int>(year);
+    }
+
+    fields = next();
+    std::size_t total = 0, analog = 0, digital = 0;
+    if (fields.size() < 3 || !parse_count(fields[0], total) || !parse_count(fields[1], analog) || !parse_count(fields[2], digital)
+        || analog + digital != total)
+        return fail("bad channel counts");
+
+    config.analog.resize(analog);
+    for (auto& channel : config.analog) {
+        fields = next();
+        if (fields.size() < 10)
+            return fail("short analog channel line");
+        channel.id = fields[1];
+        channel.phase = fields[2];
+        channel.circuit = fields[3];
+        channel.unit = fields[4];
+        if (!parse_number(fields[5], channel.a) || !parse_number(fields[6], channel.b) || !parse_number(fields[7], channel.skew_us)
+            || !parse_number(fields[8], channel.min) || !parse_number(fields[9], channel.max))
+            return fail("bad analog channel value");
+        if (fields.size() >= 13) {
+            if (!parse_number(fields[10], channel.primary) || !parse_number(fields[11], channel.secondary))
+                return fail("bad transformer ratio");
+            channel.secondary_values = fields[12] == "S" || fields[12] == "s";
+        }
+    }
+    config.digital.resize(digital);
+    for (auto& channel : config.digital) {
+        fields = next();
+        if (fields.size() < 3)
+            return fail("short digital channel line");
+        channel.id = fields[1];
+        // 1991 lines are n,id,y; later ones n,id,ph,ccbm,y.
+        if (fields.size() >= 5) {
+            channel.phase = fields[2];
+            channel.circuit = fields[3];
+        }
+        channel.normal_state = fields.back() == "1" ? 1 : 0;
+    }
+
+    fields = next();
+    if (fields.empty() || !parse_number(fields[0], config.line_frequency_Hz))
+        return fail("bad line frequency");
+
+    fields = next();
+    std::size_t rates = 0;
+    if (fields.empty() || !parse_count(fields[0], rates))
+        return fail("bad sampling rate count");
+    if (rates == 0)
+        return fail("records timed only by timestamps are not supported");
+    for (std::size_t r = 0; r < rates; ++r) {
+        fields = next();
+        double rate = 0.0;
+        std::size_t end_sample = 0;
+        if (fields.size() < 2 || !parse_number(fields[0], rate) || !parse_count(fields[1], end_sample) || rate <= 0.0)
+            return fail("bad sampling rate");
+        if (r > 0 && rate != config.sample_rate_Hz)
+            return fail("records with several sampling rates are not supported");
+        config.sample_rate_Hz = rate;
+        config.sample_count = end_sample;
+    }
+
+    fields = next();
+    if (fields.size() < 2 || !parse_time_of_day(fields[1], config.start_time_s))
+        return fail("bad start time");
+    config.start_date = fields[0];
+    fields = next();
+    if (fields.size() < 2 || !parse_time_of_day(fields[1], config.trigger_time_s))
+        return fail("bad trigger time");
+    config.trigger_date = fields[0];
+
+    fields = next();
+    if (fields.empty())
+        return fail("missing data file type");
+    if (equals_ignoring_case(fields[0], "ASCII"))
+        config.format = ComtradeFormat::Ascii;
+    else if (equals_ignoring_case(fields[0], "BINARY"))
+        config.format = ComtradeFormat::Binary;
+    else if (equals_ignoring_case(fields[0], "BINARY32"))
+        config.format = ComtradeFormat::Binary32;
+    else if (equals_ignoring_case(fields[0], "FLOAT32"))
+        config.format = ComtradeFormat::Float32;
+    else
+        return fail("unknown data file type");
+
+    config.time_multiplier = 1.0;
+    fields = next();
+    if (!fields.empty() && !fields[0].empty() && !parse_number(fields[0], config.time_multiplier))
+        return fail("bad time multiplier");
+    return true;
+}
+
+bool ComtradeRecord::open(const std::string& path)
+{
+    std::string stem = path;
+    const std::size_t dot = stem.find_last_of('.');
+    if (dot != std::string::npos && stem.find_first_of("/\\", dot) == std::string::npos) {
+        const std::string extension = stem.substr(dot + 1);
+        if (equals_ignoring_case(extension, "cfg") || equals_ignoring_case(extension, "dat"))
+            stem.resize(dot);
+    }
+
+    // The .cfg is small; read it whole and parse it.
+    std::string cfg_path;
+    MappedFile cfg;
+    for (const char* extension : { ".cfg", ".CFG" }) {
+        cfg_path = stem + extension;
+        if (cfg.open(cfg_path))
+            break;
+    }
+    if (!cfg.is_open()) {
+        error_ = cfg.error();
+        return false;
+    }
+    const std::string_view text(reinterpret_cast<const char*>(cfg.data()), cfg.size());
+    std::string parse_error;
+    if (!parse_comtrade_config(text, config_, parse_error)) {
+        error_ = "'" + cfg_path + "': " + parse_error;
+        return false;
+    }
+
+    dat_.close();
+    for (const char* extension : { ".dat", ".DAT" })
+        if (dat_.open(stem + extension, MappedFile::AccessHint::Sequential))
+            break;
+    if (!dat_.is_open()) {
+        error_ = dat_.error();
+        return false;
+    }
+
+    const std::size_t analog = config_.analog.size();
+    units_.resize(analog);
+    scale_.resize(analog);
+    offset_.resize(analog);
+    for (std::size_t ch = 0; ch < analog; ++ch) {
+        const ComtradeAnalogChannel& channel = config_.analog[ch];
+        double factor = 1.0;
+        if (channel.secondary_values && channel.secondary != 0.0)
+            factor = channel.primary / channel.secondary;
+        units_[ch] = channel.unit;
+        if (channel.unit == "A" || channel.unit == "V") {
+            factor *= 1e-3;
+            units_[ch] = "k" + channel.unit;
+        }
+        scale_[ch] = channel.a * factor;
+        offset_[ch] = channel.b * factor;
+    }
+
+    if (config_.format == ComtradeFormat::Ascii) {
+        record_bytes_ = 0;
+    } else {
+        record_bytes_ = 8 + analog * analog_bytes(config_.format) + digital_words(config_.digital.size()) * 2;
+        config_.sample_count = std::min(config_.sample_count, dat_.size() / record_bytes_);
+    }
+    error_.clear();
+    rewind();
+    return true;
+}
+
+void ComtradeRecord::rewind()
+{
+    next_frame_ = 0;
+    offset_bytes_ = 0;
+    prefetched_until_ = 0;
+    released_until_ = 0;
+}
+
+std::size_t ComtradeRecord::trigger_frame() const
+{
+    double delay_s = config_.trigger_time_s - config_.start_time_s;
+    if (config_.trigger_date != config_.start_date && delay_s < 0.0)
+        delay_s += kSecondsPerDay; // Recording ran past midnight
+    const double frame = std::ceil(delay_s * config_.sample_rate_Hz - 1e-6);
+    return static_cast<std::size_t>(std::clamp(frame, 0.0, static_cast<double>(config_.sample_count)));
+}
+
+int ComtradeRecord::analog_index(std::string_view id) const
+{
+    for (std::size_t ch = 0; ch < config_.analog.size(); ++ch)
+        if (config_.analog[ch].id == id)
+            return static_cast<int>(ch);
+    return -1;
+}
+
+int ComtradeRecord::digital_index(std::string_view id) const
+{
+    for (std::size_t ch = 0; ch < config_.digital.size(); ++ch)
+        if (config_.digital[ch].id == id)
+            return static_cast<int>(ch);
+    return -1;
+}
+
+std::size_t ComtradeRecord::read(std::span<float> frames)
+{
+    const std::size_t channels = channel_count();
+    return read_frames(frames, nullptr, channels ? frames.size() / channels : 0);
+}
+
+std::size_t ComtradeRecord::read(std::span<float> frames, std::span<std::uint8_t> status)
+{
+    const std::size_t channels = channel_count();
+    const std::size_t digital = digital_count();
+    std::size_t max_frames = channels ? frames.size() / channels : std::numeric_limits<std::size_t>::max();
+    if (digital)
+        max_frames = std::min(max_frames, status.size() / digital);
+    if (max_frames == std::numeric_limits<std::size_t>::max())
+        max_frames = 0;
+    return read_frames(frames, status.data(), max_frames);
+}
+
+std::size_t ComtradeRecord::read_frames(std::span<float> frames, std::uint8_t* status, std::size_t max_frames)
+{
+    if (!dat_.is_open())
+        return 0;
+    const std::size_t channels = channel_count();
+    const std::size_t digital = digital_count();
+    const std::size_t wanted = std::min(max_frames, config_.sample_count - next_frame_);
+    std::size_t f = 0;
+    for (; f < wanted; ++f) {
+        if (f % 256 == 0)
+            advance_window();
+        float* analog = frames.data() + f * channels;
+        std::uint8_t* states = status ? status + f * digital : nullptr;
+        if (record_bytes_) {
+            decode_binary_frame(analog, states);
+        } else if (!decode_ascii_frame(analog, states)) {
+            config_.sample_count = next_frame_; // Truncated or malformed: end the stream here
+            break;
+        }
+        ++next_frame_;
+    }
+    return f;
+}
+
+void ComtradeRecord::advance_window()
+{
+    if (prefetched_until_ < offset_bytes_ + kPrefetchBytes / 2 && prefetched_until_ < dat_.size()) {
+        const std::size_t begin = std::max(prefetched_until_, offset_bytes_);
+        const std::size_t end = std::min(offset_bytes_ + kPrefetchBytes, dat_.size());
+        if (end > begin)
+            dat_.prefetch(begin, end - begin);
+        prefetched_until_ = end;
+    }
+    if (offset_bytes_ > released_until_ + kReleaseBytes) {
+        dat_.release(released_until_, offset_bytes_ - released_until_);
+        released_until_ = offset_bytes_;
+    }
+}
+
+void ComtradeRecord::decode_binary_frame(float* analog, std::uint8_t* status)
+{
+    const unsigned char* p = dat_.data() + offset_bytes_ + 8; // Past sample number and timestamp
+    const std::size_t channels = channel_count();
+    const double* scale = scale_.data();
+    const double* offset = offset_.data();
+    switch (config_.format) {
+    case ComtradeFormat::Binary:
+        for (std::size_t ch = 0; ch < channels; ++ch, p += 2) {
+            const auto raw = load_le<std::int16_t>(p);
+            analog[ch] = raw == std::numeric_limits<std::int16_t>::min() ? 0.0f : static_cast<float>(raw * scale[ch] + offset[ch]);
+        }
+        break;
+    case ComtradeFormat::Binary32:
+        for (std::size_t ch = 0; ch < channels; ++ch, p += 4) {
+            const auto raw = load_le<std::int32_t>(p);
+            analog[ch] = raw == std::numeric_limits<std::int32_t>::min() ? 0.0f : static_cast<float>(raw * scale[ch] + offset[ch]);
+        }
+        break;
+    default:
+        for (std::size_t ch = 0; ch < channels; ++ch, p += 4)
+            analog[ch] = static_cast<float>(load_le<float>(p) * scale[ch] + offset[ch]);
+        break;
+    }
+    if (status) {
+        for (std::size_t d = 0; d < digital_count(); ++d)
+            status[d] = (load_le<std::uint16_t>(p + (d / 16) * 2) >> (d % 16)) & 1u;
+    }
+    offset_bytes_ += record_bytes_;
+}
+
+bool ComtradeRecord::decode_ascii_frame(float* analog, std::uint8_t* status)
+{
+    const char* p = reinterpret_cast<const char*>(dat_.data()) + offset_bytes_;
+    const char* const end = reinterpret_cast<const char*>(dat_.data()) + dat_.size();
+    while (p < end && (*p == '\r' || *p == '\n'))
+        ++p;
+    if (p == end)
+        return false;
+    const char* line_end = static_cast<const char*>(std::memchr(p, '\n', static_cast<std::size_t>(end - p)));
+    if (!line_end)
+        line_end = end;
+    const auto fields = split_fields(std::string_view(p, static_cast<std::size_t>(line_end - p)));
+    const std::size_t channels = channel_count();
+    if (fields.size() < 2 + channels + digital_count())
+        return false;
+    for (std::size_t ch = 0; ch < channels; ++ch) {
+        // Missing values are blank (2013) or 99999 (1999).
+        double raw = 0.0;
+        const std::string_view field = fields[2 + ch];
+        if (field.empty() || field == "99999")
+            analog[ch] = 0.0f;
+        else if (parse_number(field, raw))
+            analog[ch] = static_cast<float>(raw * scale_[ch] + offset_[ch]);
+        else
+            return false;
+    }
+    if (status)
+        for (std::size_t d = 0; d < digital_count(); ++d)
+            status[d] = fields[2 + channels + d] == "1" ? 1 : 0;
+    offset_bytes_ = static_cast<std::size_t>(line_end - reinterpret_cast<const char*>(dat_.data()));
+    return true;
+}
+
+ComtradeWriter::~ComtradeWriter()
+{
+    if (dat_.is_open())
+        close();
+}
+
+bool ComtradeWriter::open(const std::string& stem, ComtradeConfig config)
+{
+    if (dat_.is_open())
+        close();
+    if (config.sample_rate_Hz <= 0.0) {
+        error_ = "a sampling rate is required";
+        return false;
+    }
+    config_ = std::move(config);
+    config_.format = ComtradeFormat::Float32;
+    config_.revision_year = 2013;
+    config_.sample_count = 0;
+    config_.time_multiplier = 1.0;
+    for (auto& channel : config_.analog) {
+        channel.a = 1.0;
+        channel.b = 0.0;
+        channel.min = std::numeric_limits<float>::max();
+        channel.max = std::numeric_limits<float>::lowest();
+        channel.primary = channel.secondary = 1.0;
+        channel.secondary_values = false;
+    }
+    stem_ = stem;
+    dat_.open(stem_ + ".dat", std::ios::binary | std::ios::trunc);
+    if (!dat_) {
+        error_ = "cannot open '" + stem_ + ".dat'";
+        return false;
+    }
+    record_.assign(8 + config_.analog.size() * 4 + digital_words(config_.digital.size()) * 2, 0);
+    error_.clear();
+    return true;
+}
+
+bool ComtradeWriter::write(std::span<const float> frames, std::span<const std::uint8_t> status)
+{
+    if (!dat_.is_open())
+        return false;
+    const std::size_t channels = config_.analog.size();
+    const std::size_t digital = config_.digital.size();
+    const std::size_t count = channels ? frames.size() / channels : (digital ? status.size() / digital : 0);
+    for (std::size_t f = 0; f < count; ++f) {
+        char* p = record_.data();
+        const auto sample_number = static_cast<std::uint32_t>(config_.sample_count + 1);
+        // Timestamps in microseconds; past 2^32 us they are marked missing
+        // and readers fall back on the sampling rate.
+        const double micros = static_cast<double>(config_.sample_count) * 1e6 / config_.sample_rate_Hz;
+        const std::uint32_t timestamp = micros < 4294967295.0 ? static_cast<std::uint32_t>(std::llround(micros)) : 0xFFFFFFFFu;
+        std::memcpy(p, &sample_number, 4);
+        std::memcpy(p + 4, &timestamp, 4);
+        p += 8;
+        const float* values = frames.data() + f * channels;
+        for (std::size_t ch = 0; ch < channels; ++ch, p += 4) {
+            std::memcpy(p, &values[ch], 4);
+            config_.analog[ch].min = std::min<double>(config_.analog[ch].min, values[ch]);
+            config_.analog[ch].max = std::max<double>(config_.analog[ch].max, values[ch]);
+        }
+        std::memset(p, 0, digital_words(digital) * 2);
+        if (f * digital + digital <= status.size()) {
+            for (std::size_t d = 0; d < digital; ++d) {
+                if (!status[f * digital + d])
+                    continue;
+                std::uint16_t word = load_le<std::uint16_t>(reinterpret_cast<const unsigned char*>(p + (d / 16) * 2));
+                word |= static_cast<std::uint16_t>(1u << (d % 16));
+                std::memcpy(p + (d / 16) * 2, &word, 2);
+            }
+        }
+        dat_.write(record_.data(), static_cast<std::streamsize>(record_.size()));
+        ++config_.sample_count;
+    }
+    if (!dat_) {
+        error_ = "write to '" + stem_ + ".dat' failed";
+        return false;
+    }
+    return true;
+}
+
+bool ComtradeWriter::close()
+{
+    if (!dat_.is_open())
+        return false;
+    dat_.close();
+    const bool data_ok = static_cast<bool>(dat_);
+
+    // Lines end in CR LF as the standard requires.
+    std::ostringstream cfg;
+    cfg.precision(9);
+    cfg << config_.station << ',' << config_.device << ',' << config_.revision_year << "\r\n";
+    cfg << config_.analog.size() + config_.digital.size() << ',' << config_.analog.size() << "A," << config_.digital.size() << "D\r\n";
+    for (std::size_t ch = 0; ch < config_.analog.size(); ++ch) {
+        const ComtradeAnalogChannel& c = config_.analog[ch];
+        const bool empty = c.min > c.max;
+        cfg << ch + 1 << ',' << c.id << ',' << c.phase << ',' << c.circuit << ',' << c.unit << ",1,0,0," << (empty ? 0.0 : c.min) << ','
+            << (empty ? 0.0 : c.max) << ",1,1,P\r\n";
+    }
+    for (std::size_t ch = 0; ch < config_.digital.size(); ++ch) {
+        const ComtradeDigitalChannel& c = config_.digital[ch];
+        cfg << ch + 1 << ',' << c.id << ',' << c.phase << ',' << c.circuit << ',' << c.normal_state << "\r\n";
+    }
+    cfg << config_.line_frequency_Hz << "\r\n";
+    cfg << "1\r\n"
+        << config_.sample_rate_Hz << ',' << config_.sample_count << "\r\n";
+    cfg << config_.start_date << ',' << format_time_of_day(config_.start_time_s) << "\r\n";
+    cfg << config_.trigger_date << ',' << format_time_of_day(config_.trigger_time_s) << "\r\n";
+    cfg << format_name(config_.format) << "\r\n";
+    cfg << config_.time_multiplier << "\r\n";
+    cfg << "0,0\r\n0,0\r\n"; // UTC, no time quality or leap second information
+
+    std::ofstream out(stem_ + ".cfg", std::ios::binary | std::ios::trunc);
+    out << cfg.str();
+    if (!out || !data_ok) {
+        error_ = "cannot write '" + stem_ + (data_ok ? ".cfg'" : ".dat'");
+        return false;
+    }
+    return true;
+}
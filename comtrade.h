@@ -0,0 +1,145 @@
+// comtrade.h
+// IEEE C37.111 (COMTRADE) records: reading as a sampled-value stream and
+// writing simulated waveforms and trip events.
+//
+// A record is a text .cfg describing the channels and a .dat with the
+// samples, in ASCII, BINARY (int16), BINARY32 (int32) or FLOAT32 form. The
+// .cfg is parsed on open; the .dat is memory-mapped and decoded frame by
+// frame as it is read, prefetching ahead and releasing consumed pages, so
+// resident memory stays bounded however large the record is.
+//
+// Analog values are delivered as primary values. Channels in A or V are
+// scaled to kA and kV, the units the protection code works in; other units
+// pass through unchanged. Records must have a single sampling rate.
+#ifndef COMTRADE_H
+#define COMTRADE_H
+
+#include "mapped_file.h"
+#include "sampled_values.h"
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+enum class ComtradeFormat {
+    Ascii,
+    Binary,
+    Binary32,
+    Float32
+};
+
+struct ComtradeAnalogChannel {
+    std::string id;
+    std::string phase;
+    std::string circuit;
+    std::string unit;
+    double a = 1.0; // value = a * raw + b
+    double b = 0.0;
+    double skew_us = 0.0;
+    double min = 0.0;
+    double max = 0.0;
+    double primary = 1.0; // Transformer ratio primary:secondary
+    double secondary = 1.0;
+    bool secondary_values = false; // 'S': a and b give secondary values
+};
+
+struct ComtradeDigitalChannel {
+    std::string id;
+    std::string phase;
+    std::string circuit;
+    int normal_state = 0;
+};
+
+struct ComtradeConfig {
+    std::string station = "HECS";
+    std::string device = "SIM";
+    int revision_year = 2013;
+    std::vector<ComtradeAnalogChannel> analog;
+    std::vector<ComtradeDigitalChannel> digital;
+    double line_frequency_Hz = 50.0;
+    double sample_rate_Hz = 0.0;
+    std::size_t sample_count = 0;
+    std::string start_date = "01/01/2000"; // dd/mm/yyyy of the first sample
+    double start_time_s = 0.0; // Time of day of the first sample
+    std::string trigger_date = "01/01/2000";
+    double trigger_time_s = 0.0;
+    ComtradeFormat format = ComtradeFormat::Float32;
+    double time_multiplier = 1.0;
+};
+
+// Parses .cfg text. Returns false with a message in `error` on malformed input.
+bool parse_comtrade_config(std::string_view text, ComtradeConfig& config, std::string& error);
+
+class ComtradeRecord final : public SampledValueSource {
+public:
+    // Opens <stem>.cfg and <stem>.dat for a path to either file or to the
+    // stem. Returns false and fills error() on failure.
+    bool open(const std::string& path);
+    const std::string& error() const { return error_; }
+    const ComtradeConfig& config() const { return config_; }
+
+    double sample_rate_Hz() const override { return config_.sample_rate_Hz; }
+    std::size_t channel_count() const override { return config_.analog.size(); }
+    std::string channel_name(std::size_t channel) const override { return config_.analog[channel].id; }
+    const char* channel_unit(std::size_t channel) const override { return units_[channel].c_str(); }
+    std::size_t read(std::span<float> frames) override;
+    // The same, with the state (0/1) of every digital channel per frame in
+    // `status`, frame-major like the analog values.
+    std::size_t read(std::span<float> frames, std::span<std::uint8_t> status);
+
+    std::size_t digital_count() const { return config_.digital.size(); }
+    std::size_t frame_count() const { return config_.sample_count; }
+    // First frame at or after the trigger time.
+    std::size_t trigger_frame() const;
+    // Index of the channel with this id, or -1.
+    int analog_index(std::string_view id) const;
+    int digital_index(std::string_view id) const;
+    void rewind();
+
+private:
+    // `status` may be null when the digital states are not wanted.
+    std::size_t read_frames(std::span<float> frames, std::uint8_t* status, std::size_t max_frames);
+    bool decode_ascii_frame(float* analog, std::uint8_t* status);
+    void decode_binary_frame(float* analog, std::uint8_t* status);
+    void advance_window();
+
+    ComtradeConfig config_;
+    MappedFile dat_;
+    std::string error_;
+    std::vector<std::string> units_; // Delivered unit by channel
+    std::vector<double> scale_, offset_; // Raw -> delivered value, by channel
+    std::size_t record_bytes_ = 0; // Binary formats
+    std::size_t next_frame_ = 0;
+    std::size_t offset_bytes_ = 0; // Of the next frame in the .dat
+    std::size_t prefetched_until_ = 0;
+    std::size_t released_until_ = 0;
+};
+
+// Writes a FLOAT32 record: primary values in the channel units given, one
+// frame at a time, so arbitrarily long simulations can be streamed out. The
+// .cfg is written by close(), once the sample count is known.
+class ComtradeWriter {
+public:
+    ~ComtradeWriter();
+    // `config` supplies the station, channels, rates and times; its format
+    // and sample count are set by the writer.
+    bool open(const std::string& stem, ComtradeConfig config);
+    // Sample-major frames of every analog channel; `status` holds the
+    // digital channel states per frame (empty means all zero).
+    bool write(std::span<const float> frames, std::span<const std::uint8_t> status = {});
+    bool close();
+    const std::string& error() const { return error_; }
+    std::size_t frames_written() const { return config_.sample_count; }
+
+private:
+    ComtradeConfig config_;
+    std::string stem_;
+    std::ofstream dat_;
+    std::vector<char> record_;
+    std::string error_;
+};
+
+#endif // COMTRADE_H
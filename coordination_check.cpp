@@ -0,0 +1,237 @@
+// coordination_check.cpp
+#include "coordination_check.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <thread>
+#include <tuple>
+
+std::size_t CoordinationReport::count(CoordinationViolation::Kind kind) const
+{
+    return static_cast<std::size_t>(std::count_if(violations.begin(), violations.end(),
+        [kind](const CoordinationViolation& v) { return v.kind == kind; }));
+}
+
+CoordinationChecker::CoordinationChecker(ProtectionRelayPools& relays, NetworkModel& network, std::size_t threads)
+    : relays_(relays)
+    , network_(network)
+    , threads_(threads > 0 ? threads : std::max(1u, std::thread::hardware_concurrency()))
+{
+}
+
+void CoordinationChecker::collect_groups()
+{
+    groups_.clear();
+    std::vector<std::vector<std::size_t>> relays_on(network_.branch_count());
+    for (std::size_t r = 0; r < relays_.size(); ++r) {
+        const int k = network_.branch_index(relays_.entity(r));
+        if (k >= 0)
+            relays_on[k].push_back(r);
+    }
+    for (std::size_t k = 0; k < network_.branch_count(); ++k) {
+        if (relays_on[k].empty() || !network_.branch_closed_at(k))
+            continue;
+        Group group;
+        group.branch = network_.branch_entity(k);
+        group.primaries = relays_on[k];
+        const int bus = network_.branch_from(k);
+        for (int feeding : network_.bus_branches(bus)) {
+            if (feeding != static_cast<int>(k) && network_.branch_to(feeding) == bus && network_.branch_closed_at(feeding))
+                group.backups.insert(group.backups.end(), relays_on[feeding].begin(), relays_on[feeding].end());
+        }
+        groups_.push_back(std::move(group));
+    }
+}
+
+void CoordinationChecker::fill_cases(FaultCaseTable& rows, std::size_t cases_per_location, CoordinationReport& report)
+{
+    const std::size_t cases = cases_per_location * locations.size();
+    std::size_t total_rows = 0;
+    for (Group& group : groups_) {
+        group.first_row = total_rows;
+        total_rows += (group.primaries.size() + group.backups.size()) * cases;
+    }
+    rows.faulty_entity_id.resize(total_rows);
+    rows.current_kA.resize(total_rows);
+    rows.voltage_kV.resize(total_rows);
+    rows.impedance_Ohm.resize(total_rows);
+    rows.distance_km.resize(total_rows);
+    rows.fault_type.resize(total_rows);
+    rows.prefault_voltage_pu.resize(total_rows);
+
+    // One network solve per location; every relay of the group reads its
+    // view of it, scaled to each fault type and pre-fault voltage.
+    const double phase_to_phase_factor = std::sqrt(3.0) / 2.0;
+    std::vector<std::size_t> group_relays;
+    for (const Group& group : groups_) {
+        group_relays = group.primaries;
+        group_relays.insert(group_relays.end(), group.backups.begin(), group.backups.end());
+        const double length_km = network_.branch_length_km(network_.branch_index(group.branch));
+        for (std::size_t l = 0; l < locations.size(); ++l) {
+            const NetworkFaultResult& result = network_.fault_on_branch(group.branch, locations[l] * length_km);
+            ++report.network_faults;
+            for (std::size_t j = 0; j < group_relays.size(); ++j) {
+                FaultInfo view;
+                network_.relay_view(result, relays_.entity(group_relays[j]), view);
+                std::size_t row = group.first_row + j * cases + l * cases_per_location;
+                for (FaultType type : fault_types) {
+                    const double type_factor = type == FaultType::PhaseToPhase ? phase_to_phase_factor : 1.0;
+                    for (double prefault_pu : prefault_voltage_pu) {
+                        rows.faulty_entity_id[row] = view.faulty_entity_id;
+                        rows.current_kA[row] = view.current_kA * type_factor * prefault_pu;
+                        rows.voltage_kV[row] = view.voltage_kV * prefault_pu;
+                        rows.impedance_Ohm[row] = view.impedance_Ohm;
+                        rows.distance_km[row] = view.distance_km;
+                        rows.fault_type[row] = type;
+                        rows.prefault_voltage_pu[row] = prefault_pu;
+                        ++row;
+                    }
+                }
+            }
+        }
+    }
+}
+
+CoordinationViolation CoordinationChecker::worst_case(CoordinationViolation violation, std::size_t c) const
+{
+    const std::size_t per_type = prefault_voltage_pu.size();
+    const std::size_t per_location = fault_types.size() * per_type;
+    violation.location = locations[c / per_location];
+    violation.fault_type = fault_types[c % per_location / per_type];
+    violation.prefault_voltage_pu = prefault_voltage_pu[c % per_type];
+    return violation;
+}
+
+void CoordinationChecker::grade_group(const Group& group, const FaultCaseTable& rows, std::size_t cases, std::vector<int>& delay,
+    std::vector<double>& margin, std::vector<int>& clearing_ms, std::vector<std::int32_t>& clearing_relay,
+    std::vector<CoordinationViolation>& out, std::size_t& pair_cases) const
+{
+    const std::size_t primaries = group.primaries.size();
+    const std::size_t relay_count = primaries + group.backups.size();
+    delay.resize(relay_count * cases);
+    margin.resize(relay_count * cases);
+    for (std::size_t j = 0; j < relay_count; ++j) {
+        const std::size_t relay = j < primaries ? group.primaries[j] : group.backups[j - primaries];
+        const std::size_t begin = group.first_row + j * cases;
+        relays_.evaluate_cases(relay, rows.span(begin, begin + cases), delay.data() + j * cases, margin.data() + j * cases);
+    }
+
+    // The fastest primary clears each case; ties go to the relay added first.
+    clearing_ms.assign(cases, kNoTripDelayMs);
+    clearing_relay.assign(cases, -1);
+    for (std::size_t j = 0; j < primaries; ++j) {
+        const int* t = delay.data() + j * cases;
+        for (std::size_t c = 0; c < cases; ++c) {
+            const bool faster = t[c] < clearing_ms[c];
+            clearing_ms[c] = faster ? t[c] : clearing_ms[c];
+            clearing_relay[c] = faster ? static_cast<std::int32_t>(j) : clearing_relay[c];
+        }
+    }
+    std::uint32_t not_cleared = 0;
+    std::size_t first_not_cleared = 0;
+    for (std::size_t c = cases; c-- > 0;) {
+        if (clearing_relay[c] < 0) {
+            ++not_cleared;
+            first_not_cleared = c;
+        }
+    }
+    if (not_cleared > 0) {
+        CoordinationViolation v { CoordinationViolation::Kind::NotCleared, -1, -1, group.branch, 0, not_cleared, 0.0, FaultType::ThreePhase, 1.0 };
+        out.push_back(worst_case(v, first_not_cleared));
+    }
+
+    // Pair x case tiles: pair q is (primary q / backups, backup q % backups).
+    const std::size_t backups = group.backups.size();
+    const std::size_t pairs = primaries * backups;
+    struct PairState {
+        int worst_ms = kNoTripDelayMs;
+        std::size_t worst_case = 0;
+        std::uint32_t violating = 0;
+    };
+    std::vector<PairState> state(pairs);
+    for (std::size_t c0 = 0; c0 < cases; c0 += tile_cases) {
+        const std::size_t c1 = std::min(cases, c0 + tile_cases);
+        for (std::size_t q0 = 0; q0 < pairs; q0 += tile_pairs) {
+            const std::size_t q1 = std::min(pairs, q0 + tile_pairs);
+            for (std::size_t q = q0; q < q1; ++q) {
+                const auto p = static_cast<std::int32_t>(q / backups);
+                const int* tp = delay.data() + p * cases;
+                const int* tb = delay.data() + (primaries + q % backups) * cases;
+                PairState& s = state[q];
+                for (std::size_t c = c0; c < c1; ++c) {
+                    if (clearing_relay[c] != p || tb[c] == kNoTripDelayMs)
+                        continue;
+                    ++pair_cases;
+                    const int m = tb[c] - tp[c];
+                    if (m >= coordination_interval_ms)
+                        continue;
+                    ++s.violating;
+                    if (m < s.worst_ms) {
+                        s.worst_ms = m;
+                        s.worst_case = c;
+                    }
+                }
+            }
+        }
+    }
+    for (std::size_t q = 0; q < pairs; ++q) {
+        const PairState& s = state[q];
+        if (s.violating == 0)
+            continue;
+        CoordinationViolation v { s.worst_ms <= 0 ? CoordinationViolation::Kind::BackupFirst : CoordinationViolation::Kind::BelowInterval,
+            static_cast<std::int32_t>(group.primaries[q / backups]), static_cast<std::int32_t>(group.backups[q % backups]),
+            group.branch, s.worst_ms, s.violating, 0.0, FaultType::ThreePhase, 1.0 };
+        out.push_back(worst_case(v, s.worst_case));
+    }
+}
+
+CoordinationReport CoordinationChecker::check()
+{
+    CoordinationReport report;
+    collect_groups();
+    const std::size_t cases_per_location = fault_types.size() * prefault_voltage_pu.size();
+    const std::size_t cases = cases_per_location * locations.size();
+    report.branches = groups_.size();
+    report.cases = groups_.size() * cases;
+    for (const Group& group : groups_)
+        report.pairs += group.primaries.size() * group.backups.size();
+    if (cases == 0)
+        return report;
+
+    // The network model is not shared between threads: its solves come first.
+    FaultCaseTable rows;
+    fill_cases(rows, cases_per_location, report);
+
+    const std::size_t block_groups = 64;
+    const std::size_t blocks = (groups_.size() + block_groups - 1) / block_groups;
+    const std::size_t thread_count = std::max<std::size_t>(1, std::min(threads_, blocks));
+    std::vector<std::vector<CoordinationViolation>> found(thread_count);
+    std::vector<std::size_t> graded(thread_count, 0);
+    std::atomic<std::size_t> next_block { 0 };
+    auto worker = [&](std::size_t t) {
+        std::vector<int> delay, clearing_ms;
+        std::vector<double> margin;
+        std::vector<std::int32_t> clearing_relay;
+        for (std::size_t block = next_block++; block < blocks; block = next_block++) {
+            const std::size_t end = std::min(groups_.size(), (block + 1) * block_groups);
+            for (std::size_t g = block * block_groups; g < end; ++g)
+                grade_group(groups_[g], rows, cases, delay, margin, clearing_ms, clearing_relay, found[t], graded[t]);
+        }
+    };
+    std::vector<std::thread> threads;
+    threads.reserve(thread_count - 1);
+    for (std::size_t t = 1; t < thread_count; ++t)
+        threads.emplace_back(worker, t);
+    worker(0);
+    for (auto& thread : threads)
+        thread.join();
+
+    for (std::size_t t = 0; t < thread_count; ++t) {
+        report.violations.insert(report.violations.end(), found[t].begin(), found[t].end());
+        report.pair_cases += graded[t];
+    }
+    std::sort(report.violations.begin(), report.violations.end(), [](const CoordinationViolation& a, const CoordinationViolation& b) {
+        return std::tie(a.kind, a.margin_ms, a.branch, a.primary, a.backup) < std::tie(b.kind, b.margin_ms, b.branch, b.primary, b.backup);
+    });
+    return report;
+}
@@ -0,0 +1,100 @@
+// coordination_check.h
+// Protection coordination check over a network: for every primary/backup
+// relay pair and fault case, the grading margin between the backup's and
+// the primary's trip times, with the pairs that break the coordination
+// interval collected into a compact violation report.
+//
+// Pairs come from the network model: a relay on branch B (measuring at B's
+// from bus) backs up every relay on a branch leaving the bus where B ends.
+// The fault cases of a primary branch are short circuits at a few locations
+// along it, solved once each on the network, and expanded over fault types
+// and pre-fault voltages with the scalar model of build_fault_cases. What
+// each relay of the branch and of its backup branches measures is stored as
+// one contiguous block of case columns per relay, so the relays run their
+// batch evaluate_cases over it.
+//
+// A case is cleared by the fastest relay on the primary branch; each backup
+// relay is graded against that relay. Branches are handed to worker threads
+// block by block, and within a branch the pair x case margins are computed
+// in tiles sized to keep the delay columns they read in cache.
+#ifndef COORDINATION_CHECK_H
+#define COORDINATION_CHECK_H
+
+#include "ecs_core.h"
+#include "fault_sweep.h"
+#include "network_model.h"
+#include "protection_system.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct CoordinationViolation {
+    enum class Kind : std::uint8_t {
+        NotCleared, // No relay on the branch operates
+        BackupFirst, // The backup trips no later than the primary
+        BelowInterval // Margin under the coordination interval
+    };
+    Kind kind;
+    std::int32_t primary; // Flat relay index; -1 for NotCleared
+    std::int32_t backup; // -1 for NotCleared
+    Entity branch; // Faulted (primary) branch
+    int margin_ms; // Smallest over the violating cases; 0 for NotCleared
+    std::uint32_t cases; // Violating cases
+    // Worst case
+    double location; // Fraction of the branch from its from bus
+    FaultType fault_type;
+    double prefault_voltage_pu;
+};
+
+struct CoordinationReport {
+    std::size_t branches = 0; // With relays, faulted
+    std::size_t network_faults = 0; // Solved on the network
+    std::size_t cases = 0; // After the type and voltage expansion
+    std::size_t pairs = 0;
+    std::size_t pair_cases = 0; // Graded: the primary clears and the backup operates
+    // By kind, then smallest margin first.
+    std::vector<CoordinationViolation> violations;
+
+    std::size_t count(CoordinationViolation::Kind kind) const;
+};
+
+class CoordinationChecker {
+public:
+    // threads = 0 uses every hardware thread.
+    CoordinationChecker(ProtectionRelayPools& relays, NetworkModel& network, std::size_t threads = 0);
+
+    int coordination_interval_ms = 300;
+    std::vector<double> locations { 0.05, 0.5, 0.95 }; // Fractions of the branch length
+    std::vector<FaultType> fault_types { FaultType::ThreePhase, FaultType::PhaseToPhase };
+    std::vector<double> prefault_voltage_pu { 0.95, 1.0, 1.05 };
+    std::size_t tile_pairs = 16;
+    std::size_t tile_cases = 256;
+
+    // Checks the relays currently in the pools on the network's current
+    // topology.
+    CoordinationReport check();
+
+private:
+    // One primary branch: its relays, the relays backing them up, and the
+    // block of case rows holding what they measure.
+    struct Group {
+        Entity branch;
+        std::vector<std::size_t> primaries;
+        std::vector<std::size_t> backups;
+        std::size_t first_row = 0; // Relay r of primaries then backups: rows first_row + r * cases
+    };
+
+    void collect_groups();
+    void fill_cases(FaultCaseTable& rows, std::size_t cases_per_location, CoordinationReport& report);
+    void grade_group(const Group& group, const FaultCaseTable& rows, std::size_t cases, std::vector<int>& delay,
+        std::vector<double>& margin, std::vector<int>& clearing_ms, std::vector<std::int32_t>& clearing_relay,
+        std::vector<CoordinationViolation>& out, std::size_t& pair_cases) const;
+    CoordinationViolation worst_case(CoordinationViolation violation, std::size_t c) const;
+
+    ProtectionRelayPools& relays_;
+    NetworkModel& network_;
+    std::size_t threads_;
+    std::vector<Group> groups_;
+};
+
+#endif // COORDINATION_CHECK_H
@@ -19,14 +19,17 @@
 #ifndef CPS_CORO_LIB_H
 #define CPS_CORO_LIB_H
 
+#include <array> // 用于 std::array
 #include <chrono> // 用于时间和持续时间
 #include <coroutine> // 用于协程支持
+#include <cstddef> // 用于 std::size_t
 #include <cstdint> // 用于固定宽度的整数类型，如 uint64_t
 #include <exception> // 用于异常处理，如 std::terminate
 #include <functional> // 用于 std::function
 #include <map> // 用于 std::multimap
 #include <memory> // 用于智能指针 (虽然在此文件中未直接使用，但常与协程库一起使用)
 #include <queue> // 用于 std::queue
+#include <type_traits> // 用于 std::is_trivially_copyable_v
 #include <utility> // 用于 std::pair, std::move 等
 #include <variant> // 用于 std::variant (虽然在此文件中未直接使用)
 #include <vector> // 用于 std::vector
@@ -53,6 +56,17 @@ protected:
 // 事件ID类型定义，使用64位无符号整数
 using EventId = uint64_t;
 
+// 事件拦截器接口 (故障/攻击注入等)
+// 调度器在把受关注的事件交给处理器之前调用 intercept。返回 true 表示拦截器
+// 已接管该事件 (丢弃，或稍后/改写后自行通过 dispatch_event 投递)，调度器不再分发；
+// 返回 false 则照常分发。size 为事件数据的字节数；不带数据的事件 data 为 nullptr，
+// 不能按字节复制的数据 size 为 0，拦截器只能放行或丢弃。
+class EventInterceptor {
+public:
+    virtual ~EventInterceptor() = default;
+    virtual bool intercept(EventId event_id, const void* data, std::size_t size) = 0;
+};
+
 // Task 类代表一个协程任务
 // Task 是一个无返回值的协程封装。它提供了协程的句柄管理，包括创建、销毁、移动和恢复执行。
 // promise_type 是协程的约定类型，定义了协程如何创建、如何处理返回值和异常等。
@@ -154,6 +168,9 @@ public:
     using duration = std::chrono::milliseconds;
     // 事件处理器函数类型，接受一个 const void* 参数 (用于传递事件数据)
     using EventHandler = std::function<void(const void*)>;
+    // 定时回调函数类型：不需要协程帧的定时器，到期时以 (context, tag) 调用。
+    // 状态机式的系统用 tag 区分自己的定时器（例如元件下标与序号）。
+    using TimerCallback = void (*)(void* context, std::uint64_t tag);
 
     // 构造函数：初始化当前时间为0，并将自身设置为当前线程的活动调度器
     Scheduler()
@@ -180,14 +197,22 @@ public:
     // 调度一个协程句柄，将其加入就绪队列等待立即执行
     void schedule(std::coroutine_handle<> handle)
     {
-        ready_tasks_.push(handle);
+        ready_tasks_.push(Wakeup { handle });
     }
 
     // 调度一个协程句柄，在指定的延迟后执行
     void schedule_after(duration delay, std::coroutine_handle<> handle)
     {
-        // timed_tasks_ 是一个 multimap，键是唤醒时间点，值是协程句柄
-        timed_tasks_.emplace(current_time_ + delay, handle);
+        // timed_tasks_ 是一个 multimap，键是唤醒时间点，值是待唤醒项
+        timed_tasks_.emplace(current_time_ + delay, Wakeup { handle });
+    }
+
+    // 在指定的延迟后调用 callback(context, tag)
+    // 与协程定时器共用同一个定时结构和就绪队列，因此同一时刻到期的回调和协程
+    // 按登记顺序执行。定时器不可取消：需要取消时由回调按 tag 判断是否已过时。
+    void call_after(duration delay, TimerCallback callback, void* context, std::uint64_t tag)
+    {
+        timed_tasks_.emplace(current_time_ + delay, Wakeup { nullptr, callback, context, tag });
     }
 
     // 注册一个事件处理器
@@ -202,8 +227,31 @@ public:
     // EventData 是事件数据的类型。
     // 所有注册到此 event_id 的处理器都会被调用，并传入事件数据。
     // 处理器在被调用后会从 event_handlers_ 中移除 (一次性触发)。
+    // 若安装了事件拦截器且关注此 event_id，先交给拦截器。
     template <typename EventData>
     void trigger_event(EventId event_id, const EventData& data)
+    {
+        if (intercepts(event_id)) {
+            const std::size_t size = std::is_trivially_copyable_v<EventData> ? sizeof(EventData) : 0;
+            if (interceptor_->intercept(event_id, static_cast<const void*>(&data), size))
+                return;
+        }
+        dispatch_event(event_id, static_cast<const void*>(&data)); // 将数据转换为 const void* 传递
+    }
+
+    // 触发一个不带数据的事件
+    // 所有注册到此 event_id 的处理器都会被调用，传入 nullptr 作为数据。
+    // 处理器在被调用后会从 event_handlers_ 中移除 (一次性触发)。
+    void trigger_event(EventId event_id)
+    {
+        if (intercepts(event_id) && interceptor_->intercept(event_id, nullptr, 0))
+            return;
+        dispatch_event(event_id, nullptr); // 不带数据，传递 nullptr
+    }
+
+    // 把事件直接交给已注册的处理器，不经过拦截器 (拦截器投递延迟、重放或
+    // 改写后的事件时使用)。
+    void dispatch_event(EventId event_id, const void* data)
     {
         auto range = event_handlers_.equal_range(event_id); // 获取所有匹配此 event_id 的处理器
         std::vector<EventHandler> handlers_to_call; // 存储待调用的处理器，防止迭代器失效
@@ -218,27 +266,23 @@ public:
         }
         // 调用处理器
         for (const auto& handler_func : handlers_to_call) {
-            handler_func(static_cast<const void*>(&data)); // 将数据转换为 const void* 传递
+            handler_func(data);
         }
     }
 
-    // 触发一个不带数据的事件
-    // 所有注册到此 event_id 的处理器都会被调用，传入 nullptr 作为数据。
-    // 处理器在被调用后会从 event_handlers_ 中移除 (一次性触发)。
-    void trigger_event(EventId event_id)
+    // 安装事件拦截器，只拦截 event_ids 中的事件；传入 nullptr 则卸载。
+    // 关注的事件ID记在一个按ID低位索引的位图中，未关注的事件只多一次位测试；
+    // 位图的偶然重合由拦截器自行放行。
+    void set_event_interceptor(EventInterceptor* interceptor, const std::vector<EventId>& event_ids)
     {
-        auto range = event_handlers_.equal_range(event_id);
-        std::vector<EventHandler> handlers_to_call;
-        for (auto it = range.first; it != range.second; ++it) {
-            handlers_to_call.push_back(it->second);
-        }
-        if (range.first != range.second) {
-            event_handlers_.erase(range.first, range.second);
-        }
-        for (const auto& handler_func : handlers_to_call) {
-            handler_func(nullptr); // 不带数据，传递 nullptr
+        interceptor_ = interceptor;
+        intercepted_ids_.fill(0);
+        if (interceptor) {
+            for (EventId id : event_ids)
+                intercepted_ids_[(id >> 6) % intercepted_ids_.size()] |= std::uint64_t { 1 } << (id & 63);
         }
     }
+    EventInterceptor* event_interceptor() const { return interceptor_; }
 
     // 执行一步调度循环
     // 优先执行就绪队列中的任务。如果就绪队列为空，则检查是否有到期的定时任务。
@@ -248,11 +292,9 @@ public:
     {
         // 1. 处理就绪任务
         if (!ready_tasks_.empty()) {
-            auto h = ready_tasks_.front(); // 获取队首任务
+            Wakeup w = ready_tasks_.front(); // 获取队首任务
             ready_tasks_.pop(); // 从队列移除
-            if (!h.done()) { // 如果任务未完成
-                h.resume(); // 恢复执行
-            }
+            w.run(); // 恢复未完成的协程，或调用回调
             return true; // 执行了一个就绪任务
         }
 
@@ -262,9 +304,9 @@ public:
             set_time(timed_tasks_.begin()->first);
             // 将所有到期或早于当前时间的定时任务移到就绪队列
             while (!timed_tasks_.empty() && timed_tasks_.begin()->first <= current_time_) {
-                auto h = timed_tasks_.begin()->second; // 获取任务句柄
+                Wakeup w = timed_tasks_.begin()->second; // 获取待唤醒项
                 timed_tasks_.erase(timed_tasks_.begin()); // 从定时任务中移除
-                ready_tasks_.push(h); // 加入就绪队列
+                ready_tasks_.push(w); // 加入就绪队列
             }
             return true; // 处理了定时任务 (即使只是移动到就绪队列)
         }
@@ -279,11 +321,9 @@ public:
         while (current_time_ < end_time && (!ready_tasks_.empty() || !timed_tasks_.empty())) {
             // 优先处理所有当前就绪的任务
             while (!ready_tasks_.empty()) {
-                auto h = ready_tasks_.front();
+                Wakeup w = ready_tasks_.front();
                 ready_tasks_.pop();
-                if (!h.done()) {
-                    h.resume();
-                }
+                w.run();
             }
 
             // 如果就绪队列为空，但仍有定时任务
@@ -298,9 +338,9 @@ public:
                 set_time(next_event_time);
                 // 将所有到期或早于当前时间的定时任务移到就绪队列
                 while (!timed_tasks_.empty() && timed_tasks_.begin()->first <= current_time_) {
-                    auto h = timed_tasks_.begin()->second;
+                    Wakeup w = timed_tasks_.begin()->second;
                     timed_tasks_.erase(timed_tasks_.begin());
-                    ready_tasks_.push(h);
+                    ready_tasks_.push(w);
                 }
             }
         }
@@ -317,10 +357,34 @@ public:
     }
 
 private:
+    // 是否需要把此事件交给拦截器
+    bool intercepts(EventId event_id) const
+    {
+        return interceptor_ && (intercepted_ids_[(event_id >> 6) % intercepted_ids_.size()] >> (event_id & 63) & 1);
+    }
+
+    // 就绪队列和定时结构中的一项：一个协程句柄，或一个定时回调
+    struct Wakeup {
+        std::coroutine_handle<> handle;
+        TimerCallback callback = nullptr;
+        void* context = nullptr;
+        std::uint64_t tag = 0;
+
+        void run() const
+        {
+            if (callback)
+                callback(context, tag);
+            else if (!handle.done())
+                handle.resume();
+        }
+    };
+
     time_point current_time_; // 调度器的当前模拟时间
-    std::queue<std::coroutine_handle<>> ready_tasks_; // 就绪任务队列 (FIFO)
-    std::multimap<time_point, std::coroutine_handle<>> timed_tasks_; // 定时任务，按时间排序
+    std::queue<Wakeup> ready_tasks_; // 就绪任务队列 (FIFO)
+    std::multimap<time_point, Wakeup> timed_tasks_; // 定时任务，按时间排序
     std::multimap<EventId, EventHandler> event_handlers_; // 事件处理器，按事件ID组织
+    EventInterceptor* interceptor_ = nullptr; // 事件拦截器 (可为空)
+    std::array<std::uint64_t, 64> intercepted_ids_ {}; // 受拦截事件ID的位图 (4096 位)
 };
 
 // Delay 等待体，用于使协程暂停指定的时长
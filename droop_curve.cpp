@@ -0,0 +1,347 @@
+// droop_curve.cpp
+#include "droop_curve.h"
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <limits>
+#include <utility>
+
+namespace {
+
+constexpr double kInf = std::numeric_limits<double>::infinity();
+
+// A point strictly inside (left, right) used to classify a piece on that interval.
+double interior_point(double left, double right)
+{
+    if (std::isinf(left) && std::isinf(right))
+        return 0.0;
+    if (std::isinf(left))
+        return right - 1.0;
+    if (std::isinf(right))
+        return left + 1.0;
+    return 0.5 * (left + right);
+}
+
+} // namespace
+
+DroopCurve::DroopCurve()
+    : pieces_(1)
+{
+}
+
+DroopCurve DroopCurve::constant(double value)
+{
+    DroopCurve curve;
+    curve.pieces_[0].y0 = value;
+    return curve;
+}
+
+DroopCurve DroopCurve::from_pieces(std::vector<double> breakpoints, std::vector<double> point_values, std::vector<Piece> pieces)
+{
+    DroopCurve curve;
+    curve.breakpoints_ = std::move(breakpoints);
+    curve.point_values_ = std::move(point_values);
+    curve.pieces_ = std::move(pieces);
+    return curve;
+}
+
+std::size_t DroopCurve::piece_index(double x) const
+{
+    return static_cast<std::size_t>(std::upper_bound(breakpoints_.begin(), breakpoints_.end(), x) - breakpoints_.begin());
+}
+
+double DroopCurve::evaluate(double x) const
+{
+    std::size_t i = piece_index(x);
+    if (i > 0 && breakpoints_[i - 1] == x)
+        return point_values_[i - 1];
+    return pieces_[i].at(x);
+}
+
+void DroopCurve::clamp(double lo, double hi)
+{
+    std::vector<double> xs;
+    std::vector<double> values;
+    std::vector<Piece> pieces;
+    xs.reserve(breakpoints_.size() + 4);
+    values.reserve(breakpoints_.size() + 4);
+    pieces.reserve(pieces_.size() + 4);
+
+    auto clamp_value = [&](double v) { return std::max(lo, std::min(hi, v)); };
+
+    for (std::size_t i = 0; i < pieces_.size(); ++i) {
+        const Piece& p = pieces_[i];
+        double left = (i == 0) ? -kInf : breakpoints_[i - 1];
+        double right = (i == breakpoints_.size()) ? kInf : breakpoints_[i];
+
+        // Points where the linear piece leaves [lo, hi] split it into sub-pieces.
+        double cuts[2];
+        int n_cuts = 0;
+        if (p.slope != 0.0) {
+            for (double level : { lo, hi }) {
+                if (std::isinf(level))
+                    continue;
+                double c = p.x0 + (level - p.y0) / p.slope;
+                if (c > left && c < right)
+                    cuts[n_cuts++] = c;
+            }
+            if (n_cuts == 2) {
+                if (cuts[0] > cuts[1])
+                    std::swap(cuts[0], cuts[1]);
+                if (cuts[0] == cuts[1])
+                    n_cuts = 1;
+            }
+        }
+
+        double a = left;
+        for (int k = 0; k <= n_cuts; ++k) {
+            double b = (k < n_cuts) ? cuts[k] : right;
+            double v = p.at(interior_point(a, b));
+            if (v < lo)
+                pieces.push_back(Piece { 0.0, 0.0, lo });
+            else if (v > hi)
+                pieces.push_back(Piece { 0.0, 0.0, hi });
+            else
+                pieces.push_back(p);
+            if (k < n_cuts) {
+                xs.push_back(cuts[k]);
+                values.push_back(clamp_value(p.at(cuts[k])));
+            }
+            a = b;
+        }
+
+        if (i < breakpoints_.size()) {
+            xs.push_back(breakpoints_[i]);
+            values.push_back(clamp_value(point_values_[i]));
+        }
+    }
+
+    breakpoints_ = std::move(xs);
+    point_values_ = std::move(values);
+    pieces_ = std::move(pieces);
+}
+
+DroopCurve& DroopCurve::operator+=(const DroopCurve& other)
+{
+    std::vector<double> xs;
+    xs.reserve(breakpoints_.size() + other.breakpoints_.size());
+    std::set_union(breakpoints_.begin(), breakpoints_.end(),
+        other.breakpoints_.begin(), other.breakpoints_.end(),
+        std::back_inserter(xs));
+
+    std::vector<double> values;
+    values.reserve(xs.size());
+    for (double x : xs) {
+        values.push_back(evaluate(x) + other.evaluate(x));
+    }
+
+    // Walk both breakpoint lists in step; every merged interval lies inside
+    // exactly one piece of each operand.
+    std::vector<Piece> pieces;
+    pieces.reserve(xs.size() + 1);
+    std::size_t ia = 0;
+    std::size_t ib = 0;
+    for (std::size_t i = 0; i <= xs.size(); ++i) {
+        if (i > 0) {
+            double left = xs[i - 1];
+            while (ia < breakpoints_.size() && breakpoints_[ia] <= left)
+                ++ia;
+            while (ib < other.breakpoints_.size() && other.breakpoints_[ib] <= left)
+                ++ib;
+        }
+        const Piece& pa = pieces_[ia];
+        const Piece& pb = other.pieces_[ib];
+        pieces.push_back(Piece { pa.slope + pb.slope, pa.x0, pa.y0 + pb.at(pa.x0) });
+    }
+
+    breakpoints_ = std::move(xs);
+    point_values_ = std::move(values);
+    pieces_ = std::move(pieces);
+    return *this;
+}
+
+void AggregateDroopCurve::set_contribution(Key key, const DroopCurve& curve)
+{
+    remove_contribution(key);
+
+    Contribution c;
+    const auto& xs = curve.breakpoints();
+    const auto& points = curve.point_values();
+    const auto& pieces = curve.pieces();
+
+    auto slope_of = [&](std::size_t i) { return pieces[i].slope; };
+    auto intercept_of = [&](std::size_t i) { return pieces[i].y0 - pieces[i].slope * pieces[i].x0; };
+
+    c.slope = slope_of(0);
+    c.intercept = intercept_of(0);
+    c.steps.reserve(xs.size());
+    for (std::size_t i = 0; i < xs.size(); ++i) {
+        double right_slope = slope_of(i + 1);
+        double right_intercept = intercept_of(i + 1);
+        c.steps.push_back(Step {
+            xs[i],
+            right_slope - slope_of(i),
+            right_intercept - intercept_of(i),
+            points[i] - (right_slope * xs[i] + right_intercept) });
+    }
+
+    if (!stale_) {
+        if (knows_breakpoints(c))
+            apply(c, +1);
+        else
+            stale_ = true;
+    }
+    step_count_ += c.steps.size();
+    contributions_.emplace(key, std::move(c));
+    note_update();
+}
+
+bool AggregateDroopCurve::remove_contribution(Key key)
+{
+    auto it = contributions_.find(key);
+    if (it == contributions_.end())
+        return false;
+    if (!stale_)
+        apply(it->second, -1);
+    step_count_ -= it->second.steps.size();
+    contributions_.erase(it);
+    note_update();
+    return true;
+}
+
+void AggregateDroopCurve::clear()
+{
+    contributions_.clear();
+    step_count_ = 0;
+    stale_ = true;
+}
+
+bool AggregateDroopCurve::knows_breakpoints(const Contribution& c) const
+{
+    for (const Step& step : c.steps) {
+        if (!std::binary_search(xs_.begin(), xs_.end(), step.x))
+            return false;
+    }
+    return true;
+}
+
+void AggregateDroopCurve::apply(const Contribution& c, int sign)
+{
+    base_slope_ += sign * c.slope;
+    base_intercept_ += sign * c.intercept;
+    const std::size_t n = xs_.size();
+    for (const Step& step : c.steps) {
+        std::size_t i = static_cast<std::size_t>(std::lower_bound(xs_.begin(), xs_.end(), step.x) - xs_.begin());
+        if (sign > 0 && step_counts_[i]++ == 0)
+            ++live_breakpoints_;
+        if (sign < 0 && --step_counts_[i] == 0)
+            --live_breakpoints_;
+        offsets_[i] += sign * step.point_offset;
+        for (std::size_t j = i + 1; j <= n; j += j & (~j + 1)) {
+            slope_tree_[j] += sign * step.d_slope;
+            intercept_tree_[j] += sign * step.d_intercept;
+        }
+    }
+}
+
+void AggregateDroopCurve::note_update()
+{
+    // Re-summing the table after about as many updates as it has entries
+    // keeps the amortized cost per update at O(log n).
+    constexpr std::size_t kMinUpdatesBetweenRebuilds = 64;
+    if (++updates_since_rebuild_ > std::max(kMinUpdatesBetweenRebuilds, step_count_ + contributions_.size()))
+        stale_ = true;
+}
+
+void AggregateDroopCurve::rebuild() const
+{
+    std::vector<const Step*> steps;
+    steps.reserve(step_count_);
+    base_slope_ = 0.0;
+    base_intercept_ = 0.0;
+    for (const auto& [key, c] : contributions_) {
+        base_slope_ += c.slope;
+        base_intercept_ += c.intercept;
+        for (const Step& step : c.steps)
+            steps.push_back(&step);
+    }
+    // Stable: steps sharing a breakpoint are summed in key order.
+    std::stable_sort(steps.begin(), steps.end(), [](const Step* a, const Step* b) { return a->x < b->x; });
+
+    xs_.clear();
+    step_counts_.clear();
+    offsets_.clear();
+    slope_tree_.assign(1, 0.0);
+    intercept_tree_.assign(1, 0.0);
+    for (const Step* step : steps) {
+        if (xs_.empty() || xs_.back() != step->x) {
+            xs_.push_back(step->x);
+            step_counts_.push_back(0);
+            offsets_.push_back(0.0);
+            slope_tree_.push_back(0.0);
+            intercept_tree_.push_back(0.0);
+        }
+        ++step_counts_.back();
+        offsets_.back() += step->point_offset;
+        slope_tree_.back() += step->d_slope;
+        intercept_tree_.back() += step->d_intercept;
+    }
+    // Turn the per-breakpoint sums into Fenwick trees in place.
+    const std::size_t n = xs_.size();
+    for (std::size_t j = 1; j <= n; ++j) {
+        std::size_t parent = j + (j & (~j + 1));
+        if (parent <= n) {
+            slope_tree_[parent] += slope_tree_[j];
+            intercept_tree_[parent] += intercept_tree_[j];
+        }
+    }
+    live_breakpoints_ = n;
+    updates_since_rebuild_ = 0;
+    stale_ = false;
+}
+
+double AggregateDroopCurve::prefix(const std::vector<double>& tree, double base, std::size_t count) const
+{
+    double sum = 0.0;
+    for (std::size_t j = count; j > 0; j &= j - 1)
+        sum += tree[j];
+    return base + sum;
+}
+
+double AggregateDroopCurve::evaluate(double x) const
+{
+    refresh();
+    std::size_t i = static_cast<std::size_t>(std::upper_bound(xs_.begin(), xs_.end(), x) - xs_.begin());
+    double value = prefix(slope_tree_, base_slope_, i) * x + prefix(intercept_tree_, base_intercept_, i);
+    if (i > 0 && xs_[i - 1] == x && step_counts_[i - 1] > 0)
+        value += offsets_[i - 1];
+    return value;
+}
+
+DroopCurve AggregateDroopCurve::to_curve() const
+{
+    refresh();
+    std::vector<double> xs;
+    std::vector<double> point_values;
+    std::vector<DroopCurve::Piece> pieces;
+    xs.reserve(live_breakpoints_);
+    point_values.reserve(live_breakpoints_);
+    pieces.reserve(live_breakpoints_ + 1);
+    pieces.push_back(DroopCurve::Piece { base_slope_, 0.0, base_intercept_ });
+    for (std::size_t i = 0; i < xs_.size(); ++i) {
+        if (step_counts_[i] == 0)
+            continue;
+        double slope = prefix(slope_tree_, base_slope_, i + 1);
+        double intercept = prefix(intercept_tree_, base_intercept_, i + 1);
+        xs.push_back(xs_[i]);
+        point_values.push_back(slope * xs_[i] + intercept + offsets_[i]);
+        pieces.push_back(DroopCurve::Piece { slope, 0.0, intercept });
+    }
+    return DroopCurve::from_pieces(std::move(xs), std::move(point_values), std::move(pieces));
+}
+
+std::size_t AggregateDroopCurve::breakpoint_count() const
+{
+    refresh();
+    return live_breakpoints_;
+}
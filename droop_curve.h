@@ -0,0 +1,122 @@
+// droop_curve.h
+#ifndef DROOP_CURVE_H
+#define DROOP_CURVE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+// Piecewise-linear response curve P(df) with explicit breakpoints.
+// Each breakpoint carries its own point value so that curves with jumps
+// (e.g. an EV pile leaving its scheduled charging power at the deadband edge)
+// are represented exactly. Pieces are stored in anchored form
+// y0 + slope * (x - x0), which reproduces the per-device droop arithmetic
+// bit-for-bit on single-device curves.
+class DroopCurve {
+public:
+    struct Piece {
+        double slope = 0.0;
+        double x0 = 0.0;
+        double y0 = 0.0;
+        double at(double x) const { return y0 + slope * (x - x0); }
+    };
+
+    DroopCurve(); // Identically zero.
+    static DroopCurve constant(double value);
+    // Builds a curve from explicit breakpoints. `pieces` must hold one more
+    // entry than `breakpoints`; piece i covers the open interval between
+    // breakpoint i-1 and breakpoint i.
+    static DroopCurve from_pieces(std::vector<double> breakpoints, std::vector<double> point_values, std::vector<Piece> pieces);
+
+    // O(log n) evaluation via binary search over the breakpoints.
+    double evaluate(double x) const;
+
+    // Pointwise clamp into [lo, hi]; use +/-infinity for a one-sided clamp.
+    void clamp(double lo, double hi);
+
+    // Pointwise sum. The result has the union of both breakpoint sets.
+    DroopCurve& operator+=(const DroopCurve& other);
+
+    std::size_t breakpoint_count() const { return breakpoints_.size(); }
+    const std::vector<double>& breakpoints() const { return breakpoints_; }
+    const std::vector<double>& point_values() const { return point_values_; }
+    const std::vector<Piece>& pieces() const { return pieces_; }
+
+private:
+    std::size_t piece_index(double x) const;
+
+    std::vector<double> breakpoints_; // Strictly increasing.
+    std::vector<double> point_values_; // Value exactly at breakpoints_[i].
+    std::vector<Piece> pieces_; // breakpoints_.size() + 1 entries.
+};
+
+// Sum of many DroopCurves, keyed by contributor (typically an Entity), that
+// can be updated one contributor at a time. Each contribution is stored as
+// slope/intercept steps at its breakpoints. The distinct breakpoints are kept
+// sorted with Fenwick trees over their slope and intercept steps, so setting
+// or removing a contribution whose breakpoints are already known costs
+// O(k log n) for its k steps and evaluation is O(log n).
+//
+// A contribution that brings a new breakpoint triggers a full rebuild at the
+// next read, and so does a budget of incremental updates proportional to the
+// table size, which keeps the rounding of repeated add/subtract bounded. A
+// rebuild sums the contributions in key order, so a rebuilt table does not
+// depend on the order in which they were set.
+class AggregateDroopCurve {
+public:
+    using Key = std::uint64_t;
+
+    void set_contribution(Key key, const DroopCurve& curve);
+    bool remove_contribution(Key key);
+    void clear();
+
+    double evaluate(double x) const;
+    DroopCurve to_curve() const;
+
+    std::size_t contributor_count() const { return contributions_.size(); }
+    std::size_t breakpoint_count() const;
+
+private:
+    struct Step {
+        double x;
+        double d_slope; // Change of slope when crossing the breakpoint
+        double d_intercept;
+        double point_offset; // Point value minus the right-hand piece at the breakpoint
+    };
+    struct Contribution {
+        double slope = 0.0; // Leftmost piece, in slope/intercept form
+        double intercept = 0.0;
+        std::vector<Step> steps;
+    };
+
+    // Adds (sign +1) or subtracts (sign -1) a contribution whose breakpoints
+    // are all in xs_.
+    void apply(const Contribution& c, int sign);
+    bool knows_breakpoints(const Contribution& c) const;
+    void note_update();
+    void rebuild() const;
+    void refresh() const
+    {
+        if (stale_)
+            rebuild();
+    }
+    // Slope or intercept right of the first `count` breakpoints.
+    double prefix(const std::vector<double>& tree, double base, std::size_t count) const;
+
+    std::map<Key, Contribution> contributions_; // Key order fixes the summation order of a rebuild
+    std::size_t step_count_ = 0;
+
+    mutable bool stale_ = false; // Tables must be rebuilt before the next read
+    mutable std::size_t updates_since_rebuild_ = 0;
+    mutable double base_slope_ = 0.0; // Sum of the leftmost pieces
+    mutable double base_intercept_ = 0.0;
+    mutable std::vector<double> xs_; // Distinct breakpoints, sorted
+    mutable std::vector<std::uint32_t> step_counts_; // Steps at xs_[i]; 0 once all were removed
+    mutable std::vector<double> offsets_; // Summed point offsets at xs_[i]
+    mutable std::vector<double> slope_tree_; // Fenwick trees over the steps at xs_, 1-based
+    mutable std::vector<double> intercept_tree_;
+    mutable std::size_t live_breakpoints_ = 0;
+};
+
+#endif // DROOP_CURVE_H
@@ -0,0 +1,325 @@
+// event_injection.cpp
+#include "event_injection.h"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <sstream>
+#include <string_view>
+
+namespace {
+double read_field(const unsigned char* data, const InjectionField& field)
+{
+    const unsigned char* at = data + field.offset;
+    switch (field.type) {
+    case InjectionField::Type::F64: { double v; std::memcpy(&v, at, sizeof v); return v; }
+    case InjectionField::Type::F32: { float v; std::memcpy(&v, at, sizeof v); return v; }
+    case InjectionField::Type::I64: { std::int64_t v; std::memcpy(&v, at, sizeof v); return static_cast<double>(v); }
+    case InjectionField::Type::U64: { std::uint64_t v; std::memcpy(&v, at, sizeof v); return static_cast<double>(v); }
+    case InjectionField::Type::I32: { std::int32_t v; std::memcpy(&v, at, sizeof v); return v; }
+    case InjectionField::Type::U32: { std::uint32_t v; std::memcpy(&v, at, sizeof v); return v; }
+    }
+    return 0.0;
+}
+
+template <typename T>
+void store(unsigned char* at, T v)
+{
+    std::memcpy(at, &v, sizeof v);
+}
+
+void write_field(unsigned char* data, const InjectionField& field, double value)
+{
+    unsigned char* at = data + field.offset;
+    switch (field.type) {
+    case InjectionField::Type::F64: store(at, value); break;
+    case InjectionField::Type::F32: store(at, static_cast<float>(value)); break;
+    case InjectionField::Type::I64: store(at, static_cast<std::int64_t>(std::llround(value))); break;
+    case InjectionField::Type::U64: store(at, static_cast<std::uint64_t>(std::llround(value))); break;
+    case InjectionField::Type::I32: store(at, static_cast<std::int32_t>(std::lround(value))); break;
+    case InjectionField::Type::U32: store(at, static_cast<std::uint32_t>(std::lround(value))); break;
+    }
+}
+
+// Keys are read exactly, not through a double.
+std::uint64_t read_key(const unsigned char* data, const InjectionField& field)
+{
+    const unsigned char* at = data + field.offset;
+    if (field.width() == 4) {
+        std::uint32_t v;
+        std::memcpy(&v, at, sizeof v);
+        return v;
+    }
+    std::uint64_t v;
+    std::memcpy(&v, at, sizeof v);
+    return v;
+}
+
+template <typename T>
+bool parse_number(std::string_view text, T& value)
+{
+    auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+    return ec == std::errc() && end == text.data() + text.size();
+}
+
+bool parse_field(std::string_view text, InjectionField& field)
+{
+    const auto colon = text.find(':');
+    if (colon == std::string_view::npos || !parse_number(text.substr(0, colon), field.offset))
+        return false;
+    static constexpr std::pair<std::string_view, InjectionField::Type> types[] = {
+        { "f64", InjectionField::Type::F64 }, { "f32", InjectionField::Type::F32 }, { "i64", InjectionField::Type::I64 },
+        { "u64", InjectionField::Type::U64 }, { "i32", InjectionField::Type::I32 }, { "u32", InjectionField::Type::U32 }
+    };
+    for (const auto& [name, type] : types) {
+        if (text.substr(colon + 1) == name) {
+            field.type = type;
+            return true;
+        }
+    }
+    return false;
+}
+}
+
+EventInjector::EventInjector(cps_coro::Scheduler& sch)
+    : scheduler_(sch)
+{
+}
+
+EventInjector::~EventInjector()
+{
+    uninstall();
+}
+
+void EventInjector::set_key_field(cps_coro::EventId event, InjectionField field)
+{
+    key_fields_[event] = field;
+}
+
+std::size_t EventInjector::add(const InjectionRule& rule)
+{
+    rules_.push_back(rule);
+    hits_.push_back(0);
+    return rules_.size() - 1;
+}
+
+bool EventInjector::load(std::istream& in)
+{
+    std::string line;
+    for (std::size_t number = 1; std::getline(in, line); ++number) {
+        line.erase(std::min(line.find('#'), line.size()));
+        std::istringstream words(line);
+        std::string verb;
+        if (!(words >> verb))
+            continue;
+        InjectionRule rule;
+        bool is_key = false;
+        if (verb == "key")
+            is_key = true;
+        else if (verb == "drop")
+            rule.action = InjectionRule::Action::Drop;
+        else if (verb == "delay")
+            rule.action = InjectionRule::Action::Delay;
+        else if (verb == "replay")
+            rule.action = InjectionRule::Action::Replay;
+        else if (verb == "falsify")
+            rule.action = InjectionRule::Action::Falsify;
+        else {
+            error_ = "line " + std::to_string(number) + ": unknown action '" + verb + "'";
+            return false;
+        }
+        bool has_event = false;
+        auto set = [&](std::string_view name, std::string_view value) {
+            if (name == "event")
+                return has_event = parse_number(value, rule.event);
+            if (name == "key")
+                return value == "*" || parse_number(value, rule.key);
+            if (name == "from")
+                return parse_number(value, rule.from_ms);
+            if (name == "until")
+                return parse_number(value, rule.until_ms);
+            if (name == "delay")
+                return parse_number(value, rule.delay_ms);
+            if (name == "count")
+                return parse_number(value, rule.count);
+            if (name == "every")
+                return parse_number(value, rule.every_ms);
+            if (name == "field")
+                return parse_field(value, rule.field);
+            if (name == "scale")
+                return parse_number(value, rule.scale);
+            if (name == "bias")
+                return parse_number(value, rule.bias);
+            return false;
+        };
+        std::string word;
+        while (words >> word) {
+            const auto eq = word.find('=');
+            if (eq == std::string::npos || !set(std::string_view(word).substr(0, eq), std::string_view(word).substr(eq + 1))) {
+                error_ = "line " + std::to_string(number) + ": bad '" + word + "'";
+                return false;
+            }
+        }
+        if (!has_event) {
+            error_ = "line " + std::to_string(number) + ": no event";
+            return false;
+        }
+        if (is_key)
+            set_key_field(rule.event, rule.field);
+        else
+            add(rule);
+    }
+    return true;
+}
+
+void EventInjector::install()
+{
+    index_.clear();
+    for (std::uint32_t r = 0; r < rules_.size(); ++r) {
+        const InjectionRule& rule = rules_[r];
+        if (rule.from_ms >= rule.until_ms)
+            continue;
+        Index& index = index_[rule.event];
+        index.from_ms = std::min(index.from_ms, rule.from_ms);
+        index.until_ms = std::max(index.until_ms, rule.until_ms);
+        if (rule.key == InjectionRule::kAnyKey)
+            index.any_key.push_back(r);
+        else
+            index.keyed.emplace_back(rule.key, r);
+    }
+    std::vector<cps_coro::EventId> events;
+    for (auto& [event, index] : index_) {
+        std::sort(index.keyed.begin(), index.keyed.end());
+        auto key = key_fields_.find(event);
+        index.has_key_field = key != key_fields_.end();
+        if (index.has_key_field)
+            index.key_field = key->second;
+        events.push_back(event);
+    }
+    if (events.empty())
+        uninstall();
+    else
+        scheduler_.set_event_interceptor(this, events);
+}
+
+void EventInjector::uninstall()
+{
+    if (scheduler_.event_interceptor() == this)
+        scheduler_.set_event_interceptor(nullptr, {});
+}
+
+std::uint32_t EventInjector::match(const Index& index, std::int64_t now_ms, const void* data, std::size_t size) const
+{
+    auto in_window = [&](std::uint32_t r) { return now_ms >= rules_[r].from_ms && now_ms < rules_[r].until_ms; };
+    std::uint32_t best = kNone;
+    for (std::uint32_t r : index.any_key) {
+        if (in_window(r)) {
+            best = r;
+            break;
+        }
+    }
+    if (index.keyed.empty() || !index.has_key_field || !data || size < index.key_field.offset + index.key_field.width())
+        return best;
+    const std::uint64_t key = read_key(static_cast<const unsigned char*>(data), index.key_field);
+    auto it = std::lower_bound(index.keyed.begin(), index.keyed.end(), std::pair { key, std::uint32_t { 0 } });
+    for (; it != index.keyed.end() && it->first == key && it->second < best; ++it) {
+        if (in_window(it->second))
+            return it->second;
+    }
+    return best;
+}
+
+bool EventInjector::intercept(cps_coro::EventId event_id, const void* data, std::size_t size)
+{
+    auto it = index_.find(event_id);
+    if (it == index_.end())
+        return false; // Shares a bit of the scheduler's filter
+    const Index& index = it->second;
+    const std::int64_t now_ms = scheduler_.now().time_since_epoch().count();
+    if (now_ms < index.from_ms || now_ms >= index.until_ms)
+        return false;
+    ++stats_.examined;
+    const std::uint32_t r = match(index, now_ms, data, size);
+    if (r == kNone)
+        return false;
+    const InjectionRule& rule = rules_[r];
+    const bool copyable = !data || size > 0;
+    if (rule.action == InjectionRule::Action::Drop) {
+        ++hits_[r];
+        ++stats_.dropped;
+        return true;
+    }
+    if (!copyable || (rule.action == InjectionRule::Action::Falsify && size < rule.field.offset + rule.field.width())) {
+        ++stats_.unsupported;
+        return false;
+    }
+    ++hits_[r];
+    switch (rule.action) {
+    case InjectionRule::Action::Delay:
+        ++stats_.delayed;
+        hold(event_id, data, size, 1, rule.delay_ms, 0);
+        return true;
+    case InjectionRule::Action::Replay:
+        ++stats_.replayed;
+        if (rule.count > 0)
+            hold(event_id, data, size, rule.count, rule.every_ms, rule.every_ms);
+        return false; // The original goes through now
+    case InjectionRule::Action::Falsify: {
+        ++stats_.falsified;
+        // A copy per event: handlers may raise further falsified events.
+        std::vector<unsigned char> falsified(static_cast<const unsigned char*>(data), static_cast<const unsigned char*>(data) + size);
+        write_field(falsified.data(), rule.field, read_field(falsified.data(), rule.field) * rule.scale + rule.bias);
+        scheduler_.dispatch_event(event_id, falsified.data());
+        return true;
+    }
+    case InjectionRule::Action::Drop:
+        break;
+    }
+    return false;
+}
+
+void EventInjector::hold(cps_coro::EventId event, const void* data, std::size_t size, std::uint32_t copies, std::uint32_t first_ms, std::uint32_t every_ms)
+{
+    std::uint32_t slot = free_;
+    if (slot == kNone) {
+        slot = static_cast<std::uint32_t>(pending_.size());
+        pending_.emplace_back();
+    } else {
+        free_ = pending_[slot].next;
+    }
+    Pending& copy = pending_[slot];
+    copy.event = event;
+    copy.remaining = copies;
+    copy.every_ms = every_ms;
+    copy.has_data = data != nullptr;
+    const auto* bytes = static_cast<const unsigned char*>(data);
+    copy.data.assign(bytes, bytes + (data ? size : 0));
+    scheduler_.call_after(cps_coro::Scheduler::duration(first_ms), &EventInjector::on_timer, this, slot);
+}
+
+void EventInjector::on_timer(void* context, std::uint64_t tag)
+{
+    auto* injector = static_cast<EventInjector*>(context);
+    const auto slot = static_cast<std::uint32_t>(tag);
+    ++injector->stats_.copies;
+    // Handlers may hold further copies, which can grow pending_: deliver
+    // from a buffer the slot no longer owns.
+    Pending& copy = injector->pending_[slot];
+    const cps_coro::EventId event = copy.event;
+    const bool has_data = copy.has_data;
+    std::vector<unsigned char> data;
+    if (--copy.remaining > 0) {
+        data = copy.data;
+        injector->scheduler_.call_after(cps_coro::Scheduler::duration(copy.every_ms), &EventInjector::on_timer, injector, slot);
+    } else {
+        data.swap(copy.data);
+        injector->release_copy(slot);
+    }
+    injector->scheduler_.dispatch_event(event, has_data ? data.data() : nullptr);
+}
+
+void EventInjector::release_copy(std::uint32_t slot)
+{
+    pending_[slot].next = free_;
+    free_ = slot;
+}
@@ -0,0 +1,142 @@
+// event_injection.h
+// Cyber-attack and failure injection on the scheduler's event bus. Rules
+// name an event id, optionally a key read from the event's data (the entity
+// of a trip command, the meter of an alarm) and a simulated-time window, and
+// an action:
+//   drop     the event is never delivered
+//   delay    it is delivered `delay_ms` later
+//   replay   it is delivered now and again `count` times, `every_ms` apart
+//   falsify  one numeric field of its data is replaced by value * scale + bias
+//
+// Rules are compiled into an index before the run: the scheduler only hands
+// over events whose id has rules (a bit test for every other event), and per
+// id the injector checks the union of the rules' windows, then the rules for
+// any key in order and a binary search over the keyed ones. When several
+// rules match, the one added first applies. Delayed and replayed copies are
+// delivered straight to the handlers, so rules never match them again.
+//
+// Rules can also be read from text, one per line, '#' starting a comment:
+//   key     event=101 field=0:u64                  how to read event 101's key
+//   drop    event=101 key=42 from=55000 until=56000
+//   delay   event=100 delay=300
+//   replay  event=102 count=3 every=500
+//   falsify event=10000 field=0:f64 scale=1.1 bias=0
+// Fields are byte offset:type with type f64, f32, i64, u64, i32 or u32; from
+// is inclusive and until exclusive, both in simulated ms.
+//
+// Only event data that can be copied bytewise can be delayed, replayed or
+// falsified; other events pass unchanged. The injector must outlive the
+// scheduler run while copies are pending.
+#ifndef EVENT_INJECTION_H
+#define EVENT_INJECTION_H
+
+#include "cps_coro_lib.h"
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <limits>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+struct InjectionField {
+    enum class Type : std::uint8_t { F64, F32, I64, U64, I32, U32 };
+    std::uint32_t offset = 0; // Bytes into the event data
+    Type type = Type::F64;
+
+    std::size_t width() const { return type == Type::F32 || type == Type::I32 || type == Type::U32 ? 4 : 8; }
+};
+
+struct InjectionRule {
+    enum class Action : std::uint8_t { Drop, Delay, Replay, Falsify };
+    static constexpr std::uint64_t kAnyKey = std::numeric_limits<std::uint64_t>::max();
+
+    Action action = Action::Drop;
+    cps_coro::EventId event = 0;
+    std::uint64_t key = kAnyKey;
+    std::int64_t from_ms = 0;
+    std::int64_t until_ms = std::numeric_limits<std::int64_t>::max();
+    std::uint32_t delay_ms = 0; // Delay
+    std::uint32_t count = 1; // Replay: copies after the original
+    std::uint32_t every_ms = 0; // Replay: interval, the first copy included
+    InjectionField field; // Falsify
+    double scale = 1.0;
+    double bias = 0.0;
+};
+
+struct InjectionStats {
+    std::size_t examined = 0; // Raised inside a window of its id's rules
+    std::size_t dropped = 0;
+    std::size_t delayed = 0;
+    std::size_t replayed = 0; // Events replayed (copies are counted in `copies`)
+    std::size_t falsified = 0;
+    std::size_t copies = 0; // Delayed or replayed copies delivered
+    std::size_t unsupported = 0; // Matched, but the data cannot be copied
+};
+
+class EventInjector : public cps_coro::EventInterceptor {
+public:
+    explicit EventInjector(cps_coro::Scheduler& sch);
+    ~EventInjector() override;
+    EventInjector(const EventInjector&) = delete;
+    EventInjector& operator=(const EventInjector&) = delete;
+
+    // Where the key of `event` sits in its data. Without one, only rules for
+    // any key match the event.
+    void set_key_field(cps_coro::EventId event, InjectionField field);
+    std::size_t add(const InjectionRule& rule);
+    // Text rules as above; false with error() set at the first bad line.
+    bool load(std::istream& in);
+    const std::string& error() const { return error_; }
+
+    // Compiles the rules and installs the injector on the scheduler; call
+    // again after adding rules. uninstall() restores plain dispatch.
+    void install();
+    void uninstall();
+
+    bool intercept(cps_coro::EventId event_id, const void* data, std::size_t size) override;
+
+    std::size_t rule_count() const { return rules_.size(); }
+    std::size_t hits(std::size_t rule) const { return hits_[rule]; }
+    const InjectionStats& stats() const { return stats_; }
+
+private:
+    static constexpr std::uint32_t kNone = 0xFFFFFFFFu;
+
+    // Compiled rules of one event id.
+    struct Index {
+        std::int64_t from_ms = std::numeric_limits<std::int64_t>::max(); // Union of the windows
+        std::int64_t until_ms = std::numeric_limits<std::int64_t>::min();
+        bool has_key_field = false;
+        InjectionField key_field;
+        std::vector<std::uint32_t> any_key; // Rule indices, in order
+        std::vector<std::pair<std::uint64_t, std::uint32_t>> keyed; // (key, rule), sorted
+    };
+    // A copy waiting for its timer.
+    struct Pending {
+        std::uint32_t next = kNone; // Free list
+        cps_coro::EventId event = 0;
+        std::uint32_t remaining = 0;
+        std::uint32_t every_ms = 0;
+        bool has_data = false;
+        std::vector<unsigned char> data;
+    };
+
+    std::uint32_t match(const Index& index, std::int64_t now_ms, const void* data, std::size_t size) const;
+    void hold(cps_coro::EventId event, const void* data, std::size_t size, std::uint32_t copies, std::uint32_t first_ms, std::uint32_t every_ms);
+    static void on_timer(void* context, std::uint64_t tag);
+    void release_copy(std::uint32_t slot);
+
+    cps_coro::Scheduler& scheduler_;
+    std::vector<InjectionRule> rules_;
+    std::vector<std::size_t> hits_;
+    std::unordered_map<cps_coro::EventId, InjectionField> key_fields_;
+    std::unordered_map<cps_coro::EventId, Index> index_;
+    std::vector<Pending> pending_;
+    std::uint32_t free_ = kNone;
+    std::string error_;
+    InjectionStats stats_;
+};
+
+#endif // EVENT_INJECTION_H
@@ -0,0 +1,198 @@
+// fault_sweep.cpp
+#include "fault_sweep.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <thread>
+
+const char* fault_type_name(FaultType type)
+{
+    switch (type) {
+    case FaultType::ThreePhase:
+        return "3PH";
+    case FaultType::PhaseToPhase:
+        return "LL";
+    case FaultType::SinglePhaseToGround:
+        return "SLG";
+    }
+    return "?";
+}
+
+void FaultCaseTable::reserve(std::size_t cases)
+{
+    faulty_entity_id.reserve(cases);
+    current_kA.reserve(cases);
+    voltage_kV.reserve(cases);
+    impedance_Ohm.reserve(cases);
+    distance_km.reserve(cases);
+    fault_type.reserve(cases);
+    prefault_voltage_pu.reserve(cases);
+}
+
+void FaultCaseTable::add(const FaultInfo& fault, FaultType type, double prefault_pu)
+{
+    faulty_entity_id.push_back(fault.faulty_entity_id);
+    current_kA.push_back(fault.current_kA);
+    voltage_kV.push_back(fault.voltage_kV);
+    impedance_Ohm.push_back(fault.impedance_Ohm);
+    distance_km.push_back(fault.distance_km);
+    fault_type.push_back(type);
+    prefault_voltage_pu.push_back(prefault_pu);
+}
+
+FaultCaseSpan FaultCaseTable::span(std::size_t begin, std::size_t end) const
+{
+    return FaultCaseSpan { end - begin, current_kA.data() + begin, voltage_kV.data() + begin,
+        impedance_Ohm.data() + begin, distance_km.data() + begin, faulty_entity_id.data() + begin };
+}
+
+FaultCaseTable build_fault_cases(const std::vector<FaultSweepElement>& elements, const FaultSweepGrid& grid)
+{
+    FaultCaseTable table;
+    table.reserve(elements.size() * grid.locations_per_element * grid.fault_types.size() * grid.prefault_voltage_pu.size());
+    const double phase_to_phase_factor = std::sqrt(3.0) / 2.0;
+    for (const FaultSweepElement& element : elements) {
+        for (std::size_t location = 0; location < grid.locations_per_element; ++location) {
+            const double distance_km = element.length_km * (static_cast<double>(location) + 0.5) / static_cast<double>(grid.locations_per_element);
+            const double line_Ohm = element.ohm_per_km * distance_km;
+            for (FaultType type : grid.fault_types) {
+                for (double prefault_pu : grid.prefault_voltage_pu) {
+                    FaultInfo fault;
+                    fault.faulty_entity_id = element.entity;
+                    fault.voltage_kV = element.voltage_kV * prefault_pu;
+                    fault.distance_km = distance_km;
+                    switch (type) {
+                    case FaultType::ThreePhase:
+                        fault.current_kA = fault.voltage_kV / (element.source_impedance_Ohm + line_Ohm);
+                        fault.impedance_Ohm = line_Ohm;
+                        break;
+                    case FaultType::PhaseToPhase:
+                        fault.current_kA = phase_to_phase_factor * fault.voltage_kV / (element.source_impedance_Ohm + line_Ohm);
+                        fault.impedance_Ohm = line_Ohm;
+                        break;
+                    case FaultType::SinglePhaseToGround:
+                        fault.current_kA = fault.voltage_kV / (element.source_impedance_Ohm + line_Ohm + grid.ground_fault_resistance_Ohm);
+                        fault.impedance_Ohm = line_Ohm + grid.ground_fault_resistance_Ohm;
+                        break;
+                    }
+                    table.add(fault, type, prefault_pu);
+                }
+            }
+        }
+    }
+    return table;
+}
+
+void FaultSweepResults::resize(std::size_t cases)
+{
+    first_relay.resize(cases);
+    first_trip_ms.resize(cases);
+    first_margin.resize(cases);
+    backup_relay.resize(cases);
+    backup_trip_ms.resize(cases);
+}
+
+FaultSweepEngine::FaultSweepEngine(ProtectionRelayPools& relays, std::size_t threads, std::size_t block_cases)
+    : relays_(relays)
+    , threads_(threads > 0 ? threads : std::max(1u, std::thread::hardware_concurrency()))
+    , block_cases_(std::max<std::size_t>(1, block_cases))
+{
+    for (std::size_t r = 0; r < relays_.size(); ++r)
+        relay_entities_.push_back(relays_.entity(r));
+}
+
+FaultSweepResults FaultSweepEngine::run(const FaultCaseTable& cases) const
+{
+    FaultSweepResults results;
+    results.resize(cases.size());
+    const std::size_t blocks = (cases.size() + block_cases_ - 1) / block_cases_;
+    std::atomic<std::size_t> next_block { 0 };
+    auto worker = [&] {
+        std::vector<int> delay_scratch(relay_entities_.size() * block_cases_);
+        std::vector<double> margin_scratch(relay_entities_.size() * block_cases_);
+        for (std::size_t block = next_block++; block < blocks; block = next_block++) {
+            std::size_t begin = block * block_cases_;
+            run_block(cases, begin, std::min(cases.size(), begin + block_cases_), results, delay_scratch, margin_scratch);
+        }
+    };
+
+    const std::size_t thread_count = std::min(threads_, blocks);
+    if (thread_count <= 1) {
+        worker();
+        return results;
+    }
+    std::vector<std::thread> threads;
+    threads.reserve(thread_count - 1);
+    for (std::size_t t = 1; t < thread_count; ++t)
+        threads.emplace_back(worker);
+    worker();
+    for (auto& thread : threads)
+        thread.join();
+    return results;
+}
+
+void FaultSweepEngine::run_block(const FaultCaseTable& cases, std::size_t begin, std::size_t end, FaultSweepResults& results,
+    std::vector<int>& delay_scratch, std::vector<double>& margin_scratch) const
+{
+    const FaultCaseSpan span = cases.span(begin, end);
+    const std::size_t count = span.count;
+    std::int32_t* first_relay = results.first_relay.data() + begin;
+    int* first_trip_ms = results.first_trip_ms.data() + begin;
+    double* first_margin = results.first_margin.data() + begin;
+    std::int32_t* backup_relay = results.backup_relay.data() + begin;
+    int* backup_trip_ms = results.backup_trip_ms.data() + begin;
+
+    std::fill(first_relay, first_relay + count, -1);
+    std::fill(first_trip_ms, first_trip_ms + count, kNoTripDelayMs);
+    std::fill(first_margin, first_margin + count, 0.0);
+    for (std::size_t r = 0; r < relay_entities_.size(); ++r) {
+        int* delay = delay_scratch.data() + r * block_cases_;
+        double* margin = margin_scratch.data() + r * block_cases_;
+        relays_.evaluate_cases(r, span, delay, margin);
+        // Strictly faster wins, so ties go to the relay added first.
+        for (std::size_t i = 0; i < count; ++i) {
+            const bool faster = delay[i] < first_trip_ms[i];
+            first_trip_ms[i] = faster ? delay[i] : first_trip_ms[i];
+            first_margin[i] = faster ? margin[i] : first_margin[i];
+            first_relay[i] = faster ? static_cast<std::int32_t>(r) : first_relay[i];
+        }
+    }
+
+    // Backup: fastest relay protecting a different entity than the first.
+    std::fill(backup_relay, backup_relay + count, -1);
+    std::fill(backup_trip_ms, backup_trip_ms + count, kNoTripDelayMs);
+    for (std::size_t r = 0; r < relay_entities_.size(); ++r) {
+        const int* delay = delay_scratch.data() + r * block_cases_;
+        const Entity entity = relay_entities_[r];
+        for (std::size_t i = 0; i < count; ++i) {
+            const bool other_entity = first_relay[i] >= 0 && relay_entities_[first_relay[i]] != entity;
+            const bool faster = other_entity && delay[i] < backup_trip_ms[i];
+            backup_trip_ms[i] = faster ? delay[i] : backup_trip_ms[i];
+            backup_relay[i] = faster ? static_cast<std::int32_t>(r) : backup_relay[i];
+        }
+    }
+}
+
+FaultSweepSummary FaultSweepEngine::summarize(const FaultCaseTable& cases, const FaultSweepResults& results, int coordination_interval_ms) const
+{
+    FaultSweepSummary summary;
+    summary.cases = results.size();
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        if (results.first_relay[i] < 0) {
+            ++summary.not_cleared;
+            continue;
+        }
+        if (relay_entities_[results.first_relay[i]] != cases.faulty_entity_id[i])
+            ++summary.non_selective;
+        if (results.backup_relay[i] < 0)
+            continue;
+        const int margin_ms = results.backup_trip_ms[i] - results.first_trip_ms[i];
+        if (margin_ms < coordination_interval_ms)
+            ++summary.below_interval;
+        if (margin_ms < summary.min_grading_margin_ms) {
+            summary.min_grading_margin_ms = margin_ms;
+            summary.min_grading_case = i;
+        }
+    }
+    return summary;
+}
@@ -0,0 +1,435 @@
+// flisr.cpp
+#include "flisr.h"
+#include "logging_utils.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <unordered_map>
+
+FeederSwitchComponent::FeederSwitchComponent(Kind switch_kind, double pickup_kA, double limit_kW)
+    : kind(switch_kind)
+    , fault_pickup_kA(pickup_kA)
+    , transfer_limit_kW(limit_kW)
+{
+}
+
+TerminalUnitComponent::TerminalUnitComponent(Kind unit_kind, std::vector<Entity> unit_switches, int operate)
+    : kind(unit_kind)
+    , switches(std::move(unit_switches))
+    , operate_ms(operate)
+{
+}
+
+FlisrEngine::FlisrEngine(Registry& reg, NetworkModel& network, cps_coro::Scheduler& sch)
+    : registry_(reg)
+    , network_(network)
+    , scheduler_(sch)
+{
+}
+
+bool FlisrEngine::build()
+{
+    sections_.clear();
+    switches_.clear();
+    units_.clear();
+    groups_.clear();
+    free_groups_.clear();
+    faults_.clear();
+    indicated_.clear();
+
+    // Only switches a terminal unit operates split sections.
+    std::unordered_map<Entity, Entity> unit_of_switch;
+    registry_.for_each<TerminalUnitComponent>([&](TerminalUnitComponent& unit, Entity e) {
+        units_.push_back(e);
+        for (Entity sw : unit.switches)
+            unit_of_switch[sw] = e;
+    });
+    std::sort(units_.begin(), units_.end());
+
+    const std::size_t bus_count = network_.bus_count();
+    std::vector<int> parent(bus_count);
+    std::iota(parent.begin(), parent.end(), 0);
+    auto root = [&](int b) {
+        while (parent[b] != b)
+            b = parent[b] = parent[parent[b]];
+        return b;
+    };
+    std::vector<char> is_switch(network_.branch_count(), 0);
+    for (std::size_t k = 0; k < network_.branch_count(); ++k) {
+        const Entity branch = network_.branch_entity(k);
+        if (unit_of_switch.count(branch) && registry_.get<FeederSwitchComponent>(branch))
+            is_switch[k] = 1;
+        else
+            parent[root(network_.branch_from(k))] = root(network_.branch_to(k));
+    }
+
+    section_of_bus_.assign(bus_count, -1);
+    std::vector<int> section_of_root(bus_count, -1);
+    for (std::size_t b = 0; b < bus_count; ++b) {
+        int& section = section_of_root[root(static_cast<int>(b))];
+        if (section < 0) {
+            section = static_cast<int>(sections_.size());
+            sections_.emplace_back();
+        }
+        section_of_bus_[b] = section;
+        sections_[section].buses.push_back(static_cast<int>(b));
+    }
+    section_of_branch_.assign(network_.branch_count(), -1);
+    for (std::size_t k = 0; k < network_.branch_count(); ++k) {
+        const int a = section_of_bus_[network_.branch_from(k)];
+        if (!is_switch[k]) {
+            section_of_branch_[k] = a;
+            continue;
+        }
+        const Entity branch = network_.branch_entity(k);
+        const int b = section_of_bus_[network_.branch_to(k)];
+        const int sw = static_cast<int>(switches_.size());
+        switches_.push_back({ branch, unit_of_switch[branch], registry_.get<FeederSwitchComponent>(branch), a, b });
+        sections_[a].switches.push_back(sw);
+        if (b != a)
+            sections_[b].switches.push_back(sw);
+    }
+    registry_.for_each<SourceComponent>([&](SourceComponent& source, Entity) {
+        const int bus = network_.bus_index(source.bus);
+        if (bus >= 0)
+            sections_[section_of_bus_[bus]].source = true;
+    });
+    registry_.for_each<LoadComponent>([&](LoadComponent& load, Entity) {
+        const int bus = network_.bus_index(load.bus);
+        if (bus >= 0)
+            sections_[section_of_bus_[bus]].load_kW += load.p_kW;
+    });
+    return !switches_.empty();
+}
+
+bool FlisrEngine::closed(int sw) const
+{
+    return network_.branch_closed(switches_[sw].branch);
+}
+
+bool FlisrEngine::live(int section) const
+{
+    return network_.bus_energized(network_.bus_entity(sections_[section].buses.front()));
+}
+
+int FlisrEngine::section_of(Entity element) const
+{
+    const int bus = network_.bus_index(element);
+    if (bus >= 0)
+        return section_of_bus_[bus];
+    const int branch = network_.branch_index(element);
+    if (branch < 0)
+        return -1;
+    return section_of_branch_[branch] >= 0 ? section_of_branch_[branch] : section_of_bus_[network_.branch_from(branch)];
+}
+
+std::size_t FlisrEngine::live_section_count() const
+{
+    std::size_t count = 0;
+    for (std::size_t s = 0; s < sections_.size(); ++s)
+        count += live(static_cast<int>(s));
+    return count;
+}
+
+std::size_t FlisrEngine::faulted_section_count() const
+{
+    return static_cast<std::size_t>(std::count_if(sections_.begin(), sections_.end(), [](const Section& s) { return s.isolated; }));
+}
+
+double FlisrEngine::unserved_kW() const
+{
+    double total = 0.0;
+    for (std::size_t s = 0; s < sections_.size(); ++s)
+        if (!sections_[s].isolated && !live(static_cast<int>(s)))
+            total += sections_[s].load_kW;
+    return total;
+}
+
+void FlisrEngine::apply_fault(const FaultInfo& fault)
+{
+    const int section = section_of(fault.faulty_entity_id);
+    if (section < 0 || sections_[section].isolated)
+        return;
+    faults_.push_back({ fault, section });
+    if (!network_.fault_at(fault) || std::abs(network_.last_fault().fault_current_kA) < kMinMeasurableCurrent_kA) {
+        ++stats_.faults_unseen; // No supply: nothing flows until it is restored
+        return;
+    }
+    // Fault current passes the switches between the sources and the fault.
+    const NetworkFaultResult& result = network_.last_fault();
+    for (std::size_t sw = 0; sw < switches_.size(); ++sw) {
+        Switch& s = switches_[sw];
+        if (std::abs(result.branch_current_kA[network_.branch_index(s.branch)]) < s.component->fault_pickup_kA)
+            continue;
+        if (!s.component->fault_indicated) {
+            s.component->fault_indicated = true;
+            indicated_.push_back(static_cast<int>(sw));
+        }
+        if (s.component->kind == FeederSwitchComponent::Kind::Breaker && !s.trip_pending) {
+            auto trip = trip_later(static_cast<int>(sw));
+            trip.detach();
+        }
+    }
+    if (waiting_for_reports_ && !indicated_.empty()) {
+        waiting_for_reports_ = false;
+        scheduler_.trigger_event(FLISR_REPORT_EVENT);
+    }
+}
+
+std::vector<int> FlisrEngine::locate()
+{
+    // Depth of each section from the sources over indicating switches; a
+    // faulted section has no indicating switch leading deeper.
+    std::vector<int> depth(sections_.size(), -1);
+    std::vector<int> queue;
+    for (int sw : indicated_) {
+        for (int s : { switches_[sw].a, switches_[sw].b }) {
+            if (sections_[s].source && depth[s] < 0) {
+                depth[s] = 0;
+                queue.push_back(s);
+            }
+        }
+    }
+    for (std::size_t head = 0; head < queue.size(); ++head) {
+        const int s = queue[head];
+        for (int sw : sections_[s].switches) {
+            const int other = switches_[sw].a == s ? switches_[sw].b : switches_[sw].a;
+            if (switches_[sw].component->fault_indicated && depth[other] < 0) {
+                depth[other] = depth[s] + 1;
+                queue.push_back(other);
+            }
+        }
+    }
+    std::vector<int> faulted;
+    for (int s : queue) {
+        if (sections_[s].source)
+            continue;
+        bool leaves = false;
+        for (int sw : sections_[s].switches) {
+            const int other = switches_[sw].a == s ? switches_[sw].b : switches_[sw].a;
+            leaves |= switches_[sw].component->fault_indicated && depth[other] > depth[s];
+        }
+        if (!leaves)
+            faulted.push_back(s);
+    }
+    return faulted;
+}
+
+int FlisrEngine::group_of(int section)
+{
+    const int cached = sections_[section].group;
+    if (cached >= 0 && groups_[cached].valid) {
+        ++stats_.group_cache_hits;
+        return cached;
+    }
+    ++stats_.group_searches;
+    int g;
+    if (free_groups_.empty()) {
+        g = static_cast<int>(groups_.size());
+        groups_.emplace_back();
+    } else {
+        g = free_groups_.back();
+        free_groups_.pop_back();
+    }
+    // Breadth-first over closed switches; open switches end the search and
+    // become the group's restoration candidates.
+    Group& group = groups_[g];
+    group.sections.assign(1, section);
+    group.boundary.clear();
+    group.load_kW = 0.0;
+    group.valid = true;
+    sections_[section].group = g;
+    for (std::size_t head = 0; head < group.sections.size(); ++head) {
+        const int s = group.sections[head];
+        group.load_kW += sections_[s].load_kW;
+        for (int sw : sections_[s].switches) {
+            const int other = switches_[sw].a == s ? switches_[sw].b : switches_[sw].a;
+            if (!closed(sw)) {
+                group.boundary.push_back(sw);
+            } else if (sections_[other].group != g) {
+                sections_[other].group = g;
+                group.sections.push_back(other);
+            }
+        }
+    }
+    return g;
+}
+
+void FlisrEngine::invalidate(int sw)
+{
+    for (int s : { switches_[sw].a, switches_[sw].b }) {
+        const int g = sections_[s].group;
+        if (g < 0 || !groups_[g].valid)
+            continue;
+        for (int member : groups_[g].sections)
+            sections_[member].group = -1;
+        groups_[g].valid = false;
+        free_groups_.push_back(g);
+    }
+}
+
+void FlisrEngine::operate(int sw, bool close)
+{
+    auto* unit = registry_.get<TerminalUnitComponent>(switches_[sw].unit);
+    const std::int64_t now_ms = scheduler_.now().time_since_epoch().count();
+    std::int64_t done_ms = now_ms + unit->operate_ms;
+    if (unit->kind == TerminalUnitComponent::Kind::DTU) {
+        done_ms = std::max(now_ms, unit->busy_until_ms) + unit->operate_ms;
+        unit->busy_until_ms = done_ms;
+    }
+    ++in_flight_;
+    auto task = switch_later(sw, close, done_ms - now_ms);
+    task.detach();
+}
+
+void FlisrEngine::switched(int sw, bool close)
+{
+    if (closed(sw) == close)
+        return;
+    network_.set_branch_closed(switches_[sw].branch, close);
+    invalidate(sw);
+    if (!close)
+        return;
+    // Supply restored onto faults that were not seen makes them draw current.
+    std::vector<FaultInfo> struck;
+    const auto unseen = std::remove_if(faults_.begin(), faults_.end(), [&](const ActiveFault& f) {
+        if (!live(f.section))
+            return false;
+        struck.push_back(f.info);
+        return true;
+    });
+    faults_.erase(unseen, faults_.end());
+    for (const FaultInfo& info : struck)
+        apply_fault(info);
+}
+
+cps_coro::Task FlisrEngine::switch_later(int sw, bool close, std::int64_t delay_ms)
+{
+    co_await cps_coro::delay(cps_coro::Scheduler::duration(delay_ms));
+    switched(sw, close);
+    ++registry_.get<TerminalUnitComponent>(switches_[sw].unit)->operations;
+    ++(close ? stats_.switches_closed : stats_.switches_opened);
+    if (--in_flight_ == 0 && waiting_for_switching_) {
+        waiting_for_switching_ = false;
+        scheduler_.trigger_event(FLISR_SWITCHING_DONE_EVENT);
+    }
+}
+
+cps_coro::Task FlisrEngine::trip_later(int sw)
+{
+    switches_[sw].trip_pending = true;
+    co_await cps_coro::delay(cps_coro::Scheduler::duration(breaker_trip_ms));
+    switches_[sw].trip_pending = false;
+    if (closed(sw)) {
+        switched(sw, false);
+        ++stats_.breaker_trips;
+    }
+}
+
+cps_coro::Task FlisrEngine::run()
+{
+    HECS_LOG_INFO(LogSubsystem::Protection, "[{}ms] [FLISR-Master] Active: {} sections, {} switches, {} terminal units.",
+        scheduler_.now().time_since_epoch().count(), sections_.size(), switches_.size(), units_.size());
+    while (true) {
+        if (indicated_.empty()) {
+            waiting_for_reports_ = true;
+            co_await cps_coro::wait_for_event(FLISR_REPORT_EVENT);
+        }
+        // The rest of a storm's burst, and the breaker trips, arrive meanwhile.
+        co_await cps_coro::delay(cps_coro::Scheduler::duration(collection_window_ms));
+        const std::size_t batch = ++stats_.batches;
+        const FlisrStats before = stats_;
+        std::chrono::duration<double, std::milli> compute_time {};
+        auto compute_start = std::chrono::steady_clock::now();
+
+        std::vector<char> dead_at_start(sections_.size(), 0);
+        for (std::size_t s = 0; s < sections_.size(); ++s)
+            dead_at_start[s] = !sections_[s].isolated && !live(static_cast<int>(s));
+
+        // Location and isolation.
+        const std::size_t indications = indicated_.size();
+        const std::vector<int> faulted = locate();
+        for (int sw : indicated_)
+            switches_[sw].component->fault_indicated = false; // Remote reset
+        indicated_.clear();
+        for (int s : faulted) {
+            sections_[s].isolated = true;
+            for (int sw : sections_[s].switches)
+                if (closed(sw))
+                    operate(sw, false);
+        }
+        const auto cleared = std::remove_if(faults_.begin(), faults_.end(), [&](const ActiveFault& f) { return sections_[f.section].isolated; });
+        stats_.faults_located += static_cast<std::size_t>(faults_.end() - cleared);
+        faults_.erase(cleared, faults_.end());
+        compute_time += std::chrono::steady_clock::now() - compute_start;
+        HECS_LOG_INFO(LogSubsystem::Protection, "[{}ms] [FLISR-Master] Batch {}: {} indications locate {} faulted sections; isolating with {} switching commands.",
+            scheduler_.now().time_since_epoch().count(), batch, indications, faulted.size(), in_flight_);
+        if (in_flight_ > 0) {
+            waiting_for_switching_ = true;
+            co_await cps_coro::wait_for_event(FLISR_SWITCHING_DONE_EVENT);
+        }
+
+        // Restoration rounds: one switch per dead group, until no group can
+        // be picked up or new fault reports call for another batch.
+        int rounds = 0;
+        while (indicated_.empty()) {
+            compute_start = std::chrono::steady_clock::now();
+            std::vector<char> handled(groups_.size(), 0);
+            for (std::size_t s = 0; s < sections_.size(); ++s) {
+                const int section = static_cast<int>(s);
+                if (sections_[s].isolated || live(section))
+                    continue;
+                const int cached = sections_[s].group;
+                if (cached >= 0 && groups_[cached].valid && handled[cached])
+                    continue;
+                const int g = group_of(section);
+                handled.resize(groups_.size(), 0);
+                handled[g] = 1;
+                const Group& group = groups_[g];
+                int best = -1;
+                auto rank = [&](int sw) {
+                    // Own feeder breaker first, then the roomiest tie.
+                    const auto& c = *switches_[sw].component;
+                    if (c.kind == FeederSwitchComponent::Kind::Breaker)
+                        return std::numeric_limits<double>::infinity();
+                    return c.transfer_limit_kW > 0.0 ? c.transfer_limit_kW - group.load_kW : std::numeric_limits<double>::max();
+                };
+                for (int sw : group.boundary) {
+                    const int other = sections_[switches_[sw].a].group == g ? switches_[sw].b : switches_[sw].a;
+                    const auto& c = *switches_[sw].component;
+                    if (sections_[other].isolated || !live(other) || switches_[sw].trip_pending)
+                        continue;
+                    if (c.transfer_limit_kW > 0.0 && group.load_kW > c.transfer_limit_kW)
+                        continue;
+                    if (best < 0 || rank(sw) > rank(best))
+                        best = sw;
+                }
+                if (best >= 0)
+                    operate(best, true);
+            }
+            compute_time += std::chrono::steady_clock::now() - compute_start;
+            if (in_flight_ == 0)
+                break;
+            ++rounds;
+            waiting_for_switching_ = true;
+            co_await cps_coro::wait_for_event(FLISR_SWITCHING_DONE_EVENT);
+        }
+
+        std::size_t restored = 0;
+        double restored_kW = 0.0;
+        for (std::size_t s = 0; s < sections_.size(); ++s) {
+            if (dead_at_start[s] && live(static_cast<int>(s))) {
+                ++restored;
+                restored_kW += sections_[s].load_kW;
+            }
+        }
+        stats_.sections_restored += restored;
+        stats_.restored_kW += restored_kW;
+        HECS_LOG_INFO(LogSubsystem::Protection, "[{}ms] [FLISR-Master] Batch {}: {} sections ({:.0f} kW) restored in {} rounds ({} opened, {} closed); {:.0f} kW unserved, {} faults awaiting supply; {} group searches, {} cached; {:.2f} ms computing.",
+            scheduler_.now().time_since_epoch().count(), batch, restored, restored_kW, rounds,
+            stats_.switches_opened - before.switches_opened, stats_.switches_closed - before.switches_closed, unserved_kW(), faults_.size(),
+            stats_.group_searches - before.group_searches, stats_.group_cache_hits - before.group_cache_hits, compute_time.count());
+    }
+}
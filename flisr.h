@@ -0,0 +1,166 @@
+// flisr.h
+// Feeder automation: fault location, isolation and service restoration
+// (FLISR) on a distribution network model.
+//
+// Switchable branches carry a FeederSwitchComponent: a feeder breaker, a
+// sectionalizer or a normally-open tie to another feeder. Each switch has a
+// fault passage indicator and is operated by a terminal unit, an FTU for a
+// single pole-mounted switch or a DTU for a switching station whose commands
+// run one after another. The branches without a switch join buses into
+// sections, the smallest parts the network can be split into.
+//
+// A fault on the network drives fault current through the switches between
+// the sources and the fault: their indicators pick up and the breakers
+// among them trip. The master station (run()) collects the reports over a
+// short window, so a storm's burst of faults is handled as one batch:
+//   - location: a faulted section is one that fault current enters through
+//     an indicating switch without leaving it through another;
+//   - isolation: every closed switch around a faulted section opens;
+//   - restoration, in rounds: each dead group of sections (joined by closed
+//     switches) is picked up through one open switch to a live section,
+//     preferring its own feeder breaker and respecting tie transfer limits.
+// Groups come from a pruned breadth-first search that stops at open
+// switches and is memoized: a cached group is only searched again when one
+// of its switches has operated, so later rounds and later batches reuse the
+// searches of the parts of the network that did not change.
+//
+// A fault in a section without supply draws no current and is not seen;
+// restoring supply onto it trips the feeding breaker again, and the next
+// batch locates it. Switching is applied to the NetworkModel directly (the
+// model is separate from the protection demo's, so no BREAKER_OPENED_EVENT
+// is raised).
+#ifndef FLISR_H
+#define FLISR_H
+
+#include "cps_coro_lib.h"
+#include "ecs_core.h"
+#include "network_model.h"
+#include "simulation_events_and_data.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct FeederSwitchComponent : public IComponent {
+    enum class Kind {
+        Breaker, // Feeder head: interrupts fault current
+        Sectionalizer,
+        Tie // Normally open
+    };
+    Kind kind;
+    double fault_pickup_kA; // Fault passage indicator threshold
+    double transfer_limit_kW; // Ties: most load it may pick up; 0 for no limit
+    bool fault_indicated = false;
+    FeederSwitchComponent(Kind switch_kind, double pickup_kA = 0.4, double limit_kW = 0.0);
+};
+
+struct TerminalUnitComponent : public IComponent {
+    enum class Kind {
+        FTU,
+        DTU
+    };
+    Kind kind;
+    std::vector<Entity> switches; // Branch entities
+    int operate_ms; // Per command, including communication
+    std::int64_t busy_until_ms = 0; // DTU command queue
+    std::size_t operations = 0;
+    TerminalUnitComponent(Kind unit_kind, std::vector<Entity> unit_switches, int operate = 300);
+};
+
+struct FlisrStats {
+    std::size_t batches = 0;
+    std::size_t faults_located = 0;
+    std::size_t faults_unseen = 0; // In unsupplied sections when they occurred
+    std::size_t switches_opened = 0;
+    std::size_t switches_closed = 0;
+    std::size_t breaker_trips = 0;
+    std::size_t sections_restored = 0;
+    double restored_kW = 0.0;
+    std::size_t group_searches = 0;
+    std::size_t group_cache_hits = 0;
+};
+
+class FlisrEngine {
+public:
+    FlisrEngine(Registry& reg, NetworkModel& network, cps_coro::Scheduler& sch);
+
+    // Reads the switches and terminal units and forms the sections; the
+    // network model must be built. False when there are no switches.
+    bool build();
+
+    // A fault on a bus or branch of the model occurs now. It stays until
+    // its section is isolated.
+    void apply_fault(const FaultInfo& fault);
+    // Master station.
+    cps_coro::Task run();
+
+    int collection_window_ms = 300; // From the first report of a batch
+    int breaker_trip_ms = 100;
+
+    std::size_t section_count() const { return sections_.size(); }
+    std::size_t switch_count() const { return switches_.size(); }
+    std::size_t unit_count() const { return units_.size(); }
+    std::size_t live_section_count() const;
+    std::size_t faulted_section_count() const;
+    double unserved_kW() const; // Dead, healthy sections
+    const FlisrStats& stats() const { return stats_; }
+
+private:
+    struct Section {
+        std::vector<int> buses; // Network bus indices
+        std::vector<int> switches;
+        double load_kW = 0.0;
+        bool source = false;
+        bool isolated = false; // Faulted and cut off
+        int group = -1; // Cached restoration group; -1 when not searched
+    };
+    struct Switch {
+        Entity branch;
+        Entity unit = 0;
+        FeederSwitchComponent* component;
+        int a, b; // Sections
+        bool trip_pending = false;
+    };
+    struct Group {
+        std::vector<int> sections;
+        std::vector<int> boundary; // Open switches leaving the group
+        double load_kW = 0.0;
+        bool valid = false;
+    };
+    struct ActiveFault {
+        FaultInfo info;
+        int section;
+    };
+
+    bool closed(int sw) const;
+    bool live(int section) const;
+    int section_of(Entity element) const;
+    // Group of a dead, healthy section, from the cache or a new search.
+    int group_of(int section);
+    void invalidate(int sw);
+    // Sections the pending indications show faulted.
+    std::vector<int> locate();
+    void operate(int sw, bool close);
+    void switched(int sw, bool close);
+    void wake(cps_coro::EventId event);
+    cps_coro::Task switch_later(int sw, bool close, std::int64_t delay_ms);
+    cps_coro::Task trip_later(int sw);
+
+    Registry& registry_;
+    NetworkModel& network_;
+    cps_coro::Scheduler& scheduler_;
+    std::vector<Section> sections_;
+    std::vector<Switch> switches_;
+    std::vector<Entity> units_;
+    std::vector<int> section_of_bus_;
+    std::vector<int> section_of_branch_; // Lines inside a section, by branch index; -1 for switches
+    std::vector<Group> groups_;
+    std::vector<int> free_groups_;
+    std::vector<ActiveFault> faults_;
+    std::vector<int> indicated_; // Switches reported since the last batch
+    std::size_t in_flight_ = 0;
+    bool waiting_for_reports_ = false;
+    bool waiting_for_switching_ = false;
+    FlisrStats stats_;
+};
+
+#endif // FLISR_H
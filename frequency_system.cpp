@@ -1,9 +1,10 @@
 // frequency_system.cpp
 #include "frequency_system.h"
-#include "logging_utils.h" // For g_console_logger, g_data_file_logger
+#include "logging_utils.h" // For g_console_logger
 #include <chrono>
 #include <cmath> // For std::abs
 #include <iomanip> // For std::fixed, std::setprecision if still used by spdlog format indirectly
+#include <limits>
 
 // Global scheduler pointer - tasks might need access if not passed explicitly
 // This should be defined in main.cpp and accessed carefully.
@@ -31,6 +32,21 @@ FrequencyControlConfigComponent::FrequencyControlConfigComponent(
 {
 }
 
+VppStationComponent::VppStationComponent(std::vector<Entity> member_entities)
+    : members(std::move(member_entities))
+{
+}
+
+VppAggregateComponent::VppAggregateComponent(std::vector<Entity> station_entities)
+    : stations(std::move(station_entities))
+{
+}
+
+VppDeviceAggregateComponent::VppDeviceAggregateComponent(std::vector<Entity> device_entities)
+    : devices(std::move(device_entities))
+{
+}
+
 const double P_f_coeff_fs = 0.0862;
 const double M_f_coeff_fs = 0.1404;
 const double M1_f_coeff_fs = 0.1577;
@@ -46,73 +62,533 @@ double calculate_frequency_deviation(double t_relative)
     return f_dev;
 }
 
-cps_coro::Task frequencyOracleTask(Registry& registry,
-    const std::vector<Entity>& ev_entities,
-    const std::vector<Entity>& ess_entities,
+double compute_device_response_kW(const FrequencyControlConfigComponent& config, double soc, double freq_dev_hz)
+{
+    double new_calculated_power_kW = config.base_power_kW;
+    double current_abs_actual_freq_dev = std::abs(freq_dev_hz);
+
+    if (current_abs_actual_freq_dev > config.deadband_Hz) {
+        if (freq_dev_hz < 0) { // Frequency DROPPED
+            double effective_df_drop = freq_dev_hz + config.deadband_Hz;
+            if (config.type == FrequencyControlConfigComponent::DeviceType::EV_PILE) {
+                if (soc >= config.soc_min_threshold) {
+                    new_calculated_power_kW = -config.gain_kW_per_Hz * effective_df_drop;
+                } else if (config.base_power_kW < 0) {
+                    new_calculated_power_kW = 0.0;
+                } // else stays base_power_kW
+            } else if (config.type == FrequencyControlConfigComponent::DeviceType::ESS_UNIT) {
+                new_calculated_power_kW = -config.gain_kW_per_Hz * effective_df_drop;
+            }
+        } else { // Frequency RISEN
+            double effective_df_rise = freq_dev_hz - config.deadband_Hz;
+            double power_change_due_to_freq = -config.gain_kW_per_Hz * effective_df_rise;
+            new_calculated_power_kW = config.base_power_kW + power_change_due_to_freq;
+        }
+    } // else: new_calculated_power_kW remains config.base_power_kW
+
+    new_calculated_power_kW = std::max(config.min_output_kW, std::min(config.max_output_kW, new_calculated_power_kW));
+
+    if (config.type == FrequencyControlConfigComponent::DeviceType::EV_PILE) {
+        if (new_calculated_power_kW < 0 && soc >= config.soc_max_threshold)
+            new_calculated_power_kW = 0.0;
+        if (new_calculated_power_kW > 0 && soc <= config.soc_min_threshold)
+            new_calculated_power_kW = 0.0;
+    }
+    return new_calculated_power_kW;
+}
+
+DroopCurve make_device_droop_curve(const FrequencyControlConfigComponent& config, double soc)
+{
+    using Piece = DroopCurve::Piece;
+    const bool is_ev = config.type == FrequencyControlConfigComponent::DeviceType::EV_PILE;
+    const double db = config.deadband_Hz;
+    const double base = config.base_power_kW;
+
+    // Same arithmetic as compute_device_response_kW, written as anchored pieces.
+    Piece drop { -config.gain_kW_per_Hz, -db, 0.0 };
+    if (is_ev && soc < config.soc_min_threshold)
+        drop = Piece { 0.0, 0.0, base < 0 ? 0.0 : base };
+    Piece flat { 0.0, 0.0, base };
+    Piece rise { -config.gain_kW_per_Hz, db, base };
+
+    DroopCurve curve = (db > 0.0)
+        ? DroopCurve::from_pieces({ -db, db }, { base, base }, { drop, flat, rise })
+        : DroopCurve::from_pieces({ 0.0 }, { base }, { drop, rise });
+
+    curve.clamp(config.min_output_kW, config.max_output_kW);
+    if (is_ev) {
+        const double inf = std::numeric_limits<double>::infinity();
+        if (soc >= config.soc_max_threshold)
+            curve.clamp(0.0, inf);
+        if (soc <= config.soc_min_threshold)
+            curve.clamp(-inf, 0.0);
+    }
+    return curve;
+}
+
+double device_energy_capacity_kWh(FrequencyControlConfigComponent::DeviceType type)
+{
+    switch (type) {
+    case FrequencyControlConfigComponent::DeviceType::EV_PILE:
+        return 50.0; // Typical EV battery
+    case FrequencyControlConfigComponent::DeviceType::ESS_UNIT:
+        return 2000.0; // Typical ESS unit
+    }
+    return 0.0;
+}
+
+void integrate_device_soc(const FrequencyControlConfigComponent& config, PhysicalStateComponent& state, double dt_s)
+{
+    double energy_change_kWh = state.current_power_kW * (dt_s / 3600.0);
+    double capacity_kWh = device_energy_capacity_kWh(config.type);
+    if (capacity_kWh > 0)
+        state.soc -= (energy_change_kWh / capacity_kWh);
+    state.soc = std::max(0.0, std::min(1.0, state.soc));
+}
+
+std::vector<ColumnSpec> frequency_result_schema()
+{
+    return {
+        { "SimTime_ms", ColumnType::Int64 },
+        { "SimTime_s", ColumnType::Float64 },
+        { "RelativeTime_s", ColumnType::Float64 },
+        { "FreqDeviation_Hz", ColumnType::Float64 },
+        { "TotalVppPower_kW", ColumnType::Float64 },
+        { "AgcPower_kW", ColumnType::Float64 },
+    };
+}
+
+FrequencyInfo frequency_oracle_step(Registry& registry,
+    const std::vector<Entity>& vpp_entities,
     double disturbance_start_time_s,
-    double simulation_step_ms)
+    double agc_power_kW,
+    ColumnarRecorder* recorder)
 {
-    if (g_console_logger)
-        g_console_logger->info("[{:.1f}ms] [FreqOracle] Active. Disturbance at {}s. Step: {}ms.",
-            (g_scheduler ? g_scheduler->now().time_since_epoch().count() / 1.0 : 0.0),
-            disturbance_start_time_s, simulation_step_ms);
+    double current_sim_time_ms = (g_scheduler ? g_scheduler->now().time_since_epoch().count() : 0.0);
+    double current_sim_time_s = current_sim_time_ms / 1000.0;
+    double relative_time_s = current_sim_time_s - disturbance_start_time_s;
+    double freq_dev_hz = calculate_frequency_deviation(relative_time_s);
+
+    FrequencyInfo freq_info;
+    freq_info.current_sim_time_seconds = current_sim_time_s;
+    freq_info.freq_deviation_hz = freq_dev_hz;
+
+    if (g_scheduler) {
+        g_scheduler->trigger_event(FREQUENCY_UPDATE_EVENT, freq_info);
+    }
+
+    double total_vpp_power_kw = 0;
+    for (Entity vpp_entity : vpp_entities) {
+        total_vpp_power_kw += vpp_total_power_kW(registry, vpp_entity);
+    }
 
-    if (g_data_file_logger) {
-        g_data_file_logger->info("# SimTime_ms\tSimTime_s\tRelativeTime_s\tFreqDeviation_Hz\tTotalVppPower_kW");
+    if (recorder) {
+        recorder->set_int(FREQ_COL_SIM_TIME_MS, static_cast<std::int64_t>(current_sim_time_ms));
+        recorder->set(FREQ_COL_SIM_TIME_S, current_sim_time_s);
+        recorder->set(FREQ_COL_RELATIVE_TIME_S, relative_time_s);
+        recorder->set(FREQ_COL_FREQ_DEVIATION_HZ, freq_dev_hz);
+        recorder->set(FREQ_COL_TOTAL_VPP_POWER_KW, total_vpp_power_kw);
+        recorder->set(FREQ_COL_AGC_POWER_KW, agc_power_kW);
+        recorder->commit_row();
     }
+    return freq_info;
+}
+
+VppDeviceStateRecorder::VppDeviceStateRecorder(Registry& registry, const std::vector<Entity>& vpp_entities)
+    : registry_(registry)
+{
+    auto add_device = [&](Entity device, const VppStationComponent* station) {
+        auto config = registry.get<FrequencyControlConfigComponent>(device);
+        auto state = registry.get<PhysicalStateComponent>(device);
+        if (config && state)
+            devices_.push_back({ device, config, state, station });
+    };
+    for (Entity vpp_entity : vpp_entities) {
+        if (auto flat = registry.get<VppDeviceAggregateComponent>(vpp_entity)) {
+            flat_vpps_.push_back(flat);
+            for (Entity device : flat->devices)
+                add_device(device, nullptr);
+        } else if (auto hierarchical = registry.get<VppAggregateComponent>(vpp_entity)) {
+            for (Entity station_entity : hierarchical->stations) {
+                if (auto station = registry.get<VppStationComponent>(station_entity)) {
+                    for (Entity device : station->members)
+                        add_device(device, station);
+                }
+            }
+        }
+    }
+    power_kW_.resize(devices_.size());
+    soc_.resize(devices_.size());
+}
+
+std::vector<ColumnSpec> VppDeviceStateRecorder::schema() const
+{
+    auto width = static_cast<std::uint32_t>(devices_.size());
+    return {
+        { "SimTime_s", ColumnType::Float64 },
+        { "DevicePower_kW", ColumnType::Float32, width },
+        { "DeviceSoc", ColumnType::Float32, width },
+    };
+}
+
+void VppDeviceStateRecorder::refresh(double now_s)
+{
+    for (auto vpp : flat_vpps_)
+        materialize_vpp_devices(registry_, *vpp);
+
+    for (std::size_t i = 0; i < devices_.size(); ++i) {
+        const DeviceSource& device = devices_[i];
+        power_kW_[i] = device.state->current_power_kW;
+        double held_s = device.station && device.station->last_dispatch_time_s >= 0 ? now_s - device.station->last_dispatch_time_s : 0.0;
+        if (held_s > 0) {
+            PhysicalStateComponent extrapolated = *device.state;
+            integrate_device_soc(*device.config, extrapolated, held_s);
+            soc_[i] = extrapolated.soc;
+        } else {
+            soc_[i] = device.state->soc;
+        }
+    }
+}
+
+void VppDeviceStateRecorder::record(ColumnarRecorder& recorder, double now_s)
+{
+    refresh(now_s);
+    recorder.set(0, now_s);
+    std::span<float> power = recorder.row_values<float>(1);
+    std::span<float> soc = recorder.row_values<float>(2);
+    for (std::size_t i = 0; i < devices_.size(); ++i) {
+        power[i] = static_cast<float>(power_kW_[i]);
+        soc[i] = static_cast<float>(soc_[i]);
+    }
+    recorder.commit_row();
+}
+
+cps_coro::Task frequencyOracleTask(Registry& registry,
+    const std::vector<Entity>& vpp_entities,
+    double disturbance_start_time_s,
+    double simulation_step_ms,
+    ColumnarRecorder* recorder)
+{
+    HECS_LOG_INFO(LogSubsystem::Frequency, "[{:.1f}ms] [FreqOracle] Active. Disturbance at {}s. Step: {}ms.",
+        (g_scheduler ? g_scheduler->now().time_since_epoch().count() / 1.0 : 0.0),
+        disturbance_start_time_s, simulation_step_ms);
 
     while (true) {
         co_await cps_coro::delay(cps_coro::Scheduler::duration(static_cast<long long>(simulation_step_ms)));
+        frequency_oracle_step(registry, vpp_entities, disturbance_start_time_s, 0.0, recorder);
+    }
+}
 
-        double current_sim_time_ms = (g_scheduler ? g_scheduler->now().time_since_epoch().count() : 0.0);
-        double current_sim_time_s = current_sim_time_ms / 1000.0;
-        double relative_time_s = current_sim_time_s - disturbance_start_time_s;
-        double freq_dev_hz = calculate_frequency_deviation(relative_time_s);
+double agc_layer_step(const AgcSettings& settings, double previous_request_kW, const WindowAggregate& freq_window)
+{
+    double request_kW = previous_request_kW - settings.integral_gain_kW_per_Hz_s * freq_window.integral();
+    return std::max(-settings.limit_kW, std::min(settings.limit_kW, request_kW));
+}
 
-        FrequencyInfo freq_info;
-        freq_info.current_sim_time_seconds = current_sim_time_s;
-        freq_info.freq_deviation_hz = freq_dev_hz;
+double agc_delivered_kW(double request_kW, const std::vector<VppAgcAllocation>& allocations)
+{
+    double delivered_kW = 0.0;
+    for (const auto& allocation : allocations) {
+        double share_kW = request_kW * allocation.participation;
+        delivered_kW += std::max(-allocation.headroom_down_kW, std::min(allocation.headroom_up_kW, share_kW));
+    }
+    return delivered_kW;
+}
 
-        if (g_scheduler) {
-            g_scheduler->trigger_event(FREQUENCY_UPDATE_EVENT, freq_info);
-        }
+std::vector<VppAgcAllocation> economic_redispatch_step(Registry& registry,
+    const std::vector<Entity>& vpp_entities,
+    const std::vector<double>& soc_weights,
+    double probe_freq_dev_hz)
+{
+    std::vector<VppAgcAllocation> allocations(vpp_entities.size());
+    double total_weight = 0.0;
+    for (std::size_t i = 0; i < vpp_entities.size(); ++i) {
+        double idle_kW = vpp_power_at_kW(registry, vpp_entities[i], 0.0);
+        allocations[i].headroom_up_kW = std::max(0.0, vpp_power_at_kW(registry, vpp_entities[i], -probe_freq_dev_hz) - idle_kW);
+        allocations[i].headroom_down_kW = std::max(0.0, idle_kW - vpp_power_at_kW(registry, vpp_entities[i], probe_freq_dev_hz));
+        double weight = i < soc_weights.size() ? soc_weights[i] : 1.0;
+        allocations[i].participation = weight * (allocations[i].headroom_up_kW + allocations[i].headroom_down_kW);
+        total_weight += allocations[i].participation;
+    }
+    for (auto& allocation : allocations)
+        allocation.participation = total_weight > 0 ? allocation.participation / total_weight : 0.0;
+    return allocations;
+}
 
-        double total_vpp_power_kw = 0;
-        for (Entity entity_id : ev_entities) {
-            if (auto state = registry.get<PhysicalStateComponent>(entity_id)) {
-                total_vpp_power_kw += state->current_power_kW;
-            }
-        }
-        for (Entity entity_id : ess_entities) {
-            if (auto state = registry.get<PhysicalStateComponent>(entity_id)) {
-                total_vpp_power_kw += state->current_power_kW;
-            }
+std::vector<double> soc_scheduling_step(Registry& registry, const std::vector<Entity>& vpp_entities)
+{
+    // Weight each VPP by how far its mean SOC sits from the edges of the band.
+    std::vector<double> weights;
+    weights.reserve(vpp_entities.size());
+    for (Entity vpp_entity : vpp_entities) {
+        double soc = vpp_mean_soc(registry, vpp_entity);
+        weights.push_back(std::max(0.0, 1.0 - std::abs(soc - 0.5) * 2.0));
+    }
+    return weights;
+}
+
+void add_frequency_control_layers(MultiRateCoordinator& layers,
+    FrequencyControlLayers& control,
+    Registry& registry,
+    const std::vector<Entity>& vpp_entities,
+    MultiRateCoordinator::duration primary_period,
+    ColumnarRecorder* recorder)
+{
+    control.agc_allocations = HeldOutput<std::vector<VppAgcAllocation>>(economic_redispatch_step(registry, vpp_entities, {}, control.probe_freq_dev_hz));
+    control.vpp_soc_weights = HeldOutput<std::vector<double>>(soc_scheduling_step(registry, vpp_entities));
+
+    layers.add_layer("primary_response", primary_period, [&registry, &vpp_entities, &control, recorder](double /*now_s*/, double dt_s) {
+        double agc_kW = agc_delivered_kW(control.agc_request_kW.value(), control.agc_allocations.value());
+        FrequencyInfo info = frequency_oracle_step(registry, vpp_entities, control.disturbance_start_time_s, agc_kW, recorder);
+        control.freq_window.add(info.freq_deviation_hz, dt_s);
+    });
+    layers.add_layer("agc", std::chrono::seconds(2), [&control](double now_s, double /*dt_s*/) {
+        control.agc_request_kW.publish(agc_layer_step(control.agc, control.agc_request_kW.value(), control.freq_window), now_s);
+        control.freq_window.reset();
+    });
+    layers.add_layer("economic_redispatch", std::chrono::minutes(5), [&registry, &vpp_entities, &control](double now_s, double /*dt_s*/) {
+        control.agc_allocations.publish(economic_redispatch_step(registry, vpp_entities, control.vpp_soc_weights.value(), control.probe_freq_dev_hz), now_s);
+    });
+    layers.add_layer("soc_scheduling", std::chrono::hours(1), [&registry, &vpp_entities, &control](double now_s, double /*dt_s*/) {
+        control.vpp_soc_weights.publish(soc_scheduling_step(registry, vpp_entities), now_s);
+    });
+}
+
+namespace {
+
+// Flags selecting which branch of the droop curve a device currently uses.
+unsigned soc_availability_class(const FrequencyControlConfigComponent& config, double soc)
+{
+    if (config.type != FrequencyControlConfigComponent::DeviceType::EV_PILE)
+        return 0;
+    return (soc >= config.soc_min_threshold ? 1u : 0u)
+        | (soc >= config.soc_max_threshold ? 2u : 0u)
+        | (soc <= config.soc_min_threshold ? 4u : 0u);
+}
+
+// Shortest interval an SOC check is armed for. A device sitting on a
+// threshold changes class as soon as its SOC moves, so it is re-checked at the
+// next update rather than at now_s, which would be due again immediately.
+constexpr double kMinAvailabilityCheckS = 0.001;
+
+// Seconds until the held power drives the SOC onto a threshold that changes
+// the device's availability class.
+double time_to_availability_change_s(const FrequencyControlConfigComponent& config, const PhysicalStateComponent& state)
+{
+    const double inf = std::numeric_limits<double>::infinity();
+    if (config.type != FrequencyControlConfigComponent::DeviceType::EV_PILE)
+        return inf;
+    double capacity_kWh = device_energy_capacity_kWh(config.type);
+    if (capacity_kWh <= 0 || state.current_power_kW == 0.0)
+        return inf;
+    double soc_drop_per_s = state.current_power_kW / (capacity_kWh * 3600.0);
+    double t = inf;
+    for (double threshold : { config.soc_min_threshold, config.soc_max_threshold }) {
+        double gap = state.soc - threshold;
+        if ((soc_drop_per_s > 0 && gap >= 0) || (soc_drop_per_s < 0 && gap <= 0))
+            t = std::min(t, gap / soc_drop_per_s);
+    }
+    return std::max(t, kMinAvailabilityCheckS);
+}
+
+// Brings the members' SOC up to now_s using the power held since the last
+// dispatch and replaces the curve contribution of every member whose
+// availability changed. Returns true when the station curve changed.
+bool settle_station(Registry& registry, VppStationComponent& station, double now_s)
+{
+    double dt_s = station.last_dispatch_time_s >= 0 ? now_s - station.last_dispatch_time_s : 0.0;
+    bool rebuild = false;
+    for (Entity entity_id : station.members) {
+        auto config = registry.get<FrequencyControlConfigComponent>(entity_id);
+        auto state = registry.get<PhysicalStateComponent>(entity_id);
+        if (!config || !state)
+            continue;
+        unsigned before = soc_availability_class(*config, state->soc);
+        if (dt_s > 0)
+            integrate_device_soc(*config, *state, dt_s);
+        if (soc_availability_class(*config, state->soc) != before) {
+            station.curve.set_contribution(entity_id, make_device_droop_curve(*config, state->soc));
+            rebuild = true;
         }
+    }
+    station.last_dispatch_time_s = now_s;
+    return rebuild;
+}
+
+// Allocates the station share to its piles and arms the next availability check.
+void dispatch_station(Registry& registry, VppStationComponent& station, double now_s, double freq_dev_hz)
+{
+    double allocated_kW = 0.0;
+    double next_change_s = std::numeric_limits<double>::infinity();
+    for (Entity entity_id : station.members) {
+        auto config = registry.get<FrequencyControlConfigComponent>(entity_id);
+        auto state = registry.get<PhysicalStateComponent>(entity_id);
+        if (!config || !state)
+            continue;
+        state->current_power_kW = compute_device_response_kW(*config, state->soc, freq_dev_hz);
+        allocated_kW += state->current_power_kW;
+        next_change_s = std::min(next_change_s, time_to_availability_change_s(*config, *state));
+    }
+    station.allocated_kW = allocated_kW;
+    station.next_availability_check_s = now_s + next_change_s;
+}
+
+// Conservative time before a flat-mode device could reach an SOC threshold:
+// assumes it runs at its largest possible output for the whole interval. A
+// device on a threshold is re-checked at the next update, never at now_s.
+double earliest_availability_change_s(const FrequencyControlConfigComponent& config, double soc)
+{
+    const double inf = std::numeric_limits<double>::infinity();
+    if (config.type != FrequencyControlConfigComponent::DeviceType::EV_PILE)
+        return inf;
+    double capacity_kWh = device_energy_capacity_kWh(config.type);
+    double max_abs_kW = std::max(std::abs(config.min_output_kW), std::abs(config.max_output_kW));
+    if (capacity_kWh <= 0 || max_abs_kW == 0.0)
+        return inf;
+    double max_soc_rate_per_s = max_abs_kW / (capacity_kWh * 3600.0);
+    double gap = std::min(std::abs(soc - config.soc_min_threshold), std::abs(soc - config.soc_max_threshold));
+    return std::max(gap / max_soc_rate_per_s, kMinAvailabilityCheckS);
+}
+
+// Replays the frequency samples since the device was last synchronized,
+// holding power between samples exactly as a per-step dispatch would.
+void sync_device(Registry& registry, VppDeviceAggregateComponent& vpp, Entity device, VppDeviceAggregateComponent::DeviceSlot& slot)
+{
+    if (vpp.samples.empty())
+        return;
+    auto config = registry.get<FrequencyControlConfigComponent>(device);
+    auto state = registry.get<PhysicalStateComponent>(device);
+    if (!config || !state)
+        return;
+    std::size_t last = vpp.samples_base + vpp.samples.size() - 1;
+    for (std::size_t k = slot.synced_sample; k < last; ++k) {
+        const auto& sample = vpp.samples[k - vpp.samples_base];
+        const auto& next = vpp.samples[k + 1 - vpp.samples_base];
+        state->current_power_kW = compute_device_response_kW(*config, state->soc, sample.freq_dev_hz);
+        integrate_device_soc(*config, *state, next.time_s - sample.time_s);
+    }
+    state->current_power_kW = compute_device_response_kW(*config, state->soc, vpp.samples.back().freq_dev_hz);
+    slot.synced_sample = last;
+}
+
+// Synchronizes a device whose SOC check fell due, refreshes its curve if its
+// availability changed and arms the next check.
+void check_device(Registry& registry, VppDeviceAggregateComponent& vpp, Entity device, VppDeviceAggregateComponent::DeviceSlot& slot, double now_s, bool force_curve)
+{
+    auto config = registry.get<FrequencyControlConfigComponent>(device);
+    auto state = registry.get<PhysicalStateComponent>(device);
+    if (!config || !state)
+        return;
+    sync_device(registry, vpp, device, slot);
+    unsigned availability = soc_availability_class(*config, state->soc);
+    if (force_curve || availability != slot.availability) {
+        slot.availability = availability;
+        vpp.curve.set_contribution(device, make_device_droop_curve(*config, state->soc));
+    }
+    slot.next_check_s = now_s + earliest_availability_change_s(*config, state->soc);
+    if (std::isfinite(slot.next_check_s))
+        vpp.checks.emplace(slot.next_check_s, device);
+}
+
+} // namespace
+
+void materialize_vpp_device(Registry& registry, VppDeviceAggregateComponent& vpp, Entity device)
+{
+    auto it = vpp.slots.find(device);
+    if (it != vpp.slots.end())
+        sync_device(registry, vpp, device, it->second);
+}
+
+void materialize_vpp_devices(Registry& registry, VppDeviceAggregateComponent& vpp)
+{
+    for (auto& [device, slot] : vpp.slots)
+        sync_device(registry, vpp, device, slot);
+    // Every device now reflects the latest sample; older history is no longer needed.
+    if (vpp.samples.size() > 1) {
+        vpp.samples_base += vpp.samples.size() - 1;
+        vpp.samples.erase(vpp.samples.begin(), vpp.samples.end() - 1);
+    }
+}
+
+void refresh_vpp_device(Registry& registry, VppDeviceAggregateComponent& vpp, Entity device)
+{
+    auto it = vpp.slots.find(device);
+    if (it == vpp.slots.end())
+        return;
+    double now_s = vpp.samples.empty() ? 0.0 : vpp.samples.back().time_s;
+    check_device(registry, vpp, device, it->second, now_s, true);
+}
+
+double vpp_total_power_kW(Registry& registry, Entity vpp_entity)
+{
+    if (auto flat = registry.get<VppDeviceAggregateComponent>(vpp_entity))
+        return flat->total_kW;
+    if (auto hierarchical = registry.get<VppAggregateComponent>(vpp_entity))
+        return hierarchical->dispatched_kW;
+    return 0.0;
+}
 
-        if (g_data_file_logger) {
-            g_data_file_logger->info("{:.0f}\t{:.3f}\t{:.3f}\t{:.5f}\t{:.2f}",
-                current_sim_time_ms,
-                current_sim_time_s,
-                relative_time_s,
-                freq_dev_hz,
-                total_vpp_power_kw);
+double vpp_power_at_kW(Registry& registry, Entity vpp_entity, double freq_dev_hz)
+{
+    if (auto flat = registry.get<VppDeviceAggregateComponent>(vpp_entity))
+        return flat->curve.evaluate(freq_dev_hz);
+    if (auto hierarchical = registry.get<VppAggregateComponent>(vpp_entity))
+        return hierarchical->curve.evaluate(freq_dev_hz);
+    return 0.0;
+}
+
+double vpp_mean_soc(Registry& registry, Entity vpp_entity)
+{
+    std::vector<Entity> devices;
+    if (auto flat = registry.get<VppDeviceAggregateComponent>(vpp_entity)) {
+        materialize_vpp_devices(registry, *flat);
+        devices = flat->devices;
+    } else if (auto hierarchical = registry.get<VppAggregateComponent>(vpp_entity)) {
+        for (Entity station_entity : hierarchical->stations) {
+            if (auto station = registry.get<VppStationComponent>(station_entity))
+                devices.insert(devices.end(), station->members.begin(), station->members.end());
+        }
+    }
+    double soc_sum = 0.0;
+    std::size_t count = 0;
+    for (Entity device : devices) {
+        if (auto state = registry.get<PhysicalStateComponent>(device)) {
+            soc_sum += state->soc;
+            ++count;
         }
     }
+    return count > 0 ? soc_sum / count : 0.0;
 }
 
 cps_coro::Task vppFrequencyResponseTask(Registry& registry,
     const std::string& vpp_name,
-    const std::vector<Entity>& managed_entities,
-    double /*simulation_step_ms_parameter*/) // This parameter is less directly used now for SOC dt
+    Entity vpp_entity,
+    double /*simulation_step_ms_parameter*/)
 {
-    if (g_console_logger)
-        g_console_logger->info("[{:.1f}ms] [VPP-{}] Active with event-driven updates. Awaiting FREQUENCY_UPDATE_EVENT.",
-            (g_scheduler ? g_scheduler->now().time_since_epoch().count() / 1.0 : 0.0), vpp_name);
+    auto vpp = registry.get<VppDeviceAggregateComponent>(vpp_entity);
+    if (!vpp) {
+        HECS_LOG_WARN(LogSubsystem::Frequency, "[VPP-{}] Entity #{} has no VppDeviceAggregateComponent; dispatch disabled.", vpp_name, vpp_entity);
+        co_return;
+    }
+    HECS_LOG_INFO(LogSubsystem::Frequency, "[{:.1f}ms] [VPP-{}] Active with aggregate-curve dispatch over {} devices. Awaiting FREQUENCY_UPDATE_EVENT.",
+        (g_scheduler ? g_scheduler->now().time_since_epoch().count() / 1.0 : 0.0), vpp_name, vpp->devices.size());
+
+    // Build the aggregate up front so slower layers can read it before the first update.
+    const double start_s = (g_scheduler ? g_scheduler->now().time_since_epoch().count() / 1000.0 : 0.0);
+    vpp->samples.clear();
+    vpp->samples_base = 0;
+    for (Entity device : vpp->devices) {
+        auto& slot = vpp->slots[device];
+        slot.synced_sample = 0;
+        check_device(registry, *vpp, device, slot, start_s, true);
+    }
 
     double last_processed_event_time_s = -1.0;
     double vpp_instance_last_full_update_time_s = -1.0;
     double vpp_instance_last_full_update_freq_dev_hz = 0.0;
 
+    // Devices hold their power until the deviation moves by more than this
+    // or this much time has passed, as in per-device dispatch.
     const double FREQUENCY_CHANGE_THRESHOLD_HZ = 0.01;
     const double TIME_THRESHOLD_SECONDS = 1.0;
 
@@ -123,93 +599,104 @@ cps_coro::Task vppFrequencyResponseTask(Registry& registry,
             continue;
         }
         last_processed_event_time_s = current_freq_info.current_sim_time_seconds;
+        const double now_s = current_freq_info.current_sim_time_seconds;
 
-        bool perform_full_update = false;
-        double dt_since_last_full_update = 0.0;
+        if (vpp_instance_last_full_update_time_s >= 0
+            && std::abs(current_freq_info.freq_deviation_hz - vpp_instance_last_full_update_freq_dev_hz) <= FREQUENCY_CHANGE_THRESHOLD_HZ
+            && now_s - vpp_instance_last_full_update_time_s < TIME_THRESHOLD_SECONDS) {
+            continue;
+        }
+        vpp_instance_last_full_update_time_s = now_s;
+        vpp_instance_last_full_update_freq_dev_hz = current_freq_info.freq_deviation_hz;
+
+        vpp->samples.push_back({ now_s, current_freq_info.freq_deviation_hz });
+
+        // Only devices that may have crossed an SOC threshold are touched.
+        while (!vpp->checks.empty() && vpp->checks.top().first <= now_s) {
+            auto [due_s, device] = vpp->checks.top();
+            vpp->checks.pop();
+            auto it = vpp->slots.find(device);
+            if (it == vpp->slots.end() || it->second.next_check_s != due_s)
+                continue; // Stale entry
+            check_device(registry, *vpp, device, it->second, now_s, false);
+        }
 
-        if (vpp_instance_last_full_update_time_s < 0) {
-            perform_full_update = true;
-        } else {
-            dt_since_last_full_update = current_freq_info.current_sim_time_seconds - vpp_instance_last_full_update_time_s;
-            if (dt_since_last_full_update < 0)
-                dt_since_last_full_update = 0; // Safety
+        if (vpp->samples.size() > vpp->max_history_samples)
+            materialize_vpp_devices(registry, *vpp);
 
-            double freq_diff_abs = std::abs(current_freq_info.freq_deviation_hz - vpp_instance_last_full_update_freq_dev_hz);
+        vpp->total_kW = vpp->curve.evaluate(current_freq_info.freq_deviation_hz);
+    }
+}
 
-            if (freq_diff_abs > FREQUENCY_CHANGE_THRESHOLD_HZ) {
-                perform_full_update = true;
-            }
-            if (dt_since_last_full_update >= TIME_THRESHOLD_SECONDS) {
-                perform_full_update = true;
-            }
-        }
+cps_coro::Task vppHierarchicalResponseTask(Registry& registry,
+    const std::string& vpp_name,
+    Entity vpp_entity,
+    double /*simulation_step_ms_parameter*/)
+{
+    auto vpp = registry.get<VppAggregateComponent>(vpp_entity);
+    if (!vpp) {
+        HECS_LOG_WARN(LogSubsystem::Frequency, "[VPP-{}] Entity #{} has no VppAggregateComponent; hierarchical dispatch disabled.", vpp_name, vpp_entity);
+        co_return;
+    }
+    HECS_LOG_INFO(LogSubsystem::Frequency, "[{:.1f}ms] [VPP-{}] Active with hierarchical dispatch over {} stations. Awaiting FREQUENCY_UPDATE_EVENT.",
+        (g_scheduler ? g_scheduler->now().time_since_epoch().count() / 1.0 : 0.0), vpp_name, vpp->stations.size());
 
-        if (perform_full_update) {
-            // if(g_console_logger) g_console_logger->debug( // Example debug log
-            //     "[{:.1f}ms] [VPP-{}] Criteria met. Full update. SimTime: {:.3f}s. FreqDev: {:.5f}Hz. dt_full: {:.3f}s.",
-            //     (g_scheduler ? g_scheduler->now().time_since_epoch().count() / 1.0 : 0.0),
-            //     vpp_name, current_freq_info.current_sim_time_seconds,
-            //     current_freq_info.freq_deviation_hz, dt_since_last_full_update);
+    const double STATION_SHARE_TOLERANCE_KW = 0.05;
 
-            for (Entity entity_id : managed_entities) {
-                auto config = registry.get<FrequencyControlConfigComponent>(entity_id);
-                auto state = registry.get<PhysicalStateComponent>(entity_id);
+    // Build the curves up front so slower layers can read them before the first update.
+    for (Entity station_entity : vpp->stations) {
+        auto station = registry.get<VppStationComponent>(station_entity);
+        if (!station)
+            continue;
+        for (Entity entity_id : station->members) {
+            auto config = registry.get<FrequencyControlConfigComponent>(entity_id);
+            auto state = registry.get<PhysicalStateComponent>(entity_id);
+            if (config && state)
+                station->curve.set_contribution(entity_id, make_device_droop_curve(*config, state->soc));
+        }
+        vpp->curve.set_contribution(station_entity, station->curve.to_curve());
+    }
 
-                if (!config || !state)
-                    continue;
+    double last_processed_event_time_s = -1.0;
+    bool first_update = true;
 
-                if (vpp_instance_last_full_update_time_s >= 0 && dt_since_last_full_update > 1e-6) { // Avoid zero dt if not first update
-                    double power_during_last_interval = state->current_power_kW;
-                    double energy_change_kWh = power_during_last_interval * (dt_since_last_full_update / 3600.0);
-
-                    if (config->type == FrequencyControlConfigComponent::DeviceType::EV_PILE) {
-                        double typical_battery_capacity_kWh = 50.0;
-                        if (typical_battery_capacity_kWh > 0)
-                            state->soc -= (energy_change_kWh / typical_battery_capacity_kWh);
-                    } else if (config->type == FrequencyControlConfigComponent::DeviceType::ESS_UNIT) {
-                        double typical_ess_capacity_kWh = 2000.0;
-                        if (typical_ess_capacity_kWh > 0)
-                            state->soc -= (energy_change_kWh / typical_ess_capacity_kWh);
-                    }
-                    state->soc = std::max(0.0, std::min(1.0, state->soc));
-                }
+    while (true) {
+        FrequencyInfo current_freq_info = co_await cps_coro::wait_for_event<FrequencyInfo>(FREQUENCY_UPDATE_EVENT);
 
-                double new_calculated_power_kW = config->base_power_kW;
-                double current_actual_freq_dev = current_freq_info.freq_deviation_hz;
-                double current_abs_actual_freq_dev = std::abs(current_actual_freq_dev);
-
-                if (current_abs_actual_freq_dev > config->deadband_Hz) {
-                    if (current_actual_freq_dev < 0) { // Frequency DROPPED
-                        double effective_df_drop = current_actual_freq_dev + config->deadband_Hz;
-                        if (config->type == FrequencyControlConfigComponent::DeviceType::EV_PILE) {
-                            if (state->soc >= config->soc_min_threshold) {
-                                new_calculated_power_kW = -config->gain_kW_per_Hz * effective_df_drop;
-                            } else if (config->base_power_kW < 0) {
-                                new_calculated_power_kW = 0.0;
-                            } // else stays base_power_kW
-                        } else if (config->type == FrequencyControlConfigComponent::DeviceType::ESS_UNIT) {
-                            new_calculated_power_kW = -config->gain_kW_per_Hz * effective_df_drop;
-                        }
-                    } else { // Frequency RISEN
-                        double effective_df_rise = current_actual_freq_dev - config->deadband_Hz;
-                        double power_change_due_to_freq = -config->gain_kW_per_Hz * effective_df_rise;
-                        new_calculated_power_kW = config->base_power_kW + power_change_due_to_freq;
-                    }
-                } // else: new_calculated_power_kW remains config->base_power_kW
-
-                new_calculated_power_kW = std::max(config->min_output_kW, std::min(config->max_output_kW, new_calculated_power_kW));
-
-                if (config->type == FrequencyControlConfigComponent::DeviceType::EV_PILE) {
-                    if (new_calculated_power_kW < 0 && state->soc >= config->soc_max_threshold)
-                        new_calculated_power_kW = 0.0;
-                    if (new_calculated_power_kW > 0 && state->soc <= config->soc_min_threshold)
-                        new_calculated_power_kW = 0.0;
+        if (current_freq_info.current_sim_time_seconds <= last_processed_event_time_s) {
+            continue;
+        }
+        last_processed_event_time_s = current_freq_info.current_sim_time_seconds;
+        const double now_s = current_freq_info.current_sim_time_seconds;
+        const double freq_dev_hz = current_freq_info.freq_deviation_hz;
+        double dispatched_kW = 0.0;
+
+        for (Entity station_entity : vpp->stations) {
+            auto station = registry.get<VppStationComponent>(station_entity);
+            if (!station)
+                continue;
+
+            bool station_curve_changed = false;
+            bool must_dispatch = first_update || now_s >= station->next_availability_check_s;
+            if (must_dispatch)
+                station_curve_changed = settle_station(registry, *station, now_s);
+
+            double share_kW = station->curve.evaluate(freq_dev_hz);
+            if (!must_dispatch) {
+                if (std::abs(share_kW - station->allocated_kW) <= STATION_SHARE_TOLERANCE_KW) {
+                    dispatched_kW += station->allocated_kW;
+                    continue;
                 }
-                state->current_power_kW = new_calculated_power_kW;
+                station_curve_changed = settle_station(registry, *station, now_s);
             }
+            dispatch_station(registry, *station, now_s, freq_dev_hz);
+            dispatched_kW += station->allocated_kW;
 
-            vpp_instance_last_full_update_time_s = current_freq_info.current_sim_time_seconds;
-            vpp_instance_last_full_update_freq_dev_hz = current_freq_info.freq_deviation_hz;
+            if (station_curve_changed)
+                vpp->curve.set_contribution(station_entity, station->curve.to_curve());
         }
+
+        vpp->dispatched_kW = dispatched_kW;
+        first_update = false;
     }
-}
\ No newline at end of file
+}
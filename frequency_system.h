@@ -2,11 +2,19 @@
 #ifndef FREQUENCY_SYSTEM_H
 #define FREQUENCY_SYSTEM_H
 
+#include "columnar_recorder.h"
 #include "cps_coro_lib.h"
+#include "droop_curve.h"
 #include "ecs_core.h"
+#include "multi_rate.h"
 #include "simulation_events_and_data.h"
 #include <cmath>
+#include <cstddef>
+#include <functional>
+#include <queue>
 #include <string>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 // #include <fstream> // No longer needed for ofstream
 
@@ -33,18 +41,204 @@ struct FrequencyControlConfigComponent : public IComponent {
         double soc_min = 0.0, double soc_max = 1.0);
 };
 
+// Hierarchical dispatch: a station groups piles and holds the exact sum of
+// their droop curves at the members' current SOC availability.
+struct VppStationComponent : public IComponent {
+    std::vector<Entity> members;
+    AggregateDroopCurve curve; // Keyed by member entity
+    double allocated_kW = 0.0; // Share last pushed down to the members
+    double last_dispatch_time_s = -1.0; // Members' power has been held since then
+    double next_availability_check_s = -1.0; // Earliest time a member may cross an SOC threshold
+    explicit VppStationComponent(std::vector<Entity> member_entities);
+};
+
+// Aggregator level of the hierarchy: the sum of its stations' curves (for
+// what-if reads such as economic redispatch); the reported total is what the
+// piles actually hold.
+struct VppAggregateComponent : public IComponent {
+    std::vector<Entity> stations;
+    AggregateDroopCurve curve; // Keyed by station entity
+    double dispatched_kW = 0.0; // Sum of the stations' allocated_kW
+    explicit VppAggregateComponent(std::vector<Entity> station_entities);
+};
+
+// Flat dispatch with lazy device outputs: the VPP keeps the exact sum of all
+// device curves, so its total for any frequency is a binary search. Device
+// power and SOC are only materialized from the recorded frequency history
+// when read, when a device may have crossed an SOC threshold, or when the
+// history grows past max_history_samples.
+struct VppDeviceAggregateComponent : public IComponent {
+    struct DeviceSlot {
+        std::size_t synced_sample = 0; // Absolute index of the sample the device state reflects
+        unsigned availability = 0;
+        double next_check_s = 0.0;
+    };
+    struct FrequencySample {
+        double time_s;
+        double freq_dev_hz;
+    };
+
+    std::vector<Entity> devices;
+    AggregateDroopCurve curve; // Keyed by device entity
+    double total_kW = 0.0;
+
+    std::vector<FrequencySample> samples;
+    std::size_t samples_base = 0; // Absolute index of samples.front()
+    std::size_t max_history_samples = 4096;
+    std::unordered_map<Entity, DeviceSlot> slots;
+    std::priority_queue<std::pair<double, Entity>, std::vector<std::pair<double, Entity>>, std::greater<>> checks;
+
+    explicit VppDeviceAggregateComponent(std::vector<Entity> device_entities);
+};
+
 double calculate_frequency_deviation(double t_relative);
 
+// Per-device droop response shared by the flat and hierarchical VPP tasks.
+double compute_device_response_kW(const FrequencyControlConfigComponent& config, double soc, double freq_dev_hz);
+// The same response as an explicit curve over freq_dev_hz for a fixed SOC.
+DroopCurve make_device_droop_curve(const FrequencyControlConfigComponent& config, double soc);
+double device_energy_capacity_kWh(FrequencyControlConfigComponent::DeviceType type);
+// Integrates the held power over dt_s into the SOC.
+void integrate_device_soc(const FrequencyControlConfigComponent& config, PhysicalStateComponent& state, double dt_s);
+
+// Brings a flat-mode device's PhysicalStateComponent up to the latest frequency sample.
+void materialize_vpp_device(Registry& registry, VppDeviceAggregateComponent& vpp, Entity device);
+void materialize_vpp_devices(Registry& registry, VppDeviceAggregateComponent& vpp);
+// Re-derives one device's curve after its FrequencyControlConfigComponent changed.
+void refresh_vpp_device(Registry& registry, VppDeviceAggregateComponent& vpp, Entity device);
+// Total power of a VPP entity in either dispatch mode.
+double vpp_total_power_kW(Registry& registry, Entity vpp_entity);
+// Aggregate curve of a VPP evaluated at an arbitrary deviation (no dispatch).
+double vpp_power_at_kW(Registry& registry, Entity vpp_entity, double freq_dev_hz);
+// Mean SOC over a VPP's devices; materializes flat-mode devices first.
+double vpp_mean_soc(Registry& registry, Entity vpp_entity);
+
+// --- Multi-rate frequency scenario (see multi_rate.h) ---
+// Columns of the frequency result file, in frequency_result_schema() order.
+enum FrequencyResultColumn : std::size_t {
+    FREQ_COL_SIM_TIME_MS,
+    FREQ_COL_SIM_TIME_S,
+    FREQ_COL_RELATIVE_TIME_S,
+    FREQ_COL_FREQ_DEVIATION_HZ,
+    FREQ_COL_TOTAL_VPP_POWER_KW,
+    FREQ_COL_AGC_POWER_KW,
+};
+std::vector<ColumnSpec> frequency_result_schema();
+
+// Fast layer: one frequency oracle step. Publishes FREQUENCY_UPDATE_EVENT and
+// records the VPP totals together with the held AGC power (recorder may be null).
+FrequencyInfo frequency_oracle_step(Registry& registry,
+    const std::vector<Entity>& vpp_entities,
+    double disturbance_start_time_s,
+    double agc_power_kW,
+    ColumnarRecorder* recorder);
+
+// Every device's power and SOC as of a given time. The components lag
+// behind under lazy dispatch, so refresh() materializes flat-mode VPPs and
+// extrapolates hierarchical members' SOC over the power held since their
+// station's last dispatch, without touching their state. Device state is
+// resolved once at construction, so a refresh is one pass over the devices.
+// power_kW() and soc() never move: signal recorders and statistics read
+// them by pointer, after a refresh at the same time.
+class VppDeviceStateRecorder {
+public:
+    VppDeviceStateRecorder(Registry& registry, const std::vector<Entity>& vpp_entities);
+    std::size_t device_count() const { return devices_.size(); }
+    Entity device_entity(std::size_t device) const { return devices_[device].entity; }
+    void refresh(double now_s);
+    const std::vector<double>& power_kW() const { return power_kW_; }
+    const std::vector<double>& soc() const { return soc_; }
+
+    // SimTime_s, DevicePower_kW[device_count()], DeviceSoc[device_count()]
+    std::vector<ColumnSpec> schema() const;
+    // Refreshes and writes one row.
+    void record(ColumnarRecorder& recorder, double now_s);
+
+private:
+    struct DeviceSource {
+        Entity entity;
+        const FrequencyControlConfigComponent* config;
+        const PhysicalStateComponent* state;
+        const VppStationComponent* station; // Null in flat mode
+    };
+    Registry& registry_;
+    std::vector<VppDeviceAggregateComponent*> flat_vpps_;
+    std::vector<DeviceSource> devices_;
+    std::vector<double> power_kW_;
+    std::vector<double> soc_;
+};
+
+struct AgcSettings {
+    double integral_gain_kW_per_Hz_s = 2000.0;
+    double limit_kW = 5000.0;
+};
+
+// Held output of the economic redispatch layer, one entry per VPP.
+struct VppAgcAllocation {
+    double participation = 0.0;
+    double headroom_up_kW = 0.0;
+    double headroom_down_kW = 0.0;
+};
+
+// AGC layer (seconds): integral control on the windowed frequency deviation.
+double agc_layer_step(const AgcSettings& settings, double previous_request_kW, const WindowAggregate& freq_window);
+// Fast-layer read of the held AGC request split by the held allocations.
+double agc_delivered_kW(double request_kW, const std::vector<VppAgcAllocation>& allocations);
+// Economic redispatch layer (minutes): participation from aggregate-curve headroom at +/-probe_freq_dev_hz.
+std::vector<VppAgcAllocation> economic_redispatch_step(Registry& registry,
+    const std::vector<Entity>& vpp_entities,
+    const std::vector<double>& soc_weights,
+    double probe_freq_dev_hz);
+// SOC scheduling layer (hourly): per-VPP weights from mean SOC.
+std::vector<double> soc_scheduling_step(Registry& registry, const std::vector<Entity>& vpp_entities);
+
+// Settings, windowed inputs and held outputs of the frequency control layers.
+struct FrequencyControlLayers {
+    AgcSettings agc;
+    double disturbance_start_time_s = 5.0;
+    double probe_freq_dev_hz = 0.5; // Headroom probe of the economic redispatch
+    WindowAggregate freq_window;
+    HeldOutput<double> agc_request_kW { 0.0 };
+    HeldOutput<std::vector<VppAgcAllocation>> agc_allocations;
+    HeldOutput<std::vector<double>> vpp_soc_weights;
+};
+
+// Adds the primary response (every primary_period, recording into `recorder`
+// if given), AGC (2 s), economic redispatch (5 min) and SOC scheduling (1 h)
+// layers, after seeding the held allocations and weights from the current
+// VPP curves. `control`, `registry` and `vpp_entities` must outlive the run.
+// AGC is record-only: the delivered request is written to
+// FREQ_COL_AGC_POWER_KW but not applied to the VPP setpoints, and the
+// frequency follows the scripted disturbance, so no slow layer feeds back
+// into device dispatch.
+void add_frequency_control_layers(MultiRateCoordinator& layers,
+    FrequencyControlLayers& control,
+    Registry& registry,
+    const std::vector<Entity>& vpp_entities,
+    MultiRateCoordinator::duration primary_period,
+    ColumnarRecorder* recorder);
+
 cps_coro::Task frequencyOracleTask(Registry& registry,
-    const std::vector<Entity>& ev_entities,
-    const std::vector<Entity>& ess_entities,
+    const std::vector<Entity>& vpp_entities,
     double disturbance_start_time_s,
-    double simulation_step_ms // Removed std::ofstream& data_logger
-);
+    double simulation_step_ms,
+    ColumnarRecorder* recorder);
 
+// Flat dispatch mode over a VppDeviceAggregateComponent: O(log n) per
+// frequency update plus the devices whose SOC checks fall due. Updates within
+// 0.01 Hz of the last applied one and less than 1 s after it are skipped, so
+// devices hold their power in between.
 cps_coro::Task vppFrequencyResponseTask(Registry& registry,
     const std::string& vpp_name,
-    const std::vector<Entity>& managed_entities,
+    Entity vpp_entity,
+    double simulation_step_ms_parameter);
+
+// Hierarchical dispatch mode: per frequency update the VPP evaluates its
+// aggregate curve and each station's curve; piles are only re-dispatched by
+// stations whose share changed. Cost per update is O(stations).
+cps_coro::Task vppHierarchicalResponseTask(Registry& registry,
+    const std::string& vpp_name,
+    Entity vpp_entity,
     double simulation_step_ms_parameter);
 
 #endif // FREQUENCY_SYSTEM_H
\ No newline at end of file
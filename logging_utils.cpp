@@ -4,31 +4,51 @@
 #include <iostream> // 用于在日志初始化失败时输出错误
 
 // 定义全局日志记录器实例
-std::shared_ptr<spdlog::logger> g_console_logger;
+std::shared_ptr<AsyncLogger> g_console_logger;
 std::shared_ptr<spdlog::logger> g_data_file_logger;
+std::atomic<std::uint32_t> g_log_subsystem_mask { ~0u };
 
-void initialize_loggers(const std::string& data_log_filename, bool truncate_data_log)
+void set_log_subsystem_enabled(LogSubsystem subsystem, bool enabled)
+{
+    std::uint32_t bit = 1u << static_cast<std::uint32_t>(subsystem);
+    if (enabled)
+        g_log_subsystem_mask.fetch_or(bit, std::memory_order_relaxed);
+    else
+        g_log_subsystem_mask.fetch_and(~bit, std::memory_order_relaxed);
+}
+
+void initialize_loggers(const std::string& data_log_filename, bool truncate_data_log, const AsyncLogSettings& async_settings)
 {
     try {
         // 1. 控制台日志记录器
-        g_console_logger = spdlog::stdout_color_mt("console");
+        auto console_sink_logger = spdlog::stdout_color_mt("console");
         // 设置日志级别 (例如: trace, debug, info, warn, error, critical, off)
-        g_console_logger->set_level(spdlog::level::info);
+        console_sink_logger->set_level(spdlog::level::info);
         // 设置日志格式: [时间戳精确到毫秒] [日志记录器名称] [级别] 消息内容
-        g_console_logger->set_pattern("[%H:%M:%S.%e] [%n] [%^%l%$] %v");
+        // 时间戳取自调用时刻，而不是后台线程输出的时刻
+        console_sink_logger->set_pattern("[%H:%M:%S.%e] [%n] [%^%l%$] %v");
+        g_console_logger = std::make_shared<AsyncLogger>(console_sink_logger);
 
-        // 2. 数据文件日志记录器
+        // 2. 数据文件日志记录器 (可选)
         // 使用 basic_file_sink_mt，它会缓冲日志，我们将在程序结束时手动刷新
-        g_data_file_logger = spdlog::basic_logger_mt("data_file", data_log_filename, truncate_data_log);
-        g_data_file_logger->set_level(spdlog::level::info);
-        // 对于数据文件，通常只记录消息本身，以便后续处理 (如CSV)
-        g_data_file_logger->set_pattern("%v");
+        if (!data_log_filename.empty()) {
+            g_data_file_logger = spdlog::basic_logger_mt("data_file", data_log_filename, truncate_data_log);
+            g_data_file_logger->set_level(spdlog::level::info);
+            // 对于数据文件，通常只记录消息本身，以便后续处理 (如CSV)
+            g_data_file_logger->set_pattern("%v");
+        }
         // spdlog 默认情况下，在缓冲区满或遇到高级别日志（如 error, critical）时可能会自动刷新。
         // 为了确保仅在最后刷新，主要依赖于程序结束时的显式 flush 调用。
         // 对于普通 info 级别的日志，它会主要依赖内部缓冲。
 
-        spdlog::set_default_logger(g_console_logger); // 将控制台记录器设为默认，这样spdlog::info()等会用它
-        spdlog::info("Loggers initialized. Data will be written to '{}'.", data_log_filename);
+        spdlog::set_default_logger(console_sink_logger); // 将控制台记录器设为默认，这样spdlog::info()等会用它 (同步输出)
+        if (g_data_file_logger)
+            spdlog::info("Loggers initialized. Data will be written to '{}'.", data_log_filename);
+        else
+            spdlog::info("Loggers initialized.");
+
+        // 3. 启动异步日志后台线程
+        start_async_logging(async_settings);
 
     } catch (const spdlog::spdlog_ex& ex) {
         std::cerr << "Log initialization failed: " << ex.what() << std::endl;
@@ -41,6 +61,16 @@ void shutdown_loggers()
     if (g_console_logger) {
         g_console_logger->info("Flushing all logs before shutdown...");
     }
+    // 先排空异步日志缓冲区，再刷新底层 sink
+    stop_async_logging();
+    AsyncLogStats stats = async_log_stats();
+    if (stats.dropped > 0 || stats.blocked > 0) {
+        spdlog::info("Async log: {} records, {} dropped, {} waited for ring space, {} logged synchronously.",
+            stats.enqueued, stats.dropped, stats.blocked, stats.oversized);
+    }
+    if (g_console_logger) {
+        g_console_logger->target().flush();
+    }
     if (g_data_file_logger) {
         g_data_file_logger->flush();
     }
@@ -1,20 +1,104 @@
 #ifndef LOGGING_UTILS_H
 #define LOGGING_UTILS_H
 
+#include "async_log.h"
 #include "spdlog/spdlog.h"
+#include <atomic>
+#include <cstdint>
 #include <memory>
 #include <string>
 
+// 编译期最低日志级别。低于该级别的 HECS_LOG_* 语句在预处理阶段即被移除 (参数不会求值)。
+// 例如基准测试构建: -DHECS_LOG_ACTIVE_LEVEL=HECS_LOG_LEVEL_WARN (CMake 选项 HECS_LOG_ACTIVE_LEVEL=WARN)
+#define HECS_LOG_LEVEL_TRACE 0
+#define HECS_LOG_LEVEL_DEBUG 1
+#define HECS_LOG_LEVEL_INFO 2
+#define HECS_LOG_LEVEL_WARN 3
+#define HECS_LOG_LEVEL_ERROR 4
+#define HECS_LOG_LEVEL_CRITICAL 5
+#define HECS_LOG_LEVEL_OFF 6
+
+#ifndef HECS_LOG_ACTIVE_LEVEL
+#define HECS_LOG_ACTIVE_LEVEL HECS_LOG_LEVEL_TRACE
+#endif
+
+// 运行期按子系统屏蔽日志 (每个子系统一位)
+enum class LogSubsystem : std::uint32_t {
+    Core,
+    Frequency,
+    Protection,
+    Load,
+    Generation,
+    MultiRate,
+    Network,
+};
+
+extern std::atomic<std::uint32_t> g_log_subsystem_mask;
+
+inline bool log_subsystem_enabled(LogSubsystem subsystem)
+{
+    return (g_log_subsystem_mask.load(std::memory_order_relaxed) >> static_cast<std::uint32_t>(subsystem)) & 1u;
+}
+
+void set_log_subsystem_enabled(LogSubsystem subsystem, bool enabled);
+
 // 全局日志记录器实例 (声明)
-extern std::shared_ptr<spdlog::logger> g_console_logger;
+// 控制台日志经由 AsyncLogger：调用线程只拷贝参数，格式化和输出在后台线程完成。
+extern std::shared_ptr<AsyncLogger> g_console_logger;
 extern std::shared_ptr<spdlog::logger> g_data_file_logger;
 
 // 初始化日志记录器函数
-// data_log_filename: 数据日志文件的名称
+// data_log_filename: 数据日志文件的名称；为空时不创建数据日志 (仿真结果由 ColumnarRecorder 写出)
 // truncate_data_log: 是否在启动时清空已存在的数据日志文件
-void initialize_loggers(const std::string& data_log_filename = "simulation_output.csv", bool truncate_data_log = true);
+// async_settings: 异步日志的环形缓冲区大小、溢出策略 (阻塞/丢弃) 等
+void initialize_loggers(const std::string& data_log_filename = "",
+    bool truncate_data_log = true,
+    const AsyncLogSettings& async_settings = {});
 
 // 函数用于在程序结束时刷新和关闭日志
 void shutdown_loggers();
 
+// 日志宏: 先检查子系统掩码和运行期级别，通过后才对参数求值并写入异步日志。
+#define HECS_LOG_AT(level, subsystem, ...) \
+    do { \
+        if (g_console_logger && log_subsystem_enabled(subsystem) && g_console_logger->should_log(level)) \
+            g_console_logger->log(level, __VA_ARGS__); \
+    } while (0)
+
+#if HECS_LOG_ACTIVE_LEVEL <= HECS_LOG_LEVEL_TRACE
+#define HECS_LOG_TRACE(subsystem, ...) HECS_LOG_AT(spdlog::level::trace, subsystem, __VA_ARGS__)
+#else
+#define HECS_LOG_TRACE(subsystem, ...) (void)0
+#endif
+
+#if HECS_LOG_ACTIVE_LEVEL <= HECS_LOG_LEVEL_DEBUG
+#define HECS_LOG_DEBUG(subsystem, ...) HECS_LOG_AT(spdlog::level::debug, subsystem, __VA_ARGS__)
+#else
+#define HECS_LOG_DEBUG(subsystem, ...) (void)0
+#endif
+
+#if HECS_LOG_ACTIVE_LEVEL <= HECS_LOG_LEVEL_INFO
+#define HECS_LOG_INFO(subsystem, ...) HECS_LOG_AT(spdlog::level::info, subsystem, __VA_ARGS__)
+#else
+#define HECS_LOG_INFO(subsystem, ...) (void)0
+#endif
+
+#if HECS_LOG_ACTIVE_LEVEL <= HECS_LOG_LEVEL_WARN
+#define HECS_LOG_WARN(subsystem, ...) HECS_LOG_AT(spdlog::level::warn, subsystem, __VA_ARGS__)
+#else
+#define HECS_LOG_WARN(subsystem, ...) (void)0
+#endif
+
+#if HECS_LOG_ACTIVE_LEVEL <= HECS_LOG_LEVEL_ERROR
+#define HECS_LOG_ERROR(subsystem, ...) HECS_LOG_AT(spdlog::level::err, subsystem, __VA_ARGS__)
+#else
+#define HECS_LOG_ERROR(subsystem, ...) (void)0
+#endif
+
+#if HECS_LOG_ACTIVE_LEVEL <= HECS_LOG_LEVEL_CRITICAL
+#define HECS_LOG_CRITICAL(subsystem, ...) HECS_LOG_AT(spdlog::level::critical, subsystem, __VA_ARGS__)
+#else
+#define HECS_LOG_CRITICAL(subsystem, ...) (void)0
+#endif
+
 #endif // LOGGING_UTILS_H
\ No newline at end of file
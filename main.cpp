@@ -1,15 +1,31 @@
 // main.cpp
+#include "breaker_system.h"
+#include "comtrade.h"
 #include "cps_coro_lib.h"
 #include "ecs_core.h"
 #include "frequency_system.h"
 #include "logging_utils.h"
+#include "multi_rate.h"
+#include "network_model.h"
+#include "newton_power_flow.h"
 #include "protection_system.h"
+#include "radial_power_flow.h"
+#include "sampled_values.h"
+#include "signal_recorder.h"
+#include "signal_statistics.h"
 #include "simulation_events_and_data.h"
+#include "time_series_input.h"
 
+#include <algorithm>
 #include <chrono>
+#include <cmath>
+#include <complex>
+#include <filesystem>
 #include <iomanip> // For formatting output if needed
 #include <iostream> // For fallback error messages if spdlog fails
+#include <limits>
 #include <random>
+#include <span>
 #include <string>
 #include <vector>
 
@@ -60,55 +76,195 @@ long get_peak_memory_usage_kb()
 
 cps_coro::Task generatorTask()
 {
-    if (g_console_logger && g_scheduler)
-        g_console_logger->info("[{}ms] [Generator] Startup sequence initiated.", g_scheduler->now().time_since_epoch().count());
+    if (g_scheduler)
+        HECS_LOG_INFO(LogSubsystem::Generation, "[{}ms] [Generator] Startup sequence initiated.", g_scheduler->now().time_since_epoch().count());
     co_await cps_coro::delay(cps_coro::Scheduler::duration(1000));
-    if (g_console_logger && g_scheduler)
-        g_console_logger->info("[{}ms] [Generator] Online and stable.", g_scheduler->now().time_since_epoch().count());
+    if (g_scheduler)
+        HECS_LOG_INFO(LogSubsystem::Generation, "[{}ms] [Generator] Online and stable.", g_scheduler->now().time_since_epoch().count());
     if (g_scheduler)
         g_scheduler->trigger_event(GENERATOR_READY_EVENT);
 
     while (true) {
         co_await cps_coro::wait_for_event<void>(POWER_ADJUST_REQUEST_EVENT);
-        if (g_console_logger && g_scheduler)
-            g_console_logger->info("[{}ms] [Generator] Received POWER_ADJUST_REQUEST_EVENT. Adjusting...", g_scheduler->now().time_since_epoch().count());
+        if (g_scheduler)
+            HECS_LOG_INFO(LogSubsystem::Generation, "[{}ms] [Generator] Received POWER_ADJUST_REQUEST_EVENT. Adjusting...", g_scheduler->now().time_since_epoch().count());
         co_await cps_coro::delay(cps_coro::Scheduler::duration(300));
-        if (g_console_logger && g_scheduler)
-            g_console_logger->info("[{}ms] [Generator] Power output adjusted.", g_scheduler->now().time_since_epoch().count());
+        if (g_scheduler)
+            HECS_LOG_INFO(LogSubsystem::Generation, "[{}ms] [Generator] Power output adjusted.", g_scheduler->now().time_since_epoch().count());
     }
 }
 
-cps_coro::Task loadTask()
+// Without a profile the legacy fixed load steps are used. With one, every row
+// of the per-bus load profile is delivered with LOAD_CHANGE_EVENT as a
+// zero-copy ProfileSample by profilePlaybackTask; loadMonitorTask watches
+// the rows.
+cps_coro::Task loadTask(const TimeSeriesProfile* load_profile)
 {
-    if (g_console_logger && g_scheduler)
-        g_console_logger->info("[{}ms] [Load] Waiting for GENERATOR_READY_EVENT.", g_scheduler->now().time_since_epoch().count());
+    if (g_scheduler)
+        HECS_LOG_INFO(LogSubsystem::Load, "[{}ms] [Load] Waiting for GENERATOR_READY_EVENT.", g_scheduler->now().time_since_epoch().count());
     co_await cps_coro::wait_for_event<void>(GENERATOR_READY_EVENT);
-    if (g_console_logger && g_scheduler)
-        g_console_logger->info("[{}ms] [Load] Generator online. Initial load applied.", g_scheduler->now().time_since_epoch().count());
+    if (g_scheduler)
+        HECS_LOG_INFO(LogSubsystem::Load, "[{}ms] [Load] Generator online. Initial load applied.", g_scheduler->now().time_since_epoch().count());
+
+    if (load_profile && g_scheduler) {
+        auto playback = profilePlaybackTask(*load_profile, LOAD_CHANGE_EVENT);
+        playback.detach();
+        co_return;
+    }
+
     co_await cps_coro::delay(cps_coro::Scheduler::duration(500));
 
-    if (g_console_logger && g_scheduler)
-        g_console_logger->info("[{}ms] [Load] Load increased. Triggering LOAD_CHANGE_EVENT.", g_scheduler->now().time_since_epoch().count());
+    if (g_scheduler)
+        HECS_LOG_INFO(LogSubsystem::Load, "[{}ms] [Load] Load increased. Triggering LOAD_CHANGE_EVENT.", g_scheduler->now().time_since_epoch().count());
     if (g_scheduler)
         g_scheduler->trigger_event(LOAD_CHANGE_EVENT);
 
     co_await cps_coro::delay(cps_coro::Scheduler::duration(10000));
-    if (g_console_logger && g_scheduler)
-        g_console_logger->info("[{}ms] [Load] Load significantly increased. Triggering LOAD_CHANGE_EVENT & STABILITY_CONCERN_EVENT.", g_scheduler->now().time_since_epoch().count());
+    if (g_scheduler)
+        HECS_LOG_INFO(LogSubsystem::Load, "[{}ms] [Load] Load significantly increased. Triggering LOAD_CHANGE_EVENT & STABILITY_CONCERN_EVENT.", g_scheduler->now().time_since_epoch().count());
     if (g_scheduler) {
         g_scheduler->trigger_event(LOAD_CHANGE_EVENT);
         g_scheduler->trigger_event(STABILITY_CONCERN_EVENT);
     }
-    co_return;
+}
+
+// Logs large swings in the total of the load profile rows and raises
+// STABILITY_CONCERN_EVENT when the load rises well above the first row.
+cps_coro::Task loadMonitorTask(const TimeSeriesProfile& load_profile)
+{
+    const double LOG_CHANGE_FRACTION = 0.05;
+    const double STABILITY_CONCERN_FRACTION = 0.25;
+    double reference_total_kW = -1.0;
+    double last_logged_total_kW = -1.0;
+    while (true) {
+        auto sample = co_await cps_coro::wait_for_event<ProfileSample>(LOAD_CHANGE_EVENT);
+        if (!g_scheduler)
+            continue;
+        auto now_ms = g_scheduler->now().time_since_epoch().count();
+
+        double total_kW = 0.0;
+        for (float bus_kW : sample.values)
+            total_kW += bus_kW;
+        if (reference_total_kW < 0)
+            reference_total_kW = last_logged_total_kW = total_kW;
+
+        if (std::abs(total_kW - last_logged_total_kW) > LOG_CHANGE_FRACTION * reference_total_kW) {
+            HECS_LOG_INFO(LogSubsystem::Load, "[{}ms] [Load] Profile row {}: total load {:.1f} kW over {} buses. Triggering LOAD_CHANGE_EVENT.",
+                now_ms, sample.sample_index, total_kW, sample.values.size());
+            if (total_kW - reference_total_kW > STABILITY_CONCERN_FRACTION * reference_total_kW) {
+                HECS_LOG_INFO(LogSubsystem::Load, "[{}ms] [Load] Load significantly increased. Triggering STABILITY_CONCERN_EVENT.", now_ms);
+                g_scheduler->trigger_event(STABILITY_CONCERN_EVENT);
+            }
+            last_logged_total_kW = total_kW;
+        }
+        if (sample.sample_index + 1 >= load_profile.sample_count())
+            co_return;
+    }
+}
+
+// Solves the distribution feeders for every load profile row: channel i is
+// the load at loads[i], at 0.95 power factor lagging, written to the
+// LoadComponent so every network solver sees it. Each solve warm-starts
+// from the previous one. The lowest bus voltage is published with
+// VOLTAGE_CHANGE_EVENT when it moves by more than 0.5 %, for voltage
+// control to act on.
+cps_coro::Task powerFlowTask(RadialPowerFlow& power_flow, std::vector<LoadComponent*> loads)
+{
+    const double Q_PER_P = std::tan(std::acos(0.95));
+    const double PUBLISH_CHANGE_PU = 0.005;
+    double published_pu = -1.0;
+    while (true) {
+        auto sample = co_await cps_coro::wait_for_event<ProfileSample>(LOAD_CHANGE_EVENT);
+        if (!g_scheduler)
+            continue;
+        std::size_t channels = std::min(sample.values.size(), loads.size());
+        for (std::size_t i = 0; i < channels; ++i) {
+            loads[i]->p_kW = sample.values[i];
+            loads[i]->q_kvar = sample.values[i] * Q_PER_P;
+        }
+        power_flow.refresh_loads();
+        auto solve_start = std::chrono::steady_clock::now();
+        PowerFlowStats stats = power_flow.solve();
+        std::chrono::duration<double, std::micro> solve_time = std::chrono::steady_clock::now() - solve_start;
+
+        Entity lowest_bus = 0;
+        double lowest_pu = power_flow.min_voltage_pu(&lowest_bus);
+        if (std::abs(lowest_pu - published_pu) <= PUBLISH_CHANGE_PU && stats.converged)
+            continue;
+        auto now_ms = g_scheduler->now().time_since_epoch().count();
+        HECS_LOG_INFO(LogSubsystem::Network, "[{}ms] [PowerFlow] {} buses in {} feeders: {} in {} iterations ({:.0f} us). Lowest voltage {:.4f} pu at Bus#{}.",
+            now_ms, stats.buses, power_flow.feeder_count(), stats.converged ? "converged" : "NOT converged", stats.max_iterations,
+            solve_time.count(), lowest_pu, lowest_bus);
+        published_pu = lowest_pu;
+        g_scheduler->trigger_event(VOLTAGE_CHANGE_EVENT, VoltageData { lowest_pu, g_scheduler->now() });
+    }
+}
+
+// Newton-Raphson power flow over the whole network model, as an ECS system:
+// re-solved on LOAD_CHANGE_EVENT and on BREAKER_OPENED_EVENT, warm-started
+// from the previous solution. Logged when the lowest voltage moves by more
+// than 0.5 % and on every topology change.
+void logNewtonSolve(const NewtonPowerFlow& power_flow, const NewtonStats& stats, double solve_us, const char* cause)
+{
+    Entity lowest_bus = 0;
+    double lowest_pu = power_flow.min_voltage_pu(&lowest_bus);
+    HECS_LOG_INFO(LogSubsystem::Network, "[{}ms] [NewtonPF] {}: {} energized buses {} in {} iterations, {} factorizations ({:.0f} us). Lowest voltage {:.4f} pu at Bus#{}.",
+        g_scheduler->now().time_since_epoch().count(), cause, stats.buses, stats.converged ? "converged" : "NOT converged",
+        stats.iterations, stats.factorizations, solve_us, lowest_pu, lowest_bus);
+}
+
+cps_coro::Task newtonLoadTask(NewtonPowerFlow& power_flow)
+{
+    const double LOG_CHANGE_PU = 0.005;
+    double logged_pu = -1.0;
+    while (true) {
+        co_await cps_coro::wait_for_event<ProfileSample>(LOAD_CHANGE_EVENT);
+        if (!g_scheduler)
+            continue;
+        // Yield once so the handlers that write this event's loads into the
+        // LoadComponents have run.
+        co_await cps_coro::delay(cps_coro::Scheduler::duration(0));
+        power_flow.refresh_loads();
+        auto solve_start = std::chrono::steady_clock::now();
+        NewtonStats stats = power_flow.solve();
+        std::chrono::duration<double, std::micro> solve_time = std::chrono::steady_clock::now() - solve_start;
+        double lowest_pu = power_flow.min_voltage_pu();
+        if (std::abs(lowest_pu - logged_pu) <= LOG_CHANGE_PU && stats.converged)
+            continue;
+        logged_pu = lowest_pu;
+        logNewtonSolve(power_flow, stats, solve_time.count(), "load change");
+    }
+}
+
+cps_coro::Task newtonTopologyTask(NewtonPowerFlow& power_flow)
+{
+    while (true) {
+        Entity opened = co_await cps_coro::wait_for_event<Entity>(BREAKER_OPENED_EVENT);
+        if (!g_scheduler || !power_flow.set_branch_closed(opened, false))
+            continue;
+        auto solve_start = std::chrono::steady_clock::now();
+        NewtonStats stats = power_flow.solve();
+        std::chrono::duration<double, std::micro> solve_time = std::chrono::steady_clock::now() - solve_start;
+        logNewtonSolve(power_flow, stats, solve_time.count(), "breaker opened");
+    }
 }
 
 extern void avc_test();
 
-int main()
+// Usage: hecs_coro_simulation [output_dir]   (default: hecs_output)
+int main(int argc, char* argv[])
 {
     // avc_test();
 
-    initialize_loggers("vpp_freq_response_data.csv", true);
+    initialize_loggers();
+
+    // Every file the run writes goes under output_dir.
+    const std::filesystem::path output_dir = argc > 1 ? argv[1] : "hecs_output";
+    std::error_code output_dir_error;
+    std::filesystem::create_directories(output_dir, output_dir_error);
+    if (output_dir_error && g_console_logger)
+        g_console_logger->warn("Cannot create output directory '{}': {}", output_dir.string(), output_dir_error.message());
+    auto output_path = [&output_dir](const std::string& name) { return (output_dir / name).string(); };
 
     cps_coro::Scheduler scheduler_instance;
     g_scheduler = &scheduler_instance; // Initialize global scheduler pointer
@@ -122,23 +278,138 @@ int main()
 
     ProtectionSystem protection_system(registry, scheduler_instance);
     Entity line1_prot = registry.create();
-    registry.emplace<OverCurrentProtection>(line1_prot, 5.0, 200, "OC-L1P-Fast");
-    registry.emplace<DistanceProtection>(line1_prot, 5.0, 0, 15.0, 300, 25.0, 700);
+    protection_system.relays().emplace<OverCurrentProtection>(line1_prot, 5.0, 200, "OC-L1P-Fast");
+    protection_system.relays().emplace<DistanceProtection>(line1_prot, 5.0, 0, 15.0, 300, 25.0, 700);
+    protection_system.relays().emplace<OverCurrentProtection>(line1_prot, 1.0, OvercurrentCurve::IecVeryInverse, 0.5, "OC-L1P-IDMT");
     Entity transformer1_prot = registry.create();
-    registry.emplace<OverCurrentProtection>(transformer1_prot, 2.5, 300, "OC-T1P-Main");
+    protection_system.relays().emplace<OverCurrentProtection>(transformer1_prot, 2.5, 300, "OC-T1P-Main");
 
     if (g_console_logger)
         g_console_logger->info("Protection entities: Line1_Prot #{}, Transformer1_Prot #{}", line1_prot, transformer1_prot);
 
+    // Network behind the protected elements: grid infeed at the HV bus,
+    // Transformer1 HV -> MV and the 60 km Line1 MV -> feeder end, all
+    // referred to 220 kV. The relays measure at the from_bus end.
+    Entity hv_bus = registry.create();
+    Entity mv_bus = registry.create();
+    Entity feeder_end_bus = registry.create();
+    registry.emplace<BusComponent>(hv_bus, 220.0);
+    registry.emplace<BusComponent>(mv_bus, 220.0);
+    registry.emplace<BusComponent>(feeder_end_bus, 220.0);
+    registry.emplace<SourceComponent>(registry.create(), hv_bus, 220.0, std::complex<double>(0.2, 2.0));
+    registry.emplace<BranchComponent>(transformer1_prot, hv_bus, mv_bus, std::complex<double>(0.1, 4.0));
+    registry.emplace<BranchComponent>(line1_prot, mv_bus, feeder_end_bus, std::complex<double>(0.05, 0.4) * 60.0, 60.0);
+    NetworkModel network_model(registry);
+    const bool network_ready = network_model.build();
+    if (network_ready) {
+        protection_system.set_network(&network_model);
+        // Relays on the network act on 4 kHz sampled values (80 per cycle).
+        protection_system.set_sampled_values(4000.0);
+        // Fault levels along Line1: one factorization, then the cached Z-bus
+        // columns of the two line ends serve every location.
+        double line_min_kA = std::numeric_limits<double>::infinity(), line_max_kA = 0.0;
+        for (int step = 0; step <= 600; ++step) {
+            double fault_kA = std::abs(network_model.fault_on_branch(line1_prot, 0.1 * step).fault_current_kA);
+            line_min_kA = std::min(line_min_kA, fault_kA);
+            line_max_kA = std::max(line_max_kA, fault_kA);
+        }
+        if (g_console_logger) {
+            for (std::size_t b = 0; b < network_model.bus_count(); ++b)
+                g_console_logger->info("Network: bolted three-phase fault at Bus#{}: {:.2f} kA.", network_model.bus_entity(b),
+                    std::abs(network_model.fault_at_bus(network_model.bus_entity(b)).fault_current_kA));
+            g_console_logger->info("Network: Line1 faults 0-60 km: {:.2f}-{:.2f} kA ({} buses, {} factor nonzeros, {} factorization, {} column solves).",
+                line_min_kA, line_max_kA, network_model.bus_count(), network_model.factorization().factor_nonzeros(),
+                network_model.factorizations(), network_model.column_solves());
+        }
+    } else if (g_console_logger) {
+        g_console_logger->warn("Network: admittance matrix is singular; faults use the injected values.");
+    }
+
+    // COMTRADE round trip: a Line1 fault 10 km out, synthesized at the
+    // relays, is written as a COMTRADE record with each relay's pick-up and
+    // trip as digital channels, read back through the memory-mapped reader
+    // and replayed through the relays.
+    if (network_ready) {
+        const double rate_Hz = 4000.0;
+        FaultInfo recorded_fault;
+        recorded_fault.faulty_entity_id = line1_prot;
+        recorded_fault.distance_km = 10.0;
+        NetworkWaveformSource waveforms(network_model, network_model.fault_on_branch(line1_prot, 10.0), { line1_prot, transformer1_prot }, rate_Hz, 50.0, 1, 10);
+        std::vector<ProtectionSystem::SampledRelayChannels> channels(waveforms.relays().size());
+        for (std::size_t r = 0; r < channels.size(); ++r) {
+            channels[r].entity = waveforms.relays()[r];
+            for (std::size_t k = 0; k < NetworkWaveformSource::kChannelsPerRelay; ++k)
+                channels[r].channel[k] = r * NetworkWaveformSource::kChannelsPerRelay + k;
+        }
+        const auto simulated = protection_system.evaluate_sampled(waveforms, channels, waveforms.inception_frame(), recorded_fault);
+        waveforms.rewind();
+
+        ComtradeConfig record_config;
+        record_config.device = "Line1";
+        record_config.sample_rate_Hz = rate_Hz;
+        record_config.start_time_s = 6.0;
+        record_config.trigger_date = record_config.start_date;
+        record_config.trigger_time_s = record_config.start_time_s + static_cast<double>(waveforms.inception_frame()) / rate_Hz;
+        for (std::size_t ch = 0; ch < waveforms.channel_count(); ++ch) {
+            const std::string name = waveforms.channel_name(ch);
+            record_config.analog.push_back({ name, name.substr(name.size() - 1), name.substr(0, name.find('_')), waveforms.channel_unit(ch) });
+        }
+        for (std::size_t r = 0; r < simulated.size(); ++r) {
+            record_config.digital.push_back({ std::string(protection_system.relays().name(r)) + " PICKUP" });
+            record_config.digital.push_back({ std::string(protection_system.relays().name(r)) + " TRIP" });
+        }
+        ComtradeWriter writer;
+        std::vector<float> frame(waveforms.channel_count());
+        std::vector<std::uint8_t> status(record_config.digital.size());
+        const std::string record_path = output_path("protection_line1_fault");
+        bool written = writer.open(record_path, record_config);
+        for (std::size_t n = 0; written && waveforms.read(frame) == 1; ++n) {
+            const double after_inception_ms = (static_cast<double>(n + 1) - static_cast<double>(waveforms.inception_frame())) * 1000.0 / rate_Hz;
+            for (std::size_t r = 0; r < simulated.size(); ++r) {
+                const bool picked_up = simulated[r].pickup_ms >= 0.0 && after_inception_ms >= simulated[r].pickup_ms;
+                status[2 * r] = picked_up;
+                status[2 * r + 1] = picked_up && after_inception_ms >= simulated[r].trip_delay_ms;
+            }
+            written = writer.write(frame, status);
+        }
+        written = writer.close() && written;
+
+        ComtradeRecord record;
+        if (!written || !record.open(record_path + ".cfg")) {
+            if (g_console_logger)
+                g_console_logger->warn("COMTRADE: {}", written ? record.error() : writer.error());
+        } else {
+            for (auto& relay : channels)
+                for (std::size_t k = 0; k < NetworkWaveformSource::kChannelsPerRelay; ++k)
+                    relay.channel[k] = static_cast<std::size_t>(record.analog_index(waveforms.channel_name(relay.channel[k])));
+            const auto replayed = protection_system.evaluate_sampled(record, channels, record.trigger_frame(), recorded_fault);
+            if (g_console_logger) {
+                g_console_logger->info("COMTRADE: wrote {}.cfg/.dat ({} analog, {} digital channels, {} frames at {} Hz).",
+                    record_path, record.channel_count(), record.digital_count(), record.frame_count(), record.sample_rate_Hz());
+                for (std::size_t r = 0; r < replayed.size(); ++r) {
+                    if (!replayed[r].measured)
+                        continue;
+                    g_console_logger->info("COMTRADE replay: {} picks up after {:.2f} ms (simulated {:.2f} ms), trip delay {} ms (simulated {} ms).",
+                        replayed[r].protection, replayed[r].pickup_ms, simulated[r].pickup_ms, replayed[r].trip_delay_ms, simulated[r].trip_delay_ms);
+                }
+            }
+        }
+    }
+
     auto prot_sys_run_task = protection_system.run();
     prot_sys_run_task.detach();
     // MODIFICATION: Pass scheduler_instance as the last argument
     auto fault_inject_prot_task = faultInjectorTask_prot(protection_system, line1_prot, transformer1_prot, scheduler_instance);
     fault_inject_prot_task.detach();
-    auto breaker_l1p_task = circuitBreakerAgentTask_prot(line1_prot, "Line1_P", scheduler_instance);
-    breaker_l1p_task.detach();
-    auto breaker_t1p_task = circuitBreakerAgentTask_prot(transformer1_prot, "T1_P", scheduler_instance);
-    breaker_t1p_task.detach();
+    // Breakers of the protection demo.
+    BreakerSystem breaker_system(scheduler_instance);
+    breaker_system.add(line1_prot, {}, "Line1_P");
+    breaker_system.add(transformer1_prot, {}, "T1_P");
+    breaker_system.start();
+    auto network_topology_task = networkTopologyTask_prot(network_model, scheduler_instance, protection_system.reach_index());
+    network_topology_task.detach();
+    auto network_reclosing_task = networkReclosingTask_prot(network_model, scheduler_instance, protection_system.reach_index());
+    network_reclosing_task.detach();
     if (g_console_logger)
         g_console_logger->info("Protection system tasks started.");
 
@@ -181,19 +452,217 @@ int main()
         g_console_logger->info("Initialized {} ESS units for frequency response.", num_ess_units);
 
     double freq_sim_step_ms = 20.0;
-    auto freq_oracle_task_main = frequencyOracleTask(registry, ev_pile_entities_freq, ess_unit_entities_freq, 5.0, freq_sim_step_ms);
-    freq_oracle_task_main.detach();
 
-    auto ev_vpp_task_main = vppFrequencyResponseTask(registry, "EV_VPP", ev_pile_entities_freq, freq_sim_step_ms);
-    ev_vpp_task_main.detach();
-    auto ess_vpp_task_main = vppFrequencyResponseTask(registry, "ESS_VPP", ess_unit_entities_freq, freq_sim_step_ms);
-    ess_vpp_task_main.detach();
+    // Hierarchical mode dispatches through station groups: EV piles by charging
+    // station, ESS units in groups of ess_units_per_station.
+    const bool use_hierarchical_vpp_dispatch = true;
+    int ess_units_per_station = 10;
+    auto make_hierarchical_vpp = [&](const std::vector<Entity>& devices, int devices_per_station) {
+        std::vector<Entity> stations;
+        for (size_t first = 0; first < devices.size(); first += devices_per_station) {
+            size_t last = std::min(devices.size(), first + static_cast<size_t>(devices_per_station));
+            Entity station = registry.create();
+            registry.emplace<VppStationComponent>(station, std::vector<Entity>(devices.begin() + first, devices.begin() + last));
+            stations.push_back(station);
+        }
+        Entity vpp = registry.create();
+        registry.emplace<VppAggregateComponent>(vpp, std::move(stations));
+        return vpp;
+    };
+
+    std::vector<Entity> vpp_entities;
+    if (use_hierarchical_vpp_dispatch) {
+        Entity ev_vpp = make_hierarchical_vpp(ev_pile_entities_freq, piles_per_station);
+        Entity ess_vpp = make_hierarchical_vpp(ess_unit_entities_freq, ess_units_per_station);
+        vpp_entities = { ev_vpp, ess_vpp };
+        auto ev_vpp_task_main = vppHierarchicalResponseTask(registry, "EV_VPP", ev_vpp, freq_sim_step_ms);
+        ev_vpp_task_main.detach();
+        auto ess_vpp_task_main = vppHierarchicalResponseTask(registry, "ESS_VPP", ess_vpp, freq_sim_step_ms);
+        ess_vpp_task_main.detach();
+    } else {
+        Entity ev_vpp = registry.create();
+        registry.emplace<VppDeviceAggregateComponent>(ev_vpp, ev_pile_entities_freq);
+        Entity ess_vpp = registry.create();
+        registry.emplace<VppDeviceAggregateComponent>(ess_vpp, ess_unit_entities_freq);
+        vpp_entities = { ev_vpp, ess_vpp };
+        auto ev_vpp_task_main = vppFrequencyResponseTask(registry, "EV_VPP", ev_vpp, freq_sim_step_ms);
+        ev_vpp_task_main.detach();
+        auto ess_vpp_task_main = vppFrequencyResponseTask(registry, "ESS_VPP", ess_vpp, freq_sim_step_ms);
+        ess_vpp_task_main.detach();
+    }
+
+    // Multi-rate layers: 20 ms primary response, AGC, economic redispatch and
+    // SOC scheduling. Slow layers run on windowed/aggregate state; the primary
+    // layer only reads their held outputs. The AGC request is recorded, not
+    // applied to the VPPs.
+    // Set multi_rate_reference_run to run every layer at freq_sim_step_ms;
+    // the multi_rate_matches_single_rate test compares the two over an hour.
+    const bool multi_rate_reference_run = false;
+    MultiRateCoordinator rate_layers;
+    if (multi_rate_reference_run)
+        rate_layers.force_single_rate(cps_coro::Scheduler::duration(static_cast<long long>(freq_sim_step_ms)));
+
+    FrequencyControlLayers frequency_control;
+
+    // Results go to binary columnar files written by background threads.
+    // Arrow IPC files open directly in pyarrow/pandas/polars (memory-mapped);
+    // with ColumnarFileFormat::Native use hecs_columnar_to_csv instead.
+    const ColumnarFileFormat result_format = ColumnarFileFormat::ArrowIpcFile;
+    const std::string frequency_results_path = output_path(std::string("vpp_freq_response_data") + columnar_file_extension(result_format));
+    const std::string device_states_path = output_path(std::string("vpp_device_states") + columnar_file_extension(result_format));
+    ColumnarRecorder frequency_results(frequency_result_schema());
+    if (!frequency_results.open(frequency_results_path, result_format) && g_console_logger)
+        g_console_logger->warn("Frequency results will not be recorded: {}", frequency_results.error());
+    VppDeviceStateRecorder device_state_snapshots(registry, vpp_entities);
+    ColumnarRecorder device_states(device_state_snapshots.schema());
+    if (!device_states.open(device_states_path, result_format) && g_console_logger)
+        g_console_logger->warn("Device states will not be recorded: {}", device_states.error());
+
+    add_frequency_control_layers(rate_layers, frequency_control, registry, vpp_entities,
+        cps_coro::Scheduler::duration(static_cast<long long>(freq_sim_step_ms)), &frequency_results);
+    rate_layers.add_layer("device_recording", std::chrono::seconds(1), [&](double now_s, double /*dt_s*/) {
+        device_state_snapshots.record(device_states, now_s);
+    });
+
+    // Per-device power and SOC as seen by the recorders below: the
+    // components themselves lag behind under lazy dispatch, so both read
+    // the snapshot view, refreshed before every sample.
+    struct DeviceClass {
+        const char* name;
+        std::vector<Entity> entities;
+        std::vector<const double*> power_kW;
+        std::vector<const double*> soc;
+    };
+    DeviceClass device_classes[] = { { "EV_PILE", {}, {}, {} }, { "ESS_UNIT", {}, {}, {} } };
+    for (std::size_t i = 0; i < device_state_snapshots.device_count(); ++i) {
+        Entity device = device_state_snapshots.device_entity(i);
+        bool is_pile = registry.get<FrequencyControlConfigComponent>(device)->type == FrequencyControlConfigComponent::DeviceType::EV_PILE;
+        DeviceClass& device_class = device_classes[is_pile ? 0 : 1];
+        device_class.entities.push_back(device);
+        device_class.power_kW.push_back(&device_state_snapshots.power_kW()[i]);
+        device_class.soc.push_back(&device_state_snapshots.soc()[i]);
+    }
+
+    // Compressed per-device signals at the primary rate: power changes beyond
+    // a deadband, SOC as swinging-door segments, both at least every 10 s.
+    const std::string device_signals_path = output_path(std::string("vpp_device_signals") + columnar_file_extension(result_format));
+    SignalRecorder device_signals;
+    for (const DeviceClass& device_class : device_classes) {
+        device_signals.subscribe(device_class.entities, device_class.power_kW, "current_power_kW",
+            SignalSettings { SignalCompression::Deadband, 0.05, 10.0 });
+        device_signals.subscribe(device_class.entities, device_class.soc, "soc",
+            SignalSettings { SignalCompression::SwingingDoor, 0.0005, 10.0 });
+    }
+    if (!device_signals.open_spill(device_signals_path, result_format) && g_console_logger)
+        g_console_logger->warn("Device signals will only be kept in memory: {}", device_signals.error());
+    rate_layers.add_layer("signal_recording", cps_coro::Scheduler::duration(static_cast<long long>(freq_sim_step_ms)),
+        [&](double now_s, double /*dt_s*/) {
+            device_state_snapshots.refresh(now_s);
+            device_signals.sample(now_s);
+        });
+
+    // Online statistics per device, station, VPP and device class; only the
+    // summaries are written at the end of the run.
+    const double kW_to_kWh = 1.0 / 3600.0;
+    const std::vector<std::string> vpp_names = { "EV_VPP", "ESS_VPP" };
+    const std::string statistics_path = output_path("vpp_signal_statistics.csv");
+    SignalStatistics run_statistics;
+    std::vector<std::size_t> vpp_power_statistics;
+    for (std::size_t v = 0; v < vpp_entities.size(); ++v) {
+        Entity vpp = vpp_entities[v];
+        vpp_power_statistics.push_back(run_statistics.add_signal(vpp_names[v] + " total_power_kW",
+            [&registry, vpp] { return vpp_total_power_kW(registry, vpp); }, kW_to_kWh));
+        // Members hold their power between dispatches, so station sums can
+        // read the components.
+        if (auto* hierarchy = registry.get<VppAggregateComponent>(vpp)) {
+            for (Entity station : hierarchy->stations)
+                run_statistics.add_sum_signal(registry, registry.get<VppStationComponent>(station)->members,
+                    &PhysicalStateComponent::current_power_kW, "station#" + std::to_string(station) + " power_kW", kW_to_kWh);
+        }
+    }
+    for (const DeviceClass& device_class : device_classes) {
+        std::vector<std::size_t> power_signals, soc_signals;
+        for (std::size_t d = 0; d < device_class.entities.size(); ++d) {
+            const std::string suffix = "#" + std::to_string(device_class.entities[d]);
+            power_signals.push_back(run_statistics.add_signal("current_power_kW" + suffix, { device_class.power_kW[d] }, kW_to_kWh));
+            soc_signals.push_back(run_statistics.add_signal("soc" + suffix, { device_class.soc[d] }));
+        }
+        run_statistics.add_group(std::string(device_class.name) + " current_power_kW", std::move(power_signals));
+        run_statistics.add_group(std::string(device_class.name) + " soc", std::move(soc_signals));
+    }
+    rate_layers.add_layer("statistics", cps_coro::Scheduler::duration(static_cast<long long>(freq_sim_step_ms)),
+        [&](double now_s, double /*dt_s*/) {
+            device_state_snapshots.refresh(now_s);
+            run_statistics.sample(now_s);
+        });
+    auto rate_layers_task = rate_layers.run();
+    rate_layers_task.detach();
     if (g_console_logger)
         g_console_logger->info("Frequency-power response system tasks started.");
 
     auto gen_task_main = generatorTask();
     gen_task_main.detach();
-    auto load_task_main = loadTask();
+    // Demo per-bus load profile: 200 buses at 500 ms resolution with steps at
+    // 1.5 s and 11.5 s. Real studies point this at year-long profile files.
+    const std::string load_profile_path = output_path("demo_bus_load_profile.bin");
+    const std::size_t profile_buses = 200;
+    write_profile_file(load_profile_path, ProfileKind::BusLoad_kW, profile_buses, 141, 0, 500,
+        [&](std::size_t sample_index, std::span<float> row) {
+            double t_ms = static_cast<double>(sample_index) * 500.0;
+            double level = 1.0 + (t_ms >= 1500.0 ? 0.1 : 0.0) + (t_ms >= 11500.0 ? 0.3 : 0.0);
+            for (std::size_t bus = 0; bus < row.size(); ++bus)
+                row[bus] = static_cast<float>((50.0 + 10.0 * (bus % 7)) * level);
+        });
+    TimeSeriesProfile load_profile;
+    const TimeSeriesProfile* active_load_profile = nullptr;
+    if (load_profile.open(load_profile_path)) {
+        active_load_profile = &load_profile;
+    } else if (g_console_logger) {
+        g_console_logger->warn("Load profile unavailable ({}); using fixed load steps.", load_profile.error());
+    }
+    // Distribution area behind the load profile: four 10 kV feeders, each a
+    // 25-bus trunk of 0.3 km sections with a lateral bus off every trunk
+    // bus. Profile channel i is the load at the i-th feeder bus.
+    std::vector<LoadComponent*> profile_loads;
+    for (std::size_t feeder = 0; feeder * 50 < profile_buses; ++feeder) {
+        Entity substation_bus = registry.create();
+        registry.emplace<BusComponent>(substation_bus, 10.0);
+        registry.emplace<SourceComponent>(registry.create(), substation_bus, 10.5, std::complex<double>(0.05, 0.5));
+        std::vector<Entity> trunk;
+        for (int k = 0; k < 50; ++k) {
+            Entity bus = registry.create();
+            registry.emplace<BusComponent>(bus, 10.0);
+            Entity upstream = k < 25 ? (k == 0 ? substation_bus : trunk.back()) : trunk[k - 25];
+            registry.emplace<BranchComponent>(registry.create(), upstream, bus, std::complex<double>(0.27, 0.35) * 0.3, 0.3);
+            if (k < 25)
+                trunk.push_back(bus);
+            profile_loads.push_back(&registry.emplace<LoadComponent>(registry.create(), bus));
+        }
+    }
+    RadialPowerFlow distribution_power_flow(registry);
+    distribution_power_flow.build();
+    auto power_flow_task_main = powerFlowTask(distribution_power_flow, profile_loads);
+    power_flow_task_main.detach();
+
+    // The whole network (transmission protection area and distribution
+    // feeders) in one Newton-Raphson model, kept up to date by events.
+    NewtonPowerFlow network_power_flow(registry);
+    network_power_flow.mode = NewtonMode::Dishonest;
+    network_power_flow.build();
+    auto newton_load_task = newtonLoadTask(network_power_flow);
+    newton_load_task.detach();
+    auto newton_topology_task = newtonTopologyTask(network_power_flow);
+    newton_topology_task.detach();
+    if (g_console_logger)
+        g_console_logger->info("Newton power flow: {} buses, {} branches, Jacobian {} nonzeros, {} in the factors.",
+            network_power_flow.bus_count(), network_power_flow.branch_count(), network_power_flow.jacobian().nonzeros(),
+            network_power_flow.jacobian_factors().factor_nonzeros());
+
+    if (active_load_profile) {
+        auto load_monitor_task = loadMonitorTask(*active_load_profile);
+        load_monitor_task.detach();
+    }
+    auto load_task_main = loadTask(active_load_profile);
     load_task_main.detach();
     if (g_console_logger)
         g_console_logger->info("General background tasks started.");
@@ -216,6 +685,12 @@ int main()
         g_console_logger->info("Real execution time: {:.3f} seconds.", real_time_elapsed_seconds.count());
     }
 
+    if (g_console_logger) {
+        for (std::size_t i = 0; i < rate_layers.layer_count(); ++i)
+            g_console_logger->info("Layer '{}' ({} ms) ran {} times.",
+                rate_layers.layer_name(i), rate_layers.layer_period(i).count(), rate_layers.layer_steps(i));
+    }
+
     long peak_mem_kb = get_peak_memory_usage_kb();
     if (peak_mem_kb != -1 && g_console_logger) {
         g_console_logger->info("Peak memory usage (approx.): {} KB ({:.2f} MB).", peak_mem_kb, peak_mem_kb / 1024.0);
@@ -223,8 +698,32 @@ int main()
         g_console_logger->warn("Could not retrieve peak memory usage for this platform.");
     }
 
-    if (g_console_logger)
-        g_console_logger->info("VPP frequency response data saved to configured file.");
+    frequency_results.close();
+    device_states.close();
+    device_signals.flush();
+    if (g_console_logger) {
+        g_console_logger->info("VPP frequency response data: {} rows saved to '{}'.", frequency_results.rows_committed(), frequency_results_path);
+        g_console_logger->info("Device states: {} snapshots of {} devices saved to '{}'.",
+            device_states.rows_committed(), device_state_snapshots.device_count(), device_states_path);
+        g_console_logger->info("Device signals: {} archived points from {} samples of {} signals saved to '{}'.",
+            device_signals.points_archived(), device_signals.samples_seen() * device_signals.signal_count(),
+            device_signals.signal_count(), device_signals_path);
+    }
+    if (!run_statistics.write_report(statistics_path) && g_console_logger)
+        g_console_logger->warn("Could not write signal statistics to '{}'.", statistics_path);
+    if (g_console_logger) {
+        auto log_summary = [](const std::string& name, const SignalSummary& summary) {
+            g_console_logger->info("{}: mean {:.4f} (sd {:.4f}), min {:.4f} at {:.2f} s, max {:.4f} at {:.2f} s, p5/p50/p95 {:.4f}/{:.4f}/{:.4f}, integral {:.4f}",
+                name, summary.moments.mean, summary.moments.stddev(), summary.min, summary.min_time_s, summary.max, summary.max_time_s,
+                summary.digest.quantile(0.05), summary.digest.quantile(0.5), summary.digest.quantile(0.95), summary.integral);
+        };
+        for (std::size_t signal : vpp_power_statistics)
+            log_summary(run_statistics.signal_name(signal), run_statistics.summary(signal));
+        for (std::size_t group = 0; group < run_statistics.group_count(); ++group)
+            log_summary(run_statistics.group_name(group), run_statistics.group_summary(group));
+        g_console_logger->info("Signal statistics: {} signals x {} samples summarized in '{}'.",
+            run_statistics.signal_count(), run_statistics.samples_seen(), statistics_path);
+    }
     shutdown_loggers();
 
     return 0;
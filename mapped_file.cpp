@@ -0,0 +1,176 @@
+// mapped_file.cpp
+#include "mapped_file.h"
+#include <algorithm>
+#include <utility>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+{
+    *this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+    if (this != &other) {
+        close();
+        data_ = std::exchange(other.data_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+        open_ = std::exchange(other.open_, false);
+        error_ = std::move(other.error_);
+#if defined(_WIN32)
+        file_handle_ = std::exchange(other.file_handle_, nullptr);
+        mapping_handle_ = std::exchange(other.mapping_handle_, nullptr);
+#endif
+    }
+    return *this;
+}
+
+#if defined(_WIN32)
+
+bool MappedFile::open(const std::string& path, AccessHint hint)
+{
+    close();
+    DWORD flags = FILE_ATTRIBUTE_NORMAL;
+    if (hint == AccessHint::Sequential)
+        flags |= FILE_FLAG_SEQUENTIAL_SCAN;
+    else if (hint == AccessHint::Random)
+        flags |= FILE_FLAG_RANDOM_ACCESS;
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, flags, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        error_ = "cannot open '" + path + "'";
+        return false;
+    }
+    LARGE_INTEGER file_size;
+    GetFileSizeEx(file, &file_size);
+    size_ = static_cast<std::size_t>(file_size.QuadPart);
+    file_handle_ = file;
+    open_ = true;
+    if (size_ == 0)
+        return true;
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping) {
+        error_ = "cannot map '" + path + "'";
+        close();
+        return false;
+    }
+    mapping_handle_ = mapping;
+    data_ = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!data_) {
+        error_ = "cannot map '" + path + "'";
+        close();
+        return false;
+    }
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (data_)
+        UnmapViewOfFile(data_);
+    if (mapping_handle_)
+        CloseHandle(static_cast<HANDLE>(mapping_handle_));
+    if (file_handle_)
+        CloseHandle(static_cast<HANDLE>(file_handle_));
+    data_ = nullptr;
+    mapping_handle_ = nullptr;
+    file_handle_ = nullptr;
+    size_ = 0;
+    open_ = false;
+}
+
+void MappedFile::prefetch(std::size_t, std::size_t) const { }
+void MappedFile::release(std::size_t, std::size_t) const { }
+
+#else
+
+bool MappedFile::open(const std::string& path, AccessHint hint)
+{
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        error_ = "cannot open '" + path + "': " + std::strerror(errno);
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        error_ = "cannot stat '" + path + "': " + std::strerror(errno);
+        ::close(fd);
+        return false;
+    }
+    size_ = static_cast<std::size_t>(st.st_size);
+    open_ = true;
+    if (size_ > 0) {
+        void* p = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+        if (p == MAP_FAILED) {
+            error_ = "cannot map '" + path + "': " + std::strerror(errno);
+            ::close(fd);
+            size_ = 0;
+            open_ = false;
+            return false;
+        }
+        data_ = p;
+        if (hint == AccessHint::Sequential)
+            madvise(data_, size_, MADV_SEQUENTIAL);
+        else if (hint == AccessHint::Random)
+            madvise(data_, size_, MADV_RANDOM);
+    }
+    ::close(fd); // The mapping keeps its own reference to the file.
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (data_)
+        munmap(data_, size_);
+    data_ = nullptr;
+    size_ = 0;
+    open_ = false;
+}
+
+namespace {
+
+// madvise needs page-aligned ranges; round inward/outward as appropriate.
+std::size_t page_size()
+{
+    static const std::size_t size = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    return size;
+}
+
+} // namespace
+
+void MappedFile::prefetch(std::size_t offset, std::size_t length) const
+{
+    if (!data_ || offset >= size_)
+        return;
+    std::size_t begin = offset / page_size() * page_size();
+    std::size_t end = std::min(size_, offset + length);
+    madvise(static_cast<char*>(data_) + begin, end - begin, MADV_WILLNEED);
+}
+
+void MappedFile::release(std::size_t offset, std::size_t length) const
+{
+    if (!data_ || offset >= size_)
+        return;
+    // Only whole pages inside the range may be dropped.
+    std::size_t begin = (offset + page_size() - 1) / page_size() * page_size();
+    std::size_t end = std::min(size_, offset + length) / page_size() * page_size();
+    if (end > begin)
+        madvise(static_cast<char*>(data_) + begin, end - begin, MADV_DONTNEED);
+}
+
+#endif
@@ -0,0 +1,49 @@
+// mapped_file.h
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+
+// Read-only memory mapping of a whole file. Pages are faulted in by the OS
+// on access, so large inputs are never read into RAM wholesale.
+class MappedFile {
+public:
+    enum class AccessHint { Normal,
+        Sequential,
+        Random };
+
+    MappedFile() = default;
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    // Returns false and fills error() on failure.
+    bool open(const std::string& path, AccessHint hint = AccessHint::Normal);
+    void close();
+
+    bool is_open() const { return open_; }
+    const unsigned char* data() const { return static_cast<const unsigned char*>(data_); }
+    std::size_t size() const { return size_; }
+    const std::string& error() const { return error_; }
+
+    // Hints the OS to read [offset, offset+length) ahead of use.
+    void prefetch(std::size_t offset, std::size_t length) const;
+    // Lets the OS drop already-consumed pages in [offset, offset+length) from
+    // the resident set; they are re-read from the file if touched again.
+    void release(std::size_t offset, std::size_t length) const;
+
+private:
+    void* data_ = nullptr;
+    std::size_t size_ = 0;
+    bool open_ = false;
+    std::string error_;
+#if defined(_WIN32)
+    void* file_handle_ = nullptr;
+    void* mapping_handle_ = nullptr;
+#endif
+};
+
+#endif // MAPPED_FILE_H
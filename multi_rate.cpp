@@ -0,0 +1,73 @@
+// multi_rate.cpp
+#include "multi_rate.h"
+#include "logging_utils.h"
+#include <numeric>
+
+extern cps_coro::Scheduler* g_scheduler;
+
+std::size_t MultiRateCoordinator::add_layer(std::string name, duration period, StepFn step)
+{
+    if (period <= duration::zero()) {
+        HECS_LOG_WARN(LogSubsystem::MultiRate, "[MultiRate] Layer '{}' rejected: period {} ms is not positive.", name, period.count());
+        return kNoLayer;
+    }
+    layers_.push_back(Layer { std::move(name), period, std::move(step) });
+    return layers_.size() - 1;
+}
+
+void MultiRateCoordinator::force_single_rate(std::optional<duration> period)
+{
+    if (period && *period <= duration::zero()) {
+        HECS_LOG_WARN(LogSubsystem::MultiRate, "[MultiRate] Single-rate period {} ms ignored: not positive.", period->count());
+        return;
+    }
+    single_rate_ = period;
+}
+
+MultiRateCoordinator::duration MultiRateCoordinator::layer_period(std::size_t i) const
+{
+    return single_rate_ ? *single_rate_ : layers_[i].period;
+}
+
+cps_coro::Task MultiRateCoordinator::run()
+{
+    if (!g_scheduler || layers_.empty())
+        co_return;
+
+    // Slowest first for coincident ticks.
+    std::vector<std::size_t> order(layers_.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) {
+        return layers_[a].period > layers_[b].period;
+    });
+
+    auto start = g_scheduler->now();
+    for (std::size_t i = 0; i < layers_.size(); ++i) {
+        layers_[i].last_run = start;
+        layers_[i].next_due = start + layer_period(i);
+    }
+
+    for (std::size_t k = 0; k < order.size(); ++k)
+        HECS_LOG_INFO(LogSubsystem::MultiRate, "[{}ms] [MultiRate] Layer '{}' every {} ms.",
+            start.time_since_epoch().count(), layers_[order[k]].name, layer_period(order[k]).count());
+
+    while (true) {
+        auto next = layers_[0].next_due;
+        for (const auto& layer : layers_)
+            next = std::min(next, layer.next_due);
+        co_await cps_coro::delay(next - g_scheduler->now());
+
+        auto now = g_scheduler->now();
+        double now_s = now.time_since_epoch().count() / 1000.0;
+        for (std::size_t i : order) {
+            Layer& layer = layers_[i];
+            if (layer.next_due > now)
+                continue;
+            double dt_s = (now - layer.last_run).count() / 1000.0;
+            layer.step(now_s, dt_s);
+            layer.last_run = now;
+            layer.next_due += layer_period(i);
+            ++layer.steps_run;
+        }
+    }
+}
@@ -0,0 +1,455 @@
+// network_model.cpp
+#include "network_model.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+const double kSqrt3 = std::sqrt(3.0);
+
+} // namespace
+
+BusComponent::BusComponent(double nominal)
+    : nominal_kV(nominal)
+{
+}
+
+BranchComponent::BranchComponent(Entity from, Entity to, std::complex<double> impedance, double length)
+    : from_bus(from)
+    , to_bus(to)
+    , impedance_Ohm(impedance)
+    , length_km(length)
+{
+}
+
+SourceComponent::SourceComponent(Entity at_bus, double voltage, std::complex<double> impedance)
+    : bus(at_bus)
+    , voltage_kV(voltage)
+    , impedance_Ohm(impedance)
+{
+}
+
+LoadComponent::LoadComponent(Entity at_bus, double p, double q)
+    : bus(at_bus)
+    , p_kW(p)
+    , q_kvar(q)
+{
+}
+
+NetworkModel::NetworkModel(Registry& reg)
+    : registry_(reg)
+{
+}
+
+bool NetworkModel::build()
+{
+    // Entities are sorted so the bus numbering, and with it the ordering and
+    // the factors, do not depend on hash-map iteration order.
+    buses_.clear();
+    registry_.for_each<BusComponent>([&](BusComponent&, Entity e) { buses_.push_back(e); });
+    std::sort(buses_.begin(), buses_.end());
+    bus_index_.clear();
+    for (std::size_t b = 0; b < buses_.size(); ++b)
+        bus_index_[buses_[b]] = static_cast<int>(b);
+
+    branches_.clear();
+    registry_.for_each<BranchComponent>([&](BranchComponent& branch, Entity e) {
+        int from = bus_index(branch.from_bus);
+        int to = bus_index(branch.to_bus);
+        if (from >= 0 && to >= 0 && from != to)
+            branches_.push_back({ e, from, to, branch.impedance_Ohm, branch.length_km, branch.closed, -1, -1 });
+    });
+    std::sort(branches_.begin(), branches_.end(), [](const Branch& a, const Branch& b) { return a.entity < b.entity; });
+    branch_index_.clear();
+    for (std::size_t k = 0; k < branches_.size(); ++k)
+        branch_index_[branches_[k].entity] = static_cast<int>(k);
+
+    const int n = static_cast<int>(buses_.size());
+    incident_.assign(n, {});
+    for (std::size_t k = 0; k < branches_.size(); ++k) {
+        incident_[branches_[k].from].push_back(static_cast<int>(k));
+        incident_[branches_[k].to].push_back(static_cast<int>(k));
+    }
+    // Sources are shunts behind their impedance; E / Zs is the Norton
+    // injection that gives the no-load pre-fault voltages.
+    source_admittance_S_.assign(n, {});
+    source_injection_kA_.assign(n, {});
+    source_count_.assign(n, 0);
+    registry_.for_each<SourceComponent>([&](SourceComponent& source, Entity) {
+        int b = bus_index(source.bus);
+        if (b < 0)
+            return;
+        const std::complex<double> y = 1.0 / source.impedance_Ohm;
+        source_admittance_S_[b] += y;
+        source_injection_kA_[b] += y * (source.voltage_kV / kSqrt3);
+        ++source_count_[b];
+    });
+
+    island_.assign(n, -1);
+    island_size_.clear();
+    island_sources_.clear();
+    island_count_ = 0;
+    visit_mark_.assign(n, 0);
+    std::vector<int> members;
+    for (int b = 0; b < n; ++b) {
+        if (island_[b] >= 0)
+            continue;
+        collect_island(b, members);
+        int sources = 0;
+        for (int m : members) {
+            island_[m] = static_cast<int>(island_size_.size());
+            sources += source_count_[m];
+        }
+        island_size_.push_back(static_cast<int>(members.size()));
+        island_sources_.push_back(sources);
+        ++island_count_;
+    }
+
+    std::vector<int> row, col;
+    for (int b = 0; b < n; ++b) {
+        row.push_back(b);
+        col.push_back(b);
+    }
+    for (const Branch& branch : branches_) {
+        row.insert(row.end(), { branch.from, branch.to });
+        col.insert(col.end(), { branch.to, branch.from });
+    }
+    y_bus_ = csr_from_triplets(n, row, col, std::vector<std::complex<double>>(row.size()));
+    diagonal_entry_.assign(n, -1);
+    for (int b = 0; b < n; ++b)
+        diagonal_entry_[b] = static_cast<int>(y_bus_.find(b, b));
+    for (Branch& branch : branches_) {
+        branch.from_to_entry = static_cast<int>(y_bus_.find(branch.from, branch.to));
+        branch.to_from_entry = static_cast<int>(y_bus_.find(branch.to, branch.from));
+    }
+    for (int b = 0; b < n; ++b)
+        update_row(b);
+
+    lu_.analyze(y_bus_);
+    ++factorizations_;
+    zbus_columns_.assign(n, {});
+    result_ = NetworkFaultResult {};
+    if (!lu_.factorize(y_bus_))
+        return false;
+    solve_prefault();
+    return true;
+}
+
+void NetworkModel::update_row(int bus)
+{
+    for (int e = y_bus_.row_ptr[bus]; e < y_bus_.row_ptr[bus + 1]; ++e)
+        y_bus_.values[e] = {};
+    if (!energized(bus)) {
+        y_bus_.values[diagonal_entry_[bus]] = 1.0; // Decoupled, V = 0
+        return;
+    }
+    std::complex<double>& diagonal = y_bus_.values[diagonal_entry_[bus]];
+    diagonal = source_admittance_S_[bus];
+    for (int k : incident_[bus]) {
+        const Branch& branch = branches_[k];
+        if (!branch.closed)
+            continue;
+        const std::complex<double> y = 1.0 / branch.impedance_Ohm;
+        diagonal += y;
+        y_bus_.values[bus == branch.from ? branch.from_to_entry : branch.to_from_entry] -= y;
+    }
+}
+
+void NetworkModel::solve_prefault()
+{
+    prefault_kV_.resize(buses_.size());
+    for (std::size_t b = 0; b < buses_.size(); ++b)
+        prefault_kV_[b] = energized(static_cast<int>(b)) ? source_injection_kA_[b] : std::complex<double> {};
+    lu_.solve(prefault_kV_);
+}
+
+void NetworkModel::collect_island(int start, std::vector<int>& out)
+{
+    const unsigned stamp = ++visit_stamp_;
+    out.assign(1, start);
+    visit_mark_[start] = stamp;
+    for (std::size_t head = 0; head < out.size(); ++head) {
+        for (int k : incident_[out[head]]) {
+            const Branch& branch = branches_[k];
+            const int other = branch.from == out[head] ? branch.to : branch.from;
+            if (branch.closed && visit_mark_[other] != stamp) {
+                visit_mark_[other] = stamp;
+                out.push_back(other);
+            }
+        }
+    }
+}
+
+bool NetworkModel::split_island(int a, int b, std::vector<int>& changed_rows)
+{
+    visit_stamp_ += 2;
+    const unsigned stamp[2] = { visit_stamp_ - 1, visit_stamp_ };
+    std::vector<int> side[2] = { { a }, { b } };
+    std::size_t head[2] = { 0, 0 };
+    visit_mark_[a] = stamp[0];
+    visit_mark_[b] = stamp[1];
+    int separated = -1;
+    while (separated < 0) {
+        for (int s = 0; s < 2 && separated < 0; ++s) {
+            if (head[s] == side[s].size()) {
+                separated = s; // Side s is a whole island
+                break;
+            }
+            const int node = side[s][head[s]++];
+            for (int k : incident_[node]) {
+                const Branch& branch = branches_[k];
+                if (!branch.closed)
+                    continue;
+                const int other = branch.from == node ? branch.to : branch.from;
+                if (visit_mark_[other] == stamp[1 - s])
+                    return true;
+                if (visit_mark_[other] != stamp[s]) {
+                    visit_mark_[other] = stamp[s];
+                    side[s].push_back(other);
+                }
+            }
+        }
+    }
+
+    const int old_label = island_[a];
+    const int new_label = static_cast<int>(island_size_.size());
+    int moved_sources = 0;
+    for (int bus : side[separated]) {
+        island_[bus] = new_label;
+        moved_sources += source_count_[bus];
+    }
+    const int old_sources = island_sources_[old_label];
+    island_size_.push_back(static_cast<int>(side[separated].size()));
+    island_sources_.push_back(moved_sources);
+    island_size_[old_label] -= static_cast<int>(side[separated].size());
+    island_sources_[old_label] -= moved_sources;
+    ++island_count_;
+
+    // Buses of a side left without a source are de-energized.
+    if (old_sources > 0 && moved_sources == 0) {
+        changed_rows.insert(changed_rows.end(), side[separated].begin(), side[separated].end());
+    } else if (old_sources > 0 && island_sources_[old_label] == 0) {
+        std::vector<int> remaining;
+        collect_island(separated == 0 ? b : a, remaining);
+        changed_rows.insert(changed_rows.end(), remaining.begin(), remaining.end());
+    }
+    return false;
+}
+
+void NetworkModel::merge_islands(int a, int b, std::vector<int>& changed_rows)
+{
+    // Runs before the branch is closed, so the traversal stays in one island.
+    int keep = island_[a], absorb = island_[b];
+    int absorb_start = b, keep_start = a;
+    if (keep == absorb)
+        return;
+    if (island_size_[absorb] > island_size_[keep]) {
+        std::swap(keep, absorb);
+        std::swap(keep_start, absorb_start);
+    }
+    std::vector<int> members;
+    collect_island(absorb_start, members);
+    for (int bus : members)
+        island_[bus] = keep;
+    // Buses of a source-less island joined to a live one are energized.
+    if (island_sources_[keep] > 0 && island_sources_[absorb] == 0) {
+        changed_rows.insert(changed_rows.end(), members.begin(), members.end());
+    } else if (island_sources_[keep] == 0 && island_sources_[absorb] > 0) {
+        std::vector<int> energized_members;
+        collect_island(keep_start, energized_members);
+        changed_rows.insert(changed_rows.end(), energized_members.begin(), energized_members.end());
+    }
+    island_size_[keep] += island_size_[absorb];
+    island_sources_[keep] += island_sources_[absorb];
+    island_size_[absorb] = 0;
+    island_sources_[absorb] = 0;
+    --island_count_;
+}
+
+bool NetworkModel::set_branch_closed(Entity branch, bool closed)
+{
+    const int k = branch_index(branch);
+    if (k < 0)
+        return false;
+    if (auto* component = registry_.get<BranchComponent>(branch))
+        component->closed = closed;
+    Branch& br = branches_[k];
+    if (br.closed == closed)
+        return lu_.factorized();
+
+    std::vector<int> changed_rows { br.from, br.to };
+    if (closed) {
+        merge_islands(br.from, br.to, changed_rows);
+        br.closed = true;
+    } else {
+        br.closed = false;
+        split_island(br.from, br.to, changed_rows);
+    }
+    for (int bus : changed_rows)
+        update_row(bus);
+
+    ++partial_refactorizations_;
+    for (auto& column : zbus_columns_)
+        column.clear();
+    result_ = NetworkFaultResult {};
+    if (!lu_.refactorize(y_bus_, changed_rows))
+        return false;
+    solve_prefault();
+    return true;
+}
+
+bool NetworkModel::branch_closed(Entity branch) const
+{
+    const int k = branch_index(branch);
+    return k >= 0 && branches_[k].closed;
+}
+
+bool NetworkModel::bus_energized(Entity bus) const
+{
+    const int b = bus_index(bus);
+    return b >= 0 && energized(b);
+}
+
+std::size_t NetworkModel::energized_bus_count() const
+{
+    std::size_t count = 0;
+    for (std::size_t b = 0; b < buses_.size(); ++b)
+        count += energized(static_cast<int>(b)) ? 1 : 0;
+    return count;
+}
+
+int NetworkModel::bus_index(Entity bus) const
+{
+    auto it = bus_index_.find(bus);
+    return it == bus_index_.end() ? -1 : it->second;
+}
+
+int NetworkModel::branch_index(Entity branch) const
+{
+    auto it = branch_index_.find(branch);
+    return it == branch_index_.end() ? -1 : it->second;
+}
+
+const std::vector<std::complex<double>>& NetworkModel::zbus_column(int bus)
+{
+    std::vector<std::complex<double>>& column = zbus_columns_[bus];
+    if (column.empty()) {
+        column.assign(buses_.size(), {});
+        column[bus] = 1.0;
+        lu_.solve(column);
+        ++column_solves_;
+    }
+    return column;
+}
+
+void NetworkModel::solve_fault(int branch, int i, int j, double x, std::complex<double> fault_impedance_Ohm)
+{
+    // Injecting If at fraction x of branch i-j is equivalent to injecting
+    // (1 - x) If at i and x If at j, plus the drop x (1 - x) z If inside the
+    // branch, so the Thevenin impedance at the fault is
+    //   Zff = (1-x)^2 Zii + 2x(1-x) Zij + x^2 Zjj + x(1-x) z.
+    const std::vector<std::complex<double>>& col_i = zbus_column(i);
+    const std::vector<std::complex<double>>& col_j = zbus_column(j);
+    const std::complex<double> z = branch >= 0 ? branches_[branch].impedance_Ohm : std::complex<double> {};
+    const double xi = 1.0 - x;
+    const std::complex<double> z_ff = xi * xi * col_i[i] + 2.0 * x * xi * col_i[j] + x * x * col_j[j] + x * xi * z;
+    const std::complex<double> v_prefault = xi * prefault_kV_[i] + x * prefault_kV_[j];
+    const std::complex<double> fault_current = v_prefault / (z_ff + fault_impedance_Ohm);
+
+    result_.fault_current_kA = fault_current;
+    result_.thevenin_impedance_Ohm = z_ff;
+    result_.bus_voltage_kV.resize(buses_.size());
+    for (std::size_t b = 0; b < buses_.size(); ++b)
+        result_.bus_voltage_kV[b] = prefault_kV_[b] - (xi * col_i[b] + x * col_j[b]) * fault_current;
+
+    result_.branch_current_kA.assign(branches_.size(), {});
+    for (std::size_t k = 0; k < branches_.size(); ++k) {
+        const Branch& br = branches_[k];
+        if (br.closed)
+            result_.branch_current_kA[k] = (result_.bus_voltage_kV[br.from] - result_.bus_voltage_kV[br.to]) / br.impedance_Ohm;
+    }
+    if (branch >= 0)
+        result_.branch_current_kA[branch] += xi * fault_current; // Share fed from the from_bus end
+}
+
+const NetworkFaultResult& NetworkModel::fault_at_bus(Entity bus, std::complex<double> fault_impedance_Ohm)
+{
+    const int b = bus_index(bus);
+    result_.faulty_entity_id = bus;
+    result_.distance_km = 0.0;
+    if (b >= 0 && lu_.factorized())
+        solve_fault(-1, b, b, 0.0, fault_impedance_Ohm);
+    return result_;
+}
+
+const NetworkFaultResult& NetworkModel::fault_on_branch(Entity branch, double distance_km, std::complex<double> fault_impedance_Ohm)
+{
+    const int k = branch_index(branch);
+    result_.faulty_entity_id = branch;
+    result_.distance_km = distance_km;
+    if (k < 0 || !lu_.factorized())
+        return result_;
+    const Branch& br = branches_[k];
+    if (!br.closed) {
+        // A fault on an open branch draws no current from the network.
+        result_.fault_current_kA = {};
+        result_.thevenin_impedance_Ohm = {};
+        result_.bus_voltage_kV = prefault_kV_;
+        result_.branch_current_kA.assign(branches_.size(), {});
+        return result_;
+    }
+    const double x = br.length_km > 0.0 ? std::clamp(distance_km / br.length_km, 0.0, 1.0) : 0.0;
+    solve_fault(k, br.from, br.to, x, fault_impedance_Ohm);
+    return result_;
+}
+
+bool NetworkModel::fault_at(const FaultInfo& fault, std::complex<double> fault_impedance_Ohm)
+{
+    if (branch_index(fault.faulty_entity_id) >= 0) {
+        fault_on_branch(fault.faulty_entity_id, fault.distance_km, fault_impedance_Ohm);
+        return true;
+    }
+    if (bus_index(fault.faulty_entity_id) >= 0) {
+        fault_at_bus(fault.faulty_entity_id, fault_impedance_Ohm);
+        return true;
+    }
+    return false;
+}
+
+bool NetworkModel::relay_view(const NetworkFaultResult& result, Entity relay_entity, FaultInfo& view) const
+{
+    const int k = branch_index(relay_entity);
+    if (k < 0 || result.branch_current_kA.size() != branches_.size())
+        return false;
+    const std::complex<double> v = result.bus_voltage_kV[branches_[k].from];
+    const double magnitude = std::abs(result.branch_current_kA[k]);
+    const double current = magnitude > kMinMeasurableCurrent_kA ? magnitude : 0.0;
+    view.faulty_entity_id = result.faulty_entity_id;
+    view.distance_km = result.distance_km;
+    view.current_kA = current;
+    view.voltage_kV = kSqrt3 * std::abs(v);
+    view.impedance_Ohm = current > 0.0 ? std::abs(v) / current : std::numeric_limits<double>::infinity();
+    return true;
+}
+
+bool NetworkModel::relay_phasors(const NetworkFaultResult* result, Entity relay_entity, std::complex<double>& voltage_kV,
+    std::complex<double>& current_kA) const
+{
+    const int k = branch_index(relay_entity);
+    if (k < 0)
+        return false;
+    const Branch& br = branches_[k];
+    if (result) {
+        if (result->branch_current_kA.size() != branches_.size())
+            return false;
+        voltage_kV = result->bus_voltage_kV[br.from];
+        current_kA = result->branch_current_kA[k];
+        return true;
+    }
+    if (prefault_kV_.size() != buses_.size())
+        return false;
+    voltage_kV = prefault_kV_[br.from];
+    current_kA = br.closed ? (prefault_kV_[br.from] - prefault_kV_[br.to]) / br.impedance_Ohm : std::complex<double> {};
+    return true;
+}
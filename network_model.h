@@ -0,0 +1,190 @@
+// network_model.h
+// Network topology as ECS components (buses, branches, sources) and
+// symmetrical three-phase short-circuit computation on it.
+//
+// build() assembles the nodal admittance matrix Y and factorizes it once.
+// A bus fault needs one column of Z = Y^-1, obtained with one solve against
+// the cached factors; columns are kept per bus, so sweeping faults along a
+// feeder costs one factorization plus one solve per bus involved, and a fault
+// inside a branch reuses the columns of its two end buses.
+//
+// Breaker operations change the model incrementally (set_branch_closed):
+// islands are updated by a local traversal around the switched branch, buses
+// in islands without a source are decoupled (unit diagonal, zero voltage),
+// and only the factor rows reached by the changed matrix rows along the
+// elimination tree are recomputed.
+//
+// Impedances are in ohms referred to one voltage level (the protection code
+// works at 220 kV throughout); voltages are phase values in kV, currents kA.
+#ifndef NETWORK_MODEL_H
+#define NETWORK_MODEL_H
+
+#include "ecs_core.h"
+#include "simulation_events_and_data.h"
+#include "sparse_lu.h"
+#include <complex>
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+// Below this a relay measures no current (round-off on unfed branches).
+constexpr double kMinMeasurableCurrent_kA = 1e-6;
+
+struct BusComponent : public IComponent {
+    double nominal_kV;
+    explicit BusComponent(double nominal = 220.0);
+};
+
+// Line, cable or transformer between two bus entities. Protection relays
+// attached to the branch entity measure at the from_bus end.
+struct BranchComponent : public IComponent {
+    Entity from_bus;
+    Entity to_bus;
+    std::complex<double> impedance_Ohm; // Must be non-zero
+    double length_km; // Lumped elements use 1
+    bool closed = true;
+    BranchComponent(Entity from, Entity to, std::complex<double> impedance, double length = 1.0);
+};
+
+// Thevenin source (grid infeed or generator) at a bus.
+struct SourceComponent : public IComponent {
+    Entity bus;
+    double voltage_kV; // Line-to-line EMF
+    std::complex<double> impedance_Ohm;
+    SourceComponent(Entity at_bus, double voltage, std::complex<double> impedance);
+};
+
+// Constant-power load at a bus; used by the power-flow solvers, not by the
+// short-circuit computation.
+struct LoadComponent : public IComponent {
+    Entity bus;
+    double p_kW;
+    double q_kvar;
+    LoadComponent(Entity at_bus, double p = 0.0, double q = 0.0);
+};
+
+// Post-fault state of the whole network for one fault.
+struct NetworkFaultResult {
+    Entity faulty_entity_id = 0; // Bus or branch
+    double distance_km = 0.0; // From the branch's from_bus end
+    std::complex<double> fault_current_kA;
+    std::complex<double> thevenin_impedance_Ohm; // Seen from the fault
+    std::vector<std::complex<double>> bus_voltage_kV; // Phase, by bus index
+    std::vector<std::complex<double>> branch_current_kA; // Leaving the from_bus end, by branch index
+};
+
+class NetworkModel {
+public:
+    explicit NetworkModel(Registry& reg);
+
+    // Reads the components and factorizes Y. Call again after the topology or
+    // impedances change. Returns false when Y is singular (a bus without a
+    // path to a source).
+    bool build();
+
+    // Opens or closes a branch (and its BranchComponent) and updates islands,
+    // matrix and factors incrementally. False when the branch is unknown or
+    // the updated matrix is singular.
+    bool set_branch_closed(Entity branch, bool closed);
+    bool branch_closed(Entity branch) const;
+    bool bus_energized(Entity bus) const;
+    std::size_t island_count() const { return island_count_; }
+    std::size_t energized_bus_count() const;
+
+    std::size_t bus_count() const { return buses_.size(); }
+    std::size_t branch_count() const { return branches_.size(); }
+    int bus_index(Entity bus) const;
+    int branch_index(Entity branch) const;
+    Entity bus_entity(std::size_t index) const { return buses_[index]; }
+    Entity branch_entity(std::size_t index) const { return branches_[index].entity; }
+    // Topology by index, for traversals outside the model.
+    int branch_from(std::size_t index) const { return branches_[index].from; }
+    int branch_to(std::size_t index) const { return branches_[index].to; }
+    std::complex<double> branch_impedance_Ohm(std::size_t index) const { return branches_[index].impedance_Ohm; }
+    double branch_length_km(std::size_t index) const { return branches_[index].length_km; }
+    bool branch_closed_at(std::size_t index) const { return branches_[index].closed; }
+    const std::vector<int>& bus_branches(std::size_t bus) const { return incident_[bus]; }
+    // No-load phase voltage of a bus.
+    std::complex<double> prefault_voltage_kV(std::size_t bus) const { return prefault_kV_[bus]; }
+
+    // Bolted or impedance fault at a bus, or inside a branch at distance_km
+    // from its from_bus end. The result is reused between calls.
+    const NetworkFaultResult& fault_at_bus(Entity bus, std::complex<double> fault_impedance_Ohm = {});
+    const NetworkFaultResult& fault_on_branch(Entity branch, double distance_km, std::complex<double> fault_impedance_Ohm = {});
+    // Fault at a bus or branch entity; false when the entity is not in the model.
+    bool fault_at(const FaultInfo& fault, std::complex<double> fault_impedance_Ohm = {});
+    const NetworkFaultResult& last_fault() const { return result_; }
+
+    // What a relay on branch `relay_entity` measures during `result`:
+    // current, voltage (line-to-line) and apparent impedance at its bus.
+    // False when the entity is not a branch of the model.
+    bool relay_view(const NetworkFaultResult& result, Entity relay_entity, FaultInfo& view) const;
+    // Phase voltage at the relay's bus and current leaving it there, during
+    // `result` or, for nullptr, in the no-load pre-fault state.
+    bool relay_phasors(const NetworkFaultResult* result, Entity relay_entity, std::complex<double>& voltage_kV,
+        std::complex<double>& current_kA) const;
+
+    const SparseLU<std::complex<double>>& factorization() const { return lu_; }
+    std::size_t factorizations() const { return factorizations_; }
+    std::size_t partial_refactorizations() const { return partial_refactorizations_; }
+    // Factor rows recomputed by the last build or topology change.
+    std::size_t last_updated_rows() const { return lu_.last_updated_rows(); }
+    std::size_t column_solves() const { return column_solves_; }
+
+private:
+    struct Branch {
+        Entity entity;
+        int from;
+        int to;
+        std::complex<double> impedance_Ohm;
+        double length_km;
+        bool closed;
+        int from_to_entry; // Positions of (from, to) and (to, from) in y_bus_
+        int to_from_entry;
+    };
+
+    bool energized(int bus) const { return island_sources_[island_[bus]] > 0; }
+    // Buses reachable from `start` over closed branches, into `out`.
+    void collect_island(int start, std::vector<int>& out);
+    // After opening a branch between a and b: true if they are still
+    // connected, otherwise a's side gets a new island label. The traversal
+    // runs from both ends at once and stops with the smaller side.
+    bool split_island(int a, int b, std::vector<int>& changed_rows);
+    void merge_islands(int a, int b, std::vector<int>& changed_rows);
+    // Rewrites row `bus` of y_bus_ from its branches and sources.
+    void update_row(int bus);
+    void solve_prefault();
+    const std::vector<std::complex<double>>& zbus_column(int bus);
+    // Fault at fraction x along `branch` (-1 for a bus fault at i == j).
+    void solve_fault(int branch, int i, int j, double x, std::complex<double> fault_impedance_Ohm);
+
+    Registry& registry_;
+    std::vector<Entity> buses_;
+    std::unordered_map<Entity, int> bus_index_;
+    std::vector<Branch> branches_;
+    std::unordered_map<Entity, int> branch_index_;
+    std::vector<std::vector<int>> incident_; // Branch indices by bus
+    std::vector<std::complex<double>> source_admittance_S_; // By bus
+    std::vector<std::complex<double>> source_injection_kA_; // Norton, by bus
+    std::vector<int> source_count_; // By bus
+
+    std::vector<int> island_; // Label by bus
+    std::vector<int> island_size_; // By label; labels are not reused
+    std::vector<int> island_sources_;
+    std::size_t island_count_ = 0;
+    std::vector<unsigned> visit_mark_; // Traversal stamps by bus
+    unsigned visit_stamp_ = 0;
+
+    // Pattern holds every branch, open or closed, so switching only changes values.
+    CsrMatrix<std::complex<double>> y_bus_;
+    std::vector<int> diagonal_entry_; // By bus
+    SparseLU<std::complex<double>> lu_;
+    std::vector<std::complex<double>> prefault_kV_; // Phase voltages with no load
+    std::vector<std::vector<std::complex<double>>> zbus_columns_; // Empty until solved
+    std::size_t factorizations_ = 0;
+    std::size_t partial_refactorizations_ = 0;
+    std::size_t column_solves_ = 0;
+    NetworkFaultResult result_;
+};
+
+#endif // NETWORK_MODEL_H
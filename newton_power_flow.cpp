@@ -0,0 +1,464 @@
+// newton_power_flow.cpp
+#include "newton_power_flow.h"
+#include "network_model.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+constexpr double kRadToDeg = 57.29577951308232;
+const std::complex<double> kJ(0.0, 1.0);
+
+} // namespace
+
+NewtonPowerFlow::NewtonPowerFlow(Registry& reg, double base_MVA)
+    : registry_(reg)
+    , base_MVA_(base_MVA)
+{
+}
+
+void NewtonPowerFlow::build()
+{
+    // Sorted entities keep the bus numbering, ordering and factors
+    // independent of hash-map iteration order.
+    buses_.clear();
+    registry_.for_each<BusComponent>([&](BusComponent&, Entity e) { buses_.push_back(e); });
+    std::sort(buses_.begin(), buses_.end());
+    const int n = static_cast<int>(buses_.size());
+    bus_index_.clear();
+    base_kV_.assign(n, 0.0);
+    for (int b = 0; b < n; ++b) {
+        bus_index_[buses_[b]] = b;
+        base_kV_[b] = registry_.get<BusComponent>(buses_[b])->nominal_kV;
+    }
+    auto index_of = [&](Entity bus) {
+        auto it = bus_index_.find(bus);
+        return it == bus_index_.end() ? -1 : it->second;
+    };
+    auto base_impedance_Ohm = [&](int bus) { return base_kV_[bus] * base_kV_[bus] / base_MVA_; };
+
+    branches_.clear();
+    registry_.for_each<BranchComponent>([&](BranchComponent& branch, Entity e) {
+        int from = index_of(branch.from_bus);
+        int to = index_of(branch.to_bus);
+        if (from < 0 || to < 0 || from == to)
+            return;
+        const std::complex<double> z_pu = branch.impedance_Ohm / base_impedance_Ohm(from);
+        const double x_pu = std::abs(z_pu.imag()) > 1e-12 ? z_pu.imag() : std::abs(z_pu);
+        branches_.push_back({ e, from, to, 1.0 / z_pu, x_pu, branch.closed, -1, -1 });
+    });
+    std::sort(branches_.begin(), branches_.end(), [](const Branch& a, const Branch& b) { return a.entity < b.entity; });
+    branch_index_.clear();
+    incident_.assign(n, {});
+    for (std::size_t k = 0; k < branches_.size(); ++k) {
+        branch_index_[branches_[k].entity] = static_cast<int>(k);
+        incident_[branches_[k].from].push_back(static_cast<int>(k));
+        incident_[branches_[k].to].push_back(static_cast<int>(k));
+    }
+
+    // Each source is a shunt admittance behind its EMF (angle 0); y E is the
+    // Norton current it injects.
+    source_admittance_pu_.assign(n, {});
+    source_susceptance_b1_.assign(n, 0.0);
+    source_injection_pu_.assign(n, {});
+    source_count_.assign(n, 0);
+    registry_.for_each<SourceComponent>([&](SourceComponent& source, Entity) {
+        int b = index_of(source.bus);
+        if (b < 0)
+            return;
+        const std::complex<double> z_pu = source.impedance_Ohm / base_impedance_Ohm(b);
+        const std::complex<double> y = 1.0 / z_pu;
+        source_admittance_pu_[b] += y;
+        source_susceptance_b1_[b] += 1.0 / (std::abs(z_pu.imag()) > 1e-12 ? z_pu.imag() : std::abs(z_pu));
+        source_injection_pu_[b] += y * (source.voltage_kV / base_kV_[b]);
+        ++source_count_[b];
+    });
+    refresh_loads();
+
+    energized_.assign(n, 0);
+    label_islands(nullptr);
+
+    std::vector<int> row, col;
+    for (int b = 0; b < n; ++b) {
+        row.push_back(b);
+        col.push_back(b);
+    }
+    for (const Branch& branch : branches_) {
+        row.insert(row.end(), { branch.from, branch.to });
+        col.insert(col.end(), { branch.to, branch.from });
+    }
+    y_bus_ = csr_from_triplets(n, row, col, std::vector<std::complex<double>>(row.size()));
+    b_theta_.rows = b_voltage_.rows = n;
+    b_theta_.row_ptr = b_voltage_.row_ptr = y_bus_.row_ptr;
+    b_theta_.col = b_voltage_.col = y_bus_.col;
+    b_theta_.values.assign(y_bus_.nonzeros(), 0.0);
+    b_voltage_.values.assign(y_bus_.nonzeros(), 0.0);
+    diagonal_entry_.assign(n, -1);
+    for (int b = 0; b < n; ++b)
+        diagonal_entry_[b] = static_cast<int>(y_bus_.find(b, b));
+    for (Branch& branch : branches_) {
+        branch.from_to_entry = static_cast<int>(y_bus_.find(branch.from, branch.to));
+        branch.to_from_entry = static_cast<int>(y_bus_.find(branch.to, branch.from));
+    }
+    for (int b = 0; b < n; ++b)
+        update_rows(b);
+
+    // Jacobian rows 2i and 2i+1 take the columns of Y row i, two per entry.
+    jacobian_.rows = 2 * n;
+    jacobian_.row_ptr.assign(2 * n + 1, 0);
+    jacobian_.col.clear();
+    for (int i = 0; i < n; ++i) {
+        for (int half = 0; half < 2; ++half) {
+            for (int e = y_bus_.row_ptr[i]; e < y_bus_.row_ptr[i + 1]; ++e)
+                jacobian_.col.insert(jacobian_.col.end(), { 2 * y_bus_.col[e], 2 * y_bus_.col[e] + 1 });
+            jacobian_.row_ptr[2 * i + half + 1] = static_cast<int>(jacobian_.col.size());
+        }
+    }
+    jacobian_.values.assign(jacobian_.col.size(), 0.0);
+
+    // One minimum-degree ordering of the buses serves all three matrices;
+    // the Jacobian eliminates each bus's angle and magnitude together.
+    std::vector<int> bus_order = minimum_degree_order(n, y_bus_.row_ptr, y_bus_.col);
+    std::vector<int> block_order;
+    block_order.reserve(2 * n);
+    for (int b : bus_order)
+        block_order.insert(block_order.end(), { 2 * b, 2 * b + 1 });
+    jacobian_lu_.analyze(jacobian_, std::move(block_order));
+    b_theta_lu_.analyze(b_theta_, std::move(bus_order));
+    b_voltage_lu_ = b_theta_lu_; // Same pattern, same symbolic factors
+    ++analyses_;
+    jacobian_current_ = false;
+    decoupled_changed_rows_.clear();
+
+    angle_rad_.assign(n, 0.0);
+    magnitude_pu_.assign(n, 0.0);
+    for (int b = 0; b < n; ++b)
+        magnitude_pu_[b] = energized_[b] ? 1.0 : 0.0;
+    unit_.assign(n, {});
+    voltage_pu_.assign(n, {});
+    current_pu_.assign(n, {});
+    mismatch_.assign(2 * n, 0.0);
+    step_.assign(2 * n, 0.0);
+    stats_ = NewtonStats {};
+}
+
+void NewtonPowerFlow::refresh_loads()
+{
+    load_pu_.assign(buses_.size(), {});
+    registry_.for_each<LoadComponent>([&](LoadComponent& load, Entity) {
+        auto it = bus_index_.find(load.bus);
+        if (it != bus_index_.end())
+            load_pu_[it->second] += std::complex<double>(load.p_kW, load.q_kvar) / (1000.0 * base_MVA_);
+    });
+}
+
+bool NewtonPowerFlow::set_load(Entity bus, double p_kW, double q_kvar)
+{
+    auto it = bus_index_.find(bus);
+    if (it == bus_index_.end())
+        return false;
+    load_pu_[it->second] = std::complex<double>(p_kW, q_kvar) / (1000.0 * base_MVA_);
+    return true;
+}
+
+void NewtonPowerFlow::label_islands(std::vector<int>* changed)
+{
+    const int n = static_cast<int>(buses_.size());
+    island_.assign(n, -1);
+    island_sources_.clear();
+    std::vector<int> stack;
+    std::vector<int> members;
+    for (int start = 0; start < n; ++start) {
+        if (island_[start] >= 0)
+            continue;
+        const int label = static_cast<int>(island_sources_.size());
+        int sources = 0;
+        members.clear();
+        island_[start] = label;
+        stack.push_back(start);
+        while (!stack.empty()) {
+            int bus = stack.back();
+            stack.pop_back();
+            members.push_back(bus);
+            sources += source_count_[bus];
+            for (int k : incident_[bus]) {
+                const Branch& branch = branches_[k];
+                int other = branch.from == bus ? branch.to : branch.from;
+                if (branch.closed && island_[other] < 0) {
+                    island_[other] = label;
+                    stack.push_back(other);
+                }
+            }
+        }
+        island_sources_.push_back(sources);
+        for (int bus : members) {
+            char live = sources > 0 ? 1 : 0;
+            if (changed && live != energized_[bus])
+                changed->push_back(bus);
+            energized_[bus] = live;
+        }
+    }
+}
+
+void NewtonPowerFlow::update_rows(int bus)
+{
+    for (int e = y_bus_.row_ptr[bus]; e < y_bus_.row_ptr[bus + 1]; ++e) {
+        y_bus_.values[e] = {};
+        b_theta_.values[e] = 0.0;
+        b_voltage_.values[e] = 0.0;
+    }
+    const int d = diagonal_entry_[bus];
+    if (!energized_[bus]) {
+        b_theta_.values[d] = b_voltage_.values[d] = 1.0; // Decoupled, V = 0
+        return;
+    }
+    y_bus_.values[d] = source_admittance_pu_[bus];
+    b_theta_.values[d] = source_susceptance_b1_[bus];
+    for (int k : incident_[bus]) {
+        const Branch& branch = branches_[k];
+        if (!branch.closed)
+            continue;
+        const int off = bus == branch.from ? branch.from_to_entry : branch.to_from_entry;
+        y_bus_.values[d] += branch.admittance_pu;
+        y_bus_.values[off] -= branch.admittance_pu;
+        b_theta_.values[d] += 1.0 / branch.reactance_pu;
+        b_theta_.values[off] -= 1.0 / branch.reactance_pu;
+    }
+    for (int e = y_bus_.row_ptr[bus]; e < y_bus_.row_ptr[bus + 1]; ++e)
+        b_voltage_.values[e] = -y_bus_.values[e].imag();
+}
+
+bool NewtonPowerFlow::set_branch_closed(Entity branch_entity, bool closed)
+{
+    auto it = branch_index_.find(branch_entity);
+    if (it == branch_index_.end())
+        return false;
+    Branch& branch = branches_[it->second];
+    if (auto* component = registry_.get<BranchComponent>(branch_entity))
+        component->closed = closed;
+    if (branch.closed == closed)
+        return true;
+    branch.closed = closed;
+
+    std::vector<int> changed { branch.from, branch.to };
+    label_islands(&changed);
+    for (int bus : changed) {
+        update_rows(bus);
+        if (!energized_[bus]) {
+            magnitude_pu_[bus] = 0.0;
+        } else if (magnitude_pu_[bus] == 0.0) {
+            magnitude_pu_[bus] = 1.0;
+            angle_rad_[bus] = 0.0;
+        }
+    }
+    jacobian_current_ = false;
+    decoupled_changed_rows_.insert(decoupled_changed_rows_.end(), changed.begin(), changed.end());
+    return true;
+}
+
+double NewtonPowerFlow::compute_mismatch()
+{
+    const int n = static_cast<int>(buses_.size());
+    for (int i = 0; i < n; ++i) {
+        unit_[i] = std::polar(1.0, angle_rad_[i]);
+        voltage_pu_[i] = magnitude_pu_[i] * unit_[i];
+    }
+    double largest = 0.0;
+    for (int i = 0; i < n; ++i) {
+        if (!energized_[i]) {
+            current_pu_[i] = {};
+            mismatch_[2 * i] = mismatch_[2 * i + 1] = 0.0;
+            continue;
+        }
+        std::complex<double> current;
+        for (int e = y_bus_.row_ptr[i]; e < y_bus_.row_ptr[i + 1]; ++e)
+            current += y_bus_.values[e] * voltage_pu_[y_bus_.col[e]];
+        current_pu_[i] = current;
+        // Source injection less load less what flows into the network.
+        const std::complex<double> mismatch = voltage_pu_[i] * std::conj(source_injection_pu_[i] - current) - load_pu_[i];
+        mismatch_[2 * i] = mismatch.real();
+        mismatch_[2 * i + 1] = mismatch.imag();
+        largest = std::max({ largest, std::abs(mismatch.real()), std::abs(mismatch.imag()) });
+    }
+    return largest;
+}
+
+void NewtonPowerFlow::assemble_jacobian()
+{
+    // Derivatives of the power leaving bus i into the network, net of its
+    // source injection, S = V_i conj(I_i - J_i), with respect to the angles
+    // and magnitudes of the buses in Y row i.
+    const int n = static_cast<int>(buses_.size());
+    for (int i = 0; i < n; ++i) {
+        const int y_begin = y_bus_.row_ptr[i];
+        double* p_row = &jacobian_.values[jacobian_.row_ptr[2 * i]];
+        double* q_row = &jacobian_.values[jacobian_.row_ptr[2 * i + 1]];
+        if (!energized_[i]) {
+            const int entries = 2 * (y_bus_.row_ptr[i + 1] - y_begin);
+            std::fill(p_row, p_row + entries, 0.0);
+            std::fill(q_row, q_row + entries, 0.0);
+            const int d = 2 * (diagonal_entry_[i] - y_begin);
+            p_row[d] = 1.0;
+            q_row[d + 1] = 1.0;
+            continue;
+        }
+        const std::complex<double> v = voltage_pu_[i];
+        for (int e = y_begin; e < y_bus_.row_ptr[i + 1]; ++e) {
+            const int k = y_bus_.col[e];
+            const std::complex<double> y = y_bus_.values[e];
+            std::complex<double> d_angle, d_magnitude;
+            if (k == i) {
+                const std::complex<double> net = current_pu_[i] - source_injection_pu_[i];
+                d_angle = kJ * v * std::conj(net) - kJ * v * std::conj(y * v);
+                d_magnitude = v * std::conj(y * unit_[i]) + unit_[i] * std::conj(net);
+            } else {
+                d_angle = -kJ * v * std::conj(y * voltage_pu_[k]);
+                d_magnitude = v * std::conj(y * unit_[k]);
+            }
+            const int p = 2 * (e - y_begin);
+            p_row[p] = d_angle.real();
+            p_row[p + 1] = d_magnitude.real();
+            q_row[p] = d_angle.imag();
+            q_row[p + 1] = d_magnitude.imag();
+        }
+    }
+}
+
+bool NewtonPowerFlow::factorize_jacobian(NewtonStats& stats)
+{
+    assemble_jacobian();
+    ++stats.factorizations;
+    ++factorizations_;
+    jacobian_current_ = jacobian_lu_.factorize(jacobian_);
+    return jacobian_current_;
+}
+
+bool NewtonPowerFlow::factorize_decoupled(NewtonStats& stats)
+{
+    if (b_theta_lu_.factorized() && b_voltage_lu_.factorized() && decoupled_changed_rows_.empty())
+        return true;
+    ++stats.factorizations;
+    ++factorizations_;
+    bool ok = b_theta_lu_.refactorize(b_theta_, decoupled_changed_rows_)
+        && b_voltage_lu_.refactorize(b_voltage_, decoupled_changed_rows_);
+    decoupled_changed_rows_.clear();
+    return ok;
+}
+
+void NewtonPowerFlow::newton_step()
+{
+    std::copy(mismatch_.begin(), mismatch_.end(), step_.begin());
+    jacobian_lu_.solve(step_);
+    for (std::size_t i = 0; i < buses_.size(); ++i) {
+        if (!energized_[i])
+            continue;
+        angle_rad_[i] += step_[2 * i];
+        magnitude_pu_[i] += step_[2 * i + 1];
+    }
+}
+
+void NewtonPowerFlow::decoupled_half_step(bool angles)
+{
+    // dP / |V| = B' d(angle), dQ / |V| = B'' d|V|
+    const std::size_t n = buses_.size();
+    std::span<double> rhs(step_.data(), n);
+    for (std::size_t i = 0; i < n; ++i)
+        rhs[i] = energized_[i] ? mismatch_[2 * i + (angles ? 0 : 1)] / magnitude_pu_[i] : 0.0;
+    (angles ? b_theta_lu_ : b_voltage_lu_).solve(rhs);
+    std::vector<double>& state = angles ? angle_rad_ : magnitude_pu_;
+    for (std::size_t i = 0; i < n; ++i) {
+        if (energized_[i])
+            state[i] += rhs[i];
+    }
+}
+
+NewtonStats NewtonPowerFlow::solve()
+{
+    NewtonStats stats;
+    for (char live : energized_)
+        stats.buses += live ? 1 : 0;
+    double mismatch = compute_mismatch();
+    double previous = std::numeric_limits<double>::infinity();
+    while (true) {
+        if (mismatch <= tolerance_pu) {
+            stats.converged = true;
+            break;
+        }
+        if (stats.iterations == max_iterations)
+            break;
+        bool ok = true;
+        switch (mode) {
+        case NewtonMode::Full:
+            ok = factorize_jacobian(stats);
+            if (ok)
+                newton_step();
+            break;
+        case NewtonMode::Dishonest:
+            if (!jacobian_current_ || mismatch > refactor_ratio * previous)
+                ok = factorize_jacobian(stats);
+            if (ok)
+                newton_step();
+            break;
+        case NewtonMode::FastDecoupled:
+            ok = factorize_decoupled(stats);
+            if (ok) {
+                decoupled_half_step(true);
+                compute_mismatch();
+                decoupled_half_step(false);
+            }
+            break;
+        }
+        if (!ok)
+            break;
+        ++stats.iterations;
+        previous = mismatch;
+        mismatch = compute_mismatch();
+        if (!std::isfinite(mismatch))
+            break;
+    }
+    stats.max_mismatch_pu = mismatch;
+    stats_ = stats;
+    return stats;
+}
+
+bool NewtonPowerFlow::energized(Entity bus) const
+{
+    auto it = bus_index_.find(bus);
+    return it != bus_index_.end() && energized_[it->second];
+}
+
+double NewtonPowerFlow::voltage_pu(Entity bus) const
+{
+    auto it = bus_index_.find(bus);
+    return it == bus_index_.end() ? 0.0 : magnitude_pu_[it->second];
+}
+
+double NewtonPowerFlow::angle_deg(Entity bus) const
+{
+    auto it = bus_index_.find(bus);
+    return it == bus_index_.end() ? 0.0 : angle_rad_[it->second] * kRadToDeg;
+}
+
+std::complex<double> NewtonPowerFlow::voltage_kV(Entity bus) const
+{
+    auto it = bus_index_.find(bus);
+    if (it == bus_index_.end())
+        return {};
+    return std::polar(magnitude_pu_[it->second] * base_kV_[it->second], angle_rad_[it->second]);
+}
+
+double NewtonPowerFlow::min_voltage_pu(Entity* bus) const
+{
+    double lowest = 0.0;
+    Entity lowest_bus = 0;
+    for (std::size_t b = 0; b < buses_.size(); ++b) {
+        if (energized_[b] && (lowest_bus == 0 || magnitude_pu_[b] < lowest)) {
+            lowest = magnitude_pu_[b];
+            lowest_bus = buses_[b];
+        }
+    }
+    if (bus)
+        *bus = lowest_bus;
+    return lowest;
+}
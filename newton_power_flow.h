@@ -0,0 +1,164 @@
+// newton_power_flow.h
+// Newton-Raphson AC power flow for meshed networks, built from the network
+// components (buses, branches, sources, loads) like the other network
+// solvers.
+//
+// Sources are the Thevenin equivalents of the short-circuit model: their
+// admittance is part of the bus admittance matrix and their EMF drives a
+// constant current injection, so every energized bus is a PQ bus and each
+// island is referenced by its own sources (no slack bus). The unknowns are
+// angle and magnitude per bus, interleaved, so the Jacobian is the bus
+// pattern with 2x2 blocks.
+//
+// build() lays out the admittance matrix and Jacobian patterns with every
+// branch, open or closed, orders the buses by minimum degree and runs the
+// symbolic factorization once. Solves and breaker operations only change
+// values, so the analysis is reused until the next build().
+//
+// Modes:
+//   Full           Jacobian rebuilt and factorized every iteration
+//   Dishonest      Jacobian factors kept across iterations and solves, and
+//                  refreshed only when an iteration stops reducing the
+//                  mismatch fast enough
+//   FastDecoupled  constant B' (branch reactances) and B'' (-Im Y) matrices,
+//                  factorized once per topology; a breaker operation
+//                  refactorizes the rows it reaches
+//
+// Voltages are kept between solves, so each solve warm-starts from the last
+// one. Quantities are per unit on base_MVA and each bus's nominal voltage;
+// impedances are ohms referred to the voltage level of the branch.
+#ifndef NEWTON_POWER_FLOW_H
+#define NEWTON_POWER_FLOW_H
+
+#include "ecs_core.h"
+#include "sparse_lu.h"
+#include <complex>
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+enum class NewtonMode {
+    Full,
+    Dishonest,
+    FastDecoupled
+};
+
+struct NewtonStats {
+    bool converged = false;
+    int iterations = 0;
+    int factorizations = 0; // Numeric factorizations during the solve
+    double max_mismatch_pu = 0.0; // Largest P or Q mismatch at the end
+    std::size_t buses = 0; // Energized
+};
+
+class NewtonPowerFlow {
+public:
+    explicit NewtonPowerFlow(Registry& reg, double base_MVA = 100.0);
+
+    // Reads the components, lays out the matrices and analyzes their
+    // patterns. Voltages restart from 1 pu. Call again after buses or
+    // branches are added.
+    void build();
+    // Reloads LoadComponent values.
+    void refresh_loads();
+    // Sets one bus's load without going through the registry.
+    bool set_load(Entity bus, double p_kW, double q_kvar);
+    // Opens or closes a branch (and its BranchComponent). Buses cut off from
+    // every source drop to zero; newly energized buses start from 1 pu. False
+    // when the branch is unknown.
+    bool set_branch_closed(Entity branch, bool closed);
+
+    NewtonStats solve();
+
+    NewtonMode mode = NewtonMode::Full;
+    double tolerance_pu = 1e-8;
+    int max_iterations = 30;
+    // Dishonest mode refactorizes after an iteration that leaves more than
+    // this fraction of the previous mismatch.
+    double refactor_ratio = 0.2;
+
+    std::size_t bus_count() const { return buses_.size(); }
+    std::size_t branch_count() const { return branches_.size(); }
+    bool energized(Entity bus) const;
+    double voltage_pu(Entity bus) const; // 0 for unknown or dead buses
+    double angle_deg(Entity bus) const;
+    std::complex<double> voltage_kV(Entity bus) const; // Line-to-line
+    // Lowest voltage over all energized buses.
+    double min_voltage_pu(Entity* bus = nullptr) const;
+    const NewtonStats& last_stats() const { return stats_; }
+
+    const CsrMatrix<double>& jacobian() const { return jacobian_; }
+    const SparseLU<double>& jacobian_factors() const { return jacobian_lu_; }
+    std::size_t analyses() const { return analyses_; }
+    std::size_t factorizations() const { return factorizations_; }
+
+private:
+    struct Branch {
+        Entity entity;
+        int from;
+        int to;
+        std::complex<double> admittance_pu;
+        double reactance_pu; // For B'
+        bool closed;
+        int from_to_entry; // Positions of (from, to) and (to, from) in y_bus_
+        int to_from_entry;
+    };
+
+    // Labels islands and sets energized_; buses whose state flipped are
+    // appended to `changed`.
+    void label_islands(std::vector<int>* changed);
+    // Row `bus` of y_bus_, b_theta_ and b_voltage_ from its branches and sources.
+    void update_rows(int bus);
+    // Branch currents Y V and P/Q mismatches; returns the largest mismatch.
+    double compute_mismatch();
+    void assemble_jacobian();
+    bool factorize_jacobian(NewtonStats& stats);
+    bool factorize_decoupled(NewtonStats& stats);
+    void newton_step();
+    void decoupled_half_step(bool angles);
+
+    Registry& registry_;
+    double base_MVA_;
+    std::vector<Entity> buses_;
+    std::unordered_map<Entity, int> bus_index_;
+    std::vector<double> base_kV_; // Line-to-line, by bus
+    std::vector<Branch> branches_;
+    std::unordered_map<Entity, int> branch_index_;
+    std::vector<std::vector<int>> incident_; // Branch indices by bus
+    std::vector<std::complex<double>> source_admittance_pu_; // By bus
+    std::vector<double> source_susceptance_b1_; // 1/x of the sources, for B'
+    std::vector<std::complex<double>> source_injection_pu_; // Norton current, by bus
+    std::vector<int> source_count_;
+    std::vector<std::complex<double>> load_pu_; // By bus
+
+    std::vector<int> island_;
+    std::vector<char> energized_;
+    std::vector<int> island_sources_;
+
+    // Patterns hold every branch; y_bus_, b_theta_ and b_voltage_ share one.
+    CsrMatrix<std::complex<double>> y_bus_;
+    CsrMatrix<double> b_theta_, b_voltage_;
+    std::vector<int> diagonal_entry_;
+    // Row 2i holds the P equation and row 2i+1 the Q equation of bus i;
+    // column 2k is angle k, 2k+1 magnitude k. Y entry e of row i maps to
+    // columns at jacobian_.row_ptr[2i (+1)] + 2 (e - y_bus_.row_ptr[i]).
+    CsrMatrix<double> jacobian_;
+    SparseLU<double> jacobian_lu_;
+    SparseLU<double> b_theta_lu_, b_voltage_lu_;
+    bool jacobian_current_ = false; // Factors usable by Dishonest mode
+    std::vector<int> decoupled_changed_rows_; // Since the B factors were last updated
+
+    std::vector<double> angle_rad_;
+    std::vector<double> magnitude_pu_;
+    std::vector<std::complex<double>> unit_; // e^(j angle)
+    std::vector<std::complex<double>> voltage_pu_;
+    std::vector<std::complex<double>> current_pu_; // Y V
+    std::vector<double> mismatch_; // P, Q interleaved like the Jacobian rows
+    std::vector<double> step_;
+
+    NewtonStats stats_;
+    std::size_t analyses_ = 0;
+    std::size_t factorizations_ = 0;
+};
+
+#endif // NEWTON_POWER_FLOW_H
@@ -0,0 +1,162 @@
+// power_flow_benchmark.cpp
+// Times the Newton-Raphson power flow (see newton_power_flow.h) on synthetic
+// meshed 110 kV networks.
+//
+// Usage: hecs_power_flow_benchmark [buses ...]   (default: 1000 10000 50000)
+//
+// Buses sit on a square grid; a random spanning tree of grid edges plus
+// about 40 % more grid edges gives a meshed network with ~1.4 branches per
+// bus. Sources on a 12 x 12 sub-grid (one per ~144 buses), 0.3-0.9 MW load per bus at 0.95 power
+// factor. For each mode the tool reports the analysis (ordering and
+// symbolic factorization, done once in build()), a cold solve from 1 pu and
+// a warm restart after a 2 % load increase.
+#include "network_model.h"
+#include "newton_power_flow.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <numeric>
+#include <random>
+#include <vector>
+
+namespace {
+
+constexpr int kSourceSpacing = 12; // Grid steps between sources, both ways
+
+struct Grid {
+    Registry registry;
+    std::vector<Entity> buses;
+    std::vector<std::complex<double>> load_kVA; // Three-phase, by bus
+    std::size_t branches = 0;
+};
+
+void build_grid(Grid& grid, int bus_count, unsigned seed)
+{
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    const int side = static_cast<int>(std::ceil(std::sqrt(static_cast<double>(bus_count))));
+    for (int b = 0; b < bus_count; ++b) {
+        grid.buses.push_back(grid.registry.create());
+        grid.registry.emplace<BusComponent>(grid.buses.back(), 110.0);
+    }
+
+    struct Edge {
+        int a, b;
+        double weight;
+    };
+    std::vector<Edge> edges;
+    for (int b = 0; b < bus_count; ++b) {
+        if ((b + 1) % side != 0 && b + 1 < bus_count)
+            edges.push_back({ b, b + 1, unit(rng) });
+        if (b + side < bus_count)
+            edges.push_back({ b, b + side, unit(rng) });
+    }
+    std::sort(edges.begin(), edges.end(), [](const Edge& x, const Edge& y) { return x.weight < y.weight; });
+    std::vector<int> root(bus_count);
+    std::iota(root.begin(), root.end(), 0);
+    auto find = [&](int b) {
+        while (root[b] != b)
+            b = root[b] = root[root[b]];
+        return b;
+    };
+    auto add_branch = [&](int a, int b) {
+        const double length_km = 5.0 + 10.0 * unit(rng);
+        grid.registry.emplace<BranchComponent>(grid.registry.create(), grid.buses[a], grid.buses[b],
+            std::complex<double>(0.06, 0.4) * length_km, length_km);
+        ++grid.branches;
+    };
+    std::vector<const Edge*> spare;
+    for (const Edge& edge : edges) {
+        int ra = find(edge.a), rb = find(edge.b);
+        if (ra != rb) {
+            root[ra] = rb;
+            add_branch(edge.a, edge.b);
+        } else {
+            spare.push_back(&edge);
+        }
+    }
+    for (const Edge* edge : spare) {
+        if (unit(rng) < 0.4 * bus_count / static_cast<double>(spare.size()))
+            add_branch(edge->a, edge->b);
+    }
+
+    for (int row = kSourceSpacing / 2; row * side < bus_count; row += kSourceSpacing) {
+        for (int column = kSourceSpacing / 2; column < side && row * side + column < bus_count; column += kSourceSpacing)
+            grid.registry.emplace<SourceComponent>(grid.registry.create(), grid.buses[row * side + column], 115.0, std::complex<double>(0.5, 6.0));
+    }
+    const double q_per_p = std::tan(std::acos(0.95));
+    for (Entity bus : grid.buses) {
+        const double p_kW = 300.0 + 600.0 * unit(rng);
+        grid.load_kVA.emplace_back(p_kW, p_kW * q_per_p);
+        grid.registry.emplace<LoadComponent>(grid.registry.create(), bus, p_kW, p_kW * q_per_p);
+    }
+}
+
+double elapsed_ms(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+const char* mode_name(NewtonMode mode)
+{
+    switch (mode) {
+    case NewtonMode::Full:
+        return "full";
+    case NewtonMode::Dishonest:
+        return "dishonest";
+    case NewtonMode::FastDecoupled:
+        return "decoupled";
+    }
+    return "?";
+}
+
+void run(int bus_count)
+{
+    Grid grid;
+    build_grid(grid, bus_count, 2024);
+    std::printf("%d buses, %zu branches\n", bus_count, grid.branches);
+    for (NewtonMode mode : { NewtonMode::Full, NewtonMode::Dishonest, NewtonMode::FastDecoupled }) {
+        NewtonPowerFlow power_flow(grid.registry);
+        power_flow.mode = mode;
+        auto start = std::chrono::steady_clock::now();
+        power_flow.build();
+        const double analysis_ms = elapsed_ms(start);
+
+        start = std::chrono::steady_clock::now();
+        NewtonStats cold = power_flow.solve();
+        const double cold_ms = elapsed_ms(start);
+        for (std::size_t b = 0; b < grid.buses.size(); ++b)
+            power_flow.set_load(grid.buses[b], grid.load_kVA[b].real() * 1.02, grid.load_kVA[b].imag() * 1.02);
+        start = std::chrono::steady_clock::now();
+        NewtonStats warm = power_flow.solve();
+        const double warm_ms = elapsed_ms(start);
+
+        std::printf("  %-9s analysis %8.1f ms (J %zu nz, LU %zu nz) | cold %2d it %2d fact %8.1f ms%s | warm %2d it %2d fact %8.1f ms%s | Vmin %.4f pu\n",
+            mode_name(mode), analysis_ms, power_flow.jacobian().nonzeros(), power_flow.jacobian_factors().factor_nonzeros(),
+            cold.iterations, cold.factorizations, cold_ms, cold.converged ? "" : " (not converged)",
+            warm.iterations, warm.factorizations, warm_ms, warm.converged ? "" : " (not converged)",
+            power_flow.min_voltage_pu());
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    std::vector<int> sizes;
+    for (int i = 1; i < argc; ++i) {
+        int buses = std::atoi(argv[i]);
+        if (buses < 2) {
+            std::fprintf(stderr, "Usage: hecs_power_flow_benchmark [buses ...]\n");
+            return 1;
+        }
+        sizes.push_back(buses);
+    }
+    if (sizes.empty())
+        sizes = { 1000, 10000, 50000 };
+    for (int buses : sizes)
+        run(buses);
+    return 0;
+}
@@ -1,54 +1,219 @@
 // protection_system.cpp
 #include "protection_system.h"
 #include "logging_utils.h" // For g_console_logger
+#include <algorithm>
 #include <chrono>
+#include <cmath>
+#include <limits>
+#include <numbers>
 
 extern cps_coro::Scheduler* g_scheduler; // Assuming main.cpp defines this and it's accessible
 
+void ProtectiveComp::evaluate_cases(const FaultCaseSpan& cases, Entity self_entity_id, int* delay_ms, double* margin)
+{
+    for (std::size_t i = 0; i < cases.count; ++i) {
+        FaultInfo fault = cases.info(i);
+        bool picked = pick_up(fault, self_entity_id);
+        delay_ms[i] = picked ? trip_delay_ms(fault) : kNoTripDelayMs;
+        margin[i] = picked ? 1.0 : 0.0;
+    }
+}
+
+double ProtectiveComp::reach_Ohm(double /*phase_voltage_kV*/) const
+{
+    return std::numeric_limits<double>::infinity();
+}
+
+namespace {
+
+int operate_time_to_ms(double time_s)
+{
+    // Infinite (not operating) times saturate to kNoTripDelayMs.
+    return static_cast<int>(std::min(time_s * 1000.0 + 0.5, static_cast<double>(kNoTripDelayMs)));
+}
+
+} // namespace
+
+bool OverCurrentSettings::pick_up(const FaultInfo& fault_data, Entity /*self_entity_id*/) const
+{
+    // An inverse-time stage only operates strictly above pickup (M > 1).
+    return curve_table ? fault_data.current_kA > pickup_current_kA : fault_data.current_kA >= pickup_current_kA;
+}
+int OverCurrentSettings::trip_delay_ms(const FaultInfo& fault_data) const
+{
+    if (!curve_table)
+        return fixed_delay_ms;
+    return operate_time_to_ms(time_multiplier * curve_table->time_s(fault_data.current_kA / pickup_current_kA));
+}
+double OverCurrentSettings::reach_Ohm(double phase_voltage_kV) const
+{
+    // Beyond this loop impedance the fault current is below pickup.
+    return pickup_current_kA > 0.0 ? phase_voltage_kV / pickup_current_kA : std::numeric_limits<double>::infinity();
+}
+void OverCurrentSettings::evaluate_cases(const FaultCaseSpan& cases, Entity /*self_entity_id*/, int* delay_ms, double* margin) const
+{
+    const double pickup_kA = pickup_current_kA;
+    const double* current_kA = cases.current_kA;
+    if (!curve_table) {
+        const int delay = fixed_delay_ms;
+        for (std::size_t i = 0; i < cases.count; ++i) {
+            delay_ms[i] = current_kA[i] >= pickup_kA ? delay : kNoTripDelayMs;
+            margin[i] = current_kA[i] / pickup_kA;
+        }
+        return;
+    }
+    // Below pickup the curve time is infinite, which saturates to kNoTripDelayMs.
+    const InverseTimeCurveTable& table = *curve_table;
+    const double multiplier = time_multiplier;
+    for (std::size_t i = 0; i < cases.count; ++i) {
+        const double multiple = current_kA[i] / pickup_kA;
+        delay_ms[i] = operate_time_to_ms(multiplier * table.time_s(multiple));
+        margin[i] = multiple;
+    }
+}
+
 OverCurrentProtection::OverCurrentProtection(double pickup_current_kA, int delay_ms, std::string stage_name)
-    : pickup_current_kA_(pickup_current_kA)
-    , fixed_delay_ms_(delay_ms)
+    : settings_ { pickup_current_kA, delay_ms }
     , stage_name_(std::move(stage_name))
 {
 }
 
-bool OverCurrentProtection::pick_up(const FaultInfo& fault_data, Entity /*self_entity_id*/)
+OverCurrentProtection::OverCurrentProtection(double pickup_current_kA, OvercurrentCurve curve, double time_multiplier, std::string stage_name)
+    : settings_ { pickup_current_kA, 0, time_multiplier, curve == OvercurrentCurve::DefiniteTime ? nullptr : &inverse_time_curve_table(curve) }
+    , stage_name_(std::move(stage_name))
 {
-    return fault_data.current_kA >= pickup_current_kA_;
 }
-int OverCurrentProtection::trip_delay_ms(const FaultInfo& /*fault_data*/) const
+
+bool OverCurrentProtection::pick_up(const FaultInfo& fault_data, Entity self_entity_id)
 {
-    return fixed_delay_ms_;
+    return settings_.pick_up(fault_data, self_entity_id);
+}
+int OverCurrentProtection::trip_delay_ms(const FaultInfo& fault_data) const
+{
+    return settings_.trip_delay_ms(fault_data);
 }
 const char* OverCurrentProtection::name() const
 {
     return stage_name_.c_str();
 }
+double OverCurrentProtection::reach_Ohm(double phase_voltage_kV) const
+{
+    return settings_.reach_Ohm(phase_voltage_kV);
+}
+void OverCurrentProtection::evaluate_cases(const FaultCaseSpan& cases, Entity self_entity_id, int* delay_ms, double* margin)
+{
+    settings_.evaluate_cases(cases, self_entity_id, delay_ms, margin);
+}
+
+bool DistanceSettings::pick_up(const FaultInfo& fault_data, Entity self_entity_id) const
+{
+    if (fault_data.faulty_entity_id != self_entity_id && fault_data.faulty_entity_id != 0) {
+        return fault_data.impedance_Ohm <= z_set_Ohm[2];
+    }
+    return fault_data.impedance_Ohm <= z_set_Ohm[0] || fault_data.impedance_Ohm <= z_set_Ohm[1] || fault_data.impedance_Ohm <= z_set_Ohm[2];
+}
+int DistanceSettings::trip_delay_ms(const FaultInfo& fault_data) const
+{
+    if (fault_data.impedance_Ohm <= z_set_Ohm[0])
+        return t_ms[0];
+    if (fault_data.impedance_Ohm <= z_set_Ohm[1])
+        return t_ms[1];
+    if (fault_data.impedance_Ohm <= z_set_Ohm[2])
+        return t_ms[2];
+    return kNoTripDelayMs;
+}
+double DistanceSettings::reach_Ohm(double /*phase_voltage_kV*/) const
+{
+    return *std::max_element(z_set_Ohm.begin(), z_set_Ohm.end());
+}
+void DistanceSettings::evaluate_cases(const FaultCaseSpan& cases, Entity self_entity_id, int* delay_ms, double* margin) const
+{
+    // Same decisions as pick_up/trip_delay_ms: a remote fault only picks up
+    // within zone 3, but the delay is that of the innermost zone reached.
+    const double z1 = z_set_Ohm[0], z2 = z_set_Ohm[1], z3 = z_set_Ohm[2];
+    const int t1 = t_ms[0], t2 = t_ms[1], t3 = t_ms[2];
+    const double* impedance_Ohm = cases.impedance_Ohm;
+    const Entity* faulty = cases.faulty_entity_id;
+    for (std::size_t i = 0; i < cases.count; ++i) {
+        const double z = impedance_Ohm[i];
+        const bool remote = faulty[i] != self_entity_id && faulty[i] != 0;
+        const bool picked = remote ? z <= z3 : (z <= z1 || z <= z2 || z <= z3);
+        const int zone_delay = z <= z1 ? t1 : (z <= z2 ? t2 : (z <= z3 ? t3 : kNoTripDelayMs));
+        const double reach = z <= z1 ? z1 : (z <= z2 ? z2 : z3);
+        delay_ms[i] = picked ? zone_delay : kNoTripDelayMs;
+        margin[i] = z > 0.0 ? reach / z : std::numeric_limits<double>::infinity();
+    }
+}
 
 DistanceProtection::DistanceProtection(double z1_ohm, int t1_ms, double z2_ohm, int t2_ms, double z3_ohm, int t3_ms)
-    : z_set_ { z1_ohm, z2_ohm, z3_ohm }
-    , t_ms_ { t1_ms, t2_ms, t3_ms }
+    : settings_ { { z1_ohm, z2_ohm, z3_ohm }, { t1_ms, t2_ms, t3_ms } }
 {
 }
 
 bool DistanceProtection::pick_up(const FaultInfo& fault_data, Entity self_entity_id)
 {
-    if (fault_data.faulty_entity_id != self_entity_id && fault_data.faulty_entity_id != 0) {
-        return fault_data.impedance_Ohm <= z_set_[2];
-    }
-    return fault_data.impedance_Ohm <= z_set_[0] || fault_data.impedance_Ohm <= z_set_[1] || fault_data.impedance_Ohm <= z_set_[2];
+    return settings_.pick_up(fault_data, self_entity_id);
 }
 int DistanceProtection::trip_delay_ms(const FaultInfo& fault_data) const
 {
-    if (fault_data.impedance_Ohm <= z_set_[0])
-        return t_ms_[0];
-    if (fault_data.impedance_Ohm <= z_set_[1])
-        return t_ms_[1];
-    if (fault_data.impedance_Ohm <= z_set_[2])
-        return t_ms_[2];
-    return 99999;
+    return settings_.trip_delay_ms(fault_data);
 }
 const char* DistanceProtection::name() const { return "DIST"; }
+double DistanceProtection::reach_Ohm(double phase_voltage_kV) const
+{
+    return settings_.reach_Ohm(phase_voltage_kV);
+}
+void DistanceProtection::evaluate_cases(const FaultCaseSpan& cases, Entity self_entity_id, int* delay_ms, double* margin)
+{
+    settings_.evaluate_cases(cases, self_entity_id, delay_ms, margin);
+}
+
+void RelayPool<OverCurrentProtection>::push_back(Entity entity, const OverCurrentProtection& relay)
+{
+    const OverCurrentSettings& settings = relay.settings();
+    entities.push_back(entity);
+    pickup_current_kA.push_back(settings.pickup_current_kA);
+    fixed_delay_ms.push_back(settings.fixed_delay_ms);
+    time_multiplier.push_back(settings.time_multiplier);
+    curve_table.push_back(settings.curve_table);
+    stage_names.emplace_back(relay.name());
+}
+
+void RelayPool<DistanceProtection>::push_back(Entity entity, const DistanceProtection& relay)
+{
+    const DistanceSettings& settings = relay.settings();
+    entities.push_back(entity);
+    for (std::size_t zone = 0; zone < 3; ++zone) {
+        z_set_Ohm[zone].push_back(settings.z_set_Ohm[zone]);
+        t_ms[zone].push_back(settings.t_ms[zone]);
+    }
+}
+
+std::size_t ProtectionRelayPools::size() const
+{
+    std::size_t total = custom_.size();
+    std::apply([&](const auto&... pool) { ((total += pool.size()), ...); }, pools_);
+    return total;
+}
+
+Entity ProtectionRelayPools::entity(std::size_t relay) const
+{
+    Entity result = 0;
+    visit(*this, relay, [&](const auto& /*relay*/, Entity entity) { result = entity; });
+    return result;
+}
+
+const char* ProtectionRelayPools::name(std::size_t relay) const
+{
+    const char* result = nullptr;
+    visit(*this, relay, [&](const auto& relay_comp, Entity /*entity*/) { result = relay_comp.name(); });
+    return result;
+}
+
+void ProtectionRelayPools::evaluate_cases(std::size_t relay, const FaultCaseSpan& cases, int* delay_ms, double* margin)
+{
+    visit(*this, relay, [&](auto& relay_comp, Entity entity) { relay_comp.evaluate_cases(cases, entity, delay_ms, margin); });
+}
 
 ProtectionSystem::ProtectionSystem(Registry& reg, cps_coro::Scheduler& sch)
     : registry_(reg)
@@ -61,42 +226,235 @@ void ProtectionSystem::inject_fault(const FaultInfo& info)
     scheduler_.trigger_event(FAULT_INFO_EVENT_PROT, info);
 }
 
+void ProtectionSystem::set_network(NetworkModel* network)
+{
+    network_ = network;
+    reach_index_.reset();
+    if (network_)
+        reach_index_ = std::make_unique<RelayReachIndex>(*network_);
+    refresh_reach_index();
+}
+
+double ProtectionSystem::relay_reach_Ohm(std::size_t relay)
+{
+    // Fed at the highest pre-fault voltage in the model.
+    double phase_kV = 0.0;
+    for (std::size_t b = 0; b < network_->bus_count(); ++b)
+        phase_kV = std::max(phase_kV, std::abs(network_->prefault_voltage_kV(b)));
+    double reach = 0.0;
+    relays_.visit(relay, [&](const auto& comp, Entity /*entity_id*/) { reach = comp.reach_Ohm(phase_kV); });
+    return reach;
+}
+
+void ProtectionSystem::refresh_reach_index()
+{
+    if (!reach_index_ || reach_index_->relay_count() == relays_.size())
+        return;
+    std::vector<RelayReach> reaches(relays_.size());
+    for (std::size_t r = 0; r < reaches.size(); ++r)
+        reaches[r] = { relays_.entity(r), relay_reach_Ohm(r) };
+    reach_index_->build(reaches);
+    HECS_LOG_INFO(LogSubsystem::Protection, "[{}ms] [ProtectionSystem] Reach index: {} relays over {} buses, {} coverage entries.",
+        scheduler_.now().time_since_epoch().count(), reaches.size(), network_->bus_count(), reach_index_->coverage_entries());
+}
+
+void ProtectionSystem::relay_settings_changed(std::size_t relay)
+{
+    if (reach_index_ && reach_index_->relay_count() == relays_.size())
+        reach_index_->relay_changed(relay, relay_reach_Ohm(relay));
+    else
+        refresh_reach_index();
+}
+
 cps_coro::Task ProtectionSystem::run()
 {
-    if (g_console_logger)
-        g_console_logger->info("[{}ms] [ProtectionSystem] ECS Protection System active, awaiting FAULT_INFO_EVENT_PROT.",
-            scheduler_.now().time_since_epoch().count());
+    HECS_LOG_INFO(LogSubsystem::Protection, "[{}ms] [ProtectionSystem] ECS Protection System active, awaiting FAULT_INFO_EVENT_PROT.",
+        scheduler_.now().time_since_epoch().count());
     while (true) {
         auto fault_data = co_await cps_coro::wait_for_event<FaultInfo>(FAULT_INFO_EVENT_PROT);
         fault_data.calculate_impedance_if_needed();
 
-        if (g_console_logger)
-            g_console_logger->info("[{}ms] [ProtectionSystem] Received FAULT_INFO_EVENT_PROT. Fault on Entity #{} (Current: {}kA, Impedance: {}Ohm, Dist: {}km).",
-                scheduler_.now().time_since_epoch().count(),
-                fault_data.faulty_entity_id, fault_data.current_kA,
-                fault_data.impedance_Ohm, fault_data.distance_km);
-
-        registry_.for_each<ProtectiveComp>([&](ProtectiveComp& comp, Entity entity_id) {
-            if (comp.pick_up(fault_data, entity_id)) {
-                int delay_ms = comp.trip_delay_ms(fault_data);
-                if (g_console_logger)
-                    g_console_logger->info("[{}ms] [Prot-{}] Entity#{} PICKED UP. Calculated trip delay: {} ms.",
+        HECS_LOG_INFO(LogSubsystem::Protection, "[{}ms] [ProtectionSystem] Received FAULT_INFO_EVENT_PROT. Fault on Entity #{} (Current: {}kA, Impedance: {}Ohm, Dist: {}km).",
+            scheduler_.now().time_since_epoch().count(),
+            fault_data.faulty_entity_id, fault_data.current_kA,
+            fault_data.impedance_Ohm, fault_data.distance_km);
+
+        const bool network_fault = network_ && network_->fault_at(fault_data);
+        if (network_fault)
+            HECS_LOG_INFO(LogSubsystem::Protection, "[{}ms] [ProtectionSystem] Network short-circuit: {:.2f} kA at the fault.",
+                scheduler_.now().time_since_epoch().count(), std::abs(network_->last_fault().fault_current_kA));
+
+        // Only the relays that can see a network fault are evaluated.
+        std::vector<std::size_t> candidates;
+        refresh_reach_index();
+        if (network_fault && reach_index_ && reach_index_->candidates(fault_data.faulty_entity_id, candidates)) {
+            HECS_LOG_INFO(LogSubsystem::Protection, "[{}ms] [ProtectionSystem] {} of {} relays within reach.",
+                scheduler_.now().time_since_epoch().count(), candidates.size(), relays_.size());
+        } else {
+            candidates.resize(relays_.size());
+            for (std::size_t r = 0; r < candidates.size(); ++r)
+                candidates[r] = r;
+        }
+        std::vector<SampledPickup> sampled;
+        if (network_fault && sampled_rate_Hz_ > 0.0)
+            sampled = sample_relays(fault_data, candidates);
+        for (std::size_t index : candidates) {
+            relays_.visit(index, [&](auto& comp, Entity entity_id) {
+                if (!sampled.empty() && sampled[index].measured) {
+                    const SampledPickup& pickup = sampled[index];
+                    if (pickup.pickup_ms < 0.0 || pickup.trip_delay_ms == kNoTripDelayMs)
+                        return;
+                    HECS_LOG_INFO(LogSubsystem::Protection, "[{}ms] [Prot-{}] Entity#{} PICKED UP after {:.2f} ms of sampled values ({:.2f} kA, {:.2f} Ohm). Calculated trip delay: {} ms.",
                         scheduler_.now().time_since_epoch().count(),
-                        comp.name(), entity_id, delay_ms);
-                auto sub_task = trip_later(entity_id, delay_ms, comp.name(), fault_data.faulty_entity_id);
-                sub_task.detach();
+                        comp.name(), entity_id, pickup.pickup_ms, pickup.settled.current_kA, pickup.settled.impedance_Ohm, pickup.trip_delay_ms);
+                    auto sub_task = trip_later(entity_id, pickup.trip_delay_ms, comp.name(), fault_data);
+                    sub_task.detach();
+                    return;
+                }
+                FaultInfo seen = fault_data;
+                if (network_fault)
+                    network_->relay_view(network_->last_fault(), entity_id, seen);
+                if (comp.pick_up(seen, entity_id)) {
+                    int delay_ms = comp.trip_delay_ms(seen);
+                    if (delay_ms == kNoTripDelayMs)
+                        return;
+                    HECS_LOG_INFO(LogSubsystem::Protection, "[{}ms] [Prot-{}] Entity#{} PICKED UP ({:.2f} kA, {:.2f} Ohm). Calculated trip delay: {} ms.",
+                        scheduler_.now().time_since_epoch().count(),
+                        comp.name(), entity_id, seen.current_kA, seen.impedance_Ohm, delay_ms);
+                    auto sub_task = trip_later(entity_id, delay_ms, comp.name(), fault_data);
+                    sub_task.detach();
+                }
+            });
+        }
+    }
+}
+
+void ProtectionSystem::set_sampled_values(double sample_rate_Hz, double nominal_Hz)
+{
+    sampled_rate_Hz_ = sample_rate_Hz;
+    nominal_Hz_ = nominal_Hz;
+}
+
+std::vector<ProtectionSystem::SampledPickup> ProtectionSystem::sample_relays(const FaultInfo& fault, std::span<const std::size_t> relay_indices)
+{
+    // One measurement point per distinct relay entity on a network branch.
+    std::vector<Entity> points;
+    for (std::size_t relay : relay_indices) {
+        const Entity entity_id = relays_.entity(relay);
+        if (network_->branch_index(entity_id) >= 0 && std::find(points.begin(), points.end(), entity_id) == points.end())
+            points.push_back(entity_id);
+    }
+    std::vector<SampledRelayChannels> channels(points.size());
+    for (std::size_t p = 0; p < points.size(); ++p) {
+        channels[p].entity = points[p];
+        for (std::size_t k = 0; k < NetworkWaveformSource::kChannelsPerRelay; ++k)
+            channels[p].channel[k] = p * NetworkWaveformSource::kChannelsPerRelay + k;
+    }
+    NetworkWaveformSource source(*network_, network_->last_fault(), points, sampled_rate_Hz_, nominal_Hz_);
+    return evaluate_sampled(source, channels, source.inception_frame(), fault, relay_indices);
+}
+
+std::vector<ProtectionSystem::SampledPickup> ProtectionSystem::evaluate_sampled(SampledValueSource& source,
+    std::span<const SampledRelayChannels> relays, std::size_t inception_frame, const FaultInfo& fault)
+{
+    std::vector<std::size_t> all(relays_.size());
+    for (std::size_t r = 0; r < all.size(); ++r)
+        all[r] = r;
+    return evaluate_sampled(source, relays, inception_frame, fault, all);
+}
+
+std::vector<ProtectionSystem::SampledPickup> ProtectionSystem::evaluate_sampled(SampledValueSource& source,
+    std::span<const SampledRelayChannels> relays, std::size_t inception_frame, const FaultInfo& fault,
+    std::span<const std::size_t> relay_indices)
+{
+    std::vector<SampledPickup> result(relays_.size());
+    // (flat relay index, measurement point) of the relays with channels.
+    std::vector<std::pair<std::size_t, std::size_t>> measured;
+    for (std::size_t relay : relay_indices) {
+        const Entity entity_id = relays_.entity(relay);
+        auto it = std::find_if(relays.begin(), relays.end(), [&](const SampledRelayChannels& r) { return r.entity == entity_id; });
+        if (it != relays.end())
+            measured.emplace_back(relay, static_cast<std::size_t>(it - relays.begin()));
+    }
+    const std::size_t channel_count = source.channel_count();
+    if (measured.empty() || channel_count == 0 || source.sample_rate_Hz() <= 0.0)
+        return result;
+
+    const double rate_Hz = source.sample_rate_Hz();
+    PhasorEstimator estimator(channel_count, static_cast<std::size_t>(std::lround(rate_Hz / nominal_Hz_)));
+    const std::complex<float> a = std::polar(1.0f, 2.0f * std::numbers::pi_v<float> / 3.0f);
+    // Frames are read in blocks but pushed one at a time: pick-up is decided
+    // sample by sample.
+    constexpr std::size_t kBlockFrames = 256;
+    std::vector<float> block(kBlockFrames * channel_count);
+    std::vector<FaultInfo> views(relays.size());
+    std::size_t n = 0;
+    for (std::size_t frames; (frames = source.read(block)) > 0;) {
+        for (std::size_t f = 0; f < frames; ++f, ++n) {
+            estimator.push(std::span<const float>(block.data() + f * channel_count, channel_count));
+            if (n < inception_frame)
+                continue;
+            const double after_inception_ms = static_cast<double>(n + 1 - inception_frame) * 1000.0 / rate_Hz;
+            for (std::size_t p = 0; p < relays.size(); ++p) {
+                // Positive-sequence current and voltage of the point's channels.
+                const auto& ch = relays[p].channel;
+                const std::complex<float> i1 = (estimator.phasor(ch[0]) + a * estimator.phasor(ch[1]) + a * a * estimator.phasor(ch[2])) / 3.0f;
+                const std::complex<float> v1 = (estimator.phasor(ch[3]) + a * estimator.phasor(ch[4]) + a * a * estimator.phasor(ch[5])) / 3.0f;
+                const double current = std::abs(i1) > kMinMeasurableCurrent_kA ? std::abs(i1) : 0.0;
+                FaultInfo& view = views[p];
+                view = fault;
+                view.current_kA = current;
+                view.voltage_kV = std::sqrt(3.0) * std::abs(v1);
+                view.impedance_Ohm = current > 0.0 ? std::abs(v1) / current : std::numeric_limits<double>::infinity();
+            }
+            for (const auto& [relay, point] : measured) {
+                relays_.visit(relay, [&](auto& comp, Entity entity_id) {
+                    SampledPickup& pickup = result[relay];
+                    pickup.measured = true;
+                    pickup.settled = views[point];
+                    if (!comp.pick_up(pickup.settled, entity_id))
+                        pickup.pickup_ms = -1.0;
+                    else if (pickup.pickup_ms < 0.0)
+                        pickup.pickup_ms = after_inception_ms;
+                });
+            }
+        }
+    }
+    for (const auto& [relay, point] : measured) {
+        relays_.visit(relay, [&](auto& comp, Entity /*entity_id*/) {
+            SampledPickup& pickup = result[relay];
+            pickup.protection = comp.name();
+            if (pickup.measured && pickup.pickup_ms >= 0.0) {
+                const int delay_ms = comp.trip_delay_ms(pickup.settled);
+                pickup.trip_delay_ms = delay_ms == kNoTripDelayMs ? kNoTripDelayMs : static_cast<int>(std::ceil(pickup.pickup_ms)) + delay_ms;
             }
         });
     }
+    return result;
+}
+
+bool ProtectionSystem::measures_fault_current(Entity relay_entity_id, const FaultInfo& fault)
+{
+    // The topology may have changed since pickup; relays outside the model
+    // cannot tell and keep their decision.
+    FaultInfo seen;
+    if (!network_ || !network_->fault_at(fault) || !network_->relay_view(network_->last_fault(), relay_entity_id, seen))
+        return true;
+    return seen.current_kA > 0.0;
 }
 
-cps_coro::Task ProtectionSystem::trip_later(Entity protected_entity_id, int delay_ms, const char* protection_name, Entity actual_faulty_entity_id)
+cps_coro::Task ProtectionSystem::trip_later(Entity protected_entity_id, int delay_ms, std::string protection_name, FaultInfo fault)
 {
     co_await cps_coro::delay(cps_coro::Scheduler::duration(delay_ms));
-    if (g_console_logger)
-        g_console_logger->info("[{}ms] [Prot-{}] Entity#{} => TRIPPING! (Due to fault on Entity#{})",
+    if (!measures_fault_current(protected_entity_id, fault)) {
+        HECS_LOG_INFO(LogSubsystem::Protection, "[{}ms] [Prot-{}] Entity#{} reset: fault current on Entity#{} interrupted.",
             scheduler_.now().time_since_epoch().count(),
-            protection_name, protected_entity_id, actual_faulty_entity_id);
+            protection_name, protected_entity_id, fault.faulty_entity_id);
+        co_return;
+    }
+    HECS_LOG_INFO(LogSubsystem::Protection, "[{}ms] [Prot-{}] Entity#{} => TRIPPING! (Due to fault on Entity#{})",
+        scheduler_.now().time_since_epoch().count(),
+        protection_name, protected_entity_id, fault.faulty_entity_id);
     scheduler_.trigger_event(ENTITY_TRIP_EVENT_PROT, protected_entity_id);
 }
 
@@ -112,8 +470,8 @@ cps_coro::Task faultInjectorTask_prot(ProtectionSystem& protSystem, Entity line1
     fault1.voltage_kV = 220.0;
     fault1.distance_km = 10.0;
     fault1.impedance_Ohm = (220.0 / 15.0) * 0.8; // Example impedance
-    if (g_console_logger && g_scheduler)
-        g_console_logger->info("[{}ms] [FaultInjector_PROT] Injecting Fault #1 on Line Entity#{}.",
+    if (g_scheduler)
+        HECS_LOG_INFO(LogSubsystem::Protection, "[{}ms] [FaultInjector_PROT] Injecting Fault #1 on Line Entity#{}.",
             g_scheduler->now().time_since_epoch().count(), line1_id);
     protSystem.inject_fault(fault1);
 
@@ -123,31 +481,41 @@ cps_coro::Task faultInjectorTask_prot(ProtectionSystem& protSystem, Entity line1
     fault2.current_kA = 3.0; // ... rest of fault2 setup
     fault2.voltage_kV = 220.0;
     fault2.calculate_impedance_if_needed(); // Calculate if not manually set
-    if (g_console_logger && g_scheduler)
-        g_console_logger->info("[{}ms] [FaultInjector_PROT] Injecting Fault #2 on Transformer Entity#{}.",
+    if (g_scheduler)
+        HECS_LOG_INFO(LogSubsystem::Protection, "[{}ms] [FaultInjector_PROT] Injecting Fault #2 on Transformer Entity#{}.",
             g_scheduler->now().time_since_epoch().count(), transformer1_id);
     protSystem.inject_fault(fault2);
     co_return;
 }
 
-cps_coro::Task circuitBreakerAgentTask_prot(Entity associated_entity_id, const std::string& entity_name, cps_coro::Scheduler& /*scheduler_ref_for_logging_time*/)
+cps_coro::Task networkTopologyTask_prot(NetworkModel& network, cps_coro::Scheduler& scheduler, RelayReachIndex* reach_index)
 {
-    if (g_console_logger && g_scheduler)
-        g_console_logger->info("[{}ms] [BreakerAgent_PROT-{}-#{}] Active, awaiting ENTITY_TRIP_EVENT_PROT.",
-            g_scheduler->now().time_since_epoch().count(), entity_name, associated_entity_id);
     while (true) {
-        Entity tripped_entity_id = co_await cps_coro::wait_for_event<Entity>(ENTITY_TRIP_EVENT_PROT);
-        if (tripped_entity_id == associated_entity_id) {
-            if (g_console_logger && g_scheduler)
-                g_console_logger->info("[{}ms] [BreakerAgent_PROT-{}-#{}] Received TRIP for self.",
-                    g_scheduler->now().time_since_epoch().count(), entity_name, associated_entity_id);
-            co_await cps_coro::delay(cps_coro::Scheduler::duration(100)); // Breaker operating time
-            if (g_console_logger && g_scheduler)
-                g_console_logger->info("[{}ms] [BreakerAgent_PROT-{}-#{}] Breaker OPENED.",
-                    g_scheduler->now().time_since_epoch().count(), entity_name, associated_entity_id);
-            if (g_scheduler) {
-                g_scheduler->trigger_event(BREAKER_OPENED_EVENT, associated_entity_id);
-            }
-        }
+        Entity opened_entity_id = co_await cps_coro::wait_for_event<Entity>(BREAKER_OPENED_EVENT);
+        if (network.branch_index(opened_entity_id) < 0 || !network.branch_closed(opened_entity_id))
+            continue;
+        bool solved = network.set_branch_closed(opened_entity_id, false);
+        if (reach_index)
+            reach_index->branch_switched(opened_entity_id);
+        HECS_LOG_INFO(LogSubsystem::Protection, "[{}ms] [NetworkTopology_PROT] Branch#{} opened: {} islands, {}/{} buses energized, {} factor rows updated{}.",
+            scheduler.now().time_since_epoch().count(), opened_entity_id, network.island_count(),
+            network.energized_bus_count(), network.bus_count(), network.last_updated_rows(),
+            solved ? "" : " (singular network)");
     }
-}
\ No newline at end of file
+}
+
+cps_coro::Task networkReclosingTask_prot(NetworkModel& network, cps_coro::Scheduler& scheduler, RelayReachIndex* reach_index)
+{
+    while (true) {
+        Entity closed_entity_id = co_await cps_coro::wait_for_event<Entity>(BREAKER_CLOSED_EVENT);
+        if (network.branch_index(closed_entity_id) < 0 || network.branch_closed(closed_entity_id))
+            continue;
+        bool solved = network.set_branch_closed(closed_entity_id, true);
+        if (reach_index)
+            reach_index->branch_switched(closed_entity_id);
+        HECS_LOG_INFO(LogSubsystem::Protection, "[{}ms] [NetworkTopology_PROT] Branch#{} reclosed: {} islands, {}/{} buses energized, {} factor rows updated{}.",
+            scheduler.now().time_since_epoch().count(), closed_entity_id, network.island_count(),
+            network.energized_bus_count(), network.bus_count(), network.last_updated_rows(),
+            solved ? "" : " (singular network)");
+    }
+}
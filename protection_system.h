@@ -4,45 +4,242 @@
 
 #include "cps_coro_lib.h"
 #include "ecs_core.h"
+#include "inverse_time_curve.h"
+#include "network_model.h"
+#include "relay_reach_index.h"
+#include "sampled_values.h"
 #include "simulation_events_and_data.h"
 // #include <iostream> // Replaced by spdlog
+#include <array>
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <span>
 #include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 // Forward declare Scheduler if passed as parameter, or use AwaiterBase for implicit access
 // extern cps_coro::Scheduler* g_scheduler; // Assuming g_scheduler is accessible globally or passed
 
+// Trip delay of a relay that does not operate: not picked up, outside every
+// zone, or at a current where its curve time is infinite. Never scheduled.
+constexpr int kNoTripDelayMs = std::numeric_limits<int>::max();
+
 class ProtectiveComp : public IComponent {
 public:
     virtual bool pick_up(const FaultInfo& fault_data, Entity self_entity_id) = 0;
     virtual int trip_delay_ms(const FaultInfo& fault_data) const = 0;
     virtual const char* name() const = 0;
+    // Largest electrical distance, in ohms from the relay's bus, of a bolted
+    // fault the relay can pick up when the fault is fed at phase_voltage_kV
+    // (see RelayReachIndex); infinity when the settings do not bound it.
+    virtual double reach_Ohm(double phase_voltage_kV) const;
+    // Batch form of pick_up/trip_delay_ms for fault sweeps: per case, the trip
+    // delay (kNoTripDelayMs when not picked up) and the pickup margin (> 1
+    // means the relay operates with room to spare). The default evaluates the
+    // scalar functions case by case; relays override it with a loop over the
+    // columns that the compiler can vectorize.
+    virtual void evaluate_cases(const FaultCaseSpan& cases, Entity self_entity_id, int* delay_ms, double* margin);
     virtual ~ProtectiveComp() = default;
 };
 
-class OverCurrentProtection : public ProtectiveComp {
+// Definite-time stage, or an inverse-time stage following an IEC/IEEE curve
+// scaled by the time multiplier (TMS / time dial).
+struct OverCurrentSettings {
+    double pickup_current_kA = 0.0;
+    int fixed_delay_ms = 0;
+    double time_multiplier = 1.0;
+    const InverseTimeCurveTable* curve_table = nullptr; // Null for definite time
+
+    bool pick_up(const FaultInfo& fault_data, Entity self_entity_id) const;
+    int trip_delay_ms(const FaultInfo& fault_data) const;
+    double reach_Ohm(double phase_voltage_kV) const;
+    void evaluate_cases(const FaultCaseSpan& cases, Entity self_entity_id, int* delay_ms, double* margin) const;
+};
+
+class OverCurrentProtection final : public ProtectiveComp {
 public:
     OverCurrentProtection(double pickup_current_kA, int delay_ms, std::string stage_name = "OC");
+    OverCurrentProtection(double pickup_current_kA, OvercurrentCurve curve, double time_multiplier, std::string stage_name = "OC");
     bool pick_up(const FaultInfo& fault_data, Entity self_entity_id) override;
     int trip_delay_ms(const FaultInfo& fault_data) const override;
     const char* name() const override;
+    double reach_Ohm(double phase_voltage_kV) const override;
+    void evaluate_cases(const FaultCaseSpan& cases, Entity self_entity_id, int* delay_ms, double* margin) override;
+    const OverCurrentSettings& settings() const { return settings_; }
 
 private:
-    double pickup_current_kA_;
-    int fixed_delay_ms_;
+    OverCurrentSettings settings_;
     std::string stage_name_;
 };
 
-class DistanceProtection : public ProtectiveComp {
+// Three impedance zones, each with its own delay.
+struct DistanceSettings {
+    std::array<double, 3> z_set_Ohm {};
+    std::array<int, 3> t_ms {};
+
+    bool pick_up(const FaultInfo& fault_data, Entity self_entity_id) const;
+    int trip_delay_ms(const FaultInfo& fault_data) const;
+    double reach_Ohm(double phase_voltage_kV) const;
+    void evaluate_cases(const FaultCaseSpan& cases, Entity self_entity_id, int* delay_ms, double* margin) const;
+};
+
+class DistanceProtection final : public ProtectiveComp {
 public:
     DistanceProtection(double z1_ohm, int t1_ms, double z2_ohm, int t2_ms, double z3_ohm, int t3_ms);
     bool pick_up(const FaultInfo& fault_data, Entity self_entity_id) override;
     int trip_delay_ms(const FaultInfo& fault_data) const override;
     const char* name() const override;
+    double reach_Ohm(double phase_voltage_kV) const override;
+    void evaluate_cases(const FaultCaseSpan& cases, Entity self_entity_id, int* delay_ms, double* margin) override;
+    const DistanceSettings& settings() const { return settings_; }
+
+private:
+    DistanceSettings settings_;
+};
+
+// One built-in relay type stored column-wise: the protected entities and
+// each setting in its own array, so the per-relay loops read only the
+// settings they use. Names are kept apart; only logging reads them.
+template <typename Relay>
+struct RelayPool;
+
+template <>
+struct RelayPool<OverCurrentProtection> {
+    std::vector<Entity> entities;
+    std::vector<double> pickup_current_kA;
+    std::vector<int> fixed_delay_ms;
+    std::vector<double> time_multiplier;
+    std::vector<const InverseTimeCurveTable*> curve_table;
+    std::vector<std::string> stage_names;
+
+    std::size_t size() const { return entities.size(); }
+    void push_back(Entity entity, const OverCurrentProtection& relay);
+    OverCurrentSettings settings(std::size_t row) const
+    {
+        return { pickup_current_kA[row], fixed_delay_ms[row], time_multiplier[row], curve_table[row] };
+    }
+    const char* name(std::size_t row) const { return stage_names[row].c_str(); }
+};
+
+template <>
+struct RelayPool<DistanceProtection> {
+    std::vector<Entity> entities;
+    std::array<std::vector<double>, 3> z_set_Ohm; // By zone
+    std::array<std::vector<int>, 3> t_ms;
+
+    std::size_t size() const { return entities.size(); }
+    void push_back(Entity entity, const DistanceProtection& relay);
+    DistanceSettings settings(std::size_t row) const
+    {
+        return { { z_set_Ohm[0][row], z_set_Ohm[1][row], z_set_Ohm[2][row] }, { t_ms[0][row], t_ms[1][row], t_ms[2][row] } };
+    }
+    const char* name(std::size_t /*row*/) const { return "DIST"; }
+};
+
+// A relay in a built-in pool, with the relay's interface over one row.
+template <typename Relay>
+class RelayRef {
+public:
+    RelayRef(const RelayPool<Relay>& pool, std::size_t row)
+        : pool_(pool)
+        , row_(row)
+    {
+    }
+    bool pick_up(const FaultInfo& fault_data, Entity self_entity_id) const { return pool_.settings(row_).pick_up(fault_data, self_entity_id); }
+    int trip_delay_ms(const FaultInfo& fault_data) const { return pool_.settings(row_).trip_delay_ms(fault_data); }
+    const char* name() const { return pool_.name(row_); }
+    double reach_Ohm(double phase_voltage_kV) const { return pool_.settings(row_).reach_Ohm(phase_voltage_kV); }
+    void evaluate_cases(const FaultCaseSpan& cases, Entity self_entity_id, int* delay_ms, double* margin) const
+    {
+        pool_.settings(row_).evaluate_cases(cases, self_entity_id, delay_ms, margin);
+    }
+
+private:
+    const RelayPool<Relay>& pool_;
+    std::size_t row_;
+};
+
+// Relay storage for the protection system. The built-in types form a closed
+// set, each kept in its own pool and called through its final type, so the
+// per-relay calls inline into one loop per type. Any other ProtectiveComp is
+// an extension: it lives in a separate pool and is called through the vtable.
+class ProtectionRelayPools {
+public:
+    template <typename Relay, typename... Args>
+    void emplace(Entity entity, Args&&... args)
+    {
+        static_assert(std::is_base_of<ProtectiveComp, Relay>::value, "Relay must derive from ProtectiveComp");
+        if constexpr (is_builtin<Relay>) {
+            std::get<RelayPool<Relay>>(pools_).push_back(entity, Relay(std::forward<Args>(args)...));
+        } else {
+            custom_entities_.push_back(entity);
+            custom_.push_back(std::make_unique<Relay>(std::forward<Args>(args)...));
+        }
+    }
+
+    // fn(relay, entity) for every relay; built-ins are passed as a
+    // RelayRef over their pool, extensions as ProtectiveComp&.
+    template <typename Fn>
+    void for_each(Fn&& fn)
+    {
+        std::apply([&](auto&... pool) { (for_each_in(pool, fn), ...); }, pools_);
+        for (std::size_t i = 0; i < custom_.size(); ++i)
+            fn(*custom_[i], custom_entities_[i]);
+    }
+
+    // Flat relay index: the built-in pools in order, then the extensions.
+    // Indices stay valid until the next emplace.
+    std::size_t size() const;
+    Entity entity(std::size_t relay) const;
+    const char* name(std::size_t relay) const;
+    void evaluate_cases(std::size_t relay, const FaultCaseSpan& cases, int* delay_ms, double* margin);
+    // fn(relay, entity) for one flat index, typed as in for_each.
+    template <typename Fn>
+    void visit(std::size_t relay, Fn&& fn) { visit(*this, relay, fn); }
 
 private:
-    std::vector<double> z_set_;
-    std::vector<int> t_ms_;
+    using BuiltinPools = std::tuple<RelayPool<OverCurrentProtection>, RelayPool<DistanceProtection>>;
+
+    template <typename Relay>
+    static constexpr bool is_builtin = std::is_same_v<Relay, OverCurrentProtection> || std::is_same_v<Relay, DistanceProtection>;
+
+    template <typename Relay, typename Fn>
+    static void for_each_in(const RelayPool<Relay>& pool, Fn& fn)
+    {
+        for (std::size_t i = 0; i < pool.size(); ++i) {
+            RelayRef<Relay> relay(pool, i);
+            fn(relay, pool.entities[i]);
+        }
+    }
+
+    // Calls fn(relay, entity) for one flat index.
+    template <typename Self, typename Fn>
+    static void visit(Self& self, std::size_t relay, Fn&& fn)
+    {
+        bool found = false;
+        auto visit_pool = [&](const auto& pool) {
+            if (found)
+                return;
+            if (relay >= pool.size()) {
+                relay -= pool.size();
+                return;
+            }
+            RelayRef ref(pool, relay);
+            fn(ref, pool.entities[relay]);
+            found = true;
+        };
+        std::apply([&](const auto&... pool) { (visit_pool(pool), ...); }, self.pools_);
+        if (!found)
+            fn(*self.custom_[relay], self.custom_entities_[relay]);
+    }
+
+    BuiltinPools pools_;
+    std::vector<Entity> custom_entities_;
+    std::vector<std::unique_ptr<ProtectiveComp>> custom_;
 };
 
 class ProtectionSystem {
@@ -50,14 +247,77 @@ public:
     ProtectionSystem(Registry& reg, cps_coro::Scheduler& sch); // Pass scheduler explicitly
     cps_coro::Task run();
     void inject_fault(const FaultInfo& info);
+    ProtectionRelayPools& relays() { return relays_; }
+    // With a network model, faults on its buses and branches are solved on
+    // the network and each relay on a branch sees its own current, voltage
+    // and impedance; other faults and relays use the injected FaultInfo.
+    // A relay whose current has been interrupted by another breaker when its
+    // delay expires resets instead of tripping.
+    // A reach index over the network limits each fault to the relays that
+    // can see it (see RelayReachIndex); it follows relays added later, and
+    // settings and topology changes reported below.
+    void set_network(NetworkModel* network);
+    // Null without a network.
+    RelayReachIndex* reach_index() { return reach_index_.get(); }
+    // Re-indexes one relay (flat index) after its settings were changed.
+    void relay_settings_changed(std::size_t relay);
+    // Drives the relays on network branches from sampled waveforms instead
+    // of the phasor snapshot: each network fault is synthesized at
+    // sample_rate_Hz (one pre-fault and two fault cycles), its phasors are
+    // estimated sample by sample with a full-cycle DFT, and a relay picks up
+    // at the first sample from which its positive-sequence measurement keeps
+    // satisfying pick-up. The trip delay counts from that sample and uses the
+    // measurement at the end of the window. 0 (the default) turns it off.
+    void set_sampled_values(double sample_rate_Hz, double nominal_Hz = 50.0);
+
+    // Where a relay's waveforms are in a sampled-value stream: channels of
+    // Ia Ib Ic in kA and Va Vb Vc (phase) in kV.
+    struct SampledRelayChannels {
+        Entity entity;
+        std::array<std::size_t, 6> channel;
+    };
+    // Outcome of the sampled-value evaluation for one relay.
+    struct SampledPickup {
+        bool measured = false; // Its entity has channels in the stream
+        const char* protection = nullptr; // Name, when measured
+        double pickup_ms = -1.0; // After inception; < 0 when not picked up
+        int trip_delay_ms = -1; // From inception, when picked up
+        FaultInfo settled; // At the end of the stream
+    };
+    // Runs every relay whose entity has channels over the whole stream, with
+    // the fault inception at `inception_frame`: the same evaluation as for
+    // synthesized network faults, for recorded waveforms (e.g. a
+    // ComtradeRecord). `fault` supplies the fields not measured. The stream's
+    // nominal frequency is the one given to set_sampled_values. Results are
+    // by flat relay index (see ProtectionRelayPools); nothing is scheduled.
+    std::vector<SampledPickup> evaluate_sampled(SampledValueSource& source, std::span<const SampledRelayChannels> relays,
+        std::size_t inception_frame, const FaultInfo& fault);
 
 private:
-    cps_coro::Task trip_later(Entity protected_entity_id, int delay_ms, const char* protection_name, Entity actual_faulty_entity_id);
+    // evaluate_sampled over the network's last fault, for the relays listed.
+    std::vector<SampledPickup> sample_relays(const FaultInfo& fault, std::span<const std::size_t> relay_indices);
+    std::vector<SampledPickup> evaluate_sampled(SampledValueSource& source, std::span<const SampledRelayChannels> relays,
+        std::size_t inception_frame, const FaultInfo& fault, std::span<const std::size_t> relay_indices);
+    // Rebuilds the reach index when relays were added since it was built.
+    void refresh_reach_index();
+    double relay_reach_Ohm(std::size_t relay);
+
+    cps_coro::Task trip_later(Entity protected_entity_id, int delay_ms, std::string protection_name, FaultInfo fault);
+    bool measures_fault_current(Entity relay_entity_id, const FaultInfo& fault);
     Registry& registry_;
+    ProtectionRelayPools relays_;
+    NetworkModel* network_ = nullptr;
+    std::unique_ptr<RelayReachIndex> reach_index_;
+    double sampled_rate_Hz_ = 0.0;
+    double nominal_Hz_ = 50.0;
     cps_coro::Scheduler& scheduler_; // Store reference to scheduler
 };
 
 cps_coro::Task faultInjectorTask_prot(ProtectionSystem& protSystem, Entity line1_id, Entity transformer1_id, cps_coro::Scheduler& scheduler); // Pass scheduler
-cps_coro::Task circuitBreakerAgentTask_prot(Entity associated_entity_id, const std::string& entity_name, cps_coro::Scheduler& scheduler); // Pass scheduler
+// Applies BREAKER_OPENED_EVENT to the network model's topology, and to the
+// relay reach index when one is given.
+cps_coro::Task networkTopologyTask_prot(NetworkModel& network, cps_coro::Scheduler& scheduler, RelayReachIndex* reach_index = nullptr);
+// The same for BREAKER_CLOSED_EVENT (auto-reclosing, see BreakerSystem).
+cps_coro::Task networkReclosingTask_prot(NetworkModel& network, cps_coro::Scheduler& scheduler, RelayReachIndex* reach_index = nullptr);
 
 #endif // PROTECTION_SYSTEM_H
\ No newline at end of file
@@ -0,0 +1,335 @@
+// radial_power_flow.cpp
+#include "radial_power_flow.h"
+#include "network_model.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <thread>
+#include <utility>
+
+namespace {
+
+const double kSqrt3 = std::sqrt(3.0);
+
+struct Link {
+    Entity branch;
+    int other;
+    std::complex<double> impedance_Ohm;
+};
+
+} // namespace
+
+RadialPowerFlow::RadialPowerFlow(Registry& reg, std::size_t threads)
+    : registry_(reg)
+    , threads_(threads > 0 ? threads : std::max(1u, std::thread::hardware_concurrency()))
+{
+}
+
+void RadialPowerFlow::build()
+{
+    // Entities are sorted so feeder layout does not depend on hash-map order.
+    std::vector<std::pair<Entity, double>> buses;
+    registry_.for_each<BusComponent>([&](BusComponent& bus, Entity e) { buses.emplace_back(e, bus.nominal_kV); });
+    std::sort(buses.begin(), buses.end());
+    std::unordered_map<Entity, int> bus_index;
+    for (std::size_t b = 0; b < buses.size(); ++b)
+        bus_index[buses[b].first] = static_cast<int>(b);
+
+    std::vector<std::vector<Link>> links(buses.size());
+    registry_.for_each<BranchComponent>([&](BranchComponent& branch, Entity e) {
+        auto from = bus_index.find(branch.from_bus);
+        auto to = bus_index.find(branch.to_bus);
+        if (!branch.closed || from == bus_index.end() || to == bus_index.end() || from->second == to->second)
+            return;
+        links[from->second].push_back({ e, to->second, branch.impedance_Ohm });
+        links[to->second].push_back({ e, from->second, branch.impedance_Ohm });
+    });
+    for (auto& bus_links : links)
+        std::sort(bus_links.begin(), bus_links.end(), [](const Link& a, const Link& b) { return a.branch < b.branch; });
+
+    std::vector<std::pair<Entity, const SourceComponent*>> sources;
+    registry_.for_each<SourceComponent>([&](SourceComponent& source, Entity e) { sources.emplace_back(e, &source); });
+    std::sort(sources.begin(), sources.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+
+    feeders_.clear();
+    located_.clear();
+    std::vector<Location> location(buses.size(), Location { -1, -1 });
+    std::unordered_map<Entity, char> branch_seen;
+    std::vector<std::vector<int>> feeder_depths;
+    for (const auto& [source_entity, source] : sources) {
+        auto root_it = bus_index.find(source->bus);
+        if (root_it == bus_index.end())
+            continue;
+        const int root = root_it->second;
+        const std::complex<double> emf_kV = source->voltage_kV / kSqrt3;
+        if (location[root].feeder >= 0) {
+            feeders_[location[root].feeder].loops.push_back({ location[root].index, -1, source->impedance_Ohm, emf_kV, {} });
+            continue;
+        }
+
+        const int feeder_id = static_cast<int>(feeders_.size());
+        Feeder& feeder = feeders_.emplace_back();
+        feeder.emf_kV = emf_kV;
+        std::vector<int> global; // Local index -> bus index
+        std::vector<int> depth;
+        auto add_bus = [&](int b, int parent, std::complex<double> impedance) {
+            location[b] = { feeder_id, static_cast<int>(global.size()) };
+            global.push_back(b);
+            depth.push_back(parent < 0 ? 0 : depth[parent] + 1);
+            feeder.bus.push_back(buses[b].first);
+            feeder.parent.push_back(parent);
+            feeder.impedance_Ohm.push_back(impedance);
+        };
+        add_bus(root, -1, source->impedance_Ohm);
+        for (std::size_t head = 0; head < global.size(); ++head) {
+            for (const Link& link : links[global[head]]) {
+                if (branch_seen[link.branch])
+                    continue;
+                branch_seen[link.branch] = 1;
+                if (location[link.other].feeder < 0) {
+                    add_bus(link.other, static_cast<int>(head), link.impedance_Ohm);
+                    continue;
+                }
+                // Closes a loop: keep it as a breakpoint.
+                feeder.loops.push_back({ static_cast<int>(head), location[link.other].index, link.impedance_Ohm, {}, {} });
+            }
+        }
+
+        const std::size_t n = feeder.bus.size();
+        feeder.load_kVA.assign(n, {});
+        feeder.voltage_kV.assign(n, emf_kV); // Flat start
+        feeder.current_A.assign(n, {});
+        feeder.base_kV.resize(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            feeder.base_kV[i] = buses[global[i]].second / kSqrt3;
+            located_[feeder.bus[i]] = { feeder_id, static_cast<int>(i) };
+        }
+        feeder_depths.push_back(std::move(depth));
+    }
+    // Further sources are only known once every feeder is laid out.
+    for (std::size_t f = 0; f < feeders_.size(); ++f)
+        build_loop_matrix(feeders_[f], feeder_depths[f]);
+    refresh_loads();
+}
+
+void RadialPowerFlow::refresh_loads()
+{
+    for (Feeder& feeder : feeders_)
+        std::fill(feeder.load_kVA.begin(), feeder.load_kVA.end(), std::complex<double> {});
+    registry_.for_each<LoadComponent>([&](LoadComponent& load, Entity) {
+        auto it = located_.find(load.bus);
+        if (it != located_.end())
+            feeders_[it->second.feeder].load_kVA[it->second.index] += std::complex<double>(load.p_kW, load.q_kvar) / 3.0;
+    });
+}
+
+bool RadialPowerFlow::set_load(Entity bus, double p_kW, double q_kvar)
+{
+    auto it = located_.find(bus);
+    if (it == located_.end())
+        return false;
+    feeders_[it->second.feeder].load_kVA[it->second.index] = std::complex<double>(p_kW, q_kvar) / 3.0;
+    return true;
+}
+
+void RadialPowerFlow::build_loop_matrix(Feeder& feeder, const std::vector<int>& depth)
+{
+    // Each loop's tree path as (edge, sign): +1 on a's side up to the common
+    // ancestor, -1 on b's. A source loop runs from a up through the root's
+    // source impedance (edge 0). Entry (p, q) is the impedance of the edges
+    // shared by loops p and q, signed, plus the loop's own branch or source
+    // impedance on the diagonal.
+    const std::size_t loops = feeder.loops.size();
+    std::vector<std::vector<std::pair<int, int>>> paths(loops);
+    for (std::size_t p = 0; p < loops; ++p) {
+        const Loop& loop = feeder.loops[p];
+        int a = loop.a, b = loop.b;
+        while (a >= 0 && a != b) {
+            if (b < 0 || depth[a] >= depth[b]) {
+                paths[p].emplace_back(a, 1);
+                a = feeder.parent[a];
+            } else {
+                paths[p].emplace_back(b, -1);
+                b = feeder.parent[b];
+            }
+        }
+        std::sort(paths[p].begin(), paths[p].end());
+    }
+    std::vector<std::complex<double>> z(loops * loops);
+    for (std::size_t p = 0; p < loops; ++p) {
+        z[p * loops + p] += feeder.loops[p].impedance_Ohm;
+        for (std::size_t q = p; q < loops; ++q) {
+            std::complex<double> shared;
+            auto i = paths[p].begin(), j = paths[q].begin();
+            while (i != paths[p].end() && j != paths[q].end()) {
+                if (i->first < j->first) {
+                    ++i;
+                } else if (j->first < i->first) {
+                    ++j;
+                } else {
+                    shared += static_cast<double>(i->second * j->second) * feeder.impedance_Ohm[i->first];
+                    ++i;
+                    ++j;
+                }
+            }
+            z[p * loops + q] += shared;
+            if (q != p)
+                z[q * loops + p] += shared;
+        }
+    }
+
+    // Gauss-Jordan inverse with partial pivoting; the matrix is small.
+    std::vector<std::complex<double>>& inverse = feeder.loop_admittance_S;
+    inverse.assign(loops * loops, {});
+    for (std::size_t p = 0; p < loops; ++p)
+        inverse[p * loops + p] = 1.0;
+    for (std::size_t c = 0; c < loops; ++c) {
+        std::size_t pivot = c;
+        for (std::size_t r = c + 1; r < loops; ++r) {
+            if (std::abs(z[r * loops + c]) > std::abs(z[pivot * loops + c]))
+                pivot = r;
+        }
+        for (std::size_t k = 0; k < loops; ++k) {
+            std::swap(z[c * loops + k], z[pivot * loops + k]);
+            std::swap(inverse[c * loops + k], inverse[pivot * loops + k]);
+        }
+        const std::complex<double> scale = 1.0 / z[c * loops + c];
+        for (std::size_t k = 0; k < loops; ++k) {
+            z[c * loops + k] *= scale;
+            inverse[c * loops + k] *= scale;
+        }
+        for (std::size_t r = 0; r < loops; ++r) {
+            const std::complex<double> factor = z[r * loops + c];
+            if (r == c || factor == std::complex<double> {})
+                continue;
+            for (std::size_t k = 0; k < loops; ++k) {
+                z[r * loops + k] -= factor * z[c * loops + k];
+                inverse[r * loops + k] -= factor * inverse[c * loops + k];
+            }
+        }
+    }
+    feeder.loop_mismatch_kV.assign(loops, {});
+}
+
+void RadialPowerFlow::solve_feeder(Feeder& feeder) const
+{
+    const int n = static_cast<int>(feeder.bus.size());
+    const int* parent = feeder.parent.data();
+    const std::complex<double>* impedance = feeder.impedance_Ohm.data();
+    const std::complex<double>* load = feeder.load_kVA.data();
+    const double* base = feeder.base_kV.data();
+    std::complex<double>* voltage = feeder.voltage_kV.data();
+    std::complex<double>* current = feeder.current_A.data();
+
+    feeder.iterations = 0;
+    feeder.mismatch_pu = 0.0;
+    for (int iteration = 1; iteration <= max_iterations; ++iteration) {
+        // Backward: load currents (kVA / kV = A), then branch currents as the
+        // sum over each subtree. Children always follow their parent.
+        for (int i = 0; i < n; ++i)
+            current[i] = std::conj(load[i] / voltage[i]);
+        for (const Loop& loop : feeder.loops) {
+            current[loop.a] += loop.current_A;
+            if (loop.b >= 0)
+                current[loop.b] -= loop.current_A;
+        }
+        for (int i = n - 1; i > 0; --i)
+            current[parent[i]] += current[i];
+
+        // Forward: voltage drops from the source down (ohm * A = V).
+        double mismatch = 0.0;
+        std::complex<double> updated = feeder.emf_kV - impedance[0] * current[0] * 1e-3;
+        mismatch = std::abs(updated - voltage[0]) / base[0];
+        voltage[0] = updated;
+        for (int i = 1; i < n; ++i) {
+            updated = voltage[parent[i]] - impedance[i] * current[i] * 1e-3;
+            mismatch = std::max(mismatch, std::abs(updated - voltage[i]) / base[i]);
+            voltage[i] = updated;
+        }
+        // Loop currents: mismatch across each loop, then all corrections
+        // at once through the inverse loop impedance matrix.
+        const std::size_t loops = feeder.loops.size();
+        for (std::size_t p = 0; p < loops; ++p) {
+            const Loop& loop = feeder.loops[p];
+            const std::complex<double> far = loop.b >= 0 ? voltage[loop.b] : loop.emf_kV;
+            feeder.loop_mismatch_kV[p] = voltage[loop.a] - far - loop.impedance_Ohm * loop.current_A * 1e-3;
+            mismatch = std::max(mismatch, std::abs(feeder.loop_mismatch_kV[p]) / base[loop.a]);
+        }
+        for (std::size_t p = 0; p < loops; ++p) {
+            std::complex<double> correction;
+            for (std::size_t q = 0; q < loops; ++q)
+                correction += feeder.loop_admittance_S[p * loops + q] * feeder.loop_mismatch_kV[q];
+            feeder.loops[p].current_A += correction * 1000.0;
+        }
+
+        feeder.iterations = iteration;
+        feeder.mismatch_pu = mismatch;
+        if (mismatch < tolerance_pu)
+            break;
+    }
+}
+
+PowerFlowStats RadialPowerFlow::solve()
+{
+    std::atomic<std::size_t> next_feeder { 0 };
+    auto worker = [&]() {
+        for (std::size_t f = next_feeder++; f < feeders_.size(); f = next_feeder++)
+            solve_feeder(feeders_[f]);
+    };
+    const std::size_t thread_count = std::min(threads_, feeders_.size());
+    if (thread_count <= 1) {
+        worker();
+    } else {
+        std::vector<std::thread> threads;
+        threads.reserve(thread_count - 1);
+        for (std::size_t t = 1; t < thread_count; ++t)
+            threads.emplace_back(worker);
+        worker();
+        for (auto& thread : threads)
+            thread.join();
+    }
+
+    stats_ = PowerFlowStats {};
+    stats_.buses = located_.size();
+    for (const Feeder& feeder : feeders_) {
+        stats_.converged = stats_.converged && feeder.mismatch_pu < tolerance_pu;
+        stats_.max_iterations = std::max(stats_.max_iterations, feeder.iterations);
+        stats_.max_mismatch_pu = std::max(stats_.max_mismatch_pu, feeder.mismatch_pu);
+    }
+    return stats_;
+}
+
+double RadialPowerFlow::voltage_pu(Entity bus) const
+{
+    auto it = located_.find(bus);
+    if (it == located_.end())
+        return 0.0;
+    const Feeder& feeder = feeders_[it->second.feeder];
+    return std::abs(feeder.voltage_kV[it->second.index]) / feeder.base_kV[it->second.index];
+}
+
+std::complex<double> RadialPowerFlow::voltage_kV(Entity bus) const
+{
+    auto it = located_.find(bus);
+    if (it == located_.end())
+        return {};
+    return kSqrt3 * feeders_[it->second.feeder].voltage_kV[it->second.index];
+}
+
+double RadialPowerFlow::min_voltage_pu(Entity* bus) const
+{
+    double lowest = 0.0;
+    bool found = false;
+    for (const Feeder& feeder : feeders_) {
+        for (std::size_t i = 0; i < feeder.bus.size(); ++i) {
+            double v = std::abs(feeder.voltage_kV[i]) / feeder.base_kV[i];
+            if (!found || v < lowest) {
+                lowest = v;
+                found = true;
+                if (bus)
+                    *bus = feeder.bus[i];
+            }
+        }
+    }
+    return lowest;
+}
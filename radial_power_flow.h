@@ -0,0 +1,109 @@
+// radial_power_flow.h
+// Backward/forward sweep power flow for radial and weakly meshed
+// distribution feeders, built from the network components (buses, closed
+// branches, sources, loads).
+//
+// Each source bus roots one feeder: the buses it reaches over closed
+// branches, numbered in BFS order so every bus comes after its parent. A
+// feeder is stored as flat arrays in that order, and a sweep is two linear
+// passes over them:
+//   backward  bus load currents, accumulated from the deepest bus upwards
+//   forward   V(bus) = V(parent) - Z(branch) * I(branch), from the root down
+// Closed branches that would close a loop are left out of the tree as
+// breakpoints, and a further source in a feeder forms a loop from the root
+// EMF through the tree to its own EMF. The loop currents are corrected every
+// iteration from the voltage mismatches across the loops, through the
+// inverse of the small dense loop impedance matrix built with the layout.
+//
+// Voltages are kept between solves, so each solve warm-starts from the last
+// one. Feeders are independent and are solved in parallel.
+//
+// Impedances are in ohms referred to the feeder's voltage level; loads are
+// three-phase kW/kvar, voltages phase kV internally and per unit outside.
+#ifndef RADIAL_POWER_FLOW_H
+#define RADIAL_POWER_FLOW_H
+
+#include "ecs_core.h"
+#include <complex>
+#include <cstddef>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+struct PowerFlowStats {
+    bool converged = true;
+    int max_iterations = 0; // Over all feeders
+    double max_mismatch_pu = 0.0; // Last voltage update of the worst feeder
+    std::size_t buses = 0;
+};
+
+class RadialPowerFlow {
+public:
+    // threads = 0 uses every hardware thread.
+    explicit RadialPowerFlow(Registry& reg, std::size_t threads = 0);
+
+    // Reads the components and lays out the feeders from a flat voltage
+    // profile. Call again after topology changes.
+    void build();
+    // Reloads LoadComponent values into the feeders.
+    void refresh_loads();
+    // Sets one bus's load without going through the registry.
+    bool set_load(Entity bus, double p_kW, double q_kvar);
+
+    PowerFlowStats solve();
+
+    double tolerance_pu = 1e-6;
+    int max_iterations = 50;
+
+    std::size_t feeder_count() const { return feeders_.size(); }
+    std::size_t bus_count() const { return located_.size(); }
+    bool energized(Entity bus) const { return located_.count(bus) > 0; }
+    double voltage_pu(Entity bus) const; // 0 for buses not reached by a source
+    std::complex<double> voltage_kV(Entity bus) const; // Line-to-line
+    // Lowest voltage over all energized buses.
+    double min_voltage_pu(Entity* bus = nullptr) const;
+    const PowerFlowStats& last_stats() const { return stats_; }
+
+private:
+    // Breakpoint branch from bus a to bus b, or (b = -1) a further source
+    // at bus a, whose current flows from a into its EMF.
+    struct Loop {
+        int a, b; // Local bus indices
+        std::complex<double> impedance_Ohm;
+        std::complex<double> emf_kV; // Phase, when b = -1
+        std::complex<double> current_A; // Leaving a
+    };
+
+    // One feeder in BFS order; index 0 is the root (source) bus.
+    struct Feeder {
+        std::vector<Entity> bus;
+        std::vector<int> parent; // -1 at the root
+        std::vector<std::complex<double>> impedance_Ohm; // Branch to the parent; source impedance at the root
+        std::vector<std::complex<double>> load_kVA; // Per phase
+        std::vector<std::complex<double>> voltage_kV; // Phase
+        std::vector<std::complex<double>> current_A; // Into the bus from its parent, after the backward pass
+        std::vector<double> base_kV; // Phase, by bus
+        std::vector<Loop> loops;
+        std::vector<std::complex<double>> loop_admittance_S; // Inverse loop impedance matrix, row-major
+        std::vector<std::complex<double>> loop_mismatch_kV;
+        std::complex<double> emf_kV; // Root source, phase
+        int iterations = 0;
+        double mismatch_pu = 0.0;
+    };
+
+    struct Location {
+        int feeder;
+        int index;
+    };
+
+    static void build_loop_matrix(Feeder& feeder, const std::vector<int>& depth);
+    void solve_feeder(Feeder& feeder) const;
+
+    Registry& registry_;
+    std::size_t threads_;
+    std::vector<Feeder> feeders_;
+    std::unordered_map<Entity, Location> located_;
+    PowerFlowStats stats_;
+};
+
+#endif // RADIAL_POWER_FLOW_H
@@ -0,0 +1,144 @@
+// relay_reach_index.cpp
+#include "relay_reach_index.h"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <queue>
+#include <utility>
+
+RelayReachIndex::RelayReachIndex(const NetworkModel& network)
+    : network_(network)
+{
+}
+
+void RelayReachIndex::build(std::span<const RelayReach> relays)
+{
+    relays_.assign(relays.size(), Relay {});
+    covering_.assign(network_.bus_count(), {});
+    unplaced_.clear();
+    coverage_entries_ = 0;
+    distance_.assign(network_.bus_count(), 0.0);
+    reached_.assign(network_.bus_count(), 0);
+    listed_.assign(relays.size(), 0);
+    stamp_ = 0;
+    for (std::size_t r = 0; r < relays.size(); ++r) {
+        const int branch = network_.branch_index(relays[r].entity);
+        relays_[r].bus = branch < 0 ? -1 : network_.branch_from(branch);
+        relays_[r].radius_Ohm = relays[r].reach_Ohm * reach_margin;
+        if (relays_[r].bus < 0 || !std::isfinite(relays_[r].radius_Ohm))
+            unplaced_.push_back(r);
+        else
+            index_relay(r);
+    }
+    last_updated_relays_ = relays.size();
+}
+
+void RelayReachIndex::relay_changed(std::size_t relay, double reach_Ohm)
+{
+    last_updated_relays_ = 0;
+    if (relay >= relays_.size() || relays_[relay].bus < 0)
+        return; // Not on a branch: a candidate whatever its settings
+    Relay& entry = relays_[relay];
+    if (std::isfinite(entry.radius_Ohm))
+        unindex_relay(relay);
+    else
+        unplaced_.erase(std::find(unplaced_.begin(), unplaced_.end(), relay));
+    entry.radius_Ohm = reach_Ohm * reach_margin;
+    if (std::isfinite(entry.radius_Ohm))
+        index_relay(relay);
+    else
+        unplaced_.insert(std::lower_bound(unplaced_.begin(), unplaced_.end(), relay), relay);
+    last_updated_relays_ = 1;
+}
+
+void RelayReachIndex::branch_switched(Entity branch)
+{
+    const int k = network_.branch_index(branch);
+    last_updated_relays_ = 0;
+    if (k < 0)
+        return;
+    // Only paths through the branch's ends change, and a relay reaching
+    // neither end cannot reach anything through them.
+    std::vector<int> affected = covering_[network_.branch_from(k)];
+    const auto& to_side = covering_[network_.branch_to(k)];
+    affected.insert(affected.end(), to_side.begin(), to_side.end());
+    std::sort(affected.begin(), affected.end());
+    affected.erase(std::unique(affected.begin(), affected.end()), affected.end());
+    for (int relay : affected) {
+        unindex_relay(relay);
+        index_relay(relay);
+    }
+    last_updated_relays_ = affected.size();
+}
+
+void RelayReachIndex::unindex_relay(std::size_t relay)
+{
+    for (int bus : relays_[relay].covered) {
+        auto& list = covering_[bus];
+        auto it = std::find(list.begin(), list.end(), static_cast<int>(relay));
+        *it = list.back();
+        list.pop_back();
+    }
+    coverage_entries_ -= relays_[relay].covered.size();
+    relays_[relay].covered.clear();
+}
+
+void RelayReachIndex::index_relay(std::size_t relay)
+{
+    // Dijkstra from the measuring bus, stopped at the reach radius.
+    Relay& entry = relays_[relay];
+    const unsigned stamp = ++stamp_;
+    using Item = std::pair<double, int>;
+    std::priority_queue<Item, std::vector<Item>, std::greater<Item>> frontier;
+    distance_[entry.bus] = 0.0;
+    reached_[entry.bus] = stamp;
+    frontier.push({ 0.0, entry.bus });
+    while (!frontier.empty()) {
+        const auto [d, bus] = frontier.top();
+        frontier.pop();
+        if (d > distance_[bus])
+            continue; // Stale entry
+        entry.covered.push_back(bus);
+        for (int k : network_.bus_branches(bus)) {
+            if (!network_.branch_closed_at(k))
+                continue;
+            const int other = network_.branch_from(k) == bus ? network_.branch_to(k) : network_.branch_from(k);
+            const double next = d + std::abs(network_.branch_impedance_Ohm(k));
+            if (next <= entry.radius_Ohm && (reached_[other] != stamp || next < distance_[other])) {
+                reached_[other] = stamp;
+                distance_[other] = next;
+                frontier.push({ next, other });
+            }
+        }
+    }
+    for (int bus : entry.covered)
+        covering_[bus].push_back(static_cast<int>(relay));
+    coverage_entries_ += entry.covered.size();
+}
+
+bool RelayReachIndex::candidates(Entity element, std::vector<std::size_t>& out) const
+{
+    out.clear();
+    int ends[2] = { network_.bus_index(element), -1 };
+    if (ends[0] < 0) {
+        const int branch = network_.branch_index(element);
+        if (branch < 0)
+            return false;
+        ends[0] = network_.branch_from(branch);
+        ends[1] = network_.branch_to(branch);
+    }
+    const unsigned stamp = ++stamp_;
+    for (int bus : ends) {
+        if (bus < 0)
+            continue;
+        for (int relay : covering_[bus]) {
+            if (listed_[relay] != stamp) {
+                listed_[relay] = stamp;
+                out.push_back(static_cast<std::size_t>(relay));
+            }
+        }
+    }
+    out.insert(out.end(), unplaced_.begin(), unplaced_.end());
+    std::sort(out.begin(), out.end());
+    return true;
+}
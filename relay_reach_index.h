@@ -0,0 +1,82 @@
+// relay_reach_index.h
+// Index from network elements to the relays that can pick up for a fault on
+// them, so fault handling evaluates a handful of relays instead of the fleet.
+//
+// Each relay has a reach in ohms derived from its settings (the largest
+// distance zone, or for overcurrent the impedance through which the
+// pre-fault voltage still drives its pickup current). The relay covers every
+// bus whose electrical distance from its measuring bus, the shortest path
+// over closed branches summing |Z|, is within reach times `reach_margin`.
+// The margin absorbs what the path sum does not model: parallel paths,
+// infeed and outfeed, and impedance angles that differ along the path. A
+// fault inside a branch is covered by the relays covering either end.
+//
+// Relays are indexed by their flat index in ProtectionRelayPools. Relays not
+// on a branch of the model, or with unbounded reach, are candidates for
+// every fault. Updates are incremental: a settings change re-runs that
+// relay's bounded search, and switching a branch re-runs it for the relays
+// covering the branch's end buses, the only ones whose distances can change.
+#ifndef RELAY_REACH_INDEX_H
+#define RELAY_REACH_INDEX_H
+
+#include "ecs_core.h"
+#include "network_model.h"
+#include <cstddef>
+#include <span>
+#include <vector>
+
+struct RelayReach {
+    Entity entity; // Branch the relay is attached to
+    double reach_Ohm;
+};
+
+class RelayReachIndex {
+public:
+    explicit RelayReachIndex(const NetworkModel& network);
+
+    double reach_margin = 2.0;
+
+    // Indexes `relays` (by flat relay index) on the network's current
+    // topology, replacing any previous contents.
+    void build(std::span<const RelayReach> relays);
+    // After relay `relay`'s settings changed.
+    void relay_changed(std::size_t relay, double reach_Ohm);
+    // After the network opened or closed `branch`.
+    void branch_switched(Entity branch);
+
+    // Flat indices of the relays that can pick up for a fault on a bus or
+    // branch entity, ascending. False when the entity is not in the model,
+    // in which case every relay is a candidate.
+    bool candidates(Entity element, std::vector<std::size_t>& out) const;
+
+    std::size_t relay_count() const { return relays_.size(); }
+    // Bus-relay coverage pairs held.
+    std::size_t coverage_entries() const { return coverage_entries_; }
+    // Relays re-indexed by the last build or update.
+    std::size_t last_updated_relays() const { return last_updated_relays_; }
+
+private:
+    struct Relay {
+        int bus = -1; // Measuring bus; -1 when always a candidate
+        double radius_Ohm = 0.0;
+        std::vector<int> covered; // Bus indices
+    };
+
+    void index_relay(std::size_t relay);
+    void unindex_relay(std::size_t relay);
+
+    const NetworkModel& network_;
+    std::vector<Relay> relays_;
+    std::vector<std::vector<int>> covering_; // Relay indices by bus
+    std::vector<std::size_t> unplaced_; // Candidates for every fault
+    std::size_t coverage_entries_ = 0;
+    std::size_t last_updated_relays_ = 0;
+
+    // Scratch for the searches.
+    std::vector<double> distance_; // By bus, valid where reached_ == stamp_
+    std::vector<unsigned> reached_;
+    mutable std::vector<unsigned> listed_; // By relay, for candidate dedup
+    mutable unsigned stamp_ = 0;
+};
+
+#endif // RELAY_REACH_INDEX_H
@@ -0,0 +1,176 @@
+// sampled_values.cpp
+#include "sampled_values.h"
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+
+namespace {
+
+// Sliding sums are rebuilt from the cycle buffer this often.
+constexpr std::size_t kRecomputeCycles = 16;
+
+const std::complex<double> kPhaseShift[3] = {
+    { 1.0, 0.0 },
+    std::polar(1.0, -2.0 * std::numbers::pi / 3.0),
+    std::polar(1.0, 2.0 * std::numbers::pi / 3.0),
+};
+
+} // namespace
+
+PhasorEstimator::PhasorEstimator(std::size_t channels, std::size_t samples_per_cycle)
+    : channels_(channels)
+    , samples_per_cycle_(std::max<std::size_t>(samples_per_cycle, 1))
+    , cosine_(samples_per_cycle_)
+    , sine_(samples_per_cycle_)
+    , cycle_(samples_per_cycle_ * channels)
+    , real_(channels)
+    , imag_(channels)
+{
+    for (std::size_t n = 0; n < samples_per_cycle_; ++n) {
+        const double angle = 2.0 * std::numbers::pi * static_cast<double>(n) / static_cast<double>(samples_per_cycle_);
+        cosine_[n] = static_cast<float>(std::cos(angle));
+        sine_[n] = static_cast<float>(std::sin(angle));
+    }
+}
+
+void PhasorEstimator::reset()
+{
+    std::fill(cycle_.begin(), cycle_.end(), 0.0f);
+    std::fill(real_.begin(), real_.end(), 0.0f);
+    std::fill(imag_.begin(), imag_.end(), 0.0f);
+    position_ = 0;
+    samples_seen_ = 0;
+    cycles_since_recompute_ = 0;
+}
+
+void PhasorEstimator::push(std::span<const float> frames)
+{
+    const std::size_t channels = channels_;
+    const std::size_t frame_count = channels ? frames.size() / channels : 0;
+    for (std::size_t f = 0; f < frame_count; ++f) {
+        // X = sum x[n] e^(-j 2 pi n / N) over the last N samples: add the new
+        // sample's term and drop the term of the sample it replaces.
+        const float c = cosine_[position_];
+        const float s = sine_[position_];
+        const float* __restrict in = frames.data() + f * channels;
+        float* __restrict old = cycle_.data() + position_ * channels;
+        float* __restrict re = real_.data();
+        float* __restrict im = imag_.data();
+        for (std::size_t ch = 0; ch < channels; ++ch) {
+            const float delta = in[ch] - old[ch];
+            re[ch] += delta * c;
+            im[ch] -= delta * s;
+            old[ch] = in[ch];
+        }
+        ++samples_seen_;
+        if (++position_ == samples_per_cycle_) {
+            position_ = 0;
+            if (++cycles_since_recompute_ == kRecomputeCycles)
+                recompute_sums();
+        }
+    }
+}
+
+void PhasorEstimator::recompute_sums()
+{
+    cycles_since_recompute_ = 0;
+    const std::size_t channels = channels_;
+    std::fill(real_.begin(), real_.end(), 0.0f);
+    std::fill(imag_.begin(), imag_.end(), 0.0f);
+    float* __restrict re = real_.data();
+    float* __restrict im = imag_.data();
+    for (std::size_t n = 0; n < samples_per_cycle_; ++n) {
+        const float c = cosine_[n];
+        const float s = sine_[n];
+        const float* __restrict x = cycle_.data() + n * channels;
+        for (std::size_t ch = 0; ch < channels; ++ch) {
+            re[ch] += x[ch] * c;
+            im[ch] -= x[ch] * s;
+        }
+    }
+}
+
+std::complex<float> PhasorEstimator::phasor(std::size_t channel) const
+{
+    // A sinusoid of RMS value A gives |X| = N A / sqrt(2).
+    const float scale = std::numbers::sqrt2_v<float> / static_cast<float>(samples_per_cycle_);
+    return { real_[channel] * scale, imag_[channel] * scale };
+}
+
+void PhasorEstimator::magnitudes(std::span<float> out) const
+{
+    const float scale = std::numbers::sqrt2_v<float> / static_cast<float>(samples_per_cycle_);
+    const std::size_t count = std::min(out.size(), channels_);
+    for (std::size_t ch = 0; ch < count; ++ch)
+        out[ch] = scale * std::sqrt(real_[ch] * real_[ch] + imag_[ch] * imag_[ch]);
+}
+
+NetworkWaveformSource::NetworkWaveformSource(const NetworkModel& network, const NetworkFaultResult& fault, std::vector<Entity> relays,
+    double sample_rate_Hz, double nominal_Hz, int prefault_cycles, int fault_cycles)
+    : relays_(std::move(relays))
+    , sample_rate_Hz_(sample_rate_Hz)
+    , prefault_frames_(static_cast<std::size_t>(std::lround(std::max(prefault_cycles, 0) * sample_rate_Hz / nominal_Hz)))
+    , fault_frames_(static_cast<std::size_t>(std::lround(std::max(fault_cycles, 0) * sample_rate_Hz / nominal_Hz)))
+    , radians_per_sample_(2.0 * std::numbers::pi * nominal_Hz / sample_rate_Hz)
+    , dc_decay_per_sample_(0.0)
+    , prefault_(relays_.size() * kChannelsPerRelay)
+    , fault_(relays_.size() * kChannelsPerRelay)
+    , dc_offset_(relays_.size() * kChannelsPerRelay, 0.0f)
+{
+    // DC offset time constant L/R = X / (w R) of the path feeding the fault.
+    const std::complex<double> z = fault.thevenin_impedance_Ohm;
+    if (z.real() > 0.0) {
+        const double tau_s = z.imag() / (2.0 * std::numbers::pi * nominal_Hz * z.real());
+        dc_decay_per_sample_ = tau_s > 0.0 ? std::exp(-1.0 / (tau_s * sample_rate_Hz)) : 0.0;
+    }
+    const std::complex<double> inception = std::polar(1.0, radians_per_sample_ * static_cast<double>(prefault_frames_));
+    for (std::size_t r = 0; r < relays_.size(); ++r) {
+        std::complex<double> v_pre, i_pre, v_fault, i_fault;
+        if (!network.relay_phasors(nullptr, relays_[r], v_pre, i_pre) || !network.relay_phasors(&fault, relays_[r], v_fault, i_fault))
+            continue; // Not a branch of the model: flat zero channels
+        for (int phase = 0; phase < 3; ++phase) {
+            const std::complex<double> shift = std::numbers::sqrt2 * kPhaseShift[phase];
+            const std::size_t current = r * kChannelsPerRelay + phase;
+            const std::size_t voltage = current + 3;
+            prefault_[current] = std::complex<float>(i_pre * shift);
+            fault_[current] = std::complex<float>(i_fault * shift);
+            prefault_[voltage] = std::complex<float>(v_pre * shift);
+            fault_[voltage] = std::complex<float>(v_fault * shift);
+            // The current through the inductive network cannot jump.
+            dc_offset_[current] = static_cast<float>(std::real(i_pre * shift * inception) - std::real(i_fault * shift * inception));
+        }
+    }
+}
+
+std::string NetworkWaveformSource::channel_name(std::size_t channel) const
+{
+    static const char* const kSignal[kChannelsPerRelay] = { "Ia", "Ib", "Ic", "Va", "Vb", "Vc" };
+    const std::size_t relay = channel / kChannelsPerRelay;
+    if (relay >= relays_.size())
+        return {};
+    return "Relay" + std::to_string(relays_[relay]) + "_" + kSignal[channel % kChannelsPerRelay];
+}
+
+const char* NetworkWaveformSource::channel_unit(std::size_t channel) const
+{
+    return channel % kChannelsPerRelay < 3 ? "kA" : "kV";
+}
+
+std::size_t NetworkWaveformSource::read(std::span<float> frames)
+{
+    const std::size_t channels = channel_count();
+    if (channels == 0)
+        return 0;
+    const std::size_t wanted = std::min(frames.size() / channels, frame_count() - next_frame_);
+    for (std::size_t f = 0; f < wanted; ++f, ++next_frame_) {
+        const bool faulted = next_frame_ >= prefault_frames_;
+        const std::complex<float> rotation = std::complex<float>(std::polar(1.0, radians_per_sample_ * static_cast<double>(next_frame_)));
+        const float decay = faulted ? static_cast<float>(std::pow(dc_decay_per_sample_, static_cast<double>(next_frame_ - prefault_frames_))) : 0.0f;
+        const std::complex<float>* __restrict phasors = faulted ? fault_.data() : prefault_.data();
+        const float* __restrict dc = dc_offset_.data();
+        float* __restrict out = frames.data() + f * channels;
+        for (std::size_t ch = 0; ch < channels; ++ch)
+            out[ch] = phasors[ch].real() * rotation.real() - phasors[ch].imag() * rotation.imag() + dc[ch] * decay;
+    }
+    return wanted;
+}
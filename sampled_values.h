@@ -0,0 +1,112 @@
+// sampled_values.h
+// Sampled-value waveform streams and phasor estimation for protection.
+//
+// A SampledValueSource delivers multi-channel sample frames at a fixed rate
+// (4-12.8 kHz for protection). Frames are sample-major: frame f holds
+// channel c at f * channels + c, so one time step of every channel is
+// contiguous. NetworkWaveformSource synthesizes such a stream from the
+// network model's pre-fault and fault phasors.
+//
+// PhasorEstimator is a full-cycle DFT run as a sliding sum over all channels
+// at once: each new sample replaces the one a cycle older with a single
+// multiply-add per channel, in loops over the contiguous channels that the
+// compiler vectorizes. The sums are recomputed from the cycle buffer every
+// few cycles so single-precision round-off cannot accumulate.
+#ifndef SAMPLED_VALUES_H
+#define SAMPLED_VALUES_H
+
+#include "ecs_core.h"
+#include "network_model.h"
+#include <complex>
+#include <cstddef>
+#include <span>
+#include <string>
+#include <vector>
+
+class SampledValueSource {
+public:
+    virtual ~SampledValueSource() = default;
+    virtual double sample_rate_Hz() const = 0;
+    virtual std::size_t channel_count() const = 0;
+    virtual std::string channel_name(std::size_t channel) const = 0;
+    virtual const char* channel_unit(std::size_t channel) const = 0;
+    // Fills whole frames into `frames` and returns how many were written;
+    // 0 at the end of the stream.
+    virtual std::size_t read(std::span<float> frames) = 0;
+};
+
+class PhasorEstimator {
+public:
+    PhasorEstimator(std::size_t channels, std::size_t samples_per_cycle);
+
+    void reset();
+    // Consumes whole sample-major frames.
+    void push(std::span<const float> frames);
+
+    // True once a full cycle has been seen since the last reset.
+    bool settled() const { return samples_seen_ >= samples_per_cycle_; }
+    std::size_t channels() const { return channels_; }
+    std::size_t samples_per_cycle() const { return samples_per_cycle_; }
+    std::size_t samples_seen() const { return samples_seen_; }
+    // RMS phasor of a channel over the last cycle. The angle is referenced
+    // to the cycle grid, so phasors of different channels compare directly
+    // and a steady nominal-frequency signal gives a constant phasor.
+    std::complex<float> phasor(std::size_t channel) const;
+    // RMS magnitudes of all channels.
+    void magnitudes(std::span<float> out) const;
+
+private:
+    void recompute_sums();
+
+    std::size_t channels_;
+    std::size_t samples_per_cycle_;
+    std::size_t position_ = 0; // Slot of the next sample in the cycle buffer
+    std::size_t samples_seen_ = 0;
+    std::size_t cycles_since_recompute_ = 0;
+    std::vector<float> cosine_, sine_; // By slot
+    std::vector<float> cycle_; // Last cycle of frames, by slot
+    std::vector<float> real_, imag_; // DFT sums by channel
+};
+
+// Three-phase waveforms at the relays of a network model for one fault:
+// `prefault_cycles` cycles of the no-load pre-fault state, then
+// `fault_cycles` cycles of the fault. Each relay contributes six channels,
+// Ia Ib Ic in kA and Va Vb Vc (phase) in kV, in the order given. Fault
+// currents carry the decaying DC offset that keeps each phase current
+// continuous at inception, with the X/R of the Thevenin impedance at the
+// fault.
+class NetworkWaveformSource final : public SampledValueSource {
+public:
+    static constexpr std::size_t kChannelsPerRelay = 6;
+
+    NetworkWaveformSource(const NetworkModel& network, const NetworkFaultResult& fault, std::vector<Entity> relays,
+        double sample_rate_Hz, double nominal_Hz = 50.0, int prefault_cycles = 1, int fault_cycles = 2);
+
+    double sample_rate_Hz() const override { return sample_rate_Hz_; }
+    std::size_t channel_count() const override { return relays_.size() * kChannelsPerRelay; }
+    std::string channel_name(std::size_t channel) const override;
+    const char* channel_unit(std::size_t channel) const override;
+    std::size_t read(std::span<float> frames) override;
+
+    const std::vector<Entity>& relays() const { return relays_; }
+    // Frames before the fault inception; frame index == inception_frame()
+    // is the first fault sample.
+    std::size_t inception_frame() const { return prefault_frames_; }
+    std::size_t frame_count() const { return prefault_frames_ + fault_frames_; }
+    // Back to the first frame.
+    void rewind() { next_frame_ = 0; }
+
+private:
+    std::vector<Entity> relays_;
+    double sample_rate_Hz_;
+    std::size_t prefault_frames_;
+    std::size_t fault_frames_;
+    std::size_t next_frame_ = 0;
+    double radians_per_sample_;
+    double dc_decay_per_sample_;
+    // By channel: peak phasors before and during the fault, DC offset at inception.
+    std::vector<std::complex<float>> prefault_, fault_;
+    std::vector<float> dc_offset_;
+};
+
+#endif // SAMPLED_VALUES_H
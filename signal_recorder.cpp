@@ -0,0 +1,216 @@
+// signal_recorder.cpp
+#include "signal_recorder.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <limits>
+
+namespace {
+
+enum SpillColumn : std::size_t {
+    SPILL_COL_SIGNAL_ID,
+    SPILL_COL_TIME_S,
+    SPILL_COL_VALUE,
+};
+
+constexpr std::uint8_t kNothingArchived = 0;
+constexpr std::uint8_t kLastArchived = 1;
+constexpr std::uint8_t kLastPending = 2;
+
+constexpr double kInf = std::numeric_limits<double>::infinity();
+
+} // namespace
+
+SignalRecorder::SignalRecorder(std::size_t ring_capacity)
+    : ring_capacity_(std::max<std::size_t>(2, ring_capacity))
+{
+}
+
+SignalRecorder::~SignalRecorder()
+{
+    flush();
+}
+
+std::size_t SignalRecorder::add_group(const std::string& field_name, const SignalSettings& settings)
+{
+    groups_.push_back(Group { field_name, settings });
+    return groups_.size() - 1;
+}
+
+std::size_t SignalRecorder::subscribe(const std::vector<Entity>& entities,
+    const std::vector<const double*>& sources,
+    const std::string& field_name,
+    const SignalSettings& settings)
+{
+    std::size_t group = add_group(field_name, settings);
+    for (std::size_t i = 0; i < sources.size() && i < entities.size(); ++i)
+        add_signal(entities[i], group, sources[i]);
+    return std::min(sources.size(), entities.size());
+}
+
+void SignalRecorder::add_signal(Entity entity, std::size_t group, const double* source)
+{
+    sources_.push_back(source);
+    entities_.push_back(entity);
+    group_of_.push_back(static_cast<std::uint32_t>(group));
+    archived_time_s_.push_back(0.0);
+    archived_value_.push_back(0.0);
+    last_time_s_.push_back(0.0);
+    last_value_.push_back(0.0);
+    slope_upper_.push_back(kInf);
+    slope_lower_.push_back(-kInf);
+    state_.push_back(kNothingArchived);
+    ring_time_s_.resize(ring_time_s_.size() + ring_capacity_);
+    ring_value_.resize(ring_value_.size() + ring_capacity_);
+    ring_start_.push_back(0);
+    ring_count_.push_back(0);
+}
+
+bool SignalRecorder::open_spill(const std::string& path, ColumnarFileFormat format)
+{
+    spill_ = std::make_unique<ColumnarRecorder>(std::vector<ColumnSpec> {
+        { "SignalId", ColumnType::Int64 },
+        { "Time_s", ColumnType::Float64 },
+        { "Value", ColumnType::Float32 },
+    });
+    if (!spill_->open(path, format)) {
+        error_ = spill_->error();
+        spill_.reset();
+        return false;
+    }
+    if (!write_catalogue(path + ".signals.csv")) {
+        error_ = "cannot write '" + path + ".signals.csv'";
+        return false;
+    }
+    return true;
+}
+
+bool SignalRecorder::write_catalogue(const std::string& path) const
+{
+    std::ofstream out(path, std::ios::trunc);
+    if (!out)
+        return false;
+    out << "SignalId,Entity,Field,Compression,Deviation,SnapshotInterval_s\n";
+    for (std::size_t i = 0; i < sources_.size(); ++i) {
+        const Group& group = groups_[group_of_[i]];
+        out << i << ',' << entities_[i] << ',' << group.field_name << ','
+            << (group.settings.compression == SignalCompression::SwingingDoor ? "swinging_door" : "deadband") << ','
+            << group.settings.deviation << ',' << group.settings.snapshot_interval_s << '\n';
+    }
+    return static_cast<bool>(out);
+}
+
+void SignalRecorder::sample(double now_s)
+{
+    ++samples_seen_;
+    for (std::size_t i = 0; i < sources_.size(); ++i) {
+        const double value = *sources_[i];
+        const SignalSettings& settings = groups_[group_of_[i]].settings;
+
+        if (state_[i] == kNothingArchived) {
+            archive(i, now_s, value);
+            continue;
+        }
+        const double since_archive_s = now_s - archived_time_s_[i];
+        if (since_archive_s <= 0.0)
+            continue;
+
+        if (settings.compression == SignalCompression::Deadband) {
+            if (std::abs(value - archived_value_[i]) > settings.deviation || since_archive_s >= settings.snapshot_interval_s)
+                archive(i, now_s, value);
+            continue;
+        }
+
+        // Swinging door: narrow the corridor of slopes from the archived point
+        // that keep every sample within the deviation.
+        double upper = std::min(slope_upper_[i], (value + settings.deviation - archived_value_[i]) / since_archive_s);
+        double lower = std::max(slope_lower_[i], (value - settings.deviation - archived_value_[i]) / since_archive_s);
+        if (lower > upper) {
+            // The door closed: the segment ends at the previous sample.
+            archive_on_door(i);
+            double dt_s = now_s - last_time_s_[i];
+            upper = (value + settings.deviation - archived_value_[i]) / dt_s;
+            lower = (value - settings.deviation - archived_value_[i]) / dt_s;
+        }
+        slope_upper_[i] = upper;
+        slope_lower_[i] = lower;
+        last_time_s_[i] = now_s;
+        last_value_[i] = value;
+        state_[i] = kLastPending;
+        if (now_s - archived_time_s_[i] >= settings.snapshot_interval_s)
+            archive_on_door(i);
+    }
+}
+
+void SignalRecorder::archive_on_door(std::size_t signal)
+{
+    // The sample's own slope is only inside its band; earlier samples may
+    // have narrowed the corridor past it.
+    const double dt_s = last_time_s_[signal] - archived_time_s_[signal];
+    const double slope = std::clamp((last_value_[signal] - archived_value_[signal]) / dt_s, slope_lower_[signal], slope_upper_[signal]);
+    archive(signal, last_time_s_[signal], archived_value_[signal] + slope * dt_s);
+}
+
+void SignalRecorder::archive(std::size_t signal, double time_s, double value)
+{
+    archived_time_s_[signal] = time_s;
+    archived_value_[signal] = value;
+    last_time_s_[signal] = time_s;
+    last_value_[signal] = value;
+    slope_upper_[signal] = kInf;
+    slope_lower_[signal] = -kInf;
+    state_[signal] = kLastArchived;
+    ++points_archived_;
+
+    if (ring_count_[signal] == ring_capacity_) {
+        if (spill_) {
+            spill(signal, ring_capacity_ / 2);
+        } else {
+            ring_start_[signal] = static_cast<std::uint32_t>((ring_start_[signal] + 1) % ring_capacity_);
+            --ring_count_[signal];
+            ++points_overwritten_;
+        }
+    }
+    std::size_t slot = signal * ring_capacity_ + (ring_start_[signal] + ring_count_[signal]) % ring_capacity_;
+    ring_time_s_[slot] = time_s;
+    ring_value_[slot] = static_cast<float>(value);
+    ++ring_count_[signal];
+}
+
+void SignalRecorder::spill(std::size_t signal, std::size_t count)
+{
+    std::size_t base = signal * ring_capacity_;
+    for (std::size_t k = 0; k < count; ++k) {
+        std::size_t slot = base + (ring_start_[signal] + k) % ring_capacity_;
+        spill_->set_int(SPILL_COL_SIGNAL_ID, static_cast<std::int64_t>(signal));
+        spill_->set(SPILL_COL_TIME_S, ring_time_s_[slot]);
+        spill_->set(SPILL_COL_VALUE, ring_value_[slot]);
+        spill_->commit_row();
+    }
+    ring_start_[signal] = static_cast<std::uint32_t>((ring_start_[signal] + count) % ring_capacity_);
+    ring_count_[signal] -= static_cast<std::uint32_t>(count);
+    points_spilled_ += count;
+}
+
+void SignalRecorder::flush()
+{
+    for (std::size_t i = 0; i < sources_.size(); ++i) {
+        if (state_[i] == kLastPending)
+            archive_on_door(i);
+        if (spill_ && ring_count_[i] > 0)
+            spill(i, ring_count_[i]);
+    }
+    if (spill_)
+        spill_->close();
+}
+
+std::vector<std::pair<double, double>> SignalRecorder::recent_points(std::size_t signal) const
+{
+    std::vector<std::pair<double, double>> points;
+    std::size_t base = signal * ring_capacity_;
+    for (std::size_t k = 0; k < ring_count_[signal]; ++k) {
+        std::size_t slot = base + (ring_start_[signal] + k) % ring_capacity_;
+        points.emplace_back(ring_time_s_[slot], ring_value_[slot]);
+    }
+    return points;
+}
@@ -0,0 +1,143 @@
+// signal_recorder.h
+// Compressed per-entity time series. A signal is one double field of one
+// entity's component (e.g. PhysicalStateComponent::soc of a pile); the field
+// address is resolved when subscribing, so sampling is a pass over pointers.
+//
+// Each sample is filtered per signal and only archived points are kept:
+//   Deadband      - archive when the value moves more than `deviation` from
+//                   the last archived value (sample-and-hold reconstruction).
+//   SwingingDoor  - archive only when a straight line from the last archived
+//                   point can no longer stay within `deviation` of every
+//                   sample since (linear reconstruction). The point that
+//                   ends a segment lies on such a line, so it may differ
+//                   from its sample by up to `deviation`.
+// Every signal is also archived at least every snapshot_interval_s, which
+// gives decimated snapshots of otherwise flat signals.
+//
+// Archived points sit in preallocated per-signal rings. When a ring fills,
+// its older half is spilled to a columnar file (SignalId, Time_s, Value) and
+// the signal catalogue is written next to it as <path>.signals.csv. Without a
+// spill file the oldest points are overwritten.
+#ifndef SIGNAL_RECORDER_H
+#define SIGNAL_RECORDER_H
+
+#include "columnar_recorder.h"
+#include "ecs_core.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+enum class SignalCompression {
+    Deadband,
+    SwingingDoor,
+};
+
+struct SignalSettings {
+    SignalCompression compression = SignalCompression::Deadband;
+    double deviation = 0.0;
+    double snapshot_interval_s = 60.0;
+};
+
+class SignalRecorder {
+public:
+    explicit SignalRecorder(std::size_t ring_capacity = 32);
+    ~SignalRecorder();
+    SignalRecorder(const SignalRecorder&) = delete;
+    SignalRecorder& operator=(const SignalRecorder&) = delete;
+
+    // Adds one signal per entity that has a Comp; returns how many were added.
+    // The components must outlive the recorder (the registry never moves them).
+    template <typename Comp>
+    std::size_t subscribe(Registry& registry,
+        const std::vector<Entity>& entities,
+        double Comp::*field,
+        const std::string& field_name,
+        const SignalSettings& settings)
+    {
+        std::size_t added = 0;
+        std::size_t group = add_group(field_name, settings);
+        for (Entity entity : entities) {
+            if (Comp* component = registry.get<Comp>(entity)) {
+                add_signal(entity, group, &(component->*field));
+                ++added;
+            }
+        }
+        return added;
+    }
+    // The same over values kept elsewhere, e.g. a state view refreshed
+    // before every sample: sources[i] is the signal of entities[i] and must
+    // stay valid while the recorder samples.
+    std::size_t subscribe(const std::vector<Entity>& entities,
+        const std::vector<const double*>& sources,
+        const std::string& field_name,
+        const SignalSettings& settings);
+
+    // Spill file for points pushed out of full rings. Call after subscribing.
+    bool open_spill(const std::string& path, ColumnarFileFormat format = ColumnarFileFormat::Native);
+    const std::string& error() const { return error_; }
+
+    // Reads every signal and archives the points its filter keeps.
+    void sample(double now_s);
+    // End of run: archives pending swinging-door points, spills every ring
+    // and closes the spill file.
+    void flush();
+
+    std::size_t signal_count() const { return sources_.size(); }
+    Entity signal_entity(std::size_t signal) const { return entities_[signal]; }
+    const std::string& signal_field(std::size_t signal) const { return groups_[group_of_[signal]].field_name; }
+    // Archived points still held in memory, oldest first.
+    std::vector<std::pair<double, double>> recent_points(std::size_t signal) const;
+
+    std::uint64_t samples_seen() const { return samples_seen_; }
+    std::uint64_t points_archived() const { return points_archived_; }
+    std::uint64_t points_spilled() const { return points_spilled_; }
+    std::uint64_t points_overwritten() const { return points_overwritten_; }
+
+private:
+    struct Group {
+        std::string field_name;
+        SignalSettings settings;
+    };
+
+    std::size_t add_group(const std::string& field_name, const SignalSettings& settings);
+    void add_signal(Entity entity, std::size_t group, const double* source);
+    void archive(std::size_t signal, double time_s, double value);
+    // Swinging door: archives the last sample's time on a line through the
+    // archived point that stays within the corridor.
+    void archive_on_door(std::size_t signal);
+    void spill(std::size_t signal, std::size_t count);
+    bool write_catalogue(const std::string& path) const;
+
+    std::size_t ring_capacity_;
+    std::vector<Group> groups_;
+
+    // Per signal (structure of arrays).
+    std::vector<const double*> sources_;
+    std::vector<Entity> entities_;
+    std::vector<std::uint32_t> group_of_;
+    std::vector<double> archived_time_s_;
+    std::vector<double> archived_value_;
+    std::vector<double> last_time_s_; // Last sample seen (swinging door)
+    std::vector<double> last_value_;
+    std::vector<double> slope_upper_; // Door slopes from the archived point
+    std::vector<double> slope_lower_;
+    std::vector<std::uint8_t> state_; // 0 = nothing archived, 1 = last sample archived, 2 = last sample pending
+
+    // Rings: signal i owns slots [i * ring_capacity_, (i + 1) * ring_capacity_).
+    std::vector<double> ring_time_s_;
+    std::vector<float> ring_value_;
+    std::vector<std::uint32_t> ring_start_;
+    std::vector<std::uint32_t> ring_count_;
+
+    std::unique_ptr<ColumnarRecorder> spill_;
+    std::string error_;
+    std::uint64_t samples_seen_ = 0;
+    std::uint64_t points_archived_ = 0;
+    std::uint64_t points_spilled_ = 0;
+    std::uint64_t points_overwritten_ = 0;
+};
+
+#endif // SIGNAL_RECORDER_H
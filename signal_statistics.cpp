@@ -0,0 +1,256 @@
+// signal_statistics.cpp
+#include "signal_statistics.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <numbers>
+#include <utility>
+
+void RunningMoments::merge(const RunningMoments& other)
+{
+    if (other.count == 0)
+        return;
+    if (count == 0) {
+        *this = other;
+        return;
+    }
+    const double n_a = static_cast<double>(count);
+    const double n_b = static_cast<double>(other.count);
+    const double n = n_a + n_b;
+    const double delta = other.mean - mean;
+    mean += delta * n_b / n;
+    m2 += other.m2 + delta * delta * n_a * n_b / n;
+    count += other.count;
+}
+
+double RunningMoments::stddev() const
+{
+    return std::sqrt(variance());
+}
+
+namespace {
+
+// k1 scale function: centroids near q = 0 and q = 1 stay small.
+double digest_scale(double q)
+{
+    return TDigest::kCompression / (2.0 * std::numbers::pi) * std::asin(std::clamp(2.0 * q - 1.0, -1.0, 1.0));
+}
+
+} // namespace
+
+void TDigest::compress()
+{
+    if (buffered_ == 0)
+        return;
+
+    std::array<std::pair<double, double>, kBufferSize> incoming;
+    for (std::size_t i = 0; i < buffered_; ++i) {
+        incoming[i] = { buffer_mean_[i], buffer_weight_[i] };
+        min_ = std::min(min_, buffer_mean_[i]);
+        max_ = std::max(max_, buffer_mean_[i]);
+    }
+    std::sort(incoming.begin(), incoming.begin() + buffered_,
+        [](const auto& a, const auto& b) { return a.first < b.first; });
+
+    // Merge the sorted buffer with the (sorted) centroids.
+    std::array<double, kMaxCentroids + kBufferSize> means;
+    std::array<double, kMaxCentroids + kBufferSize> weights;
+    std::size_t count = 0;
+    double total = 0.0;
+    for (std::size_t c = 0, b = 0; c < centroids_ || b < buffered_; ++count) {
+        if (b == buffered_ || (c < centroids_ && mean_[c] <= incoming[b].first)) {
+            means[count] = mean_[c];
+            weights[count] = weight_[c++];
+        } else {
+            means[count] = incoming[b].first;
+            weights[count] = incoming[b++].second;
+        }
+        total += weights[count];
+    }
+    buffered_ = 0;
+
+    // Greedy pass: grow the current centroid while it spans at most one unit
+    // of the scale function.
+    centroids_ = 0;
+    double current_mean = means[0];
+    double current_weight = weights[0];
+    double weight_before = 0.0;
+    double k_left = digest_scale(0.0);
+    for (std::size_t i = 1; i < count; ++i) {
+        double q_right = (weight_before + current_weight + weights[i]) / total;
+        if (digest_scale(q_right) - k_left <= 1.0 || centroids_ == kMaxCentroids - 1) {
+            current_weight += weights[i];
+            current_mean += (means[i] - current_mean) * weights[i] / current_weight;
+        } else {
+            mean_[centroids_] = current_mean;
+            weight_[centroids_++] = current_weight;
+            weight_before += current_weight;
+            k_left = digest_scale(weight_before / total);
+            current_mean = means[i];
+            current_weight = weights[i];
+        }
+    }
+    mean_[centroids_] = current_mean;
+    weight_[centroids_++] = current_weight;
+}
+
+void TDigest::merge(const TDigest& other)
+{
+    for (std::size_t i = 0; i < other.centroids_; ++i)
+        add(other.mean_[i], other.weight_[i]);
+    for (std::size_t i = 0; i < other.buffered_; ++i)
+        add(other.buffer_mean_[i], other.buffer_weight_[i]);
+    min_ = std::min(min_, other.min_);
+    max_ = std::max(max_, other.max_);
+}
+
+double TDigest::total_weight() const
+{
+    double total = 0.0;
+    for (std::size_t i = 0; i < centroids_; ++i)
+        total += weight_[i];
+    for (std::size_t i = 0; i < buffered_; ++i)
+        total += buffer_weight_[i];
+    return total;
+}
+
+double TDigest::quantile(double q) const
+{
+    if (buffered_ > 0) {
+        TDigest flushed = *this;
+        flushed.compress();
+        return flushed.quantile(q);
+    }
+    if (centroids_ == 0)
+        return std::numeric_limits<double>::quiet_NaN();
+    if (q <= 0.0)
+        return min_;
+    if (q >= 1.0)
+        return max_;
+
+    // Interpolate between centroid centres; the ends run out to min and max.
+    const double target = q * total_weight();
+    double previous_centre = 0.0;
+    double previous_mean = min_;
+    double cumulative = 0.0;
+    for (std::size_t i = 0; i < centroids_; ++i) {
+        double centre = cumulative + weight_[i] / 2.0;
+        if (target < centre) {
+            double span = centre - previous_centre;
+            return span > 0.0 ? previous_mean + (mean_[i] - previous_mean) * (target - previous_centre) / span : mean_[i];
+        }
+        previous_centre = centre;
+        previous_mean = mean_[i];
+        cumulative += weight_[i];
+    }
+    double span = cumulative - previous_centre;
+    return span > 0.0 ? previous_mean + (max_ - previous_mean) * (target - previous_centre) / span : max_;
+}
+
+void SignalSummary::merge(const SignalSummary& other)
+{
+    moments.merge(other.moments);
+    if (other.min < min) {
+        min = other.min;
+        min_time_s = other.min_time_s;
+    }
+    if (other.max > max) {
+        max = other.max;
+        max_time_s = other.max_time_s;
+    }
+    integral += other.integral;
+    digest.merge(other.digest);
+}
+
+std::size_t SignalStatistics::add_signal_slot(const std::string& name, double integral_scale)
+{
+    names_.push_back(name);
+    integral_scale_.push_back(integral_scale);
+    last_value_.push_back(0.0);
+    summaries_.emplace_back();
+    return names_.size() - 1;
+}
+
+std::size_t SignalStatistics::add_signal(const std::string& name, std::vector<const double*> sources, double integral_scale)
+{
+    sources_.insert(sources_.end(), sources.begin(), sources.end());
+    source_begin_.push_back(sources_.size());
+    callbacks_.emplace_back();
+    return add_signal_slot(name, integral_scale);
+}
+
+std::size_t SignalStatistics::add_signal(const std::string& name, std::function<double()> source, double integral_scale)
+{
+    source_begin_.push_back(sources_.size());
+    callbacks_.push_back(std::move(source));
+    return add_signal_slot(name, integral_scale);
+}
+
+std::size_t SignalStatistics::add_group(const std::string& name, std::vector<std::size_t> signals)
+{
+    groups_.push_back(Group { name, std::move(signals) });
+    return groups_.size() - 1;
+}
+
+void SignalStatistics::sample(double now_s)
+{
+    const double dt_s = samples_seen_ > 0 ? now_s - last_time_s_ : 0.0;
+    ++samples_seen_;
+    for (std::size_t i = 0; i < names_.size(); ++i) {
+        double value = 0.0;
+        const std::size_t begin = source_begin_[i];
+        const std::size_t end = source_begin_[i + 1];
+        if (begin == end) {
+            if (callbacks_[i])
+                value = callbacks_[i]();
+        } else {
+            for (std::size_t k = begin; k < end; ++k)
+                value += *sources_[k];
+        }
+
+        SignalSummary& summary = summaries_[i];
+        summary.integral += last_value_[i] * dt_s * integral_scale_[i];
+        last_value_[i] = value;
+        summary.moments.add(value);
+        if (value < summary.min) {
+            summary.min = value;
+            summary.min_time_s = now_s;
+        }
+        if (value > summary.max) {
+            summary.max = value;
+            summary.max_time_s = now_s;
+        }
+        summary.digest.add(value);
+    }
+    last_time_s_ = now_s;
+}
+
+SignalSummary SignalStatistics::group_summary(std::size_t group) const
+{
+    SignalSummary merged;
+    for (std::size_t signal : groups_[group].signals)
+        merged.merge(summaries_[signal]);
+    return merged;
+}
+
+bool SignalStatistics::write_report(const std::string& path) const
+{
+    std::ofstream out(path, std::ios::trunc);
+    if (!out)
+        return false;
+    out.precision(10);
+    out << "Name,Kind,Signals,Samples,Mean,StdDev,Min,MinTime_s,Max,MaxTime_s,P01,P05,P50,P95,P99,Integral\n";
+    auto write_row = [&](const std::string& name, const char* kind, std::size_t signals, const SignalSummary& summary) {
+        out << name << ',' << kind << ',' << signals << ',' << summary.moments.count << ','
+            << summary.moments.mean << ',' << summary.moments.stddev() << ','
+            << summary.min << ',' << summary.min_time_s << ',' << summary.max << ',' << summary.max_time_s;
+        for (double q : { 0.01, 0.05, 0.5, 0.95, 0.99 })
+            out << ',' << summary.digest.quantile(q);
+        out << ',' << summary.integral << '\n';
+    };
+    for (std::size_t group = 0; group < groups_.size(); ++group)
+        write_row(groups_[group].name, "group", groups_[group].signals.size(), group_summary(group));
+    for (std::size_t i = 0; i < names_.size(); ++i)
+        write_row(names_[i], "signal", 1, summaries_[i]);
+    return static_cast<bool>(out);
+}
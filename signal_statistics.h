@@ -0,0 +1,169 @@
+// signal_statistics.h
+// Online statistics over simulation signals, so a run (or every member of an
+// ensemble) reports summaries instead of raw rows. Each signal keeps a
+// fixed-size summary updated on every sample:
+//   - count, mean and variance (Welford)
+//   - minimum and maximum with the time they occurred
+//   - percentiles from a merging t-digest of bounded size
+//   - the time integral of the held value, scaled (kW -> kWh with 1/3600)
+// A signal reads one double field, the sum of several (e.g. a station's
+// member powers) or a callback. Groups merge the summaries of their member
+// signals when reported, e.g. every EV pile's power as one distribution.
+#ifndef SIGNAL_STATISTICS_H
+#define SIGNAL_STATISTICS_H
+
+#include "ecs_core.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <string>
+#include <vector>
+
+// Welford's running mean and variance; merge() is Chan's pairwise update.
+struct RunningMoments {
+    std::uint64_t count = 0;
+    double mean = 0.0;
+    double m2 = 0.0;
+
+    void add(double value)
+    {
+        ++count;
+        double delta = value - mean;
+        mean += delta / static_cast<double>(count);
+        m2 += delta * (value - mean);
+    }
+    void merge(const RunningMoments& other);
+    double variance() const { return count > 1 ? m2 / static_cast<double>(count - 1) : 0.0; }
+    double stddev() const;
+};
+
+// Merging t-digest (Dunning) with the k1 scale function. Points collect in a
+// small buffer that is merged into at most kMaxCentroids centroids when full,
+// so memory is fixed and accuracy is best near the tails: each centroid
+// spans at most one unit of the scale, so the rank of quantile(q) is within
+// 2*pi*sqrt(q*(1-q))/kCompression of q (about 5% at the median, 1% at P01).
+class TDigest {
+public:
+    static constexpr double kCompression = 64.0;
+    static constexpr std::size_t kMaxCentroids = 66;
+    static constexpr std::size_t kBufferSize = 128;
+
+    void add(double value, double weight = 1.0)
+    {
+        buffer_mean_[buffered_] = value;
+        buffer_weight_[buffered_] = weight;
+        if (++buffered_ == kBufferSize)
+            compress();
+    }
+    void merge(const TDigest& other);
+    // q in [0, 1]; NaN when empty.
+    double quantile(double q) const;
+    double total_weight() const;
+    std::size_t centroid_count() const { return centroids_; }
+
+private:
+    void compress();
+
+    std::array<double, kMaxCentroids> mean_ {};
+    std::array<double, kMaxCentroids> weight_ {};
+    std::size_t centroids_ = 0;
+    std::array<double, kBufferSize> buffer_mean_ {};
+    std::array<double, kBufferSize> buffer_weight_ {};
+    std::size_t buffered_ = 0;
+    double min_ = std::numeric_limits<double>::infinity();
+    double max_ = -std::numeric_limits<double>::infinity();
+};
+
+struct SignalSummary {
+    RunningMoments moments;
+    double min = std::numeric_limits<double>::infinity();
+    double min_time_s = 0.0;
+    double max = -std::numeric_limits<double>::infinity();
+    double max_time_s = 0.0;
+    double integral = 0.0;
+    TDigest digest;
+
+    void merge(const SignalSummary& other);
+};
+
+class SignalStatistics {
+public:
+    // integral_scale multiplies value * seconds; 0 leaves the integral at 0.
+    std::size_t add_signal(const std::string& name, std::vector<const double*> sources, double integral_scale = 0.0);
+    std::size_t add_signal(const std::string& name, std::function<double()> source, double integral_scale = 0.0);
+
+    // One signal per entity that has a Comp, named "<field_name>#<entity>".
+    // The components must outlive the statistics (the registry never moves them).
+    template <typename Comp>
+    std::vector<std::size_t> add_field_signals(Registry& registry,
+        const std::vector<Entity>& entities,
+        double Comp::*field,
+        const std::string& field_name,
+        double integral_scale = 0.0)
+    {
+        std::vector<std::size_t> added;
+        for (Entity entity : entities) {
+            if (Comp* component = registry.get<Comp>(entity))
+                added.push_back(add_signal(field_name + "#" + std::to_string(entity), { &(component->*field) }, integral_scale));
+        }
+        return added;
+    }
+
+    // One signal holding the sum of the field over every entity that has a Comp.
+    template <typename Comp>
+    std::size_t add_sum_signal(Registry& registry,
+        const std::vector<Entity>& entities,
+        double Comp::*field,
+        const std::string& name,
+        double integral_scale = 0.0)
+    {
+        std::vector<const double*> sources;
+        for (Entity entity : entities) {
+            if (Comp* component = registry.get<Comp>(entity))
+                sources.push_back(&(component->*field));
+        }
+        return add_signal(name, std::move(sources), integral_scale);
+    }
+
+    std::size_t add_group(const std::string& name, std::vector<std::size_t> signals);
+
+    // Reads every signal once; the previous values are held until now_s for
+    // the integrals.
+    void sample(double now_s);
+
+    std::size_t signal_count() const { return names_.size(); }
+    std::size_t group_count() const { return groups_.size(); }
+    const std::string& signal_name(std::size_t signal) const { return names_[signal]; }
+    const std::string& group_name(std::size_t group) const { return groups_[group].name; }
+    const SignalSummary& summary(std::size_t signal) const { return summaries_[signal]; }
+    SignalSummary group_summary(std::size_t group) const;
+    std::uint64_t samples_seen() const { return samples_seen_; }
+
+    // One CSV row per signal and per group.
+    bool write_report(const std::string& path) const;
+
+private:
+    struct Group {
+        std::string name;
+        std::vector<std::size_t> signals;
+    };
+
+    std::size_t add_signal_slot(const std::string& name, double integral_scale);
+
+    std::vector<std::string> names_;
+    // Signal i sums sources_[source_begin_[i] .. source_begin_[i + 1]); a
+    // signal with no sources reads its callback.
+    std::vector<std::size_t> source_begin_ { 0 };
+    std::vector<const double*> sources_;
+    std::vector<std::function<double()>> callbacks_;
+    std::vector<double> integral_scale_;
+    std::vector<double> last_value_;
+    std::vector<SignalSummary> summaries_;
+    std::vector<Group> groups_;
+    double last_time_s_ = 0.0;
+    std::uint64_t samples_seen_ = 0;
+};
+
+#endif // SIGNAL_STATISTICS_H
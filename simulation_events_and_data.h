@@ -4,6 +4,8 @@
 
 #include "cps_coro_lib.h" // For cps_coro::EventId
 #include "ecs_core.h" // For Entity
+#include <cstddef>
+#include <span>
 #include <string>
 
 // The global scheduler (g_scheduler) is defined in main.cpp.
@@ -23,10 +25,21 @@ constexpr cps_coro::EventId POWER_ADJUST_REQUEST_EVENT = 9;
 // --- 保护系统专用事件ID ---
 constexpr cps_coro::EventId FAULT_INFO_EVENT_PROT = 100;
 constexpr cps_coro::EventId ENTITY_TRIP_EVENT_PROT = 101;
+constexpr cps_coro::EventId BREAKER_CLOSED_EVENT = 102; // 自动重合闸合闸，数据为 Entity
+
+// --- 馈线自动化 (FLISR) 事件ID ---
+constexpr cps_coro::EventId FLISR_REPORT_EVENT = 110;
+constexpr cps_coro::EventId FLISR_SWITCHING_DONE_EVENT = 111;
+
+// --- 高级量测 (AMI) 事件ID ---
+constexpr cps_coro::EventId AMI_OUTAGE_EVENT = 120; // 电表停电告警 (last gasp)，数据为电表通信节点号
 
 // --- 频率-有功响应系统专用事件ID ---
 constexpr cps_coro::EventId FREQUENCY_UPDATE_EVENT = 200;
 
+// --- 电压控制 (AVC) 事件ID ---
+constexpr cps_coro::EventId VOLTAGE_CHANGE_EVENT = 10000;
+
 // --- 核心数据结构 ---
 struct FaultInfo {
     double current_kA = 0.0;
@@ -43,9 +56,45 @@ struct FaultInfo {
     }
 };
 
+// A block of fault cases stored column-wise (see fault_sweep.h); case i is
+// the FaultInfo built from element i of every column.
+struct FaultCaseSpan {
+    std::size_t count = 0;
+    const double* current_kA = nullptr;
+    const double* voltage_kV = nullptr;
+    const double* impedance_Ohm = nullptr;
+    const double* distance_km = nullptr;
+    const Entity* faulty_entity_id = nullptr;
+
+    FaultInfo info(std::size_t i) const
+    {
+        FaultInfo fault;
+        fault.current_kA = current_kA[i];
+        fault.voltage_kV = voltage_kV[i];
+        fault.impedance_Ohm = impedance_Ohm[i];
+        fault.distance_km = distance_km[i];
+        fault.faulty_entity_id = faulty_entity_id[i];
+        return fault;
+    }
+};
+
 struct FrequencyInfo {
     double current_sim_time_seconds;
     double freq_deviation_hz;
 };
 
+// One row of a memory-mapped input profile (see time_series_input.h).
+// `values` points into the mapping; it stays valid while the profile is open.
+struct ProfileSample {
+    double current_sim_time_seconds = 0.0;
+    std::size_t sample_index = 0;
+    std::span<const float> values;
+};
+
+// 电压变化事件数据 (VOLTAGE_CHANGE_EVENT)
+struct VoltageData {
+    double voltage; // 电压值 (标幺值)
+    cps_coro::Scheduler::time_point timestamp; // 事件发生的时间戳
+};
+
 #endif // SIMULATION_EVENTS_AND_DATA_H
\ No newline at end of file
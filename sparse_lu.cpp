@@ -0,0 +1,292 @@
+// sparse_lu.cpp
+#include "sparse_lu.h"
+#include <algorithm>
+#include <functional>
+#include <numeric>
+#include <queue>
+#include <utility>
+
+namespace {
+
+// Symmetrized adjacency without the diagonal, each list sorted.
+std::vector<std::vector<int>> symmetric_adjacency(int rows, const std::vector<int>& row_ptr, const std::vector<int>& col)
+{
+    std::vector<std::vector<int>> adjacency(rows);
+    for (int r = 0; r < rows; ++r) {
+        for (int e = row_ptr[r]; e < row_ptr[r + 1]; ++e) {
+            if (col[e] != r) {
+                adjacency[r].push_back(col[e]);
+                adjacency[col[e]].push_back(r);
+            }
+        }
+    }
+    for (auto& list : adjacency) {
+        std::sort(list.begin(), list.end());
+        list.erase(std::unique(list.begin(), list.end()), list.end());
+    }
+    return adjacency;
+}
+
+// Eliminates v: its remaining neighbours are joined into a clique. Those
+// neighbours are the off-diagonal pattern of v's factor row and column.
+template <typename Visit>
+void eliminate_node(std::vector<std::vector<int>>& adjacency, int v, std::vector<int>& merged, Visit&& visit)
+{
+    const std::vector<int>& neighbours = adjacency[v];
+    for (int u : neighbours) {
+        merged.clear();
+        std::set_union(adjacency[u].begin(), adjacency[u].end(), neighbours.begin(), neighbours.end(), std::back_inserter(merged));
+        merged.erase(std::remove_if(merged.begin(), merged.end(), [&](int w) { return w == u || w == v; }), merged.end());
+        adjacency[u].swap(merged);
+        visit(u);
+    }
+}
+
+// Eliminates the graph in minimum-degree order (ties to the lower index).
+std::vector<int> eliminate_minimum_degree(std::vector<std::vector<int>> adjacency, std::vector<std::vector<int>>* fill)
+{
+    const int rows = static_cast<int>(adjacency.size());
+    std::vector<int> order;
+    order.reserve(rows);
+    std::vector<char> eliminated(rows, 0);
+    using Entry = std::pair<std::size_t, int>;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<>> queue;
+    for (int r = 0; r < rows; ++r)
+        queue.emplace(adjacency[r].size(), r);
+
+    std::vector<int> merged;
+    while (!queue.empty()) {
+        auto [degree, v] = queue.top();
+        queue.pop();
+        if (eliminated[v] || degree != adjacency[v].size())
+            continue; // Stale entry
+        eliminate_node(adjacency, v, merged, [&](int u) { queue.emplace(adjacency[u].size(), u); });
+        eliminated[v] = 1;
+        order.push_back(v);
+        if (fill)
+            (*fill)[v] = std::move(adjacency[v]);
+        adjacency[v].clear();
+    }
+    return order;
+}
+
+// Eliminates the graph in a given order.
+void eliminate_in_order(std::vector<std::vector<int>> adjacency, const std::vector<int>& order, std::vector<std::vector<int>>& fill)
+{
+    std::vector<int> merged;
+    for (int v : order) {
+        eliminate_node(adjacency, v, merged, [](int) {});
+        fill[v] = std::move(adjacency[v]);
+        adjacency[v].clear();
+    }
+}
+
+} // namespace
+
+template <typename Scalar>
+std::ptrdiff_t CsrMatrix<Scalar>::find(int row, int column) const
+{
+    auto begin = col.begin() + row_ptr[row];
+    auto end = col.begin() + row_ptr[row + 1];
+    auto it = std::lower_bound(begin, end, column);
+    return it != end && *it == column ? it - col.begin() : -1;
+}
+
+template <typename Scalar>
+CsrMatrix<Scalar> csr_from_triplets(int rows, const std::vector<int>& row, const std::vector<int>& column,
+    const std::vector<Scalar>& value)
+{
+    std::vector<std::size_t> sorted(row.size());
+    std::iota(sorted.begin(), sorted.end(), std::size_t(0));
+    std::sort(sorted.begin(), sorted.end(), [&](std::size_t a, std::size_t b) {
+        return row[a] != row[b] ? row[a] < row[b] : column[a] < column[b];
+    });
+
+    CsrMatrix<Scalar> m;
+    m.rows = rows;
+    m.row_ptr.assign(rows + 1, 0);
+    for (std::size_t k = 0; k < sorted.size(); ++k) {
+        std::size_t t = sorted[k];
+        if (k > 0 && row[t] == row[sorted[k - 1]] && column[t] == column[sorted[k - 1]]) {
+            m.values.back() += value[t];
+            continue;
+        }
+        m.col.push_back(column[t]);
+        m.values.push_back(value[t]);
+        ++m.row_ptr[row[t] + 1];
+    }
+    for (int r = 0; r < rows; ++r)
+        m.row_ptr[r + 1] += m.row_ptr[r];
+    return m;
+}
+
+std::vector<int> minimum_degree_order(int rows, const std::vector<int>& row_ptr, const std::vector<int>& col)
+{
+    return eliminate_minimum_degree(symmetric_adjacency(rows, row_ptr, col), nullptr);
+}
+
+template <typename Scalar>
+void SparseLU<Scalar>::analyze(const CsrMatrix<Scalar>& a)
+{
+    std::vector<std::vector<int>> fill(a.rows);
+    order_ = eliminate_minimum_degree(symmetric_adjacency(a.rows, a.row_ptr, a.col), &fill);
+    build_symbolic(a, fill);
+}
+
+template <typename Scalar>
+void SparseLU<Scalar>::analyze(const CsrMatrix<Scalar>& a, std::vector<int> order)
+{
+    std::vector<std::vector<int>> fill(a.rows);
+    eliminate_in_order(symmetric_adjacency(a.rows, a.row_ptr, a.col), order, fill);
+    order_ = std::move(order);
+    build_symbolic(a, fill);
+}
+
+template <typename Scalar>
+void SparseLU<Scalar>::build_symbolic(const CsrMatrix<Scalar>& a, const std::vector<std::vector<int>>& fill)
+{
+    rows_ = a.rows;
+    factorized_ = false;
+    position_.assign(rows_, 0);
+    for (int k = 0; k < rows_; ++k)
+        position_[order_[k]] = k;
+
+    // U row k holds the later positions adjacent to pivot k at elimination;
+    // the pattern is symmetric, so L row i lists every k whose U row holds i.
+    u_ptr_.assign(rows_ + 1, 0);
+    u_col_.clear();
+    std::vector<int> l_count(rows_, 0);
+    for (int k = 0; k < rows_; ++k) {
+        std::size_t first = u_col_.size();
+        for (int neighbour : fill[order_[k]])
+            u_col_.push_back(position_[neighbour]);
+        std::sort(u_col_.begin() + first, u_col_.end());
+        for (std::size_t e = first; e < u_col_.size(); ++e)
+            ++l_count[u_col_[e]];
+        u_ptr_[k + 1] = static_cast<int>(u_col_.size());
+    }
+    l_ptr_.assign(rows_ + 1, 0);
+    for (int i = 0; i < rows_; ++i)
+        l_ptr_[i + 1] = l_ptr_[i] + l_count[i];
+    l_col_.assign(l_ptr_[rows_], 0);
+    std::vector<int> next(l_ptr_.begin(), l_ptr_.end() - 1);
+    for (int k = 0; k < rows_; ++k) {
+        for (int e = u_ptr_[k]; e < u_ptr_[k + 1]; ++e)
+            l_col_[next[u_col_[e]]++] = k; // k increases, so rows stay sorted
+    }
+
+    etree_parent_.assign(rows_, -1);
+    for (int k = 0; k < rows_; ++k) {
+        if (u_ptr_[k] < u_ptr_[k + 1])
+            etree_parent_[k] = u_col_[u_ptr_[k]];
+    }
+    affected_.assign(rows_, 0);
+
+    a_col_position_.resize(a.col.size());
+    for (std::size_t e = 0; e < a.col.size(); ++e)
+        a_col_position_[e] = position_[a.col[e]];
+    l_val_.assign(l_col_.size(), Scalar {});
+    u_val_.assign(u_col_.size(), Scalar {});
+    diagonal_.assign(rows_, Scalar {});
+    work_.assign(rows_, Scalar {});
+}
+
+template <typename Scalar>
+bool SparseLU<Scalar>::factorize_row(const CsrMatrix<Scalar>& a, int i)
+{
+    // Row i of L, the pivot and row i of U from A's row and the earlier U
+    // rows, in a dense work row; every update lands in the row's own fill
+    // pattern.
+    const int original = order_[i];
+    for (int e = a.row_ptr[original]; e < a.row_ptr[original + 1]; ++e)
+        work_[a_col_position_[e]] += a.values[e];
+    for (int e = l_ptr_[i]; e < l_ptr_[i + 1]; ++e) {
+        const int k = l_col_[e];
+        const Scalar lik = work_[k] / diagonal_[k];
+        work_[k] = Scalar {};
+        l_val_[e] = lik;
+        for (int f = u_ptr_[k]; f < u_ptr_[k + 1]; ++f)
+            work_[u_col_[f]] -= lik * u_val_[f];
+    }
+    diagonal_[i] = work_[i];
+    work_[i] = Scalar {};
+    for (int e = u_ptr_[i]; e < u_ptr_[i + 1]; ++e) {
+        u_val_[e] = work_[u_col_[e]];
+        work_[u_col_[e]] = Scalar {};
+    }
+    return diagonal_[i] != Scalar {};
+}
+
+template <typename Scalar>
+bool SparseLU<Scalar>::factorize(const CsrMatrix<Scalar>& a)
+{
+    factorized_ = false;
+    last_updated_rows_ = 0;
+    if (a.rows != rows_ || a.col.size() != a_col_position_.size())
+        return false;
+    for (int i = 0; i < rows_; ++i) {
+        ++last_updated_rows_;
+        if (!factorize_row(a, i))
+            return false;
+    }
+    factorized_ = true;
+    return true;
+}
+
+template <typename Scalar>
+bool SparseLU<Scalar>::refactorize(const CsrMatrix<Scalar>& a, std::span<const int> changed_rows)
+{
+    if (!factorized_)
+        return factorize(a);
+    // Row p of the factors reads only U rows k with U(k, p) != 0, and those
+    // k are descendants of p in the elimination tree, so a change in row i
+    // propagates to i's ancestors and nowhere else.
+    std::vector<int> rows;
+    for (int changed : changed_rows) {
+        for (int p = position_[changed]; p >= 0 && !affected_[p]; p = etree_parent_[p]) {
+            affected_[p] = 1;
+            rows.push_back(p);
+        }
+    }
+    std::sort(rows.begin(), rows.end());
+    factorized_ = false;
+    last_updated_rows_ = rows.size();
+    bool ok = true;
+    for (int p : rows) {
+        affected_[p] = 0;
+        if (ok)
+            ok = factorize_row(a, p);
+    }
+    factorized_ = ok;
+    return ok;
+}
+
+template <typename Scalar>
+void SparseLU<Scalar>::solve(std::span<Scalar> b) const
+{
+    // Not thread-safe: the permuted right-hand side lives in work_.
+    for (int i = 0; i < rows_; ++i) {
+        Scalar sum = b[order_[i]];
+        for (int e = l_ptr_[i]; e < l_ptr_[i + 1]; ++e)
+            sum -= l_val_[e] * work_[l_col_[e]];
+        work_[i] = sum;
+    }
+    for (int i = rows_ - 1; i >= 0; --i) {
+        Scalar sum = work_[i];
+        for (int e = u_ptr_[i]; e < u_ptr_[i + 1]; ++e)
+            sum -= u_val_[e] * work_[u_col_[e]];
+        work_[i] = sum / diagonal_[i];
+    }
+    for (int i = 0; i < rows_; ++i) {
+        b[order_[i]] = work_[i];
+        work_[i] = Scalar {};
+    }
+}
+
+template struct CsrMatrix<double>;
+template struct CsrMatrix<std::complex<double>>;
+template CsrMatrix<double> csr_from_triplets(int, const std::vector<int>&, const std::vector<int>&, const std::vector<double>&);
+template CsrMatrix<std::complex<double>> csr_from_triplets(int, const std::vector<int>&, const std::vector<int>&,
+    const std::vector<std::complex<double>>&);
+template class SparseLU<double>;
+template class SparseLU<std::complex<double>>;
@@ -0,0 +1,104 @@
+// sparse_lu.h
+// Sparse LU factorization for network matrices (nodal admittance, power-flow
+// Jacobians). Matrices are CSR with a structurally symmetric pattern, which
+// holds for every network matrix in this project; pivots are taken from the
+// diagonal (no numeric pivoting), which suits diagonally dominant network
+// matrices.
+//
+// Work is split so it can be reused:
+//   analyze()    - minimum-degree (or given) ordering and the fill pattern
+//                  of L and U (depends on the sparsity pattern only)
+//   factorize()  - numeric factors for new values on the analyzed pattern
+//   refactorize()- the same after a few rows changed: only the factor rows
+//                  on the elimination-tree paths from those rows to the root
+//                  are recomputed
+//   solve()      - forward/backward substitution, any number of times
+#ifndef SPARSE_LU_H
+#define SPARSE_LU_H
+
+#include <complex>
+#include <cstddef>
+#include <span>
+#include <vector>
+
+template <typename Scalar>
+struct CsrMatrix {
+    int rows = 0;
+    std::vector<int> row_ptr { 0 }; // rows + 1 entries
+    std::vector<int> col; // Sorted within each row
+    std::vector<Scalar> values;
+
+    std::size_t nonzeros() const { return col.size(); }
+    // Index of (row, column) in col/values, or -1 if it is not stored.
+    std::ptrdiff_t find(int row, int column) const;
+};
+
+// Builds a CSR matrix from (row, column, value) triplets; duplicates are summed.
+template <typename Scalar>
+CsrMatrix<Scalar> csr_from_triplets(int rows, const std::vector<int>& row, const std::vector<int>& column,
+    const std::vector<Scalar>& value);
+
+// Minimum-degree elimination order of the symmetrized pattern. order[k] is
+// the row eliminated at step k.
+std::vector<int> minimum_degree_order(int rows, const std::vector<int>& row_ptr, const std::vector<int>& col);
+
+template <typename Scalar>
+class SparseLU {
+public:
+    // Ordering and symbolic factorization. Call again when the pattern changes.
+    void analyze(const CsrMatrix<Scalar>& a);
+    // The same for a given elimination order (order[k] is the row eliminated
+    // at step k), e.g. a bus ordering expanded to a block matrix.
+    void analyze(const CsrMatrix<Scalar>& a, std::vector<int> order);
+    // Numeric factorization of a matrix with the analyzed pattern. Returns
+    // false on a zero pivot.
+    bool factorize(const CsrMatrix<Scalar>& a);
+    // Numeric update after the values of `changed_rows` (original numbering)
+    // changed, symmetrically in their columns. Falls back to factorize() when
+    // there is no valid factorization to update.
+    bool refactorize(const CsrMatrix<Scalar>& a, std::span<const int> changed_rows);
+    // Solves A x = b in place.
+    void solve(std::span<Scalar> b) const;
+
+    bool analyzed() const { return rows_ > 0; }
+    bool factorized() const { return factorized_; }
+    int rows() const { return rows_; }
+    // Stored entries of L and U together (diagonal counted once).
+    std::size_t factor_nonzeros() const { return l_col_.size() + u_col_.size() + static_cast<std::size_t>(rows_); }
+    const std::vector<int>& order() const { return order_; }
+    // Rows recomputed by the last factorize()/refactorize().
+    std::size_t last_updated_rows() const { return last_updated_rows_; }
+
+private:
+    // Positions, L/U patterns and the elimination tree from order_ and the
+    // factor pattern of each original row.
+    void build_symbolic(const CsrMatrix<Scalar>& a, const std::vector<std::vector<int>>& fill);
+    bool factorize_row(const CsrMatrix<Scalar>& a, int i);
+
+    int rows_ = 0;
+    bool factorized_ = false;
+    std::size_t last_updated_rows_ = 0;
+    std::vector<int> order_; // Position -> original row
+    std::vector<int> position_; // Original row -> position
+
+    // Rows in elimination order. L is unit lower triangular (strictly lower
+    // part stored); U's diagonal is kept apart. Columns are positions.
+    std::vector<int> l_ptr_, l_col_;
+    std::vector<Scalar> l_val_;
+    std::vector<int> u_ptr_, u_col_;
+    std::vector<Scalar> u_val_;
+    std::vector<Scalar> diagonal_;
+    // Elimination tree: the first off-diagonal position of each U row, -1
+    // at a root. A change in row i reaches only i's ancestors.
+    std::vector<int> etree_parent_;
+    std::vector<char> affected_;
+    // For entry e of A (CSR order): its slot in the work row.
+    std::vector<int> a_col_position_;
+
+    mutable std::vector<Scalar> work_;
+};
+
+extern template class SparseLU<double>;
+extern template class SparseLU<std::complex<double>>;
+
+#endif // SPARSE_LU_H
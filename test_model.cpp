@@ -1,29 +1,45 @@
 #include "cps_coro_lib.h" // 引入协程库
+#include "network_model.h" // 母线、支路、电源、负荷组件
+#include "radial_power_flow.h" // 馈线潮流计算
+#include "simulation_events_and_data.h" // VOLTAGE_CHANGE_EVENT, VoltageData
 #include <iostream> // 用于标准输入输出
 
-// 定义事件ID
-constexpr cps_coro::EventId VOLTAGE_CHANGE_EVENT = 10000;
-
-// 事件数据结构体
-struct VoltageData {
-    double voltage; // 电压值
-    cps_coro::Scheduler::time_point timestamp; // 事件发生的时间戳
-};
-
-// Sensor 协程：模拟传感器检测电压变化并触发事件
+// Sensor 协程：对一条 10 kV 馈线做潮流计算，测量最低母线电压并触发事件
 cps_coro::Task sensor_coroutine(cps_coro::Scheduler& scheduler)
 {
     std::cout << "[" << scheduler.now().time_since_epoch().count() << "ms] Sensor: Initializing." << std::endl;
 
-    // 模拟10秒后电压跌落
+    // 馈线：电源 + 10 段 0.5 km 线路，每段末端一个负荷
+    Registry registry;
+    Entity feeder_bus = registry.create();
+    registry.emplace<BusComponent>(feeder_bus, 10.0);
+    registry.emplace<SourceComponent>(registry.create(), feeder_bus, 10.3, std::complex<double>(0.05, 0.5));
+    std::vector<Entity> load_buses;
+    for (int section = 0; section < 10; ++section) {
+        Entity bus = registry.create();
+        registry.emplace<BusComponent>(bus, 10.0);
+        registry.emplace<BranchComponent>(registry.create(), feeder_bus, bus, std::complex<double>(0.27, 0.35) * 0.5, 0.5);
+        load_buses.push_back(bus);
+        feeder_bus = bus;
+    }
+    RadialPowerFlow power_flow(registry);
+    power_flow.build();
+    auto feeder_voltage_pu = [&](double load_kW_per_bus) {
+        for (Entity bus : load_buses)
+            power_flow.set_load(bus, load_kW_per_bus, 0.33 * load_kW_per_bus);
+        power_flow.solve(); // 从上一次的解热启动
+        return power_flow.min_voltage_pu();
+    };
+
+    // 10秒后负荷加重 (每个负荷 750 kW)，电压跌落
     co_await cps_coro::delay(std::chrono::seconds(10));
-    VoltageData low_voltage_data = { 0.92, scheduler.now() };
+    VoltageData low_voltage_data = { feeder_voltage_pu(750.0), scheduler.now() };
     std::cout << "[" << scheduler.now().time_since_epoch().count() << "ms] Sensor: Voltage drop detected. V = " << low_voltage_data.voltage << std::endl;
     scheduler.trigger_event(VOLTAGE_CHANGE_EVENT, low_voltage_data);
 
-    // 模拟再过10秒后电压恢复 (总计20秒)
+    // 再过10秒后负荷减轻 (每个负荷 150 kW)，电压恢复 (总计20秒)
     co_await cps_coro::delay(std::chrono::seconds(10));
-    VoltageData normal_voltage_data = { 1.01, scheduler.now() };
+    VoltageData normal_voltage_data = { feeder_voltage_pu(150.0), scheduler.now() };
     std::cout << "[" << scheduler.now().time_since_epoch().count() << "ms] Sensor: Voltage rise detected. V = " << normal_voltage_data.voltage << std::endl;
     scheduler.trigger_event(VOLTAGE_CHANGE_EVENT, normal_voltage_data);
 
@@ -0,0 +1,399 @@
+// arrow_ipc_writer_test.cpp
+#include "arrow_ipc_writer.h"
+#include "columnar_recorder.h"
+#include "test_support.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace {
+
+// The file as bytes; reads past the end yield zero and clear ok.
+struct Image {
+    std::vector<std::uint8_t> bytes;
+    mutable bool ok = true;
+
+    explicit Image(const std::string& path)
+    {
+        std::ifstream in(path, std::ios::binary);
+        bytes.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+
+    template <typename T>
+    T get(std::size_t at) const
+    {
+        T value {};
+        if (at > bytes.size() || bytes.size() - at < sizeof(T)) {
+            ok = false;
+            return value;
+        }
+        std::memcpy(&value, bytes.data() + at, sizeof(T));
+        return value;
+    }
+};
+
+// Read side of a flatbuffer table: a signed offset to the vtable, whose
+// slots give each field's position relative to the table.
+struct FlatTable {
+    const Image* image;
+    std::size_t pos;
+
+    std::size_t field(std::uint16_t id) const
+    {
+        const std::size_t vtable = pos - static_cast<std::size_t>(static_cast<std::int64_t>(image->get<std::int32_t>(pos)));
+        const std::size_t slot = 4 + 2 * std::size_t(id);
+        if (slot >= image->get<std::uint16_t>(vtable))
+            return 0;
+        const std::uint16_t offset = image->get<std::uint16_t>(vtable + slot);
+        return offset ? pos + offset : 0;
+    }
+
+    template <typename T>
+    T scalar(std::uint16_t id, T fallback = T {}) const
+    {
+        const std::size_t at = field(id);
+        return at ? image->get<T>(at) : fallback;
+    }
+
+    std::size_t follow(std::uint16_t id) const
+    {
+        const std::size_t at = field(id);
+        if (!at)
+            image->ok = false;
+        return at + image->get<std::uint32_t>(at);
+    }
+
+    FlatTable table(std::uint16_t id) const { return { image, follow(id) }; }
+
+    // Position of the first element; length receives the element count.
+    std::size_t vector(std::uint16_t id, std::size_t* length) const
+    {
+        const std::size_t at = follow(id);
+        *length = image->get<std::uint32_t>(at);
+        return at + 4;
+    }
+
+    std::vector<FlatTable> tables(std::uint16_t id) const
+    {
+        std::size_t length = 0;
+        const std::size_t first = vector(id, &length);
+        std::vector<FlatTable> result;
+        for (std::size_t i = 0; i < length && image->ok; ++i)
+            result.push_back({ image, first + 4 * i + image->get<std::uint32_t>(first + 4 * i) });
+        return result;
+    }
+
+    std::string string(std::uint16_t id) const
+    {
+        std::size_t length = 0;
+        const std::size_t first = vector(id, &length);
+        if (!image->ok || first + length > image->bytes.size())
+            return {};
+        return std::string(reinterpret_cast<const char*>(image->bytes.data() + first), length);
+    }
+};
+
+// Arrow format.fbs: Type union members and MetadataVersion::V5.
+constexpr std::uint8_t kInt = 2;
+constexpr std::uint8_t kFloatingPoint = 3;
+constexpr std::uint8_t kFixedSizeList = 16;
+constexpr std::int16_t kV5 = 4;
+
+// Field as decoded from a Schema table.
+struct Field {
+    std::string name;
+    bool nullable = true;
+    std::uint8_t type = 0;
+    std::int32_t bit_width = 0; // Int
+    bool is_signed = false;
+    std::int16_t precision = -1; // FloatingPoint
+    std::int32_t list_size = 0; // FixedSizeList
+    std::vector<Field> children;
+};
+
+Field read_field(const FlatTable& table)
+{
+    Field field;
+    field.name = table.string(0);
+    field.nullable = table.scalar<std::uint8_t>(1) != 0;
+    field.type = table.scalar<std::uint8_t>(2);
+    const FlatTable type = table.table(3);
+    if (field.type == kInt) {
+        field.bit_width = type.scalar<std::int32_t>(0);
+        field.is_signed = type.scalar<std::uint8_t>(1) != 0;
+    } else if (field.type == kFloatingPoint) {
+        field.precision = type.scalar<std::int16_t>(0);
+    } else if (field.type == kFixedSizeList) {
+        field.list_size = type.scalar<std::int32_t>(0);
+    }
+    for (const FlatTable& child : table.tables(5))
+        field.children.push_back(read_field(child));
+    return field;
+}
+
+std::vector<Field> read_schema(const FlatTable& schema)
+{
+    std::vector<Field> fields;
+    for (const FlatTable& field : schema.tables(1))
+        fields.push_back(read_field(field));
+    return fields;
+}
+
+struct Batch {
+    std::size_t offset; // Of the message, at its continuation marker
+    std::int32_t metadata_length; // Including the 8-byte prefix
+    std::size_t body; // Start of the body in the file
+    std::int64_t body_length;
+    std::int64_t rows;
+    std::vector<std::int64_t> node_lengths;
+    std::vector<std::int64_t> node_nulls;
+    std::vector<std::int64_t> buffer_offsets;
+    std::vector<std::int64_t> buffer_lengths;
+};
+
+struct Messages {
+    std::vector<Field> schema;
+    std::size_t schema_count = 0;
+    std::vector<Batch> batches;
+    std::size_t end = 0; // Just past the end-of-stream marker
+    bool aligned = true; // Every metadata block and body starts 8-byte aligned
+};
+
+// Walks the encapsulated messages from at up to the end-of-stream marker.
+Messages read_messages(const Image& image, std::size_t at)
+{
+    Messages messages;
+    while (image.ok) {
+        if (image.get<std::uint32_t>(at) != 0xFFFFFFFF) {
+            image.ok = false;
+            break;
+        }
+        const std::int32_t length = image.get<std::int32_t>(at + 4);
+        if (length == 0) {
+            messages.end = at + 8;
+            break;
+        }
+        const std::size_t metadata = at + 8;
+        const std::size_t body = metadata + static_cast<std::size_t>(length);
+        messages.aligned = messages.aligned && at % 8 == 0 && body % 8 == 0;
+        const FlatTable message { &image, metadata + image.get<std::uint32_t>(metadata) };
+        if (message.scalar<std::int16_t>(0) != kV5)
+            image.ok = false;
+        const std::uint8_t header_type = message.scalar<std::uint8_t>(1);
+        const std::int64_t body_length = message.scalar<std::int64_t>(3);
+        if (header_type == 1) {
+            messages.schema = read_schema(message.table(2));
+            ++messages.schema_count;
+        } else if (header_type == 3) {
+            const FlatTable header = message.table(2);
+            Batch batch { at, length + 8, body, body_length, header.scalar<std::int64_t>(0), {}, {}, {}, {} };
+            std::size_t count = 0;
+            std::size_t first = header.vector(1, &count); // FieldNode { length, null_count }
+            for (std::size_t i = 0; i < count; ++i) {
+                batch.node_lengths.push_back(image.get<std::int64_t>(first + 16 * i));
+                batch.node_nulls.push_back(image.get<std::int64_t>(first + 16 * i + 8));
+            }
+            first = header.vector(2, &count); // Buffer { offset, length }
+            for (std::size_t i = 0; i < count; ++i) {
+                batch.buffer_offsets.push_back(image.get<std::int64_t>(first + 16 * i));
+                batch.buffer_lengths.push_back(image.get<std::int64_t>(first + 16 * i + 8));
+            }
+            messages.batches.push_back(batch);
+        } else {
+            image.ok = false;
+        }
+        at = body + static_cast<std::size_t>(body_length);
+    }
+    return messages;
+}
+
+const std::vector<ColumnSpec> kSchema = {
+    { "time_s", ColumnType::Float64, 1 },
+    { "step", ColumnType::Int64, 1 },
+    { "power_kW", ColumnType::Float32, 3 },
+};
+
+double time_value(std::size_t r)
+{
+    return 0.25 * static_cast<double>(r);
+}
+
+std::int64_t step_value(std::size_t r)
+{
+    return (std::int64_t(1) << 40) - 7 * static_cast<std::int64_t>(r);
+}
+
+float power_value(std::size_t r, std::size_t k)
+{
+    return static_cast<float>(r) - 0.5f * static_cast<float>(k);
+}
+
+// The schema of kSchema as Arrow sees it.
+void check_schema(const std::vector<Field>& fields)
+{
+    HECS_CHECK(fields.size() == 3);
+    if (fields.size() != 3)
+        return;
+    for (const Field& field : fields)
+        HECS_CHECK(!field.nullable);
+    HECS_CHECK(fields[0].name == "time_s" && fields[0].type == kFloatingPoint && fields[0].precision == 2);
+    HECS_CHECK(fields[0].children.empty());
+    HECS_CHECK(fields[1].name == "step" && fields[1].type == kInt && fields[1].bit_width == 64 && fields[1].is_signed);
+    HECS_CHECK(fields[2].name == "power_kW" && fields[2].type == kFixedSizeList && fields[2].list_size == 3);
+    HECS_CHECK(fields[2].children.size() == 1);
+    if (fields[2].children.size() == 1) {
+        const Field& item = fields[2].children[0];
+        HECS_CHECK(item.name == "item" && item.type == kFloatingPoint && item.precision == 1 && !item.nullable);
+    }
+}
+
+// Checks a batch's nodes and buffers against kSchema and decodes its values
+// from the body, comparing them with rows first_row onwards.
+void check_batch(const Image& image, const Batch& batch, std::size_t first_row, std::size_t rows)
+{
+    const auto n = static_cast<std::int64_t>(rows);
+    HECS_CHECK(batch.rows == n);
+    // time_s, step, power_kW list, power_kW values; no nulls anywhere.
+    const std::vector<std::int64_t> node_lengths = { n, n, n, 3 * n };
+    HECS_CHECK(batch.node_lengths == node_lengths);
+    HECS_CHECK(batch.node_nulls == std::vector<std::int64_t>(4, 0));
+    // Validity bitmaps are omitted (length 0) as every value is present.
+    const std::vector<std::int64_t> buffer_lengths = { 0, 8 * n, 0, 8 * n, 0, 0, 4 * 3 * n };
+    HECS_CHECK(batch.buffer_lengths == buffer_lengths);
+    if (batch.buffer_offsets.size() != buffer_lengths.size())
+        return;
+    for (std::size_t b = 0; b < buffer_lengths.size(); ++b) {
+        HECS_CHECK(batch.buffer_offsets[b] % 8 == 0);
+        HECS_CHECK(batch.buffer_offsets[b] + buffer_lengths[b] <= batch.body_length);
+    }
+
+    auto at = [&](std::size_t buffer, std::size_t index, std::size_t size) {
+        return batch.body + static_cast<std::size_t>(batch.buffer_offsets[buffer]) + index * size;
+    };
+    bool values_match = true;
+    for (std::size_t r = 0; r < rows; ++r) {
+        values_match = values_match && image.get<double>(at(1, r, 8)) == time_value(first_row + r);
+        values_match = values_match && image.get<std::int64_t>(at(3, r, 8)) == step_value(first_row + r);
+        for (std::size_t k = 0; k < 3; ++k)
+            values_match = values_match && image.get<float>(at(6, 3 * r + k, 4)) == power_value(first_row + r, k);
+    }
+    HECS_CHECK(values_match);
+}
+
+} // namespace
+
+// A file of two record batches: the magic at both ends, the schema message,
+// each batch's nodes, buffers and values at the offsets its metadata gives,
+// the end-of-stream marker, and a footer that repeats the schema and points
+// at exactly the batch messages found by walking the stream.
+HECS_TEST(arrow_ipc_file_layout)
+{
+    hecs_test::ScratchDirectory dir("hecs_arrow_ipc_file");
+    const std::string path = dir.file("results.arrow");
+    const std::size_t batch_rows[] = { 3, 2 };
+    {
+        ArrowIpcWriter writer;
+        HECS_CHECK(writer.open(path, kSchema, ArrowIpcFormat::File));
+        std::size_t first_row = 0;
+        for (std::size_t rows : batch_rows) {
+            std::vector<double> time;
+            std::vector<std::int64_t> step;
+            std::vector<float> power;
+            for (std::size_t r = first_row; r < first_row + rows; ++r) {
+                time.push_back(time_value(r));
+                step.push_back(step_value(r));
+                for (std::size_t k = 0; k < 3; ++k)
+                    power.push_back(power_value(r, k));
+            }
+            HECS_CHECK(writer.write_batch({ time.data(), step.data(), power.data() }, rows));
+            first_row += rows;
+        }
+        HECS_CHECK(writer.batches_written() == 2);
+        HECS_CHECK(writer.close());
+        HECS_CHECK(writer.error().empty());
+    }
+
+    const Image image(path);
+    const std::size_t size = image.bytes.size();
+    HECS_CHECK(size > 16 && std::memcmp(image.bytes.data(), "ARROW1\0\0", 8) == 0);
+    HECS_CHECK(std::memcmp(image.bytes.data() + size - 6, "ARROW1", 6) == 0);
+
+    const Messages messages = read_messages(image, 8);
+    HECS_CHECK(image.ok);
+    HECS_CHECK(messages.aligned);
+    HECS_CHECK(messages.schema_count == 1);
+    check_schema(messages.schema);
+    HECS_CHECK(messages.batches.size() == 2);
+    if (messages.batches.size() == 2) {
+        check_batch(image, messages.batches[0], 0, 3);
+        check_batch(image, messages.batches[1], 3, 2);
+    }
+
+    // Footer { version, schema, dictionaries, recordBatches } sits between
+    // the end-of-stream marker and its int32 length.
+    const auto footer_length = static_cast<std::size_t>(image.get<std::int32_t>(size - 10));
+    const std::size_t footer = size - 10 - footer_length;
+    HECS_CHECK(footer == messages.end);
+    const FlatTable root { &image, footer + image.get<std::uint32_t>(footer) };
+    HECS_CHECK(root.scalar<std::int16_t>(0) == kV5);
+    check_schema(read_schema(root.table(1)));
+    std::size_t dictionaries = 0;
+    root.vector(2, &dictionaries);
+    HECS_CHECK(dictionaries == 0);
+    std::size_t blocks = 0;
+    const std::size_t first = root.vector(3, &blocks); // Block { offset, metaDataLength, bodyLength }
+    HECS_CHECK(blocks == messages.batches.size());
+    for (std::size_t b = 0; b < blocks && b < messages.batches.size(); ++b) {
+        const Batch& batch = messages.batches[b];
+        HECS_CHECK(image.get<std::int64_t>(first + 24 * b) == static_cast<std::int64_t>(batch.offset));
+        HECS_CHECK(image.get<std::int32_t>(first + 24 * b + 8) == batch.metadata_length);
+        HECS_CHECK(image.get<std::int64_t>(first + 24 * b + 16) == batch.body_length);
+    }
+    HECS_CHECK(image.ok);
+}
+
+// Through ColumnarRecorder in the stream format: no magic or footer, each
+// 3-row chunk (and the partial last one) becomes a record batch, and the
+// file ends right after the end-of-stream marker.
+HECS_TEST(arrow_ipc_stream_from_recorder)
+{
+    hecs_test::ScratchDirectory dir("hecs_arrow_ipc_stream");
+    const std::string path = dir.file("results.arrows");
+    const std::size_t rows = 7;
+    {
+        ColumnarRecorder recorder(kSchema, 3 * (8 + 8 + 3 * 4));
+        HECS_CHECK(recorder.rows_per_chunk() == 3);
+        HECS_CHECK(recorder.open(path, ColumnarFileFormat::ArrowIpcStream));
+        for (std::size_t r = 0; r < rows; ++r) {
+            recorder.set(0, time_value(r));
+            recorder.set_int(1, step_value(r));
+            std::span<float> power = recorder.row_values<float>(2);
+            for (std::size_t k = 0; k < power.size(); ++k)
+                power[k] = power_value(r, k);
+            recorder.commit_row();
+        }
+        recorder.close();
+        HECS_CHECK(recorder.error().empty());
+    }
+
+    const Image image(path);
+    const Messages messages = read_messages(image, 0);
+    HECS_CHECK(image.ok);
+    HECS_CHECK(messages.aligned);
+    HECS_CHECK(messages.schema_count == 1);
+    check_schema(messages.schema);
+    HECS_CHECK(messages.end == image.bytes.size());
+    HECS_CHECK(messages.batches.size() == 3);
+    std::size_t first_row = 0;
+    for (const Batch& batch : messages.batches) {
+        const std::size_t batch_rows = std::min<std::size_t>(3, rows - first_row);
+        check_batch(image, batch, first_row, batch_rows);
+        first_row += batch_rows;
+    }
+    HECS_CHECK(first_row == rows);
+}
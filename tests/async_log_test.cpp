@@ -0,0 +1,276 @@
+// async_log_test.cpp
+#include "async_log.h"
+#include "spdlog/sinks/base_sink.h"
+#include "test_support.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using std::chrono::milliseconds;
+
+// Keeps every formatted message. With hold() the first message parks the
+// backend inside the sink until release(), so the rings fill up.
+class CaptureSink : public spdlog::sinks::base_sink<std::mutex> {
+public:
+    void hold() { held_ = true; }
+
+    void wait_until_held()
+    {
+        std::unique_lock<std::mutex> lock(gate_mutex_);
+        gate_.wait(lock, [this] { return parked_; });
+    }
+
+    void release()
+    {
+        std::lock_guard<std::mutex> lock(gate_mutex_);
+        held_ = false;
+        gate_.notify_all();
+    }
+
+    std::vector<std::string> messages()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return messages_;
+    }
+
+protected:
+    void sink_it_(const spdlog::details::log_msg& msg) override
+    {
+        messages_.emplace_back(msg.payload.data(), msg.payload.size());
+        std::unique_lock<std::mutex> lock(gate_mutex_);
+        if (held_) {
+            parked_ = true;
+            gate_.notify_all();
+            gate_.wait(lock, [this] { return !held_; });
+        }
+    }
+
+    void flush_() override { }
+
+private:
+    std::vector<std::string> messages_;
+    std::mutex gate_mutex_;
+    std::condition_variable gate_;
+    bool held_ = false;
+    bool parked_ = false;
+};
+
+std::shared_ptr<spdlog::logger> make_logger(const std::shared_ptr<CaptureSink>& sink)
+{
+    auto logger = std::make_shared<spdlog::logger>("async_log_test", sink);
+    logger->set_level(spdlog::level::trace);
+    return logger;
+}
+
+AsyncLogSettings small_rings(LogOverflowPolicy overflow)
+{
+    AsyncLogSettings settings;
+    settings.ring_bytes = 4096;
+    settings.overflow = overflow;
+    settings.idle_poll = milliseconds(1);
+    return settings;
+}
+
+// Splits "<thread> <sequence>" messages per thread; false on a message that
+// does not parse or a sequence that does not continue its thread's run.
+bool per_thread_in_order(const std::vector<std::string>& messages, std::vector<int>& counts)
+{
+    for (const std::string& message : messages) {
+        int thread = -1;
+        int sequence = -1;
+        if (std::sscanf(message.c_str(), "%d %d", &thread, &sequence) != 2 || thread < 0
+            || thread >= static_cast<int>(counts.size()) || sequence != counts[thread])
+            return false;
+        ++counts[thread];
+    }
+    return true;
+}
+
+void ignore_args(const void*, fmt::string_view, fmt::memory_buffer&) { }
+
+} // namespace
+
+HECS_TEST(async_log_ring_wraps_with_filler)
+{
+    using namespace async_log_detail;
+    Ring ring(4096, std::this_thread::get_id());
+    HECS_CHECK(ring.capacity() == 4096);
+
+    auto write = [&](std::size_t bytes) {
+        void* slot = ring.reserve(bytes);
+        if (!slot)
+            return static_cast<void*>(nullptr);
+        static_cast<RecordHeader*>(slot)->format = &ignore_args;
+        ring.commit(bytes);
+        return slot;
+    };
+    std::vector<void*> seen;
+    auto drain = [&] { return ring.drain([&](RecordHeader& header, unsigned char*) { seen.push_back(&header); }); };
+
+    void* first = write(1536);
+    void* second = write(1536);
+    HECS_CHECK(first && second);
+    HECS_CHECK(!ring.reserve(1536)); // 3072 used, 1024 left
+    HECS_CHECK(drain() == 2);
+    HECS_CHECK(ring.empty());
+
+    // 1024 bytes remain before the end: they become filler and the record
+    // starts over at the front of the buffer.
+    void* wrapped = write(1536);
+    HECS_CHECK(wrapped == first);
+    HECS_CHECK(static_cast<RecordHeader*>(wrapped)->size == 1536);
+    seen.clear();
+    HECS_CHECK(drain() == 1); // The filler is skipped
+    HECS_CHECK(seen.size() == 1 && seen[0] == wrapped);
+    HECS_CHECK(ring.empty());
+
+    // Records that end exactly at the end of the buffer need no filler, and
+    // the ring fills to the last byte; the space comes back once the
+    // consumer catches up.
+    HECS_CHECK(write(1024) && write(1536));
+    HECS_CHECK(write(1536) == first);
+    HECS_CHECK(!ring.reserve(16));
+    HECS_CHECK(drain() == 3);
+    HECS_CHECK(ring.reserve(16));
+}
+
+HECS_TEST(async_log_null_string_is_logged_as_null)
+{
+    auto sink = std::make_shared<CaptureSink>();
+    AsyncLogger log(make_logger(sink));
+    const char* missing = nullptr;
+    char* missing_mutable = nullptr;
+    log.info("name={} alias={}", missing, missing_mutable); // Backend not running: synchronous
+    start_async_logging(small_rings(LogOverflowPolicy::Block));
+    log.info("name={} alias={}", missing, missing_mutable);
+    stop_async_logging();
+
+    std::vector<std::string> messages = sink->messages();
+    HECS_CHECK(messages.size() == 2);
+    for (const std::string& message : messages)
+        HECS_CHECK(message == "name=(null) alias=(null)");
+}
+
+HECS_TEST(async_log_drop_policy_counts_discarded_records)
+{
+    auto sink = std::make_shared<CaptureSink>();
+    sink->hold();
+    AsyncLogger log(make_logger(sink));
+    const AsyncLogStats before = async_log_stats();
+    start_async_logging(small_rings(LogOverflowPolicy::Drop));
+    log.info("0 {}", 0);
+    sink->wait_until_held();
+    const int total = 200; // About 80 bytes each: far more than a 4 KiB ring
+    for (int i = 1; i < total; ++i)
+        log.info("0 {}", i);
+    sink->release();
+    stop_async_logging();
+    const AsyncLogStats after = async_log_stats();
+
+    const std::uint64_t enqueued = after.enqueued - before.enqueued;
+    const std::uint64_t dropped = after.dropped - before.dropped;
+    HECS_CHECK(dropped > 0);
+    HECS_CHECK(enqueued + dropped == total);
+    HECS_CHECK(after.blocked == before.blocked);
+
+    // The kept records reach the sink in order: a prefix of the run, since
+    // the ring only empties once the sink is released.
+    std::vector<std::string> messages = sink->messages();
+    HECS_CHECK(messages.size() == enqueued);
+    std::vector<int> counts(1, 0);
+    HECS_CHECK(per_thread_in_order(messages, counts));
+}
+
+HECS_TEST(async_log_block_policy_waits_and_keeps_every_record)
+{
+    auto sink = std::make_shared<CaptureSink>();
+    sink->hold();
+    AsyncLogger log(make_logger(sink));
+    const AsyncLogStats before = async_log_stats();
+    start_async_logging(small_rings(LogOverflowPolicy::Block));
+    const int total = 200;
+    std::thread producer([&] {
+        for (int i = 0; i < total; ++i)
+            log.info("0 {}", i);
+    });
+    while (async_log_stats().blocked == before.blocked)
+        std::this_thread::yield();
+    sink->release();
+    producer.join();
+    stop_async_logging();
+    const AsyncLogStats after = async_log_stats();
+
+    HECS_CHECK(after.blocked > before.blocked);
+    HECS_CHECK(after.dropped == before.dropped);
+    HECS_CHECK(after.enqueued - before.enqueued == total);
+    std::vector<int> counts(1, 0);
+    HECS_CHECK(per_thread_in_order(sink->messages(), counts));
+    HECS_CHECK(counts[0] == total);
+}
+
+HECS_TEST(async_log_keeps_per_thread_order)
+{
+    auto sink = std::make_shared<CaptureSink>();
+    AsyncLogger log(make_logger(sink));
+    start_async_logging(small_rings(LogOverflowPolicy::Block));
+    const int thread_count = 4;
+    const int per_thread = 2000; // Many wraps of a 4 KiB ring
+    std::vector<std::thread> producers;
+    for (int t = 0; t < thread_count; ++t) {
+        producers.emplace_back([&log, t] {
+            for (int i = 0; i < per_thread; ++i)
+                log.info("{} {}", t, i);
+        });
+    }
+    for (auto& producer : producers)
+        producer.join();
+    stop_async_logging();
+
+    std::vector<int> counts(thread_count, 0);
+    HECS_CHECK(per_thread_in_order(sink->messages(), counts));
+    for (int count : counts)
+        HECS_CHECK(count == per_thread);
+}
+
+HECS_TEST(async_log_stop_drains_while_producers_log)
+{
+    auto sink = std::make_shared<CaptureSink>();
+    AsyncLogger log(make_logger(sink));
+    start_async_logging(small_rings(LogOverflowPolicy::Block));
+    const int thread_count = 4;
+    std::atomic<bool> done { false };
+    std::atomic<int> started { 0 };
+    std::vector<int> logged(thread_count, 0);
+    std::vector<std::thread> producers;
+    for (int t = 0; t < thread_count; ++t) {
+        producers.emplace_back([&, t] {
+            started.fetch_add(1);
+            // Keep going past stop(): later records are logged synchronously.
+            for (int i = 0; !done.load() || i < 1000; ++i) {
+                log.info("{} {}", t, i);
+                logged[t] = i + 1;
+            }
+        });
+    }
+    while (started.load() < thread_count)
+        std::this_thread::yield();
+    std::this_thread::sleep_for(milliseconds(5));
+    stop_async_logging();
+    done.store(true);
+    for (auto& producer : producers)
+        producer.join();
+
+    // Nothing is lost in the ring and no synchronous record overtakes an
+    // earlier one of the same thread.
+    std::vector<int> counts(thread_count, 0);
+    HECS_CHECK(per_thread_in_order(sink->messages(), counts));
+    for (int t = 0; t < thread_count; ++t)
+        HECS_CHECK(counts[t] == logged[t]);
+}
@@ -0,0 +1,74 @@
+// breaker_system_test.cpp
+#include "breaker_system.h"
+#include "simulation_events_and_data.h"
+#include "test_support.h"
+#include <vector>
+
+namespace {
+
+cps_coro::Task opened_listener(cps_coro::Scheduler& scheduler, std::vector<std::pair<long long, Entity>>& opened)
+{
+    while (true) {
+        Entity entity = co_await cps_coro::wait_for_event<Entity>(BREAKER_OPENED_EVENT);
+        opened.emplace_back(scheduler.now().time_since_epoch().count(), entity);
+    }
+}
+
+} // namespace
+
+// Without reclosing or 50BF, every trip command outside the operating time
+// opens the breaker and raises BREAKER_OPENED_EVENT, as the per-breaker
+// agent did; a trip while opening is ignored.
+HECS_TEST(breaker_reopens_on_every_trip)
+{
+    hecs_test::ScopedScheduler sim;
+    BreakerSystem breakers(sim.scheduler);
+    const Entity line = 10;
+    breakers.add(line);
+    breakers.start();
+    std::vector<std::pair<long long, Entity>> opened;
+    auto task = opened_listener(sim.scheduler, opened);
+    task.detach();
+
+    sim.scheduler.trigger_event(ENTITY_TRIP_EVENT_PROT, line);
+    sim.run_for_ms(50);
+    HECS_CHECK(breakers.state(line) == BreakerSystem::State::Opening);
+    sim.scheduler.trigger_event(ENTITY_TRIP_EVENT_PROT, line); // Ignored
+    sim.run_for_ms(150);
+    HECS_CHECK(breakers.state(line) == BreakerSystem::State::Open);
+    sim.scheduler.trigger_event(ENTITY_TRIP_EVENT_PROT, line);
+    sim.run_for_ms(200);
+
+    const std::vector<std::pair<long long, Entity>> expected = { { 100, line }, { 300, line } };
+    HECS_CHECK(opened == expected);
+    HECS_CHECK(breakers.state(line) == BreakerSystem::State::Open);
+    HECS_CHECK(breakers.stats().trips == 2 && breakers.stats().openings == 2);
+}
+
+// A stuck breaker hands the fault to its backups after the 50BF time, and
+// once freed opens on the next trip command instead of staying Opening.
+HECS_TEST(stuck_breaker_fails_over_and_retries)
+{
+    hecs_test::ScopedScheduler sim;
+    BreakerSystem breakers(sim.scheduler);
+    const Entity feeder = 20, backup = 21;
+    BreakerSettings settings;
+    settings.failure_ms = 250;
+    breakers.add(feeder, settings);
+    breakers.add(backup);
+    breakers.set_backups(feeder, { backup });
+    breakers.set_stuck(feeder, true);
+
+    HECS_CHECK(breakers.trip(feeder));
+    sim.run_for_ms(400);
+    HECS_CHECK(breakers.state(feeder) == BreakerSystem::State::Opening);
+    HECS_CHECK(breakers.state(backup) == BreakerSystem::State::Open);
+    HECS_CHECK(breakers.stats().failures == 1);
+
+    breakers.set_stuck(feeder, false);
+    HECS_CHECK(breakers.trip(feeder));
+    sim.run_for_ms(400);
+    HECS_CHECK(breakers.state(feeder) == BreakerSystem::State::Open);
+    HECS_CHECK(breakers.stats().failures == 1); // Opened before the new 50BF time
+    HECS_CHECK(!breakers.trip(99));
+}
@@ -0,0 +1,150 @@
+// columnar_recorder_test.cpp
+#include "columnar_recorder.h"
+#include "test_support.h"
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::string read_text(const std::string& path)
+{
+    std::ifstream in(path, std::ios::binary);
+    return { std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>() };
+}
+
+// Runs the converter built next to hecs_tests; true on exit status 0.
+bool run_columnar_to_csv(const std::string& arguments)
+{
+    const std::string command = std::string("\"") + HECS_COLUMNAR_TO_CSV + "\" " + arguments;
+    return std::system(command.c_str()) == 0;
+}
+
+} // namespace
+
+// 95 rows through 10-row chunks (one writer slot, so commit_row waits for
+// the writer) come back with every column and width intact: the last chunk
+// is partial, int64 values beyond 2^53 stay exact, and a chunk cut short at
+// the end of the file is ignored.
+HECS_TEST(columnar_recorder_round_trip)
+{
+    hecs_test::ScratchDirectory dir("hecs_columnar_round_trip");
+    const std::string path = dir.file("results.hcol");
+    const std::vector<ColumnSpec> schema = {
+        { "time_s", ColumnType::Float64, 1 },
+        { "step", ColumnType::Int64, 1 },
+        { "power_kW", ColumnType::Float32, 5 },
+        { "soc", ColumnType::Float64, 3 },
+    };
+    const std::size_t row_bytes = 8 + 8 + 5 * 4 + 3 * 8;
+    const std::size_t rows = 95;
+    const std::int64_t big = (std::int64_t(1) << 53) + 1;
+    auto power = [](std::size_t r, std::size_t k) { return static_cast<float>(r) * 0.5f - static_cast<float>(k); };
+    auto soc = [](std::size_t r, std::size_t k) { return 0.001 * static_cast<double>(r) + 0.1 * static_cast<double>(k); };
+    {
+        ColumnarRecorder recorder(schema, 10 * row_bytes, 1);
+        HECS_CHECK(recorder.rows_per_chunk() == 10);
+        HECS_CHECK(recorder.column_index("soc") == 3 && recorder.column_index("none") == schema.size());
+        HECS_CHECK(recorder.open(path));
+        for (std::size_t r = 0; r < rows; ++r) {
+            recorder.set(0, 0.02 * static_cast<double>(r));
+            recorder.set_int(1, big + static_cast<std::int64_t>(r));
+            std::span<float> p = recorder.row_values<float>(2);
+            for (std::size_t k = 0; k < p.size(); ++k)
+                p[k] = power(r, k);
+            std::span<double> s = recorder.row_values<double>(3);
+            for (std::size_t k = 0; k < s.size(); ++k)
+                s[k] = soc(r, k);
+            recorder.commit_row();
+        }
+        HECS_CHECK(recorder.rows_committed() == rows);
+        recorder.close();
+        HECS_CHECK(recorder.error().empty());
+    }
+
+    ColumnarReader reader;
+    HECS_CHECK(reader.open(path));
+    HECS_CHECK(reader.schema().size() == schema.size());
+    for (std::size_t c = 0; c < schema.size() && c < reader.schema().size(); ++c) {
+        HECS_CHECK(reader.schema()[c].name == schema[c].name);
+        HECS_CHECK(reader.schema()[c].type == schema[c].type);
+        HECS_CHECK(reader.schema()[c].width == schema[c].width);
+    }
+    HECS_CHECK(reader.chunk_count() == 10);
+    HECS_CHECK(reader.row_count() == rows);
+    bool values_match = true;
+    std::size_t r = 0;
+    for (std::size_t chunk = 0; chunk < reader.chunk_count(); ++chunk) {
+        const std::size_t chunk_rows = reader.chunk_rows(chunk);
+        HECS_CHECK(chunk_rows == (chunk + 1 < reader.chunk_count() ? 10u : 5u));
+        std::span<const std::int64_t> steps = reader.column_values<std::int64_t>(chunk, 1);
+        std::span<const float> p = reader.column_values<float>(chunk, 2);
+        HECS_CHECK(p.size() == chunk_rows * 5);
+        for (std::size_t row = 0; row < chunk_rows; ++row, ++r) {
+            values_match = values_match && reader.value(chunk, 0, row) == 0.02 * static_cast<double>(r);
+            values_match = values_match && steps[row] == big + static_cast<std::int64_t>(r);
+            for (std::size_t k = 0; k < 5; ++k)
+                values_match = values_match && p[row * 5 + k] == power(r, k);
+            for (std::size_t k = 0; k < 3; ++k)
+                values_match = values_match && reader.value(chunk, 3, row, k) == soc(r, k);
+        }
+    }
+    HECS_CHECK(values_match);
+    HECS_CHECK(r == rows);
+
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 4);
+    ColumnarReader cut;
+    HECS_CHECK(cut.open(path));
+    HECS_CHECK(cut.chunk_count() == 9);
+    HECS_CHECK(cut.row_count() == 90);
+}
+
+// hecs_columnar_to_csv expands wide columns to name[k], writes the shortest
+// round-trip form of each value across chunk boundaries, and honours
+// --columns, --delimiter and --info.
+HECS_TEST(columnar_to_csv_output)
+{
+    hecs_test::ScratchDirectory dir("hecs_columnar_to_csv");
+    const std::string path = dir.file("small.hcol");
+    {
+        ColumnarRecorder recorder({ { "t", ColumnType::Float64, 1 }, { "n", ColumnType::Int64, 1 }, { "v", ColumnType::Float32, 2 } },
+            2 * (8 + 8 + 2 * 4));
+        HECS_CHECK(recorder.open(path));
+        for (int r = 0; r < 3; ++r) {
+            recorder.set(0, 0.5 * r);
+            recorder.set_int(1, 1000 * r - 1);
+            recorder.row_values<float>(2)[0] = static_cast<float>(r) + 0.25f;
+            recorder.row_values<float>(2)[1] = -static_cast<float>(r + 1);
+            recorder.commit_row();
+        }
+        recorder.close();
+    }
+    const std::string input = "\"" + path + "\" ";
+
+    HECS_CHECK(run_columnar_to_csv(input + "\"" + dir.file("all.csv") + "\""));
+    HECS_CHECK(read_text(dir.file("all.csv"))
+        == "t,n,v[0],v[1]\n"
+           "0,-1,0.25,-1\n"
+           "0.5,999,1.25,-2\n"
+           "1,1999,2.25,-3\n");
+
+    HECS_CHECK(run_columnar_to_csv(input + "\"" + dir.file("some.csv") + "\" --columns v,t --delimiter tab"));
+    HECS_CHECK(read_text(dir.file("some.csv"))
+        == "v[0]\tv[1]\tt\n"
+           "0.25\t-1\t0\n"
+           "1.25\t-2\t0.5\n"
+           "2.25\t-3\t1\n");
+
+    HECS_CHECK(run_columnar_to_csv(input + "--info > \"" + dir.file("info.txt") + "\""));
+    HECS_CHECK(read_text(dir.file("info.txt"))
+        == "t\tfloat64\t1\n"
+           "n\tint64\t1\n"
+           "v\tfloat32\t2\n"
+           "3 rows in 2 chunks\n");
+
+    HECS_CHECK(!run_columnar_to_csv(input + "--columns missing > \"" + dir.file("none.csv") + "\" 2>&1"));
+}
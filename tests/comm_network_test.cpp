@@ -0,0 +1,107 @@
+// comm_network_test.cpp
+#include "comm_network.h"
+#include "test_support.h"
+#include <cstdint>
+#include <vector>
+
+namespace {
+
+constexpr cps_coro::EventId kTelemetryEvent = 9001;
+
+struct Telemetry {
+    std::uint32_t sequence;
+    double value;
+};
+
+struct Received {
+    std::int64_t at_ms;
+    Telemetry telemetry;
+};
+
+cps_coro::Task receiver(cps_coro::Scheduler& scheduler, std::vector<Received>& received)
+{
+    while (true) {
+        Telemetry telemetry = co_await cps_coro::wait_for_event<Telemetry>(kTelemetryEvent);
+        received.push_back({ scheduler.now().time_since_epoch().count(), telemetry });
+    }
+}
+
+} // namespace
+
+// Two hops of 5 ms latency and 1 Mbit/s: a packet arrives intact after both
+// latencies plus two transmission times, and a burst keeps its order.
+HECS_TEST(comm_network_delivers_in_order_with_latency)
+{
+    hecs_test::ScopedScheduler sim;
+    CommNetwork network(sim.scheduler);
+    const std::uint32_t meter = network.add_node(), router = network.add_node(), head_end = network.add_node();
+    const std::uint32_t isolated = network.add_node();
+    CommLinkSettings link;
+    link.latency_ms = 5.0;
+    link.bandwidth_bps = 1e6;
+    network.connect(meter, router, link);
+    network.connect(router, head_end, link);
+    HECS_CHECK(network.link_count() == 4);
+
+    std::vector<Received> received;
+    auto task = receiver(sim.scheduler, received);
+    task.detach();
+    HECS_CHECK(network.send(meter, head_end, kTelemetryEvent, Telemetry { 7, 230.5 }));
+    HECS_CHECK(!network.send(meter, isolated, kTelemetryEvent, Telemetry { 8, 0.0 }));
+    sim.run_for_ms(100);
+    HECS_CHECK(received.size() == 1);
+    // 2 x (5 ms + 48 bytes at 1 Mbit/s), on the 1 ms calendar grid.
+    HECS_CHECK(received[0].at_ms >= 10 && received[0].at_ms <= 12);
+    HECS_CHECK(received[0].telemetry.sequence == 7 && received[0].telemetry.value == 230.5);
+
+    for (std::uint32_t s = 0; s < 50; ++s)
+        network.send(meter, head_end, kTelemetryEvent, Telemetry { 100 + s, 0.0 });
+    sim.run_for_ms(100);
+    HECS_CHECK(received.size() == 51);
+    bool in_order = true;
+    for (std::size_t i = 1; i < received.size(); ++i)
+        in_order &= received[i].telemetry.sequence == 99 + i && received[i].at_ms >= received[i - 1].at_ms;
+    HECS_CHECK(in_order);
+
+    const CommStats& stats = network.stats();
+    HECS_CHECK(stats.sent == 52 && stats.delivered == 51 && stats.unroutable == 1);
+    HECS_CHECK(stats.transmissions == 102);
+    HECS_CHECK(stats.lost == 0 && stats.dropped == 0);
+    HECS_CHECK(network.in_flight() == 0);
+}
+
+// A burst larger than the output queue is tail-dropped, a lossy link loses
+// about its share, and the packet pool is reused rather than grown.
+HECS_TEST(comm_network_drops_and_loses_packets)
+{
+    hecs_test::ScopedScheduler sim;
+    CommNetwork network(sim.scheduler, 3);
+    const std::uint32_t a = network.add_node(), b = network.add_node(), c = network.add_node();
+    CommLinkSettings narrow;
+    narrow.bandwidth_bps = 64e3;
+    narrow.queue_bytes = 10 * 1000;
+    network.connect(a, b, narrow);
+    CommLinkSettings lossy;
+    lossy.loss = 0.3;
+    lossy.bandwidth_bps = 10e6;
+    network.connect(a, c, lossy);
+
+    // 1000-byte packets: ten fit the queue, the rest of the burst is dropped.
+    for (int i = 0; i < 40; ++i)
+        network.send(a, b, 1000);
+    HECS_CHECK(network.stats().dropped >= 25 && network.stats().dropped <= 30);
+    sim.run_for_ms(10000);
+    HECS_CHECK(network.stats().delivered + network.stats().dropped == 40);
+
+    const std::size_t pool = network.packet_pool_size();
+    for (int round = 0; round < 20; ++round) {
+        for (int i = 0; i < 100; ++i)
+            network.send(a, c, 100);
+        sim.run_for_ms(50);
+    }
+    const CommStats& stats = network.stats();
+    HECS_CHECK(stats.lost > 450 && stats.lost < 750);
+    HECS_CHECK(stats.delivered + stats.lost + stats.dropped == stats.sent);
+    HECS_CHECK(network.in_flight() == 0);
+    HECS_CHECK(network.packet_pool_size() <= pool + 100);
+}
@@ -0,0 +1,85 @@
+// coordination_check_test.cpp
+#include "coordination_check.h"
+#include "network_model.h"
+#include "protection_system.h"
+#include "test_support.h"
+#include <complex>
+#include <vector>
+
+namespace {
+
+using Kind = CoordinationViolation::Kind;
+
+// source - B0 -L1- B1 -L2- B2 -L3- B3, and L4 from B1 to B4: the relay on
+// L1 backs up those on L2 and L4, the relay on L2 the one on L3.
+struct GradedFeeder {
+    Registry registry;
+    Entity l1 = 0, l2 = 0, l3 = 0, l4 = 0;
+    NetworkModel network { registry };
+
+    GradedFeeder()
+    {
+        std::vector<Entity> buses;
+        for (int b = 0; b < 5; ++b) {
+            buses.push_back(registry.create());
+            registry.emplace<BusComponent>(buses.back(), 20.0);
+        }
+        auto line = [&](int from, int to) {
+            const Entity branch = registry.create();
+            registry.emplace<BranchComponent>(branch, buses[from], buses[to], std::complex<double>(0.2, 0.4) * 5.0, 5.0);
+            return branch;
+        };
+        l1 = line(0, 1);
+        l2 = line(1, 2);
+        l3 = line(2, 3);
+        l4 = line(1, 4);
+        registry.emplace<SourceComponent>(registry.create(), buses[0], 21.0, std::complex<double>(0.1, 1.0));
+    }
+};
+
+} // namespace
+
+// Definite-time relays graded by hand: L1 over L2 by 300 ms (coordinated),
+// L1 faster than L4 (backup first), L3 never picking up (not cleared); then
+// L2 slowed to 100 ms under L1 (below the interval).
+HECS_TEST(coordination_check_finds_graded_violations)
+{
+    GradedFeeder feeder;
+    HECS_CHECK(feeder.network.build());
+    ProtectionRelayPools relays;
+    relays.emplace<OverCurrentProtection>(feeder.l1, 0.1, 500, "L1");
+    relays.emplace<OverCurrentProtection>(feeder.l2, 0.1, 200, "L2");
+    relays.emplace<OverCurrentProtection>(feeder.l3, 1000.0, 100, "L3");
+    relays.emplace<OverCurrentProtection>(feeder.l4, 0.1, 600, "L4");
+
+    CoordinationChecker checker(relays, feeder.network, 1);
+    CoordinationReport report = checker.check();
+    const std::size_t cases = checker.locations.size() * checker.fault_types.size() * checker.prefault_voltage_pu.size();
+    HECS_CHECK(report.branches == 4);
+    HECS_CHECK(report.pairs == 3);
+    HECS_CHECK(report.cases == 4 * cases);
+    HECS_CHECK(report.violations.size() == 2);
+    HECS_CHECK(report.count(Kind::NotCleared) == 1);
+    HECS_CHECK(report.count(Kind::BackupFirst) == 1);
+    HECS_CHECK(report.count(Kind::BelowInterval) == 0);
+    for (const CoordinationViolation& v : report.violations) {
+        HECS_CHECK(v.cases == cases);
+        if (v.kind == Kind::NotCleared) {
+            HECS_CHECK(v.branch == feeder.l3 && v.primary == -1);
+        } else {
+            HECS_CHECK(v.branch == feeder.l4 && v.primary == 3 && v.backup == 0 && v.margin_ms == -100);
+        }
+    }
+
+    // The same relays with L2 at 400 ms: L1 backs it up by only 100 ms.
+    ProtectionRelayPools slowed;
+    slowed.emplace<OverCurrentProtection>(feeder.l1, 0.1, 500, "L1");
+    slowed.emplace<OverCurrentProtection>(feeder.l2, 0.1, 400, "L2");
+    CoordinationChecker slowed_checker(slowed, feeder.network, 2);
+    report = slowed_checker.check();
+    HECS_CHECK(report.count(Kind::BelowInterval) == 1);
+    HECS_CHECK(report.count(Kind::BackupFirst) == 0);
+    const CoordinationViolation& below = report.violations.front();
+    HECS_CHECK(below.kind == Kind::BelowInterval && below.branch == feeder.l2 && below.primary == 1 && below.backup == 0);
+    HECS_CHECK(below.margin_ms == 100);
+}
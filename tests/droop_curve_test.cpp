@@ -0,0 +1,78 @@
+// droop_curve_test.cpp
+#include "droop_curve.h"
+#include "test_support.h"
+#include <map>
+#include <random>
+#include <vector>
+
+namespace {
+
+// A clamped droop curve with a deadband of `db` around zero.
+DroopCurve make_curve(double gain, double db, double base, double limit)
+{
+    using Piece = DroopCurve::Piece;
+    DroopCurve curve = DroopCurve::from_pieces({ -db, db }, { base, base },
+        { Piece { -gain, -db, 0.0 }, Piece { 0.0, 0.0, base }, Piece { -gain, db, base } });
+    curve.clamp(-limit, limit);
+    return curve;
+}
+
+} // namespace
+
+// Random set/remove traffic against the direct sum of the live contributions.
+HECS_TEST(aggregate_droop_curve_matches_sum)
+{
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> pick_key(0, 199);
+    std::uniform_int_distribution<int> pick_shape(0, 5);
+    std::uniform_int_distribution<int> pick_action(0, 3);
+    const double deadbands[] = { 0.0, 0.02, 0.03 };
+
+    AggregateDroopCurve aggregate;
+    std::map<AggregateDroopCurve::Key, DroopCurve> live;
+    for (int update = 0; update < 5000; ++update) {
+        AggregateDroopCurve::Key key = pick_key(rng);
+        if (pick_action(rng) == 0) {
+            HECS_CHECK(aggregate.remove_contribution(key) == (live.erase(key) == 1));
+        } else {
+            int shape = pick_shape(rng);
+            DroopCurve curve = make_curve(2.0 + shape, deadbands[shape % 3], shape - 2.5, 4.0 + shape % 2);
+            aggregate.set_contribution(key, curve);
+            live[key] = curve;
+        }
+        if (update % 50 != 0)
+            continue;
+        DroopCurve reference;
+        for (const auto& [k, curve] : live)
+            reference += curve;
+        HECS_CHECK(aggregate.contributor_count() == live.size());
+        for (double x : { -1.0, -0.5, -0.03, -0.025, -0.02, 0.0, 0.01, 0.02, 0.03, 0.2, 0.9 })
+            HECS_CHECK_NEAR(aggregate.evaluate(x), reference.evaluate(x), 1e-9);
+        DroopCurve flattened = aggregate.to_curve();
+        HECS_CHECK(flattened.breakpoint_count() == aggregate.breakpoint_count());
+        for (double x : { -0.7, -0.03, 0.0, 0.03, 0.4 })
+            HECS_CHECK_NEAR(flattened.evaluate(x), reference.evaluate(x), 1e-9);
+    }
+
+    aggregate.clear();
+    HECS_CHECK(aggregate.contributor_count() == 0);
+    HECS_CHECK(aggregate.breakpoint_count() == 0);
+    HECS_CHECK(aggregate.evaluate(0.1) == 0.0);
+}
+
+// The result depends on the contributions, not on the order they were set.
+HECS_TEST(aggregate_droop_curve_order_independent)
+{
+    std::vector<DroopCurve> curves;
+    for (int i = 0; i < 300; ++i)
+        curves.push_back(make_curve(1.0 + 0.37 * i, 0.01 * (i % 4), 0.11 * i - 15.0, 3.0 + i % 7));
+
+    AggregateDroopCurve forward;
+    AggregateDroopCurve backward;
+    for (std::size_t i = 0; i < curves.size(); ++i) {
+        forward.set_contribution(i, curves[i]);
+        backward.set_contribution(curves.size() - 1 - i, curves[curves.size() - 1 - i]);
+    }
+    for (double x : { -0.8, -0.03, -0.01, 0.0, 0.015, 0.03, 0.6 })
+        HECS_CHECK(forward.evaluate(x) == backward.evaluate(x));
+}
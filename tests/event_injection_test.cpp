@@ -0,0 +1,100 @@
+// event_injection_test.cpp
+#include "event_injection.h"
+#include "test_support.h"
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr cps_coro::EventId kCommandEvent = 9100;
+
+struct Command {
+    std::uint64_t entity;
+    double value;
+};
+
+struct Delivered {
+    std::int64_t at_ms;
+    Command command;
+};
+
+cps_coro::Task receiver(cps_coro::Scheduler& scheduler, std::vector<Delivered>& delivered)
+{
+    while (true) {
+        Command command = co_await cps_coro::wait_for_event<Command>(kCommandEvent);
+        delivered.push_back({ scheduler.now().time_since_epoch().count(), command });
+    }
+}
+
+} // namespace
+
+// Text rules keyed on the command's entity: each action applies to its key
+// and window only, and the rule added first wins over a later match.
+HECS_TEST(event_injector_applies_matching_rules)
+{
+    hecs_test::ScopedScheduler sim;
+    EventInjector injector(sim.scheduler);
+    std::istringstream rules("key     event=9100 field=0:u64\n"
+                             "delay   event=9100 key=7 delay=300\n"
+                             "drop    event=9100 key=42 from=1000 until=2000\n"
+                             "falsify event=9100 key=5 field=8:f64 scale=2 bias=1\n"
+                             "replay  event=9100 key=9 count=2 every=100\n"
+                             "drop    event=9100 key=7  # shadowed by the delay above\n");
+    HECS_CHECK(injector.load(rules));
+    HECS_CHECK(injector.rule_count() == 5);
+    injector.install();
+
+    std::vector<Delivered> delivered;
+    auto task = receiver(sim.scheduler, delivered);
+    task.detach();
+    auto send = [&](std::uint64_t entity, double value) { sim.scheduler.trigger_event(kCommandEvent, Command { entity, value }); };
+
+    send(42, 0.0); // Before the drop window
+    sim.run_for_ms(1000);
+    send(42, 0.0);
+    send(7, 0.0);
+    send(5, 10.0);
+    send(9, 0.0);
+    send(3, 4.0);
+    sim.run_for_ms(1000);
+    send(42, 0.0); // The window is half-open
+    sim.run_for_ms(10);
+
+    std::vector<std::pair<std::int64_t, std::uint64_t>> order;
+    for (const Delivered& d : delivered)
+        order.emplace_back(d.at_ms, d.command.entity);
+    const std::vector<std::pair<std::int64_t, std::uint64_t>> expected = {
+        { 0, 42 }, { 1000, 5 }, { 1000, 9 }, { 1000, 3 }, { 1100, 9 }, { 1200, 9 }, { 1300, 7 }, { 2000, 42 }
+    };
+    HECS_CHECK(order == expected);
+    HECS_CHECK(delivered.size() == expected.size() && delivered[1].command.value == 21.0 && delivered[3].command.value == 4.0);
+
+    const InjectionStats& stats = injector.stats();
+    HECS_CHECK(stats.dropped == 1 && stats.delayed == 1 && stats.falsified == 1 && stats.replayed == 1);
+    HECS_CHECK(stats.copies == 3 && stats.unsupported == 0);
+    HECS_CHECK(injector.hits(0) == 1 && injector.hits(1) == 1 && injector.hits(4) == 0);
+
+    injector.uninstall();
+    sim.run_for_ms(10);
+    send(7, 0.0);
+    HECS_CHECK(delivered.size() == expected.size() + 1 && delivered.back().at_ms == 2020);
+}
+
+HECS_TEST(event_injector_rejects_bad_rules)
+{
+    hecs_test::ScopedScheduler sim;
+    EventInjector injector(sim.scheduler);
+    std::istringstream unknown("# comment only\n\nexplode event=1\n");
+    HECS_CHECK(!injector.load(unknown));
+    HECS_CHECK(injector.error().find("line 3") != std::string::npos);
+    std::istringstream bad_value("drop event=1 key=x\n");
+    HECS_CHECK(!injector.load(bad_value));
+    HECS_CHECK(injector.error().find("key=x") != std::string::npos);
+    std::istringstream bad_field("falsify event=1 field=8:f16\n");
+    HECS_CHECK(!injector.load(bad_field));
+    std::istringstream no_event("delay delay=5\n");
+    HECS_CHECK(!injector.load(no_event));
+    HECS_CHECK(injector.rule_count() == 0);
+}
@@ -0,0 +1,144 @@
+// flisr_test.cpp
+#include "flisr.h"
+#include "test_support.h"
+#include <complex>
+#include <vector>
+
+namespace {
+
+using Kind = FeederSwitchComponent::Kind;
+
+// Two 10 kV feeders from their own substations:
+//   SA -[BA]- A1 -[S1]- A2 -[S2]- A3      (loads 300, 200, 150 kW)
+//   SB -[BB]- B1 -[S3]- B2                (loads 400, 100 kW)
+// Each section is two buses joined by a 1 km line. A3's far end has two
+// normally open ties: TS to B1 (100 kW limit, too small for A3) and TL to
+// B2 (limit set per case).
+struct TwoFeeders {
+    Registry registry;
+    NetworkModel network { registry };
+    Entity ba = 0, s1 = 0, s2 = 0, bb = 0, s3 = 0, ts = 0, tl = 0;
+    Entity a2_line = 0;
+    std::vector<Entity> section_buses[5]; // A1, A2, A3, B1, B2: near and far bus
+
+    explicit TwoFeeders(double large_tie_limit_kW)
+    {
+        auto bus = [&] {
+            const Entity e = registry.create();
+            registry.emplace<BusComponent>(e, 10.0);
+            return e;
+        };
+        auto station = [&] {
+            const Entity e = bus();
+            registry.emplace<SourceComponent>(registry.create(), e, 10.5, std::complex<double>(0.1, 0.5));
+            return e;
+        };
+        auto section = [&](int index, double load_kW) {
+            section_buses[index] = { bus(), bus() };
+            const Entity line = registry.create();
+            registry.emplace<BranchComponent>(line, section_buses[index][0], section_buses[index][1], std::complex<double>(0.27, 0.35), 1.0);
+            registry.emplace<LoadComponent>(registry.create(), section_buses[index][1], load_kW, 0.0);
+            return line;
+        };
+        auto link = [&](Entity from, Entity to, Kind kind, double limit_kW = 0.0) {
+            const Entity sw = registry.create();
+            registry.emplace<BranchComponent>(sw, from, to, std::complex<double>(0.0, 0.001));
+            registry.emplace<FeederSwitchComponent>(sw, kind, 0.4, limit_kW);
+            if (kind != Kind::Breaker)
+                registry.emplace<TerminalUnitComponent>(registry.create(), TerminalUnitComponent::Kind::FTU, std::vector<Entity> { sw }, 300);
+            return sw;
+        };
+        const Entity sa = station();
+        const Entity sb = station();
+        section(0, 300.0);
+        a2_line = section(1, 200.0);
+        section(2, 150.0);
+        section(3, 400.0);
+        section(4, 100.0);
+        ba = link(sa, section_buses[0][0], Kind::Breaker);
+        s1 = link(section_buses[0][1], section_buses[1][0], Kind::Sectionalizer);
+        s2 = link(section_buses[1][1], section_buses[2][0], Kind::Sectionalizer);
+        bb = link(sb, section_buses[3][0], Kind::Breaker);
+        s3 = link(section_buses[3][1], section_buses[4][0], Kind::Sectionalizer);
+        ts = link(section_buses[2][1], section_buses[3][1], Kind::Tie, 100.0);
+        tl = link(section_buses[2][1], section_buses[4][1], Kind::Tie, large_tie_limit_kW);
+        registry.get<BranchComponent>(ts)->closed = false;
+        registry.get<BranchComponent>(tl)->closed = false;
+        registry.emplace<TerminalUnitComponent>(registry.create(), TerminalUnitComponent::Kind::DTU, std::vector<Entity> { ba, bb }, 200);
+    }
+
+    bool live(int section) const { return network.bus_energized(section_buses[section][0]) && network.bus_energized(section_buses[section][1]); }
+};
+
+// Fault in the middle of A2's line, run through one FLISR batch.
+void run_a2_fault(TwoFeeders& feeders, FlisrEngine& flisr, hecs_test::ScopedScheduler& sim)
+{
+    auto master = flisr.run();
+    FaultInfo fault;
+    fault.faulty_entity_id = feeders.a2_line;
+    fault.distance_km = 0.5;
+    flisr.apply_fault(fault);
+    sim.run_for_ms(5000);
+}
+
+} // namespace
+
+// BA and S1 carry the fault current, so A2 is located and cut out between
+// S1 and S2. BA (already tripped) recloses onto A1, and A3 is picked up over
+// TL, the tie with room for its 150 kW, not over TS; feeder B stays up.
+HECS_TEST(flisr_isolates_and_restores_hand_checked_feeder)
+{
+    hecs_test::ScopedScheduler sim;
+    TwoFeeders feeders(500.0);
+    FlisrEngine flisr(feeders.registry, feeders.network, sim.scheduler);
+    HECS_CHECK(feeders.network.build());
+    HECS_CHECK(flisr.build());
+    HECS_CHECK(flisr.section_count() == 7); // Two stations and five feeder sections
+    HECS_CHECK(flisr.switch_count() == 7);
+    run_a2_fault(feeders, flisr, sim);
+
+    const NetworkModel& network = feeders.network;
+    HECS_CHECK(!network.branch_closed(feeders.s1));
+    HECS_CHECK(!network.branch_closed(feeders.s2));
+    HECS_CHECK(network.branch_closed(feeders.ba));
+    HECS_CHECK(network.branch_closed(feeders.tl));
+    HECS_CHECK(!network.branch_closed(feeders.ts));
+    HECS_CHECK(network.branch_closed(feeders.bb) && network.branch_closed(feeders.s3));
+    HECS_CHECK(feeders.live(0));
+    HECS_CHECK(!feeders.live(1));
+    HECS_CHECK(feeders.live(2));
+    HECS_CHECK(feeders.live(3) && feeders.live(4));
+
+    const FlisrStats& stats = flisr.stats();
+    HECS_CHECK(stats.batches == 1);
+    HECS_CHECK(stats.faults_located == 1);
+    HECS_CHECK(stats.breaker_trips == 1);
+    HECS_CHECK(stats.switches_opened == 2); // S1, S2
+    HECS_CHECK(stats.switches_closed == 2); // BA, TL
+    HECS_CHECK(stats.sections_restored == 2);
+    HECS_CHECK_NEAR(stats.restored_kW, 450.0, 1e-9);
+    HECS_CHECK(flisr.faulted_section_count() == 1);
+    HECS_CHECK_NEAR(flisr.unserved_kW(), 0.0, 1e-9);
+}
+
+// The same fault with both ties too small for A3: it stays dead rather than
+// overloading a neighbour, and only A1 comes back.
+HECS_TEST(flisr_respects_tie_transfer_limits)
+{
+    hecs_test::ScopedScheduler sim;
+    TwoFeeders feeders(120.0);
+    FlisrEngine flisr(feeders.registry, feeders.network, sim.scheduler);
+    HECS_CHECK(feeders.network.build());
+    HECS_CHECK(flisr.build());
+    run_a2_fault(feeders, flisr, sim);
+
+    const NetworkModel& network = feeders.network;
+    HECS_CHECK(!network.branch_closed(feeders.s1) && !network.branch_closed(feeders.s2));
+    HECS_CHECK(!network.branch_closed(feeders.ts) && !network.branch_closed(feeders.tl));
+    HECS_CHECK(network.branch_closed(feeders.ba));
+    HECS_CHECK(feeders.live(0));
+    HECS_CHECK(!feeders.live(1) && !feeders.live(2));
+    HECS_CHECK(flisr.stats().sections_restored == 1);
+    HECS_CHECK_NEAR(flisr.stats().restored_kW, 300.0, 1e-9);
+    HECS_CHECK_NEAR(flisr.unserved_kW(), 150.0, 1e-9);
+}
@@ -0,0 +1,192 @@
+// frequency_system_test.cpp
+#include "frequency_system.h"
+#include "test_support.h"
+#include <vector>
+
+namespace {
+
+// The demo's EV pile: 5 kW scheduled charging, 4 kW/Hz, 30 mHz deadband,
+// SOC band 0.1-0.95.
+Entity add_pile(Registry& registry, double soc)
+{
+    Entity pile = registry.create();
+    registry.emplace<FrequencyControlConfigComponent>(pile, FrequencyControlConfigComponent::DeviceType::EV_PILE, -5.0, 4.0, 0.03, 5.0, -5.0, 0.1, 0.95);
+    registry.emplace<PhysicalStateComponent>(pile, -5.0, soc);
+    return pile;
+}
+
+double member_power_kW(Registry& registry, const std::vector<Entity>& devices)
+{
+    double total_kW = 0.0;
+    for (Entity device : devices)
+        total_kW += registry.get<PhysicalStateComponent>(device)->current_power_kW;
+    return total_kW;
+}
+
+} // namespace
+
+// A pile whose SOC sits exactly on soc_min or soc_max used to re-arm its
+// check at now_s, so the due-check loop never finished.
+HECS_TEST(flat_vpp_soc_on_threshold)
+{
+    hecs_test::ScopedScheduler sim;
+    Registry registry;
+    const std::vector<Entity> piles = { add_pile(registry, 0.95), add_pile(registry, 0.1), add_pile(registry, 0.5) };
+    Entity vpp = registry.create();
+    registry.emplace<VppDeviceAggregateComponent>(vpp, piles);
+    const std::vector<Entity> vpps = { vpp };
+
+    auto response = vppFrequencyResponseTask(registry, "test", vpp, 20.0);
+    response.detach();
+    auto oracle = frequencyOracleTask(registry, vpps, 0.0, 20.0, nullptr);
+    oracle.detach();
+    sim.run_for_ms(5000);
+
+    auto* aggregate = registry.get<VppDeviceAggregateComponent>(vpp);
+    materialize_vpp_devices(registry, *aggregate);
+    // Inside the deadband the pile at soc_min charges away from it; once the
+    // frequency drops, the one at soc_max discharges away from it.
+    HECS_CHECK(registry.get<PhysicalStateComponent>(piles[1])->soc > 0.1);
+    HECS_CHECK(registry.get<PhysicalStateComponent>(piles[0])->soc < 0.95);
+    HECS_CHECK_NEAR(aggregate->total_kW, member_power_kW(registry, piles), 1e-9);
+}
+
+// The lazy flat dispatch must reproduce per-device dispatch with the same
+// update gating: power recomputed only when the deviation moved by more than
+// 0.01 Hz or 1 s passed, SOC integrated over the held power in between.
+HECS_TEST(flat_vpp_matches_per_device_dispatch)
+{
+    hecs_test::ScopedScheduler sim;
+    Registry registry;
+    Registry reference;
+    std::vector<Entity> piles;
+    std::vector<Entity> reference_piles;
+    for (int p = 0; p < 20; ++p) {
+        piles.push_back(add_pile(registry, 0.1 + 0.045 * p));
+        reference_piles.push_back(add_pile(reference, 0.1 + 0.045 * p));
+    }
+    Entity vpp = registry.create();
+    registry.emplace<VppDeviceAggregateComponent>(vpp, piles);
+    const std::vector<Entity> vpps = { vpp };
+
+    auto response = vppFrequencyResponseTask(registry, "test", vpp, 20.0);
+    response.detach();
+    auto oracle = frequencyOracleTask(registry, vpps, 0.0, 20.0, nullptr);
+    oracle.detach();
+    const int steps = 1500;
+    sim.run_for_ms(20 * steps + 10);
+
+    double last_update_s = -1.0;
+    double last_update_freq_dev_hz = 0.0;
+    for (int k = 1; k <= steps; ++k) {
+        double now_s = (20.0 * k) / 1000.0;
+        double freq_dev_hz = calculate_frequency_deviation(now_s);
+        if (last_update_s >= 0 && std::abs(freq_dev_hz - last_update_freq_dev_hz) <= 0.01 && now_s - last_update_s < 1.0)
+            continue;
+        for (Entity pile : reference_piles) {
+            auto config = reference.get<FrequencyControlConfigComponent>(pile);
+            auto state = reference.get<PhysicalStateComponent>(pile);
+            if (last_update_s >= 0)
+                integrate_device_soc(*config, *state, now_s - last_update_s);
+            state->current_power_kW = compute_device_response_kW(*config, state->soc, freq_dev_hz);
+        }
+        last_update_s = now_s;
+        last_update_freq_dev_hz = freq_dev_hz;
+    }
+
+    materialize_vpp_devices(registry, *registry.get<VppDeviceAggregateComponent>(vpp));
+    for (std::size_t p = 0; p < piles.size(); ++p) {
+        HECS_CHECK_NEAR(registry.get<PhysicalStateComponent>(piles[p])->soc, reference.get<PhysicalStateComponent>(reference_piles[p])->soc, 1e-12);
+        HECS_CHECK_NEAR(registry.get<PhysicalStateComponent>(piles[p])->current_power_kW,
+            reference.get<PhysicalStateComponent>(reference_piles[p])->current_power_kW, 1e-9);
+    }
+    HECS_CHECK_NEAR(vpp_total_power_kW(registry, vpp), member_power_kW(reference, reference_piles), 1e-9);
+}
+
+HECS_TEST(hierarchical_vpp_reports_dispatched_power)
+{
+    hecs_test::ScopedScheduler sim;
+    Registry registry;
+    std::vector<Entity> stations;
+    std::vector<Entity> piles;
+    for (int s = 0; s < 4; ++s) {
+        std::vector<Entity> members;
+        for (int p = 0; p < 5; ++p)
+            members.push_back(add_pile(registry, s == 0 ? 0.95 : 0.1 + 0.2 * p));
+        piles.insert(piles.end(), members.begin(), members.end());
+        stations.push_back(registry.create());
+        registry.emplace<VppStationComponent>(stations.back(), members);
+    }
+    Entity vpp = registry.create();
+    registry.emplace<VppAggregateComponent>(vpp, stations);
+    const std::vector<Entity> vpps = { vpp };
+
+    auto response = vppHierarchicalResponseTask(registry, "test", vpp, 20.0);
+    response.detach();
+    auto oracle = frequencyOracleTask(registry, vpps, 0.0, 20.0, nullptr);
+    oracle.detach();
+    for (int step = 0; step < 100; ++step) {
+        sim.run_for_ms(100);
+        HECS_CHECK_NEAR(vpp_total_power_kW(registry, vpp), member_power_kW(registry, piles), 1e-9);
+    }
+}
+
+// The components lag behind under lazy dispatch; the snapshot view must not.
+HECS_TEST(device_state_view_is_current_between_dispatches)
+{
+    hecs_test::ScopedScheduler sim;
+    Registry registry;
+    std::vector<Entity> flat_piles;
+    for (int p = 0; p < 5; ++p)
+        flat_piles.push_back(add_pile(registry, 0.2 + 0.1 * p));
+    Entity flat_vpp = registry.create();
+    registry.emplace<VppDeviceAggregateComponent>(flat_vpp, flat_piles);
+    std::vector<Entity> members;
+    for (int p = 0; p < 5; ++p)
+        members.push_back(add_pile(registry, 0.2 + 0.1 * p));
+    Entity station = registry.create();
+    registry.emplace<VppStationComponent>(station, members);
+    Entity hierarchical_vpp = registry.create();
+    registry.emplace<VppAggregateComponent>(hierarchical_vpp, std::vector<Entity> { station });
+    const std::vector<Entity> vpps = { flat_vpp, hierarchical_vpp };
+    VppDeviceStateRecorder view(registry, vpps);
+    HECS_CHECK(view.device_count() == 10);
+
+    auto flat_response = vppFrequencyResponseTask(registry, "flat", flat_vpp, 20.0);
+    flat_response.detach();
+    auto hierarchical_response = vppHierarchicalResponseTask(registry, "hierarchical", hierarchical_vpp, 20.0);
+    hierarchical_response.detach();
+    auto oracle = frequencyOracleTask(registry, vpps, 0.0, 20.0, nullptr);
+    oracle.detach();
+    sim.run_for_ms(30010);
+    const double now_s = 30.0;
+
+    // Flat piles are only synchronized when read.
+    std::vector<double> stale_soc;
+    for (Entity pile : flat_piles)
+        stale_soc.push_back(registry.get<PhysicalStateComponent>(pile)->soc);
+    view.refresh(now_s);
+    bool flat_was_stale = false;
+    for (std::size_t d = 0; d < flat_piles.size(); ++d) {
+        HECS_CHECK(view.device_entity(d) == flat_piles[d]);
+        flat_was_stale = flat_was_stale || stale_soc[d] != view.soc()[d];
+    }
+    HECS_CHECK(flat_was_stale);
+    materialize_vpp_devices(registry, *registry.get<VppDeviceAggregateComponent>(flat_vpp));
+    for (std::size_t d = 0; d < flat_piles.size(); ++d) {
+        HECS_CHECK_NEAR(view.soc()[d], registry.get<PhysicalStateComponent>(flat_piles[d])->soc, 1e-12);
+        HECS_CHECK_NEAR(view.power_kW()[d], registry.get<PhysicalStateComponent>(flat_piles[d])->current_power_kW, 1e-12);
+    }
+
+    // Station members hold their power since the last dispatch; their SOC
+    // is integrated up to now without settling the station.
+    const double held_s = now_s - registry.get<VppStationComponent>(station)->last_dispatch_time_s;
+    HECS_CHECK(held_s > 0.0);
+    for (std::size_t m = 0; m < members.size(); ++m) {
+        PhysicalStateComponent expected = *registry.get<PhysicalStateComponent>(members[m]);
+        integrate_device_soc(*registry.get<FrequencyControlConfigComponent>(members[m]), expected, held_s);
+        HECS_CHECK(view.device_entity(flat_piles.size() + m) == members[m]);
+        HECS_CHECK_NEAR(view.soc()[flat_piles.size() + m], expected.soc, 1e-12);
+        HECS_CHECK_NEAR(view.power_kW()[flat_piles.size() + m], expected.current_power_kW, 1e-12);
+    }
+}
@@ -0,0 +1,48 @@
+// inverse_time_curve_test.cpp
+#include "inverse_time_curve.h"
+#include "test_support.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace {
+
+constexpr OvercurrentCurve kInverseCurves[] = {
+    OvercurrentCurve::IecStandardInverse, OvercurrentCurve::IecVeryInverse, OvercurrentCurve::IecExtremelyInverse,
+    OvercurrentCurve::IeeeModeratelyInverse, OvercurrentCurve::IeeeVeryInverse, OvercurrentCurve::IeeeExtremelyInverse
+};
+
+} // namespace
+
+// The table stays within 0.1% of the pow() reference from just above pickup
+// to kMaxMultiple, and holds the kMaxMultiple time beyond it.
+HECS_TEST(inverse_time_table_matches_exact_curves)
+{
+    for (OvercurrentCurve curve : kInverseCurves) {
+        const InverseTimeCurveTable& table = inverse_time_curve_table(curve);
+        double max_error = 0.0;
+        for (double multiple = 1.01; multiple <= InverseTimeCurveTable::kMaxMultiple; multiple *= 1.0007) {
+            const double exact = inverse_time_exact_s(curve, multiple);
+            max_error = std::max(max_error, std::abs(table.time_s(multiple) - exact) / exact);
+        }
+        HECS_CHECK(max_error < 1e-3);
+        HECS_CHECK(std::isinf(table.time_s(1.0)));
+        HECS_CHECK(std::isinf(table.time_s(0.5)));
+        HECS_CHECK_NEAR(table.time_s(1000.0), inverse_time_exact_s(curve, InverseTimeCurveTable::kMaxMultiple), 1e-9);
+    }
+}
+
+// The batch form applies pickup and TMS per element, as the scalar lookup does.
+HECS_TEST(inverse_time_batch_matches_scalar)
+{
+    const InverseTimeCurveTable& table = inverse_time_curve_table(OvercurrentCurve::IecVeryInverse);
+    const std::vector<double> current_kA = { 0.5, 1.0, 1.5, 4.0, 20.0, 500.0 };
+    const std::vector<double> pickup_kA = { 1.0, 1.0, 1.0, 2.0, 2.5, 1.0 };
+    const std::vector<double> time_multiplier = { 0.1, 0.1, 0.5, 1.0, 0.05, 0.3 };
+    std::vector<double> time_s(current_kA.size());
+    table.operate_times_s(current_kA.data(), pickup_kA.data(), time_multiplier.data(), current_kA.size(), time_s.data());
+    HECS_CHECK(std::isinf(time_s[0]));
+    HECS_CHECK(std::isinf(time_s[1]));
+    for (std::size_t i = 2; i < time_s.size(); ++i)
+        HECS_CHECK_NEAR(time_s[i], time_multiplier[i] * table.time_s(current_kA[i] / pickup_kA[i]), 1e-12);
+}
@@ -0,0 +1,129 @@
+// multi_rate_test.cpp
+#include "frequency_system.h"
+#include "multi_rate.h"
+#include "test_support.h"
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+namespace {
+
+using std::chrono::milliseconds;
+
+struct ScenarioTrace {
+    std::vector<double> vpp_total_kW; // Per primary step, summed over the VPPs
+    std::vector<double> agc_request_kW; // Held AGC request after the step
+    double max_abs_freq_dev_hz = 0.0;
+    std::vector<std::uint64_t> layer_steps;
+};
+
+// The demo's control layers over a small fleet: EV piles in stations
+// (hierarchical dispatch) and ESS units (flat dispatch).
+ScenarioTrace run_frequency_scenario(bool single_rate, long long duration_ms)
+{
+    hecs_test::ScopedScheduler sim;
+    Registry registry;
+    std::vector<Entity> stations;
+    for (int s = 0; s < 4; ++s) {
+        std::vector<Entity> piles;
+        for (int p = 0; p < 5; ++p) {
+            Entity pile = registry.create();
+            registry.emplace<FrequencyControlConfigComponent>(pile, FrequencyControlConfigComponent::DeviceType::EV_PILE, -5.0, 4.0, 0.03, 5.0, -5.0, 0.1, 0.95);
+            registry.emplace<PhysicalStateComponent>(pile, -5.0, 0.15 + 0.04 * (5 * s + p));
+            piles.push_back(pile);
+        }
+        stations.push_back(registry.create());
+        registry.emplace<VppStationComponent>(stations.back(), piles);
+    }
+    std::vector<Entity> ess_units;
+    for (int e = 0; e < 4; ++e) {
+        ess_units.push_back(registry.create());
+        registry.emplace<FrequencyControlConfigComponent>(ess_units.back(), FrequencyControlConfigComponent::DeviceType::ESS_UNIT, 0.0, 100.0, 0.03, 1000.0, -1000.0, 0.05, 0.95);
+        registry.emplace<PhysicalStateComponent>(ess_units.back(), 0.0, 0.3 + 0.1 * e);
+    }
+    Entity ev_vpp = registry.create();
+    registry.emplace<VppAggregateComponent>(ev_vpp, stations);
+    Entity ess_vpp = registry.create();
+    registry.emplace<VppDeviceAggregateComponent>(ess_vpp, ess_units);
+    const std::vector<Entity> vpps = { ev_vpp, ess_vpp };
+
+    auto ev_task = vppHierarchicalResponseTask(registry, "EV", ev_vpp, 20.0);
+    ev_task.detach();
+    auto ess_task = vppFrequencyResponseTask(registry, "ESS", ess_vpp, 20.0);
+    ess_task.detach();
+
+    MultiRateCoordinator layers;
+    if (single_rate)
+        layers.force_single_rate(milliseconds(20));
+    FrequencyControlLayers control;
+    add_frequency_control_layers(layers, control, registry, vpps, milliseconds(20), nullptr);
+
+    ScenarioTrace trace;
+    layers.add_layer("probe", milliseconds(20), [&](double now_s, double /*dt_s*/) {
+        trace.vpp_total_kW.push_back(vpp_total_power_kW(registry, ev_vpp) + vpp_total_power_kW(registry, ess_vpp));
+        trace.agc_request_kW.push_back(control.agc_request_kW.value());
+        double freq_dev_hz = std::abs(calculate_frequency_deviation(now_s - control.disturbance_start_time_s));
+        trace.max_abs_freq_dev_hz = std::max(trace.max_abs_freq_dev_hz, freq_dev_hz);
+    });
+    auto run = layers.run();
+    run.detach();
+    sim.run_for_ms(duration_ms + 10);
+
+    for (std::size_t i = 0; i < layers.layer_count(); ++i)
+        trace.layer_steps.push_back(layers.layer_steps(i));
+    return trace;
+}
+
+} // namespace
+
+HECS_TEST(multi_rate_rejects_non_positive_period)
+{
+    hecs_test::ScopedScheduler sim;
+    MultiRateCoordinator layers;
+    int steps = 0;
+    HECS_CHECK(layers.add_layer("zero", milliseconds(0), [&](double, double) { ++steps; }) == MultiRateCoordinator::kNoLayer);
+    HECS_CHECK(layers.add_layer("negative", milliseconds(-5), [&](double, double) { ++steps; }) == MultiRateCoordinator::kNoLayer);
+    HECS_CHECK(layers.layer_count() == 0);
+    layers.force_single_rate(milliseconds(0));
+    std::size_t tick = layers.add_layer("tick", milliseconds(20), [&](double, double) { ++steps; });
+    HECS_CHECK(tick == 0);
+    HECS_CHECK(layers.layer_period(tick) == milliseconds(20));
+
+    auto run = layers.run();
+    run.detach();
+    sim.run_for_ms(110);
+    HECS_CHECK(steps == 5);
+}
+
+// One simulated hour and a minute: every slow layer, the hourly SOC
+// scheduling included, runs in the multi-rate configuration. AGC is
+// record-only (see add_frequency_control_layers), so the VPP response
+// matching the single-rate run exactly only shows that the slow layers do
+// not disturb the primary one; what is compared across rates is the AGC
+// request, which may lag the single-rate one by one AGC period.
+HECS_TEST(multi_rate_matches_single_rate)
+{
+    const long long duration_ms = 61 * 60 * 1000;
+    ScenarioTrace multi = run_frequency_scenario(false, duration_ms);
+    ScenarioTrace single = run_frequency_scenario(true, duration_ms);
+
+    // primary_response, agc, economic_redispatch, soc_scheduling, probe
+    const std::vector<std::uint64_t> expected_steps = { 183000, 1830, 12, 1, 183000 };
+    HECS_CHECK(multi.layer_steps == expected_steps);
+    HECS_CHECK(single.layer_steps == std::vector<std::uint64_t>(5, 183000));
+
+    HECS_CHECK(multi.vpp_total_kW.size() == single.vpp_total_kW.size());
+    const double agc_lag_bound_kW = AgcSettings {}.integral_gain_kW_per_Hz_s * (2.0 + 0.02) * multi.max_abs_freq_dev_hz;
+    double max_total_diff_kW = 0.0;
+    double max_agc_diff_kW = 0.0;
+    double max_agc_kW = 0.0;
+    for (std::size_t k = 0; k < std::min(multi.vpp_total_kW.size(), single.vpp_total_kW.size()); ++k) {
+        max_total_diff_kW = std::max(max_total_diff_kW, std::abs(multi.vpp_total_kW[k] - single.vpp_total_kW[k]));
+        max_agc_diff_kW = std::max(max_agc_diff_kW, std::abs(multi.agc_request_kW[k] - single.agc_request_kW[k]));
+        max_agc_kW = std::max(max_agc_kW, std::abs(single.agc_request_kW[k]));
+    }
+    HECS_CHECK_NEAR(max_total_diff_kW, 0.0, 1e-9);
+    // The request is well away from zero, so the lag bound is not vacuous.
+    HECS_CHECK(max_agc_kW > 4.0 * agc_lag_bound_kW);
+    HECS_CHECK(max_agc_diff_kW <= agc_lag_bound_kW);
+}
@@ -0,0 +1,181 @@
+// network_model_test.cpp
+#include "network_model.h"
+#include "test_support.h"
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <vector>
+
+namespace {
+
+// Ring B0-B1-B2-B3-B4-B0 fed at B0 and B3, with a spur B2-B5-B6.
+struct RingGrid {
+    Registry registry;
+    std::vector<Entity> buses;
+    std::vector<Entity> lines; // B0-B1, B1-B2, B2-B3, B3-B4, B4-B0, B2-B5, B5-B6
+
+    RingGrid()
+    {
+        for (int b = 0; b < 7; ++b) {
+            buses.push_back(registry.create());
+            registry.emplace<BusComponent>(buses.back(), 220.0);
+        }
+        const int ends[][2] = { { 0, 1 }, { 1, 2 }, { 2, 3 }, { 3, 4 }, { 4, 0 }, { 2, 5 }, { 5, 6 } };
+        for (std::size_t k = 0; k < std::size(ends); ++k) {
+            lines.push_back(registry.create());
+            const double length_km = 10.0 + 5.0 * k;
+            registry.emplace<BranchComponent>(lines.back(), buses[ends[k][0]], buses[ends[k][1]],
+                std::complex<double>(0.05, 0.4) * length_km, length_km);
+        }
+        registry.emplace<SourceComponent>(registry.create(), buses[0], 230.0, std::complex<double>(0.5, 6.0));
+        registry.emplace<SourceComponent>(registry.create(), buses[3], 225.0, std::complex<double>(1.0, 9.0));
+    }
+};
+
+bool near(std::complex<double> a, std::complex<double> b, double tolerance)
+{
+    return std::abs(a - b) <= tolerance;
+}
+
+// The incrementally switched model against one built from scratch on the
+// same components: islands, energization, pre-fault voltages, and every bus
+// fault and mid-line fault with the currents each relay would see.
+void check_matches_rebuild(RingGrid& grid, NetworkModel& incremental)
+{
+    NetworkModel fresh(grid.registry);
+    HECS_CHECK(fresh.build());
+    HECS_CHECK(incremental.island_count() == fresh.island_count());
+    HECS_CHECK(incremental.energized_bus_count() == fresh.energized_bus_count());
+    for (std::size_t b = 0; b < grid.buses.size(); ++b) {
+        HECS_CHECK(incremental.bus_energized(grid.buses[b]) == fresh.bus_energized(grid.buses[b]));
+        HECS_CHECK(near(incremental.prefault_voltage_kV(b), fresh.prefault_voltage_kV(b), 1e-9));
+    }
+
+    auto compare_results = [&](const NetworkFaultResult& a, const NetworkFaultResult& b) {
+        HECS_CHECK(near(a.fault_current_kA, b.fault_current_kA, 1e-9));
+        HECS_CHECK(near(a.thevenin_impedance_Ohm, b.thevenin_impedance_Ohm, 1e-9));
+        HECS_CHECK(a.bus_voltage_kV.size() == b.bus_voltage_kV.size());
+        for (std::size_t i = 0; i < a.bus_voltage_kV.size() && i < b.bus_voltage_kV.size(); ++i)
+            HECS_CHECK(near(a.bus_voltage_kV[i], b.bus_voltage_kV[i], 1e-9));
+        HECS_CHECK(a.branch_current_kA.size() == b.branch_current_kA.size());
+        for (std::size_t i = 0; i < a.branch_current_kA.size() && i < b.branch_current_kA.size(); ++i)
+            HECS_CHECK(near(a.branch_current_kA[i], b.branch_current_kA[i], 1e-9));
+    };
+    for (Entity bus : grid.buses) {
+        const NetworkFaultResult expected = fresh.fault_at_bus(bus, { 2.0, 0.0 });
+        compare_results(incremental.fault_at_bus(bus, { 2.0, 0.0 }), expected);
+    }
+    for (Entity line : grid.lines) {
+        const double mid_km = grid.registry.get<BranchComponent>(line)->length_km / 2.0;
+        const NetworkFaultResult expected = fresh.fault_on_branch(line, mid_km);
+        compare_results(incremental.fault_on_branch(line, mid_km), expected);
+    }
+}
+
+} // namespace
+
+// Open and reclose branches one at a time: a ring opening that keeps one
+// island, a spur cut off without a source, a split into two fed islands,
+// lone buses left unfed, then everything closed again in another order.
+// After each step the incremental model must match a fresh build().
+HECS_TEST(network_switching_matches_rebuild)
+{
+    RingGrid grid;
+    NetworkModel model(grid.registry);
+    HECS_CHECK(model.build());
+    HECS_CHECK(model.island_count() == 1);
+    check_matches_rebuild(grid, model);
+
+    const auto& lines = grid.lines;
+    struct Step {
+        Entity line;
+        bool closed;
+        std::size_t islands;
+        std::size_t energized;
+    };
+    const Step steps[] = {
+        { lines[0], false, 1, 7 }, // Ring open at B0-B1: still one island
+        { lines[5], false, 2, 5 }, // Spur B5-B6 cut off, unfed
+        { lines[3], false, 3, 5 }, // B0-B4 | B3-B2-B1: two fed islands
+        { lines[4], false, 4, 4 }, // B4 alone, unfed
+        { lines[1], false, 5, 3 }, // B1 alone, unfed
+        { lines[5], true, 4, 5 }, // Spur energized again from B2
+        { lines[0], true, 3, 6 }, // B1 joins B0
+        { lines[3], true, 2, 7 }, // B4 joins B3's island
+        { lines[4], true, 1, 7 }, // The two fed islands merge
+        { lines[1], true, 1, 7 }, // Ring closed inside one island
+    };
+    for (const Step& step : steps) {
+        HECS_CHECK(model.set_branch_closed(step.line, step.closed));
+        HECS_CHECK(model.branch_closed(step.line) == step.closed);
+        HECS_CHECK(model.island_count() == step.islands);
+        HECS_CHECK(model.energized_bus_count() == step.energized);
+        check_matches_rebuild(grid, model);
+    }
+    HECS_CHECK(model.factorizations() == 1);
+    HECS_CHECK(model.partial_refactorizations() == std::size(steps));
+}
+
+// Source E = 100 kV phase behind Zs = j10 Ohm at B0, line L1 (2 + j20 Ohm,
+// 20 km) to B1 and an unloaded spur L2 to B2. Every fault current is E over
+// the series impedance to the fault, and the relay on L1 sees all of it.
+HECS_TEST(fault_currents_match_hand_calculation)
+{
+    using C = std::complex<double>;
+    Registry registry;
+    Entity buses[3];
+    for (Entity& bus : buses) {
+        bus = registry.create();
+        registry.emplace<BusComponent>(bus, 173.2);
+    }
+    const Entity l1 = registry.create();
+    registry.emplace<BranchComponent>(l1, buses[0], buses[1], C(2.0, 20.0), 20.0);
+    const Entity l2 = registry.create();
+    registry.emplace<BranchComponent>(l2, buses[1], buses[2], C(1.0, 8.0), 8.0);
+    const C zs(0.0, 10.0);
+    const C z_line(2.0, 20.0);
+    const double e_kV = 100.0;
+    registry.emplace<SourceComponent>(registry.create(), buses[0], e_kV * std::sqrt(3.0), zs);
+    NetworkModel model(registry);
+    HECS_CHECK(model.build());
+
+    struct Case {
+        bool on_line;
+        double distance_km;
+        C fault_impedance_Ohm;
+        C path_Ohm; // Source to fault, without the fault impedance
+    };
+    const Case cases[] = {
+        { false, 0.0, {}, zs + z_line }, // Bolted at B1
+        { false, 0.0, { 5.0, 0.0 }, zs + z_line }, // 5 Ohm at B1
+        { true, 10.0, {}, zs + 0.5 * z_line }, // Bolted at mid-line
+        { true, 10.0, { 5.0, 0.0 }, zs + 0.5 * z_line }, // 5 Ohm at mid-line
+        { true, 5.0, {}, zs + 0.25 * z_line }, // Bolted 5 km out
+    };
+    for (const Case& c : cases) {
+        const NetworkFaultResult& result = c.on_line ? model.fault_on_branch(l1, c.distance_km, c.fault_impedance_Ohm)
+                                                     : model.fault_at_bus(buses[1], c.fault_impedance_Ohm);
+        const C expected = e_kV / (c.path_Ohm + c.fault_impedance_Ohm);
+        HECS_CHECK(std::abs(result.fault_current_kA - expected) < 1e-9);
+        HECS_CHECK(std::abs(result.thevenin_impedance_Ohm - c.path_Ohm) < 1e-9);
+        HECS_CHECK(std::abs(result.bus_voltage_kV[0] - (e_kV - zs * expected)) < 1e-9);
+
+        // Relay on L1 at B0: the whole fault current, and the impedance of
+        // the line section plus the fault impedance; nothing flows in L2.
+        FaultInfo view;
+        HECS_CHECK(model.relay_view(result, l1, view));
+        HECS_CHECK_NEAR(view.current_kA, std::abs(expected), 1e-9);
+        HECS_CHECK_NEAR(view.voltage_kV, std::sqrt(3.0) * std::abs(e_kV - zs * expected), 1e-9);
+        HECS_CHECK_NEAR(view.impedance_Ohm, std::abs(c.path_Ohm - zs + c.fault_impedance_Ohm), 1e-9);
+        HECS_CHECK(model.relay_view(result, l2, view));
+        HECS_CHECK(view.current_kA == 0.0);
+    }
+
+    // At the source bus the line carries nothing and the source alone limits
+    // the current.
+    const NetworkFaultResult& at_source = model.fault_at_bus(buses[0]);
+    HECS_CHECK(std::abs(at_source.fault_current_kA - e_kV / zs) < 1e-9);
+    FaultInfo view;
+    HECS_CHECK(model.relay_view(at_source, l1, view));
+    HECS_CHECK(view.current_kA == 0.0);
+}
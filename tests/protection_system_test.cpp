@@ -0,0 +1,79 @@
+// protection_system_test.cpp
+#include "fault_sweep.h"
+#include "protection_system.h"
+#include "test_support.h"
+#include <vector>
+
+// Outside every zone the scalar and the batch path both report kNoTripDelayMs.
+HECS_TEST(distance_out_of_zone_reports_no_trip)
+{
+    DistanceProtection relay(5.0, 0, 10.0, 300, 20.0, 600);
+    const Entity self = 7;
+    const std::vector<double> impedance_Ohm = { 2.0, 8.0, 15.0, 25.0 };
+    const std::vector<int> expected_ms = { 0, 300, 600, kNoTripDelayMs };
+    for (std::size_t i = 0; i < impedance_Ohm.size(); ++i) {
+        FaultInfo fault;
+        fault.impedance_Ohm = impedance_Ohm[i];
+        fault.faulty_entity_id = self;
+        HECS_CHECK(relay.trip_delay_ms(fault) == expected_ms[i]);
+    }
+
+    const std::size_t n = impedance_Ohm.size();
+    std::vector<double> unused(n, 0.0);
+    std::vector<Entity> faulty(n, self);
+    FaultCaseSpan cases { n, unused.data(), unused.data(), impedance_Ohm.data(), unused.data(), faulty.data() };
+    std::vector<int> delay_ms(n);
+    std::vector<double> margin(n);
+    relay.evaluate_cases(cases, self, delay_ms.data(), margin.data());
+    HECS_CHECK(delay_ms == expected_ms);
+}
+
+// The batch sweep finds the same first relay and trip time per case as the
+// scalar pick_up/trip_delay_ms, whatever the block size and thread count.
+HECS_TEST(fault_sweep_matches_scalar_relays)
+{
+    ProtectionRelayPools pools;
+    const Entity line1 = 1, line2 = 2;
+    pools.emplace<OverCurrentProtection>(line1, 15.0, 400, "OC-definite");
+    pools.emplace<OverCurrentProtection>(line1, 12.0, OvercurrentCurve::IecStandardInverse, 0.2, "OC-inverse");
+    pools.emplace<DistanceProtection>(line1, 2.0, 0, 4.0, 300, 6.0, 600);
+    pools.emplace<OverCurrentProtection>(line2, 10.0, OvercurrentCurve::IeeeVeryInverse, 1.0, "OC-inverse");
+    pools.emplace<DistanceProtection>(line2, 1.5, 0, 3.0, 300, 4.5, 600);
+
+    FaultSweepGrid grid;
+    grid.locations_per_element = 40;
+    grid.prefault_voltage_pu = { 0.9, 1.0, 1.1 };
+    grid.ground_fault_resistance_Ohm = 2.0;
+    const std::vector<FaultSweepElement> elements = {
+        { line1, 20.0, 0.4, 1.0, 110.0 },
+        { line2, 15.0, 0.4, 4.0, 110.0 },
+    };
+    const FaultCaseTable cases = build_fault_cases(elements, grid);
+    HECS_CHECK(cases.size() == 2 * 40 * 3 * 3);
+
+    for (std::size_t threads : { std::size_t { 1 }, std::size_t { 3 } }) {
+        FaultSweepEngine engine(pools, threads, 64);
+        const FaultSweepResults results = engine.run(cases);
+        std::size_t cleared = 0;
+        for (std::size_t i = 0; i < cases.size(); ++i) {
+            const FaultInfo fault = cases.span(i, i + 1).info(0);
+            std::int32_t first = -1;
+            int first_ms = kNoTripDelayMs;
+            for (std::size_t r = 0; r < pools.size(); ++r) {
+                int delay_ms = kNoTripDelayMs;
+                pools.visit(r, [&](auto& relay, Entity entity) {
+                    if (relay.pick_up(fault, entity))
+                        delay_ms = relay.trip_delay_ms(fault);
+                });
+                if (delay_ms < first_ms) {
+                    first_ms = delay_ms;
+                    first = static_cast<std::int32_t>(r);
+                }
+            }
+            cleared += first >= 0;
+            HECS_CHECK(results.first_relay[i] == first);
+            HECS_CHECK(results.first_trip_ms[i] == first_ms);
+        }
+        HECS_CHECK(cleared > 0 && cleared < cases.size());
+    }
+}
@@ -0,0 +1,155 @@
+// relay_reach_index_test.cpp
+#include "network_model.h"
+#include "relay_reach_index.h"
+#include "test_support.h"
+#include <algorithm>
+#include <complex>
+#include <limits>
+#include <queue>
+#include <random>
+#include <vector>
+
+namespace {
+
+struct Branch {
+    Entity entity;
+    int from, to;
+    double z_Ohm;
+    bool closed = true;
+};
+
+// 6x6 meshed grid with random line lengths and one relay per branch.
+struct ReachGrid {
+    Registry registry;
+    std::vector<Entity> buses;
+    std::vector<Branch> branches;
+    std::vector<RelayReach> relays;
+
+    ReachGrid()
+    {
+        constexpr int side = 6;
+        std::mt19937 rng(5);
+        std::uniform_real_distribution<double> length_km(2.0, 20.0);
+        for (int b = 0; b < side * side; ++b) {
+            buses.push_back(registry.create());
+            registry.emplace<BusComponent>(buses.back(), 110.0);
+        }
+        auto connect = [&](int a, int b) {
+            const double km = length_km(rng);
+            const std::complex<double> z = std::complex<double>(0.1, 0.4) * km;
+            branches.push_back({ registry.create(), a, b, std::abs(z) });
+            registry.emplace<BranchComponent>(branches.back().entity, buses[a], buses[b], z, km);
+            relays.push_back({ branches.back().entity, std::abs(z) * (0.5 + length_km(rng) / 10.0) });
+        };
+        for (int y = 0; y < side; ++y)
+            for (int x = 0; x < side; ++x) {
+                if (x + 1 < side)
+                    connect(y * side + x, y * side + x + 1);
+                if (y + 1 < side)
+                    connect(y * side + x, (y + 1) * side + x);
+            }
+        registry.emplace<SourceComponent>(registry.create(), buses[0], 115.0, std::complex<double>(0.5, 6.0));
+        // Unbounded reach, and a relay on an entity outside the model: both
+        // candidates for every fault.
+        relays.push_back({ branches[7].entity, std::numeric_limits<double>::infinity() });
+        relays.push_back({ registry.create(), 10.0 });
+    }
+
+    // Bus indices within `radius` of `bus` over closed branches (Dijkstra).
+    std::vector<char> within(int bus, double radius) const
+    {
+        std::vector<double> distance(buses.size(), std::numeric_limits<double>::infinity());
+        using Item = std::pair<double, int>;
+        std::priority_queue<Item, std::vector<Item>, std::greater<Item>> queue;
+        distance[bus] = 0.0;
+        queue.push({ 0.0, bus });
+        while (!queue.empty()) {
+            auto [d, b] = queue.top();
+            queue.pop();
+            if (d > distance[b])
+                continue;
+            for (const Branch& branch : branches) {
+                if (!branch.closed || (branch.from != b && branch.to != b))
+                    continue;
+                const int other = branch.from == b ? branch.to : branch.from;
+                if (d + branch.z_Ohm < distance[other]) {
+                    distance[other] = d + branch.z_Ohm;
+                    queue.push({ distance[other], other });
+                }
+            }
+        }
+        std::vector<char> covered(buses.size());
+        for (std::size_t b = 0; b < buses.size(); ++b)
+            covered[b] = distance[b] <= radius;
+        return covered;
+    }
+
+    // Brute-force candidates of every bus and every branch, in that order.
+    std::vector<std::vector<std::size_t>> expected(double margin) const
+    {
+        std::vector<std::vector<std::size_t>> by_element(buses.size() + branches.size());
+        for (std::size_t r = 0; r < relays.size(); ++r) {
+            auto on = std::find_if(branches.begin(), branches.end(), [&](const Branch& b) { return b.entity == relays[r].entity; });
+            std::vector<char> covered(buses.size(), 1);
+            if (on != branches.end() && relays[r].reach_Ohm != std::numeric_limits<double>::infinity())
+                covered = within(on->from, relays[r].reach_Ohm * margin);
+            for (std::size_t b = 0; b < buses.size(); ++b)
+                if (covered[b])
+                    by_element[b].push_back(r);
+            for (std::size_t k = 0; k < branches.size(); ++k)
+                if (covered[branches[k].from] || covered[branches[k].to])
+                    by_element[buses.size() + k].push_back(r);
+        }
+        return by_element;
+    }
+
+    void check(const RelayReachIndex& index) const
+    {
+        const auto by_element = expected(index.reach_margin);
+        std::vector<std::size_t> candidates;
+        bool all_match = true;
+        for (std::size_t e = 0; e < by_element.size(); ++e) {
+            const Entity element = e < buses.size() ? buses[e] : branches[e - buses.size()].entity;
+            all_match &= index.candidates(element, candidates) && candidates == by_element[e];
+        }
+        HECS_CHECK(all_match);
+    }
+};
+
+} // namespace
+
+// Candidates match a brute-force shortest-path search after the build, a
+// branch opening and closing, and a settings change.
+HECS_TEST(reach_index_matches_brute_force)
+{
+    ReachGrid grid;
+    NetworkModel network(grid.registry);
+    HECS_CHECK(network.build());
+    RelayReachIndex index(network);
+    index.build(grid.relays);
+    HECS_CHECK(index.relay_count() == grid.relays.size());
+    grid.check(index);
+
+    // A relay far from a corner bus does not see faults there.
+    std::vector<std::size_t> candidates;
+    HECS_CHECK(index.candidates(grid.buses.back(), candidates));
+    HECS_CHECK(candidates.size() < grid.relays.size() / 2);
+    HECS_CHECK(!index.candidates(grid.registry.create(), candidates));
+
+    Branch& opened = grid.branches[12];
+    HECS_CHECK(network.set_branch_closed(opened.entity, false));
+    opened.closed = false;
+    index.branch_switched(opened.entity);
+    HECS_CHECK(index.last_updated_relays() < grid.relays.size());
+    grid.check(index);
+
+    HECS_CHECK(network.set_branch_closed(opened.entity, true));
+    opened.closed = true;
+    index.branch_switched(opened.entity);
+    grid.check(index);
+
+    grid.relays[3].reach_Ohm *= 4.0;
+    index.relay_changed(3, grid.relays[3].reach_Ohm);
+    HECS_CHECK(index.last_updated_relays() == 1);
+    grid.check(index);
+}
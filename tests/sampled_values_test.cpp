@@ -0,0 +1,65 @@
+// sampled_values_test.cpp
+#include "sampled_values.h"
+#include "test_support.h"
+#include <cmath>
+#include <complex>
+#include <numbers>
+#include <vector>
+
+namespace {
+
+// Frames of a balanced three-phase set (RMS `rms`, phase A at `angle_rad`)
+// on channels 0-2, sampled at `samples_per_cycle` of the nominal frequency.
+std::vector<float> three_phase_frames(std::size_t frames, std::size_t first, std::size_t samples_per_cycle, double rms, double angle_rad)
+{
+    std::vector<float> block(frames * 3);
+    const double step = 2.0 * std::numbers::pi / static_cast<double>(samples_per_cycle);
+    for (std::size_t f = 0; f < frames; ++f)
+        for (std::size_t ch = 0; ch < 3; ++ch)
+            block[f * 3 + ch] = static_cast<float>(std::sqrt(2.0) * rms * std::cos(step * static_cast<double>(first + f) + angle_rad - 2.0 * std::numbers::pi / 3.0 * ch));
+    return block;
+}
+
+} // namespace
+
+// A steady signal reads its RMS value and phase once a cycle has been seen,
+// keeps reading them over a long stream, and follows a step within one cycle.
+HECS_TEST(phasor_estimator_tracks_steady_and_step_signals)
+{
+    constexpr std::size_t kSamplesPerCycle = 80; // 4 kHz at 50 Hz
+    PhasorEstimator estimator(3, kSamplesPerCycle);
+    std::size_t n = 0;
+    auto push = [&](std::size_t frames, double rms, double angle_rad) {
+        estimator.push(three_phase_frames(frames, n, kSamplesPerCycle, rms, angle_rad));
+        n += frames;
+    };
+
+    push(kSamplesPerCycle - 1, 10.0, 0.3);
+    HECS_CHECK(!estimator.settled());
+    push(1, 10.0, 0.3);
+    HECS_CHECK(estimator.settled());
+    const std::complex<float> a = estimator.phasor(0);
+    HECS_CHECK_NEAR(std::abs(a), 10.0, 1e-4);
+    // Phases B and C lag A by 120 and 240 degrees.
+    HECS_CHECK_NEAR(std::arg(estimator.phasor(1) / a), -2.0 * std::numbers::pi / 3.0, 1e-5);
+    HECS_CHECK_NEAR(std::arg(estimator.phasor(2) / a), 2.0 * std::numbers::pi / 3.0, 1e-5);
+
+    // Thousands of cycles later (the sliding sums recomputed many times over)
+    // the phasor is the same, mid-cycle included.
+    push(kSamplesPerCycle * 5000 + 17, 10.0, 0.3);
+    HECS_CHECK_NEAR(std::abs(estimator.phasor(0) - a), 0.0, 1e-3);
+    std::vector<float> rms(3);
+    estimator.magnitudes(rms);
+    for (float value : rms)
+        HECS_CHECK_NEAR(value, 10.0, 1e-3);
+
+    // A step to 25 RMS: in between during the cycle, exact after it.
+    push(kSamplesPerCycle / 2, 25.0, 0.3);
+    HECS_CHECK(std::abs(estimator.phasor(0)) > 10.5 && std::abs(estimator.phasor(0)) < 24.5);
+    push(kSamplesPerCycle / 2, 25.0, 0.3);
+    HECS_CHECK_NEAR(std::abs(estimator.phasor(0)), 25.0, 1e-3);
+
+    estimator.reset();
+    HECS_CHECK(!estimator.settled());
+    HECS_CHECK(estimator.samples_seen() == 0);
+}
@@ -0,0 +1,184 @@
+// signal_recorder_test.cpp
+#include "signal_recorder.h"
+#include "test_support.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+using Points = std::vector<std::pair<double, double>>;
+
+SignalSettings settings(SignalCompression compression, double deviation, double snapshot_interval_s)
+{
+    SignalSettings s;
+    s.compression = compression;
+    s.deviation = deviation;
+    s.snapshot_interval_s = snapshot_interval_s;
+    return s;
+}
+
+// Value of the linear reconstruction through the archived points at time_s.
+double interpolate(const Points& points, double time_s)
+{
+    auto after = std::lower_bound(points.begin(), points.end(), time_s, [](const auto& p, double t) { return p.first < t; });
+    if (after == points.end())
+        return points.back().second;
+    if (after == points.begin() || after->first == time_s)
+        return after->second;
+    auto before = after - 1;
+    return before->second + (after->second - before->second) * (time_s - before->first) / (after->first - before->first);
+}
+
+} // namespace
+
+// Deadband keeps a sample only when it leaves the band around the last kept
+// value, so the held value never misses a sample by more than the deviation.
+HECS_TEST(signal_deadband_keeps_band_crossings)
+{
+    double value = 0.0;
+    SignalRecorder recorder(64);
+    HECS_CHECK(recorder.subscribe({ 7 }, { &value }, "power_kW", settings(SignalCompression::Deadband, 0.5, 1000.0)) == 1);
+    const double samples[] = { 0.0, 0.2, 0.6, 0.7, 1.2, 1.1, 0.5, 0.5 };
+    for (std::size_t k = 0; k < std::size(samples); ++k) {
+        value = samples[k];
+        recorder.sample(static_cast<double>(k));
+    }
+    const Points kept = recorder.recent_points(0);
+    const Points expected = { { 0.0, 0.0 }, { 2.0, 0.6f }, { 4.0, 1.2f }, { 6.0, 0.5 } };
+    HECS_CHECK(kept == expected);
+    HECS_CHECK(recorder.samples_seen() == std::size(samples));
+    HECS_CHECK(recorder.points_archived() == expected.size());
+    HECS_CHECK(recorder.signal_entity(0) == 7 && recorder.signal_field(0) == "power_kW");
+
+    std::size_t held = 0;
+    for (std::size_t k = 0; k < std::size(samples); ++k) {
+        while (held + 1 < kept.size() && kept[held + 1].first <= static_cast<double>(k))
+            ++held;
+        HECS_CHECK(std::abs(kept[held].second - samples[k]) <= 0.5 + 1e-6);
+    }
+}
+
+// Swinging door on a sine: the straight lines between kept points stay
+// within the deviation of every sample, with far fewer points than samples.
+// A ramp needs only its two ends.
+HECS_TEST(signal_swinging_door_error_bound)
+{
+    const double deviation = 0.01;
+    double sine = 0.0;
+    double ramp = 0.0;
+    SignalRecorder recorder(4096);
+    recorder.subscribe({ 1 }, { &sine }, "sine", settings(SignalCompression::SwingingDoor, deviation, 1000.0));
+    recorder.subscribe({ 2 }, { &ramp }, "ramp", settings(SignalCompression::SwingingDoor, deviation, 1000.0));
+    std::vector<std::pair<double, double>> truth;
+    for (int k = 0; k <= 400; ++k) {
+        const double t = 0.05 * k;
+        sine = std::sin(t);
+        ramp = 2.0 * t - 3.0;
+        truth.emplace_back(t, sine);
+        recorder.sample(t);
+    }
+    recorder.flush();
+
+    const Points kept = recorder.recent_points(0);
+    HECS_CHECK(kept.front().first == 0.0 && kept.back().first == truth.back().first);
+    HECS_CHECK(kept.size() < truth.size() / 4);
+    double worst = 0.0;
+    for (const auto& [t, v] : truth)
+        worst = std::max(worst, std::abs(interpolate(kept, t) - v));
+    HECS_CHECK(worst <= deviation + 1e-6); // Points are stored as float32
+
+    const Points ramp_points = recorder.recent_points(1);
+    HECS_CHECK(ramp_points.size() == 2);
+    HECS_CHECK(ramp_points.size() == 2 && ramp_points[0] == Points::value_type(0.0, -3.0) && ramp_points[1] == Points::value_type(20.0, 37.0));
+}
+
+// A flat signal is still archived every snapshot interval, with either
+// filter.
+HECS_TEST(signal_snapshot_interval_forces_points)
+{
+    double flat = 4.0;
+    SignalRecorder recorder(64);
+    recorder.subscribe({ 1 }, { &flat }, "deadband", settings(SignalCompression::Deadband, 1.0, 2.0));
+    recorder.subscribe({ 2 }, { &flat }, "door", settings(SignalCompression::SwingingDoor, 1.0, 2.0));
+    for (int k = 0; k <= 20; ++k)
+        recorder.sample(0.5 * k);
+    recorder.flush();
+    for (std::size_t signal = 0; signal < 2; ++signal) {
+        const Points kept = recorder.recent_points(signal);
+        HECS_CHECK(kept.size() == 6);
+        for (std::size_t p = 0; p < kept.size(); ++p)
+            HECS_CHECK(kept[p] == Points::value_type(2.0 * p, 4.0));
+    }
+}
+
+// Full rings spill their older half to the columnar file; at the end every
+// point is in the file in order, next to the signal catalogue. Without a
+// spill file the ring keeps the newest points and counts the rest.
+HECS_TEST(signal_recorder_spills_full_rings)
+{
+    hecs_test::ScratchDirectory dir("hecs_signal_spill");
+    const std::string path = dir.file("signals.hcol");
+    double values[2] = {};
+    const int samples = 50;
+    {
+        SignalRecorder recorder(8);
+        recorder.subscribe({ 11, 12 }, { &values[0], &values[1] }, "power_kW", settings(SignalCompression::Deadband, 0.0, 60.0));
+        HECS_CHECK(recorder.open_spill(path));
+        for (int k = 0; k < samples; ++k) {
+            values[0] = k;
+            values[1] = -0.5 * k;
+            recorder.sample(0.1 * k);
+        }
+        HECS_CHECK(recorder.points_spilled() > 0);
+        HECS_CHECK(recorder.recent_points(0).size() <= 8);
+        recorder.flush();
+        HECS_CHECK(recorder.points_archived() == 2 * samples);
+        HECS_CHECK(recorder.points_spilled() == 2 * samples);
+        HECS_CHECK(recorder.points_overwritten() == 0);
+    }
+
+    ColumnarReader reader;
+    HECS_CHECK(reader.open(path));
+    HECS_CHECK(reader.row_count() == 2 * samples);
+    std::vector<Points> spilled(2);
+    for (std::size_t chunk = 0; chunk < reader.chunk_count(); ++chunk) {
+        for (std::size_t row = 0; row < reader.chunk_rows(chunk); ++row) {
+            const auto signal = static_cast<std::size_t>(reader.value(chunk, 0, row));
+            if (signal < 2)
+                spilled[signal].emplace_back(reader.value(chunk, 1, row), reader.value(chunk, 2, row));
+        }
+    }
+    for (std::size_t signal = 0; signal < 2; ++signal) {
+        HECS_CHECK(spilled[signal].size() == static_cast<std::size_t>(samples));
+        bool in_order = true;
+        for (std::size_t k = 0; k < spilled[signal].size(); ++k) {
+            const double expected = signal == 0 ? static_cast<double>(k) : -0.5 * static_cast<double>(k);
+            in_order = in_order && spilled[signal][k] == Points::value_type(0.1 * static_cast<double>(k), expected);
+        }
+        HECS_CHECK(in_order);
+    }
+
+    std::ifstream catalogue(path + ".signals.csv");
+    const std::string text { std::istreambuf_iterator<char>(catalogue), std::istreambuf_iterator<char>() };
+    HECS_CHECK(text
+        == "SignalId,Entity,Field,Compression,Deviation,SnapshotInterval_s\n"
+           "0,11,power_kW,deadband,0,60\n"
+           "1,12,power_kW,deadband,0,60\n");
+
+    double value = 0.0;
+    SignalRecorder ring_only(8);
+    ring_only.subscribe({ 1 }, { &value }, "v", settings(SignalCompression::Deadband, 0.0, 60.0));
+    for (int k = 0; k < samples; ++k) {
+        value = k;
+        ring_only.sample(k);
+    }
+    HECS_CHECK(ring_only.points_overwritten() == static_cast<std::uint64_t>(samples - 8));
+    const Points newest = ring_only.recent_points(0);
+    HECS_CHECK(newest.size() == 8 && newest.front() == Points::value_type(samples - 8, samples - 8));
+}
@@ -0,0 +1,224 @@
+// signal_statistics_test.cpp
+#include "signal_statistics.h"
+#include "test_support.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <numbers>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+const double kQuantiles[] = { 0.001, 0.01, 0.05, 0.25, 0.5, 0.75, 0.95, 0.99, 0.999 };
+
+// Rank error TDigest documents for quantile q.
+double rank_bound(double q)
+{
+    return 2.0 * std::numbers::pi * std::sqrt(q * (1.0 - q)) / TDigest::kCompression;
+}
+
+// Largest distance between q and the fraction of sorted values at or below
+// the digest's estimate of the q quantile, less the bound for that q; <= 0
+// when every quantile is within its bound.
+double worst_rank_excess(const TDigest& digest, std::vector<double> values)
+{
+    std::sort(values.begin(), values.end());
+    const double n = static_cast<double>(values.size());
+    double worst = -1.0;
+    for (double q : kQuantiles) {
+        const double estimate = digest.quantile(q);
+        // The estimate may fall between two values; any rank in that gap is exact.
+        const double below = static_cast<double>(std::lower_bound(values.begin(), values.end(), estimate) - values.begin()) / n;
+        const double at_or_below = static_cast<double>(std::upper_bound(values.begin(), values.end(), estimate) - values.begin()) / n;
+        const double error = q < below ? below - q : (q > at_or_below ? q - at_or_below : 0.0);
+        worst = std::max(worst, error - rank_bound(q));
+    }
+    return worst;
+}
+
+// 20000 values each from a uniform, a long-tailed and a bimodal source.
+std::vector<std::vector<double>> test_distributions()
+{
+    std::mt19937_64 random(20240611);
+    std::uniform_real_distribution<double> uniform(-50.0, 150.0);
+    std::exponential_distribution<double> exponential(0.1);
+    std::normal_distribution<double> low(10.0, 2.0);
+    std::normal_distribution<double> high(60.0, 5.0);
+    std::vector<std::vector<double>> sets(3);
+    for (int i = 0; i < 20000; ++i) {
+        sets[0].push_back(uniform(random));
+        sets[1].push_back(exponential(random));
+        sets[2].push_back(i % 4 == 0 ? high(random) : low(random));
+    }
+    return sets;
+}
+
+struct Pile : IComponent {
+    double power_kW = 0.0;
+};
+
+} // namespace
+
+// On shuffled, skewed and two-humped data, and on sorted data, every
+// quantile's rank is within the documented bound of the exact one, q = 0 and
+// q = 1 give the exact extremes, the centroid count stays bounded, and
+// digests merged from halves of the data keep the same bound.
+HECS_TEST(tdigest_quantiles_within_documented_error)
+{
+    std::vector<std::vector<double>> sets = test_distributions();
+    std::vector<double> ramp;
+    for (int i = 0; i < 20000; ++i)
+        ramp.push_back(0.5 * i);
+    sets.push_back(ramp);
+
+    for (const std::vector<double>& values : sets) {
+        TDigest whole;
+        TDigest first_half;
+        TDigest second_half;
+        for (std::size_t i = 0; i < values.size(); ++i) {
+            whole.add(values[i]);
+            (i < values.size() / 2 ? first_half : second_half).add(values[i]);
+        }
+        HECS_CHECK(whole.total_weight() == static_cast<double>(values.size()));
+        HECS_CHECK(whole.centroid_count() <= TDigest::kMaxCentroids);
+        HECS_CHECK(whole.quantile(0.0) == *std::min_element(values.begin(), values.end()));
+        HECS_CHECK(whole.quantile(1.0) == *std::max_element(values.begin(), values.end()));
+        HECS_CHECK(worst_rank_excess(whole, values) <= 0.0);
+
+        first_half.merge(second_half);
+        HECS_CHECK(first_half.total_weight() == static_cast<double>(values.size()));
+        HECS_CHECK(worst_rank_excess(first_half, values) <= 0.0);
+    }
+
+    TDigest empty;
+    HECS_CHECK(std::isnan(empty.quantile(0.5)));
+}
+
+// Held-value integration against closed forms: a ramp sampled every second
+// (the last value is not extended past the last sample), a step profile on
+// an irregular grid, and a signal without a scale that stays at 0. Moments,
+// extremes and their times are exact.
+HECS_TEST(signal_statistics_integrates_energy)
+{
+    double ramp_kW = 0.0;
+    double step_kW = 0.0;
+    SignalStatistics statistics;
+    const std::size_t ramp = statistics.add_signal("ramp", std::vector<const double*> { &ramp_kW }, 1.0 / 3600.0);
+    const std::size_t step = statistics.add_signal("step", [&] { return step_kW; }, 1.0 / 3600.0);
+    const std::size_t unscaled = statistics.add_signal("unscaled", std::vector<const double*> { &ramp_kW });
+
+    // Step profile: 100 kW until 900 s, -40 kW until 2700 s, 250 kW to 3600 s.
+    auto step_at = [](double t) { return t < 900.0 ? 100.0 : (t < 2700.0 ? -40.0 : 250.0); };
+    const int n = 3600;
+    for (int k = 0; k <= n; ++k) {
+        // Every second, plus half a second later at every third second.
+        ramp_kW = k;
+        step_kW = step_at(k);
+        statistics.sample(k);
+        if (k < n && k % 3 == 0) {
+            step_kW = step_at(k + 0.5);
+            ramp_kW = k + 0.5;
+            statistics.sample(k + 0.5);
+        }
+    }
+    HECS_CHECK(statistics.samples_seen() == static_cast<std::uint64_t>(n + 1 + 1200));
+
+    // Each ramp sample holds its value until the next: k over every second,
+    // plus 0.25 kW*s for each of the 1200 half-second samples.
+    HECS_CHECK_NEAR(statistics.summary(ramp).integral, (n * (n - 1) / 2.0 + 0.25 * 1200) / 3600.0, 1e-9);
+    HECS_CHECK_NEAR(statistics.summary(step).integral, (100.0 * 900.0 - 40.0 * 1800.0 + 250.0 * 900.0) / 3600.0, 1e-9);
+    HECS_CHECK(statistics.summary(unscaled).integral == 0.0);
+
+    const SignalSummary& summary = statistics.summary(step);
+    HECS_CHECK(summary.min == -40.0 && summary.min_time_s == 900.0);
+    HECS_CHECK(summary.max == 250.0 && summary.max_time_s == 2700.0);
+    const SignalSummary& ramp_summary = statistics.summary(ramp);
+    HECS_CHECK(ramp_summary.moments.count == static_cast<std::uint64_t>(n + 1 + 1200));
+    double sum = 0.0;
+    double sum_squares = 0.0;
+    std::vector<double> values;
+    for (int k = 0; k <= n; ++k) {
+        values.push_back(k);
+        if (k < n && k % 3 == 0)
+            values.push_back(k + 0.5);
+    }
+    for (double v : values)
+        sum += v;
+    const double mean = sum / static_cast<double>(values.size());
+    for (double v : values)
+        sum_squares += (v - mean) * (v - mean);
+    HECS_CHECK_NEAR(ramp_summary.moments.mean, mean, 1e-9);
+    HECS_CHECK_NEAR(ramp_summary.moments.variance(), sum_squares / static_cast<double>(values.size() - 1), 1e-6);
+    HECS_CHECK(ramp_summary.max == n && ramp_summary.max_time_s == n);
+}
+
+// A sum signal reads the total of its members each sample; a group of the
+// members' own signals pools their samples, so its count, moments, extremes,
+// integral and quantiles match those of all member values together.
+HECS_TEST(signal_statistics_sum_and_group_signals)
+{
+    Registry registry;
+    std::vector<Entity> piles;
+    for (int p = 0; p < 3; ++p) {
+        piles.push_back(registry.create());
+        registry.emplace<Pile>(piles.back());
+    }
+    const Entity without_pile = registry.create();
+    std::vector<Entity> members = piles;
+    members.push_back(without_pile);
+
+    SignalStatistics statistics;
+    const std::vector<std::size_t> each = statistics.add_field_signals<Pile>(registry, members, &Pile::power_kW, "power_kW", 1.0 / 3600.0);
+    HECS_CHECK(each.size() == 3);
+    HECS_CHECK(statistics.signal_name(each[1]) == "power_kW#" + std::to_string(piles[1]));
+    const std::size_t total = statistics.add_sum_signal<Pile>(registry, members, &Pile::power_kW, "station_kW", 1.0 / 3600.0);
+    const std::size_t group = statistics.add_group("piles", each);
+    HECS_CHECK(statistics.group_name(group) == "piles" && statistics.group_count() == 1);
+
+    std::mt19937_64 random(7);
+    std::uniform_real_distribution<double> draw(0.0, 22.0);
+    std::vector<double> pooled;
+    std::vector<double> totals;
+    double energy_kWh = 0.0;
+    double previous_total = 0.0;
+    const int samples = 2000;
+    for (int k = 0; k < samples; ++k) {
+        double station = 0.0;
+        for (int p = 0; p < 3; ++p) {
+            // Pile p draws on a scale of p + 1, so the members differ.
+            const double power = draw(random) * (p + 1);
+            registry.get<Pile>(piles[p])->power_kW = power;
+            pooled.push_back(power);
+            station += power;
+        }
+        totals.push_back(station);
+        energy_kWh += previous_total * 10.0 / 3600.0;
+        previous_total = station;
+        statistics.sample(10.0 * k);
+    }
+
+    const SignalSummary& sum = statistics.summary(total);
+    HECS_CHECK(sum.moments.count == static_cast<std::uint64_t>(samples));
+    HECS_CHECK(sum.min == *std::min_element(totals.begin(), totals.end()));
+    HECS_CHECK(sum.max == *std::max_element(totals.begin(), totals.end()));
+    HECS_CHECK_NEAR(sum.integral, energy_kWh, 1e-9);
+
+    const SignalSummary merged = statistics.group_summary(group);
+    HECS_CHECK(merged.moments.count == pooled.size());
+    HECS_CHECK(merged.digest.total_weight() == static_cast<double>(pooled.size()));
+    HECS_CHECK(merged.min == *std::min_element(pooled.begin(), pooled.end()));
+    HECS_CHECK(merged.max == *std::max_element(pooled.begin(), pooled.end()));
+    double mean = 0.0;
+    for (double v : pooled)
+        mean += v / static_cast<double>(pooled.size());
+    double m2 = 0.0;
+    for (double v : pooled)
+        m2 += (v - mean) * (v - mean);
+    HECS_CHECK_NEAR(merged.moments.mean, mean, 1e-9);
+    HECS_CHECK_NEAR(merged.moments.variance(), m2 / static_cast<double>(pooled.size() - 1), 1e-6);
+    // Every pile sees the same instants, so the members' energies add up to the station's.
+    HECS_CHECK_NEAR(merged.integral, sum.integral, 1e-9);
+    HECS_CHECK(worst_rank_excess(merged.digest, pooled) <= 0.0);
+}
@@ -0,0 +1,68 @@
+// test_main.cpp
+#include "test_support.h"
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+// Defined by main.cpp in the simulation; the cases install their own.
+cps_coro::Scheduler* g_scheduler = nullptr;
+
+namespace {
+
+struct TestCase {
+    const char* name;
+    hecs_test::TestFn fn;
+};
+
+std::vector<TestCase>& test_cases()
+{
+    static std::vector<TestCase> cases;
+    return cases;
+}
+
+int g_failures = 0;
+
+} // namespace
+
+namespace hecs_test {
+
+bool add(const char* name, TestFn fn)
+{
+    test_cases().push_back({ name, fn });
+    return true;
+}
+
+void fail(const char* file, int line, const char* expression)
+{
+    std::fprintf(stderr, "%s:%d: check failed: %s\n", file, line, expression);
+    ++g_failures;
+}
+
+void fail_near(const char* file, int line, const char* expression, double actual, double expected, double tolerance)
+{
+    std::fprintf(stderr, "%s:%d: check failed: %s = %.9g, expected %.9g +/- %.3g\n", file, line, expression, actual, expected, tolerance);
+    ++g_failures;
+}
+
+} // namespace hecs_test
+
+int main(int argc, char** argv)
+{
+    int run = 0;
+    for (const TestCase& test : test_cases()) {
+        bool selected = argc < 2;
+        for (int i = 1; i < argc; ++i)
+            selected = selected || std::strcmp(argv[i], test.name) == 0;
+        if (!selected)
+            continue;
+        int failures_before = g_failures;
+        test.fn();
+        std::printf("%s %s\n", g_failures == failures_before ? "[  OK  ]" : "[FAILED]", test.name);
+        ++run;
+    }
+    if (run == 0) {
+        std::fprintf(stderr, "No test case matches the arguments.\n");
+        return 2;
+    }
+    return g_failures == 0 ? 0 : 1;
+}
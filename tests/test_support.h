@@ -0,0 +1,74 @@
+// test_support.h
+// Minimal harness for the hecs_tests executable. HECS_TEST(name) defines a
+// case; HECS_CHECK and HECS_CHECK_NEAR record a failure and let the case go
+// on. `hecs_tests <name>` runs one case (one ctest entry each), without
+// arguments every case runs.
+#ifndef TEST_SUPPORT_H
+#define TEST_SUPPORT_H
+
+#include "cps_coro_lib.h"
+#include <cmath>
+#include <filesystem>
+#include <string>
+
+extern cps_coro::Scheduler* g_scheduler;
+
+namespace hecs_test {
+
+using TestFn = void (*)();
+
+bool add(const char* name, TestFn fn);
+void fail(const char* file, int line, const char* expression);
+void fail_near(const char* file, int line, const char* expression, double actual, double expected, double tolerance);
+
+// Installs a fresh scheduler as g_scheduler for the lifetime of a case.
+struct ScopedScheduler {
+    cps_coro::Scheduler scheduler;
+    ScopedScheduler() { g_scheduler = &scheduler; }
+    ~ScopedScheduler() { g_scheduler = nullptr; }
+    ScopedScheduler(const ScopedScheduler&) = delete;
+    ScopedScheduler& operator=(const ScopedScheduler&) = delete;
+
+    void run_for_ms(long long ms) { scheduler.run_until(scheduler.now() + cps_coro::Scheduler::duration(ms)); }
+};
+
+// A directory of its own under the system temp directory, removed with its
+// files at the end of the case.
+struct ScratchDirectory {
+    std::filesystem::path path;
+    explicit ScratchDirectory(const char* name)
+        : path(std::filesystem::temp_directory_path() / name)
+    {
+        std::filesystem::remove_all(path);
+        std::filesystem::create_directories(path);
+    }
+    ~ScratchDirectory()
+    {
+        std::error_code ignored;
+        std::filesystem::remove_all(path, ignored);
+    }
+    std::string file(const char* name) const { return (path / name).string(); }
+};
+
+} // namespace hecs_test
+
+#define HECS_TEST(name) \
+    static void name(); \
+    [[maybe_unused]] static const bool name##_registered = hecs_test::add(#name, &name); \
+    static void name()
+
+#define HECS_CHECK(expression) \
+    do { \
+        if (!(expression)) \
+            hecs_test::fail(__FILE__, __LINE__, #expression); \
+    } while (0)
+
+#define HECS_CHECK_NEAR(actual, expected, tolerance) \
+    do { \
+        const double hecs_actual_ = (actual); \
+        const double hecs_expected_ = (expected); \
+        if (!(std::abs(hecs_actual_ - hecs_expected_) <= (tolerance))) \
+            hecs_test::fail_near(__FILE__, __LINE__, #actual, hecs_actual_, hecs_expected_, (tolerance)); \
+    } while (0)
+
+#endif // TEST_SUPPORT_H
@@ -0,0 +1,164 @@
+// time_series_input_test.cpp
+#include "simulation_events_and_data.h"
+#include "test_support.h"
+#include "time_series_input.h"
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr std::size_t kChannels = 3;
+constexpr std::size_t kSamples = 50;
+constexpr std::int64_t kStart_ms = 1000;
+constexpr std::int64_t kInterval_ms = 200;
+
+float profile_value(std::size_t sample, std::size_t channel)
+{
+    return static_cast<float>(100 * channel) + 0.5f * static_cast<float>(sample);
+}
+
+bool write_test_profile(const std::string& path)
+{
+    return write_profile_file(path, ProfileKind::BusLoad_kW, kChannels, kSamples, kStart_ms, kInterval_ms,
+        [](std::size_t sample, std::span<float> row) {
+            for (std::size_t ch = 0; ch < row.size(); ++ch)
+                row[ch] = profile_value(sample, ch);
+        });
+}
+
+std::vector<char> read_bytes(const std::string& path)
+{
+    std::ifstream in(path, std::ios::binary);
+    return { std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>() };
+}
+
+void write_bytes(const std::string& path, const std::vector<char>& bytes)
+{
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+}
+
+cps_coro::Task collect_rows(std::vector<ProfileSample>& rows)
+{
+    while (true)
+        rows.push_back(co_await cps_coro::wait_for_event<ProfileSample>(LOAD_CHANGE_EVENT));
+}
+
+} // namespace
+
+// A written profile reads back with its header and every value, the row in
+// effect is sample-and-hold and clamped to the file, and playback delivers
+// each row once at its start time.
+HECS_TEST(profile_round_trip)
+{
+    hecs_test::ScratchDirectory dir("hecs_profile_round_trip");
+    const std::string path = dir.file("load.bin");
+    HECS_CHECK(write_test_profile(path));
+
+    TimeSeriesProfile profile;
+    HECS_CHECK(profile.open(path));
+    HECS_CHECK(profile.kind() == ProfileKind::BusLoad_kW);
+    HECS_CHECK(profile.channel_count() == kChannels);
+    HECS_CHECK(profile.sample_count() == kSamples);
+    HECS_CHECK(profile.start_time_ms() == kStart_ms);
+    HECS_CHECK(profile.interval_ms() == kInterval_ms);
+    bool values_match = true;
+    for (std::size_t s = 0; s < kSamples; ++s) {
+        std::span<const float> row = profile.row(s);
+        values_match = values_match && row.size() == kChannels;
+        for (std::size_t ch = 0; ch < row.size(); ++ch)
+            values_match = values_match && row[ch] == profile_value(s, ch);
+    }
+    HECS_CHECK(values_match);
+
+    HECS_CHECK(profile.sample_index_at(0) == 0);
+    HECS_CHECK(profile.sample_index_at(kStart_ms + 7 * kInterval_ms) == 7);
+    HECS_CHECK(profile.sample_index_at(kStart_ms + 8 * kInterval_ms - 1) == 7);
+    HECS_CHECK(profile.sample_index_at(kStart_ms + 1000 * kInterval_ms) == kSamples - 1);
+
+    ProfileCursor cursor(profile);
+    HECS_CHECK(cursor.index() == 0);
+    HECS_CHECK(cursor.next_change_ms() == kStart_ms + kInterval_ms);
+    HECS_CHECK(!cursor.advance_to(kStart_ms + kInterval_ms - 1));
+    HECS_CHECK(cursor.advance_to(kStart_ms + 10 * kInterval_ms));
+    HECS_CHECK(cursor.index() == 10 && cursor.current()[2] == profile_value(10, 2));
+    HECS_CHECK(!cursor.at_end());
+    cursor.advance_to(kStart_ms + kSamples * kInterval_ms);
+    HECS_CHECK(cursor.at_end());
+
+    hecs_test::ScopedScheduler sim;
+    std::vector<ProfileSample> rows;
+    auto collector = collect_rows(rows);
+    auto playback = profilePlaybackTask(profile, LOAD_CHANGE_EVENT);
+    sim.run_for_ms(kStart_ms + (kSamples + 5) * kInterval_ms);
+    HECS_CHECK(playback.is_done());
+    HECS_CHECK(rows.size() == kSamples);
+    for (std::size_t s = 0; s < rows.size(); ++s) {
+        HECS_CHECK(rows[s].sample_index == s);
+        HECS_CHECK_NEAR(rows[s].current_sim_time_seconds, (kStart_ms + s * kInterval_ms) / 1000.0, 1e-9);
+        HECS_CHECK(rows[s].values.data() == profile.row(s).data()); // Zero-copy
+    }
+}
+
+// Files that are missing, truncated or carry an inconsistent header are
+// refused with an error, including counts whose byte size overflows.
+HECS_TEST(profile_rejects_bad_headers)
+{
+    hecs_test::ScratchDirectory dir("hecs_profile_bad_headers");
+    const std::string good_path = dir.file("good.bin");
+    HECS_CHECK(write_test_profile(good_path));
+    const std::vector<char> good = read_bytes(good_path);
+    HECS_CHECK(good.size() == sizeof(ProfileHeader) + kSamples * kChannels * sizeof(float));
+
+    TimeSeriesProfile missing;
+    HECS_CHECK(!missing.open(dir.file("missing.bin")));
+    HECS_CHECK(!missing.error().empty());
+
+    std::vector<char> truncated(good.begin(), good.begin() + sizeof(ProfileHeader) / 2);
+    write_bytes(dir.file("truncated.bin"), truncated);
+    TimeSeriesProfile short_file;
+    HECS_CHECK(!short_file.open(dir.file("truncated.bin")));
+    HECS_CHECK(!short_file.error().empty());
+
+    using Corrupt = void (*)(ProfileHeader&);
+    const Corrupt corruptions[] = {
+        [](ProfileHeader& h) { h.magic[0] = 'X'; },
+        [](ProfileHeader& h) { h.version = 2; },
+        [](ProfileHeader& h) { h.interval_ms = 0; },
+        [](ProfileHeader& h) { h.interval_ms = -200; },
+        [](ProfileHeader& h) { h.sample_count = 0; },
+        [](ProfileHeader& h) { h.sample_count = kSamples + 1; }, // One row past the end
+        [](ProfileHeader& h) { h.channel_count = kChannels + 1; },
+        [](ProfileHeader& h) { h.data_offset = sizeof(ProfileHeader) + 2; }, // Misaligned
+        [](ProfileHeader& h) { h.data_offset = ~std::uint64_t(0) - 3; }, // Past the file
+        // sample_count * channel_count * 4 wraps to 0 in 64 bits
+        [](ProfileHeader& h) {
+            h.sample_count = std::uint64_t(1) << 62;
+            h.channel_count = 1;
+        },
+        [](ProfileHeader& h) {
+            h.sample_count = std::uint64_t(1) << 40;
+            h.channel_count = std::uint64_t(1) << 30;
+        },
+    };
+    int case_index = 0;
+    for (Corrupt corrupt : corruptions) {
+        std::vector<char> bytes = good;
+        ProfileHeader header;
+        std::memcpy(&header, bytes.data(), sizeof(header));
+        corrupt(header);
+        std::memcpy(bytes.data(), &header, sizeof(header));
+        const std::string path = dir.file(("bad" + std::to_string(case_index++) + ".bin").c_str());
+        write_bytes(path, bytes);
+        TimeSeriesProfile profile;
+        HECS_CHECK(!profile.open(path));
+        HECS_CHECK(!profile.error().empty());
+    }
+
+    TimeSeriesProfile profile;
+    HECS_CHECK(profile.open(good_path)); // The untouched file still opens
+}
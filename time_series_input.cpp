@@ -0,0 +1,147 @@
+// time_series_input.cpp
+#include "time_series_input.h"
+#include "simulation_events_and_data.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+extern cps_coro::Scheduler* g_scheduler;
+
+namespace {
+
+constexpr char kProfileMagic[8] = { 'H', 'E', 'C', 'S', 'P', 'R', 'F', '1' };
+constexpr std::uint32_t kProfileVersion = 1;
+
+} // namespace
+
+bool TimeSeriesProfile::open(const std::string& path)
+{
+    if (!file_.open(path, MappedFile::AccessHint::Sequential)) {
+        error_ = file_.error();
+        return false;
+    }
+    if (file_.size() < sizeof(ProfileHeader)) {
+        error_ = "'" + path + "' is too small for a profile header";
+        file_.close();
+        return false;
+    }
+    std::memcpy(&header_, file_.data(), sizeof(ProfileHeader));
+    if (std::memcmp(header_.magic, kProfileMagic, sizeof(kProfileMagic)) != 0 || header_.version != kProfileVersion) {
+        error_ = "'" + path + "' is not a version 1 HECS profile";
+        file_.close();
+        return false;
+    }
+    // Rows must fit behind data_offset; divided rather than multiplied so a
+    // corrupt count cannot overflow the check.
+    const std::uint64_t file_size = file_.size();
+    if (header_.interval_ms <= 0 || header_.sample_count == 0 || header_.data_offset % alignof(float) != 0
+        || header_.data_offset > file_size
+        || (header_.channel_count > 0
+            && (file_size - header_.data_offset) / sizeof(float) / header_.channel_count < header_.sample_count)) {
+        error_ = "'" + path + "' has an inconsistent header";
+        file_.close();
+        return false;
+    }
+    return true;
+}
+
+std::size_t TimeSeriesProfile::sample_index_at(std::int64_t time_ms) const
+{
+    if (time_ms <= header_.start_time_ms)
+        return 0;
+    auto index = static_cast<std::uint64_t>((time_ms - header_.start_time_ms) / header_.interval_ms);
+    return static_cast<std::size_t>(std::min<std::uint64_t>(index, header_.sample_count - 1));
+}
+
+std::span<const float> TimeSeriesProfile::row(std::size_t sample_index) const
+{
+    // open() checks that data_offset keeps rows float-aligned in the page-aligned mapping.
+    auto first = reinterpret_cast<const float*>(file_.data() + row_offset(sample_index));
+    return { first, channel_count() };
+}
+
+ProfileCursor::ProfileCursor(const TimeSeriesProfile& profile, std::size_t prefetch_bytes, std::size_t release_bytes)
+    : profile_(profile)
+    , prefetch_bytes_(prefetch_bytes)
+    , release_bytes_(release_bytes)
+{
+    released_until_ = profile_.row_offset(0);
+    prefetched_until_ = released_until_;
+    advance_to(profile_.start_time_ms());
+}
+
+bool ProfileCursor::advance_to(std::int64_t time_ms)
+{
+    std::size_t next_index = profile_.sample_index_at(time_ms);
+    bool changed = next_index != index_;
+    index_ = next_index;
+
+    std::size_t row_begin = profile_.row_offset(index_);
+    std::size_t row_end = row_begin + profile_.row_bytes();
+    if (prefetched_until_ < row_end + prefetch_bytes_ / 2) {
+        profile_.file().prefetch(std::max(prefetched_until_, row_begin), row_end + prefetch_bytes_ - std::max(prefetched_until_, row_begin));
+        prefetched_until_ = row_end + prefetch_bytes_;
+    }
+    if (row_begin > released_until_ + release_bytes_) {
+        profile_.file().release(released_until_, row_begin - released_until_);
+        released_until_ = row_begin;
+    }
+    return changed;
+}
+
+std::int64_t ProfileCursor::next_change_ms() const
+{
+    return profile_.start_time_ms() + static_cast<std::int64_t>(index_ + 1) * profile_.interval_ms();
+}
+
+bool write_profile_file(const std::string& path,
+    ProfileKind kind,
+    std::size_t channel_count,
+    std::size_t sample_count,
+    std::int64_t start_time_ms,
+    std::int64_t interval_ms,
+    const std::function<void(std::size_t, std::span<float>)>& fill_row)
+{
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out)
+        return false;
+
+    ProfileHeader header {};
+    std::memcpy(header.magic, kProfileMagic, sizeof(kProfileMagic));
+    header.version = kProfileVersion;
+    header.kind = kind;
+    header.channel_count = channel_count;
+    header.sample_count = sample_count;
+    header.start_time_ms = start_time_ms;
+    header.interval_ms = interval_ms;
+    header.data_offset = sizeof(ProfileHeader);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    std::vector<float> row(channel_count);
+    for (std::size_t i = 0; i < sample_count && out; ++i) {
+        std::fill(row.begin(), row.end(), 0.0f);
+        fill_row(i, row);
+        out.write(reinterpret_cast<const char*>(row.data()), static_cast<std::streamsize>(row.size() * sizeof(float)));
+    }
+    return static_cast<bool>(out);
+}
+
+cps_coro::Task profilePlaybackTask(const TimeSeriesProfile& profile, cps_coro::EventId event_id)
+{
+    if (!g_scheduler)
+        co_return;
+    std::int64_t now_ms = g_scheduler->now().time_since_epoch().count();
+    if (now_ms < profile.start_time_ms())
+        co_await cps_coro::delay(cps_coro::Scheduler::duration(profile.start_time_ms() - now_ms));
+
+    ProfileCursor cursor(profile);
+    while (true) {
+        now_ms = g_scheduler->now().time_since_epoch().count();
+        cursor.advance_to(now_ms);
+        g_scheduler->trigger_event(event_id, ProfileSample { now_ms / 1000.0, cursor.index(), cursor.current() });
+        if (cursor.at_end())
+            co_return;
+        co_await cps_coro::delay(cps_coro::Scheduler::duration(cursor.next_change_ms() - now_ms));
+    }
+}
@@ -0,0 +1,106 @@
+// time_series_input.h
+// Streaming time-series inputs (per-bus load, PV irradiance, EV arrivals).
+// Profiles are binary files memory-mapped read-only; a ProfileCursor is
+// advanced with simulated time and hands out the current row as a span that
+// points straight into the mapping.
+//
+// File layout (little-endian):
+//   ProfileHeader (64 bytes)
+//   sample_count rows of channel_count float32 values, row-major by time,
+//   so one row holds every channel (bus) at one instant.
+#ifndef TIME_SERIES_INPUT_H
+#define TIME_SERIES_INPUT_H
+
+#include "cps_coro_lib.h"
+#include "mapped_file.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <string>
+
+enum class ProfileKind : std::uint32_t {
+    BusLoad_kW = 1,
+    PvIrradiance_Wm2 = 2,
+    EvArrivals_per_interval = 3,
+};
+
+struct ProfileHeader {
+    char magic[8]; // "HECSPRF1"
+    std::uint32_t version;
+    ProfileKind kind;
+    std::uint64_t channel_count;
+    std::uint64_t sample_count;
+    std::int64_t start_time_ms; // Simulation time of row 0
+    std::int64_t interval_ms;
+    std::uint64_t data_offset; // Byte offset of row 0
+    std::uint64_t reserved;
+};
+static_assert(sizeof(ProfileHeader) == 64, "ProfileHeader is an on-disk layout");
+
+class TimeSeriesProfile {
+public:
+    bool open(const std::string& path);
+    const std::string& error() const { return error_; }
+
+    ProfileKind kind() const { return header_.kind; }
+    std::size_t channel_count() const { return static_cast<std::size_t>(header_.channel_count); }
+    std::size_t sample_count() const { return static_cast<std::size_t>(header_.sample_count); }
+    std::int64_t start_time_ms() const { return header_.start_time_ms; }
+    std::int64_t interval_ms() const { return header_.interval_ms; }
+
+    // Row that is in effect at time_ms (sample-and-hold; clamped to the file).
+    std::size_t sample_index_at(std::int64_t time_ms) const;
+    std::span<const float> row(std::size_t sample_index) const;
+
+    const MappedFile& file() const { return file_; }
+    std::size_t row_bytes() const { return channel_count() * sizeof(float); }
+    std::size_t row_offset(std::size_t sample_index) const { return static_cast<std::size_t>(header_.data_offset) + sample_index * row_bytes(); }
+
+private:
+    MappedFile file_;
+    ProfileHeader header_ {};
+    std::string error_;
+};
+
+// Sequential reader over a profile. Advancing prefetches the next rows and
+// releases consumed ones, so resident memory stays bounded by the windows
+// rather than the file size.
+class ProfileCursor {
+public:
+    explicit ProfileCursor(const TimeSeriesProfile& profile,
+        std::size_t prefetch_bytes = std::size_t(8) << 20,
+        std::size_t release_bytes = std::size_t(64) << 20);
+
+    // Moves to the row in effect at time_ms. Returns true if the row changed.
+    bool advance_to(std::int64_t time_ms);
+    std::span<const float> current() const { return profile_.row(index_); }
+    std::size_t index() const { return index_; }
+    bool at_end() const { return index_ + 1 >= profile_.sample_count(); }
+    // Simulation time at which the next row takes effect.
+    std::int64_t next_change_ms() const;
+
+private:
+    const TimeSeriesProfile& profile_;
+    std::size_t index_ = 0;
+    std::size_t prefetch_bytes_;
+    std::size_t release_bytes_;
+    std::size_t prefetched_until_ = 0; // Byte offset
+    std::size_t released_until_ = 0; // Byte offset
+};
+
+// Writes a profile row by row; fill_row(sample_index, row) fills one row of
+// channel_count values. Nothing beyond one row is held in memory.
+bool write_profile_file(const std::string& path,
+    ProfileKind kind,
+    std::size_t channel_count,
+    std::size_t sample_count,
+    std::int64_t start_time_ms,
+    std::int64_t interval_ms,
+    const std::function<void(std::size_t, std::span<float>)>& fill_row);
+
+// Follows a profile through simulated time and triggers event_id with a
+// ProfileSample each time a new row takes effect.
+cps_coro::Task profilePlaybackTask(const TimeSeriesProfile& profile, cps_coro::EventId event_id);
+
+#endif // TIME_SERIES_INPUT_H